@@ -31,6 +31,7 @@
 #include "layout.h"
 
 static void bar_pane_comment_changed(GtkTextBuffer *buffer, gpointer data);
+static void bar_pane_comment_notify_cb(FileData *fd, NotifyType type, gpointer data);
 
 /*
  *-------------------------------------------------------------------
@@ -142,8 +143,10 @@ static void bar_pane_comment_set_fd(GtkWidget *bar, FileData *fd)
 	pcd = g_object_get_data(G_OBJECT(bar), "pane_data");
 	if (!pcd) return;
 
+	file_data_unregister_notify_fd_func(pcd->fd, bar_pane_comment_notify_cb, pcd);
 	file_data_unref(pcd->fd);
 	pcd->fd = file_data_ref(fd);
+	file_data_register_notify_fd_func(pcd->fd, bar_pane_comment_notify_cb, pcd);
 
 	bar_pane_comment_update(pcd);
 }
@@ -221,7 +224,7 @@ static void bar_pane_comment_destroy(GtkWidget *widget, gpointer data)
 {
 	PaneCommentData *pcd = data;
 
-	file_data_unregister_notify_func(bar_pane_comment_notify_cb, pcd);
+	file_data_unregister_notify_fd_func(pcd->fd, bar_pane_comment_notify_cb, pcd);
 
 	file_data_unref(pcd->fd);
 	g_free(pcd->key);
@@ -277,9 +280,6 @@ static GtkWidget *bar_pane_comment_new(const gchar *id, const gchar *title, cons
 	g_signal_connect(G_OBJECT(buffer), "changed",
 			 G_CALLBACK(bar_pane_comment_changed), pcd);
 
-
-	file_data_register_notify_func(bar_pane_comment_notify_cb, pcd, NOTIFY_PRIORITY_LOW);
-
 	return pcd->widget;
 }
 
@@ -287,8 +287,10 @@ void bar_pane_exif_set_fd(GtkWidget *widget, FileData *fd)
 	ped = g_object_get_data(G_OBJECT(widget), "pane_data");
 	if (!ped) return;
 
+	file_data_unregister_notify_fd_func(ped->fd, bar_pane_exif_notify_cb, ped);
 	file_data_unref(ped->fd);
 	ped->fd = file_data_ref(fd);
+	file_data_register_notify_fd_func(ped->fd, bar_pane_exif_notify_cb, ped);
 
 	bar_pane_exif_update(ped);
 }
@@ -740,7 +742,7 @@ static void bar_pane_exif_destroy(GtkWidget *widget, gpointer data)
 {
 	PaneExifData *ped = data;
 
-	file_data_unregister_notify_func(bar_pane_exif_notify_cb, ped);
+	file_data_unregister_notify_fd_func(ped->fd, bar_pane_exif_notify_cb, ped);
 	g_object_unref(ped->size_group);
 	file_data_unref(ped->fd);
 	g_free(ped->pane.id);
@@ -803,7 +805,6 @@ static GtkWidget *bar_pane_exif_new(const gchar *id, const gchar *title, gboolea
 	bar_pane_exif_dnd_init(ped->widget);
 	g_signal_connect(ped->widget, "button_release_event", G_CALLBACK(bar_pane_exif_menu_cb), ped);
 
-	file_data_register_notify_func(bar_pane_exif_notify_cb, ped, NOTIFY_PRIORITY_LOW);
 
 	gtk_widget_show(ped->widget);
 
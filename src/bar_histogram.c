@@ -55,6 +55,7 @@ struct _PaneHistogramData
 };
 
 static gboolean bar_pane_histogram_update_cb(gpointer data);
+static void bar_pane_histogram_notify_cb(FileData *fd, NotifyType type, gpointer data);
 
 
 static void bar_pane_histogram_update(PaneHistogramData *phd)
@@ -116,8 +117,10 @@ static void bar_pane_histogram_set_fd(GtkWidget *pane, FileData *fd)
 	phd = g_object_get_data(G_OBJECT(pane), "pane_data");
 	if (!phd) return;
 
+	file_data_unregister_notify_fd_func(phd->fd, bar_pane_histogram_notify_cb, phd);
 	file_data_unref(phd->fd);
 	phd->fd = file_data_ref(fd);
+	file_data_register_notify_fd_func(phd->fd, bar_pane_histogram_notify_cb, phd);
 
 	bar_pane_histogram_update(phd);
 }
@@ -203,7 +206,7 @@ static void bar_pane_histogram_destroy(GtkWidget *widget, gpointer data)
 	PaneHistogramData *phd = data;
 
 	if (phd->idle_id) g_source_remove(phd->idle_id);
-	file_data_unregister_notify_func(bar_pane_histogram_notify_cb, phd);
+	file_data_unregister_notify_fd_func(phd->fd, bar_pane_histogram_notify_cb, phd);
 
 	file_data_unref(phd->fd);
 	histogram_free(phd->histogram);
@@ -333,8 +336,6 @@ static GtkWidget *bar_pane_histogram_new(const gchar *id, const gchar *title, gi
 
 	gtk_widget_show(phd->widget);
 
-	file_data_register_notify_func(bar_pane_histogram_notify_cb, phd, NOTIFY_PRIORITY_LOW);
-
 	return phd->widget;
 }
 
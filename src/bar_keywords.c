@@ -41,6 +41,7 @@
 
 //static void bar_pane_keywords_keyword_update_all(void);
 static void bar_pane_keywords_changed(GtkTextBuffer *buffer, gpointer data);
+static void bar_pane_keywords_notify_cb(FileData *fd, NotifyType type, gpointer data);
 
 /*
  *-------------------------------------------------------------------
@@ -243,8 +244,10 @@ void bar_pane_keywords_set_fd(GtkWidget *pane, FileData *fd)
 	pkd = g_object_get_data(G_OBJECT(pane), "pane_data");
 	if (!pkd) return;
 
+	file_data_unregister_notify_fd_func(pkd->fd, bar_pane_keywords_notify_cb, pkd);
 	file_data_unref(pkd->fd);
 	pkd->fd = file_data_ref(fd);
+	file_data_register_notify_fd_func(pkd->fd, bar_pane_keywords_notify_cb, pkd);
 
 	bar_pane_keywords_update(pkd);
 }
@@ -1386,7 +1389,7 @@ static void bar_pane_keywords_destroy(GtkWidget *widget, gpointer data)
 	string_list_free(pkd->expanded_rows);
 	if (pkd->click_tpath) gtk_tree_path_free(pkd->click_tpath);
 	if (pkd->idle_id) g_source_remove(pkd->idle_id);
-	file_data_unregister_notify_func(bar_pane_keywords_notify_cb, pkd);
+	file_data_unregister_notify_fd_func(pkd->fd, bar_pane_keywords_notify_cb, pkd);
 
 	file_data_unref(pkd->fd);
 	g_free(pkd->key);
@@ -1541,8 +1544,6 @@ static GtkWidget *bar_pane_keywords_new(const gchar *id, const gchar *title, con
 	gtk_container_add(GTK_CONTAINER(scrolled), pkd->keyword_treeview);
 	gtk_widget_show(pkd->keyword_treeview);
 
-	file_data_register_notify_func(bar_pane_keywords_notify_cb, pkd, NOTIFY_PRIORITY_LOW);
-
 	return pkd->widget;
 }
 
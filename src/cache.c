@@ -36,6 +36,15 @@
  * Cache data file format:
  *-------------------------------------------------------------------
  *
+ * A CacheSimHeader followed by one CacheSimRecord, as written in memory.
+ * The byte order field is compared on load, a file of another version or
+ * byte order is treated as missing and written again.
+ *
+ * The similarity grid is stored as three planes of 32 x 32 bytes
+ * (red, green, blue), the layout of ImageSimilarityData.
+ *
+ * Files of the previous text format are still read:
+ *
  * SIMcache
  * #comment
  * Dimensions=[<width> x <height>]
@@ -43,14 +52,84 @@
  * MD5sum=[<32 character ascii text digest>]
  * SimilarityGrid[32 x 32]=<3072 bytes of data (1024 pixels in RGB format, 1 pixel is 24bits)>
  *
- *
  * The first line (9 bytes) indicates it is a SIMcache format file. (new line char must exist)
  * Comment lines starting with a # are ignored up to a new line.
  * All data lines should end with a new line char.
  * Format is very strict, data must begin with the char immediately following '='.
  * Currently SimilarityGrid is always assumed to be 32 x 32 RGB.
+ *
+ *-------------------------------------------------------------------
+ * Sim pack format:
+ *-------------------------------------------------------------------
+ *
+ * One GQ_CACHE_SIM_PACK file per cache folder holds the records of all
+ * sim files of that folder, so that a folder is mapped once instead of
+ * opening a file per image. It is a CacheSimPackHeader, count entries
+ * sorted by name and the nul terminated names. The pack is only a copy,
+ * it is rebuilt by a thread when the cache folder is newer, and each entry keeps the
+ * mtime of its image to be checked on lookup.
  */
 
+#define CACHE_SIM_MAGIC "GQsimbin"
+#define CACHE_SIM_PACK_MAGIC "GQsimpak"
+#define CACHE_SIM_VERSION 1
+#define CACHE_SIM_BYTE_ORDER 0x01020304
+
+#define CACHE_SIM_HAVE_DIMENSIONS	(1 << 0)
+#define CACHE_SIM_HAVE_DATE		(1 << 1)
+#define CACHE_SIM_HAVE_MD5SUM		(1 << 2)
+#define CACHE_SIM_HAVE_SIMILARITY	(1 << 3)
+
+typedef struct _CacheSimHeader CacheSimHeader;
+struct _CacheSimHeader
+{
+	gchar magic[8];
+	guint32 version;
+	guint32 byte_order;
+};
+
+typedef struct _CacheSimRecord CacheSimRecord;
+struct _CacheSimRecord
+{
+	guint32 flags;		/* CACHE_SIM_HAVE_* */
+	gint32 width;
+	gint32 height;
+	guint32 reserved;
+	gint64 date;
+	guchar md5sum[16];
+	guint8 avg_r[1024];
+	guint8 avg_g[1024];
+	guint8 avg_b[1024];
+};
+
+typedef struct _CacheSimPackHeader CacheSimPackHeader;
+struct _CacheSimPackHeader
+{
+	gchar magic[8];
+	guint32 version;
+	guint32 byte_order;
+	guint32 count;
+	guint32 names_size;
+};
+
+typedef struct _CacheSimPackEntry CacheSimPackEntry;
+struct _CacheSimPackEntry
+{
+	gint64 mtime;		/* of the image */
+	guint32 name_offset;
+	guint32 reserved;
+	CacheSimRecord record;
+};
+
+struct _CacheSimPack
+{
+	gchar *dir;		/* cache folder */
+	GMappedFile *mapped;
+	const CacheSimPackHeader *header;
+	const CacheSimPackEntry *entries;
+	const gchar *names;
+};
+
 
 /*
  *-------------------------------------------------------------------
@@ -77,77 +156,81 @@ void cache_sim_data_free(CacheData *cd)
 	g_free(cd);
 }
 
-/*
- *-------------------------------------------------------------------
- * sim cache write
- *-------------------------------------------------------------------
- */
-
-static gboolean cache_sim_write_dimensions(SecureSaveInfo *ssi, CacheData *cd)
-{
-	if (!cd || !cd->dimensions) return FALSE;
-
-	secure_fprintf(ssi, "Dimensions=[%d x %d]\n", cd->width, cd->height);
-
-	return TRUE;
-}
-
-static gboolean cache_sim_write_date(SecureSaveInfo *ssi, CacheData *cd)
+static void cache_sim_record_from_data(CacheSimRecord *rec, CacheData *cd)
 {
-	if (!cd || !cd->have_date) return FALSE;
+	memset(rec, 0, sizeof(CacheSimRecord));
 
-	secure_fprintf(ssi, "Date=[%ld]\n", cd->date);
-
-	return TRUE;
-}
-
-static gboolean cache_sim_write_md5sum(SecureSaveInfo *ssi, CacheData *cd)
-{
-	gchar *text;
-
-	if (!cd || !cd->have_md5sum) return FALSE;
-
-	text = md5_digest_to_text(cd->md5sum);
-	secure_fprintf(ssi, "MD5sum=[%s]\n", text);
-	g_free(text);
-
-	return TRUE;
+	if (cd->dimensions)
+		{
+		rec->flags |= CACHE_SIM_HAVE_DIMENSIONS;
+		rec->width = cd->width;
+		rec->height = cd->height;
+		}
+	if (cd->have_date)
+		{
+		rec->flags |= CACHE_SIM_HAVE_DATE;
+		rec->date = cd->date;
+		}
+	if (cd->have_md5sum)
+		{
+		rec->flags |= CACHE_SIM_HAVE_MD5SUM;
+		memcpy(rec->md5sum, cd->md5sum, sizeof(rec->md5sum));
+		}
+	if (cd->similarity && cd->sim && cd->sim->filled)
+		{
+		rec->flags |= CACHE_SIM_HAVE_SIMILARITY;
+		memcpy(rec->avg_r, cd->sim->avg_r, sizeof(rec->avg_r));
+		memcpy(rec->avg_g, cd->sim->avg_g, sizeof(rec->avg_g));
+		memcpy(rec->avg_b, cd->sim->avg_b, sizeof(rec->avg_b));
+		}
 }
 
-static gboolean cache_sim_write_similarity(SecureSaveInfo *ssi, CacheData *cd)
+static void cache_sim_record_to_data(const CacheSimRecord *rec, CacheData *cd)
 {
-	guint x, y;
-	guint8 buf[3 * 32];
-
-	if (!cd || !cd->similarity || !cd->sim || !cd->sim->filled) return FALSE;
-
-	secure_fprintf(ssi, "SimilarityGrid[32 x 32]=");
-	for (y = 0; y < 32; y++)
+	if (rec->flags & CACHE_SIM_HAVE_DIMENSIONS)
 		{
-		guint s = y * 32;
-		guint8 *avg_r = &cd->sim->avg_r[s];
-		guint8 *avg_g = &cd->sim->avg_g[s];
-		guint8 *avg_b = &cd->sim->avg_b[s];
-		guint n = 0;
-
-		for (x = 0; x < 32; x++)
-			{
-			buf[n++] = avg_r[x];
-			buf[n++] = avg_g[x];
-			buf[n++] = avg_b[x];
-			}
+		cache_sim_data_set_dimensions(cd, rec->width, rec->height);
+		}
+	if (rec->flags & CACHE_SIM_HAVE_DATE)
+		{
+		cache_sim_data_set_date(cd, (time_t)rec->date);
+		}
+	if (rec->flags & CACHE_SIM_HAVE_MD5SUM)
+		{
+		memcpy(cd->md5sum, rec->md5sum, sizeof(cd->md5sum));
+		cd->have_md5sum = TRUE;
+		}
+	if (rec->flags & CACHE_SIM_HAVE_SIMILARITY)
+		{
+		if (!cd->sim) cd->sim = image_sim_new();
 
-		secure_fwrite(buf, sizeof(buf), 1, ssi);
+		memcpy(cd->sim->avg_r, rec->avg_r, sizeof(rec->avg_r));
+		memcpy(cd->sim->avg_g, rec->avg_g, sizeof(rec->avg_g));
+		memcpy(cd->sim->avg_b, rec->avg_b, sizeof(rec->avg_b));
+		cd->sim->filled = TRUE;
+		cd->similarity = TRUE;
 		}
+}
 
-	secure_fputc(ssi, '\n');
+/*
+ *-------------------------------------------------------------------
+ * sim cache write
+ *-------------------------------------------------------------------
+ */
 
-	return TRUE;
+static void cache_sim_header_init(CacheSimHeader *header)
+{
+	memset(header, 0, sizeof(CacheSimHeader));
+	memcpy(header->magic, CACHE_SIM_MAGIC, sizeof(header->magic));
+	header->version = CACHE_SIM_VERSION;
+	header->byte_order = CACHE_SIM_BYTE_ORDER;
 }
 
 gboolean cache_sim_data_save(CacheData *cd)
 {
 	SecureSaveInfo *ssi;
+	CacheSimHeader header;
+	CacheSimRecord rec;
 	gchar *pathl;
 
 	if (!cd || !cd->path) return FALSE;
@@ -162,11 +245,11 @@ gboolean cache_sim_data_save(CacheData *cd)
 		return FALSE;
 		}
 
-	secure_fprintf(ssi, "SIMcache\n#%s %s\n", PACKAGE, VERSION);
-	cache_sim_write_dimensions(ssi, cd);
-	cache_sim_write_date(ssi, cd);
-	cache_sim_write_md5sum(ssi, cd);
-	cache_sim_write_similarity(ssi, cd);
+	cache_sim_header_init(&header);
+	cache_sim_record_from_data(&rec, cd);
+
+	secure_fwrite(&header, sizeof(header), 1, ssi);
+	secure_fwrite(&rec, sizeof(rec), 1, ssi);
 
 	if (secure_close(ssi))
 		{
@@ -396,29 +479,64 @@ static gboolean cache_sim_read_similarity(FILE *f, gchar *buf, gint s, CacheData
 
 #define CACHE_LOAD_LINE_NOISE 8
 
-CacheData *cache_sim_data_load(const gchar *path)
+/* the binary format, data holds the whole file */
+static CacheData *cache_sim_data_load_binary(const gchar *path, const guchar *data, gsize size)
+{
+	CacheSimHeader header;
+	CacheSimRecord rec;
+	CacheData *cd;
+
+	memcpy(&header, data, sizeof(header));
+	if (size != sizeof(header) + sizeof(rec) ||
+	    header.version != CACHE_SIM_VERSION ||
+	    header.byte_order != CACHE_SIM_BYTE_ORDER)
+		{
+		if (path) DEBUG_1("%s is not a cache file of this version", path);
+		return NULL;
+		}
+
+	memcpy(&rec, data + sizeof(header), sizeof(rec));
+	if (!rec.flags) return NULL;
+
+	cd = cache_sim_data_new();
+	cd->path = g_strdup(path);
+	cache_sim_record_to_data(&rec, cd);
+
+	return cd;
+}
+
+/*
+ * pathl is in the file system encoding, path is the utf8 path kept in the data.
+ * Without path nothing is logged, so that it can be used by a thread.
+ */
+static CacheData *cache_sim_data_load_real(const gchar *pathl, const gchar *path)
 {
 	FILE *f;
 	CacheData *cd = NULL;
+	guchar data[sizeof(CacheSimHeader) + sizeof(CacheSimRecord) + 1];
+	gsize size;
 	gchar buf[32];
 	gint success = CACHE_LOAD_LINE_NOISE;
-	gchar *pathl;
-
-	if (!path) return NULL;
-
-	pathl = path_from_utf8(path);
-	f = fopen(pathl, "r");
-	g_free(pathl);
 
+	f = fopen(pathl, "rb");
 	if (!f) return NULL;
 
+	/* one read for a binary file, one more byte to catch a longer file */
+	size = fread(data, 1, sizeof(data), f);
+	if (size >= sizeof(CacheSimHeader) && memcmp(data, CACHE_SIM_MAGIC, strlen(CACHE_SIM_MAGIC)) == 0)
+		{
+		fclose(f);
+		return cache_sim_data_load_binary(path, data, size);
+		}
+
 	cd = cache_sim_data_new();
 	cd->path = g_strdup(path);
 
-	if (fread(&buf, sizeof(gchar), 9, f) != 9 ||
-	    strncmp(buf, "SIMcache", 8) != 0)
+	if (size < 9 ||
+	    strncmp((gchar *)data, "SIMcache", 8) != 0 ||
+	    fseek(f, 9, SEEK_SET) != 0)
 		{
-		DEBUG_1("%s is not a cache file", cd->path);
+		if (path) DEBUG_1("%s is not a cache file", path);
 		success = 0;
 		}
 
@@ -469,6 +587,390 @@ CacheData *cache_sim_data_load(const gchar *path)
 	return cd;
 }
 
+CacheData *cache_sim_data_load(const gchar *path)
+{
+	CacheData *cd;
+	gchar *pathl;
+
+	if (!path) return NULL;
+
+	pathl = path_from_utf8(path);
+	cd = cache_sim_data_load_real(pathl, path);
+	g_free(pathl);
+
+	return cd;
+}
+
+/*
+ *-------------------------------------------------------------------
+ * sim pack
+ *-------------------------------------------------------------------
+ */
+
+static gboolean cache_sim_pack_is_sim(const gchar *name)
+{
+	gsize len = strlen(name);
+	gsize ext_len = strlen(GQ_CACHE_EXT_SIM);
+
+	return (len > ext_len && strcmp(name + len - ext_len, GQ_CACHE_EXT_SIM) == 0);
+}
+
+/* checks for sim files of dirl written at or after time */
+static gboolean cache_sim_pack_sim_written_since(const gchar *dirl, time_t time)
+{
+	DIR *dp;
+	struct dirent *dir;
+	gboolean written = FALSE;
+
+	dp = opendir(dirl);
+	if (!dp) return TRUE;
+
+	while (!written && (dir = readdir(dp)) != NULL)
+		{
+		gchar *sim_pathl;
+		struct stat st;
+
+		if (!cache_sim_pack_is_sim(dir->d_name)) continue;
+
+		/* the mtime of a sim file is that of its image, the ctime is when it was written */
+		sim_pathl = g_build_filename(dirl, dir->d_name, NULL);
+		if (stat(sim_pathl, &st) == 0 && st.st_ctime >= time) written = TRUE;
+		g_free(sim_pathl);
+		}
+	closedir(dp);
+
+	return written;
+}
+
+/*
+ * packs the sim files of the cache folder dirl, in the file system encoding,
+ * it is run by a thread and so logs nothing
+ */
+static gboolean cache_sim_pack_save(const gchar *dirl)
+{
+	GList *names = NULL;
+	GList *work;
+	DIR *dp;
+	struct dirent *dir;
+	SecureSaveInfo *ssi;
+	CacheSimPackHeader header;
+	gchar *pathl;
+	guint32 offset;
+	struct stat st;
+	struct utimbuf ut;
+	time_t scan_time;
+
+	/* the folder as it was before the scan */
+	if (stat(dirl, &st) != 0) return FALSE;
+	scan_time = st.st_mtime;
+
+	dp = opendir(dirl);
+	if (!dp) return FALSE;
+
+	memset(&header, 0, sizeof(header));
+	while ((dir = readdir(dp)) != NULL)
+		{
+		if (!cache_sim_pack_is_sim(dir->d_name)) continue;
+
+		/* the name of the image */
+		names = g_list_prepend(names, g_strndup(dir->d_name, strlen(dir->d_name) - strlen(GQ_CACHE_EXT_SIM)));
+		header.count++;
+		header.names_size += strlen(names->data) + 1;
+		}
+	closedir(dp);
+
+	names = g_list_sort(names, (GCompareFunc)strcmp);
+
+	pathl = g_build_filename(dirl, GQ_CACHE_SIM_PACK, NULL);
+	ssi = secure_open(pathl);
+	if (!ssi)
+		{
+		string_list_free(names);
+		g_free(pathl);
+		return FALSE;
+		}
+	ssi->preserve_perms = FALSE;
+
+	memcpy(header.magic, CACHE_SIM_PACK_MAGIC, sizeof(header.magic));
+	header.version = CACHE_SIM_VERSION;
+	header.byte_order = CACHE_SIM_BYTE_ORDER;
+	secure_fwrite(&header, sizeof(header), 1, ssi);
+
+	/* an entry per name, one that can not be read is left without flags */
+	offset = 0;
+	for (work = names; work; work = work->next)
+		{
+		const gchar *name = work->data;
+		CacheSimPackEntry entry;
+		gchar *sim_pathl;
+		CacheData *cd = NULL;
+
+		memset(&entry, 0, sizeof(entry));
+		entry.name_offset = offset;
+		offset += strlen(name) + 1;
+
+		sim_pathl = g_strconcat(dirl, G_DIR_SEPARATOR_S, name, GQ_CACHE_EXT_SIM, NULL);
+		if (stat(sim_pathl, &st) == 0)
+			{
+			cd = cache_sim_data_load_real(sim_pathl, NULL);
+			}
+		g_free(sim_pathl);
+
+		if (cd)
+			{
+			/* a sim file has the mtime of its image */
+			entry.mtime = st.st_mtime;
+			cache_sim_record_from_data(&entry.record, cd);
+			cache_sim_data_free(cd);
+			}
+
+		secure_fwrite(&entry, sizeof(entry), 1, ssi);
+		}
+
+	for (work = names; work; work = work->next)
+		{
+		secure_fwrite(work->data, strlen(work->data) + 1, 1, ssi);
+		}
+	string_list_free(names);
+
+	if (secure_close(ssi))
+		{
+		g_free(pathl);
+		return FALSE;
+		}
+
+	/*
+	 * writing the pack changed the folder, the pack is as new as the folder
+	 * now unless a sim file was written since the scan, then it is as old as
+	 * the folder before the scan, and rebuilt when next opened
+	 */
+	if (stat(dirl, &st) != 0) st.st_mtime = scan_time;
+	ut.modtime = cache_sim_pack_sim_written_since(dirl, scan_time) ? scan_time - 1 : st.st_mtime;
+	ut.actime = ut.modtime;
+	utime(pathl, &ut);
+	g_free(pathl);
+
+	return TRUE;
+}
+
+/*
+ * The packs are built by a thread, a folder whose pack is out of date is
+ * read from its sim files meanwhile. The folders being built are only
+ * known to the main thread.
+ */
+
+#define CACHE_SIM_PACK_THREADS 1
+
+typedef struct _CacheSimPackBuild CacheSimPackBuild;
+struct _CacheSimPackBuild
+{
+	gchar *dirl;
+	gboolean success;
+};
+
+static GHashTable *cache_sim_pack_building = NULL;
+#ifdef HAVE_GTHREAD
+static GThreadPool *cache_sim_pack_pool = NULL;
+#endif
+
+static gboolean cache_sim_pack_build_done_cb(gpointer data)
+{
+	CacheSimPackBuild *build = data;
+
+	if (!build->success)
+		{
+		gchar *pathl = g_build_filename(build->dirl, GQ_CACHE_SIM_PACK, NULL);
+
+		log_printf(_("error saving sim pack: %s\n"), pathl);
+		g_free(pathl);
+		}
+
+	g_hash_table_remove(cache_sim_pack_building, build->dirl);
+	g_free(build->dirl);
+	g_free(build);
+
+	return FALSE;
+}
+
+static void cache_sim_pack_build_run(gpointer data, gpointer user_data)
+{
+	CacheSimPackBuild *build = data;
+
+	build->success = cache_sim_pack_save(build->dirl);
+
+	g_idle_add(cache_sim_pack_build_done_cb, build);
+}
+
+static void cache_sim_pack_build(const gchar *dirl)
+{
+	CacheSimPackBuild *build;
+
+	if (!cache_sim_pack_building)
+		{
+		cache_sim_pack_building = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+		}
+	if (g_hash_table_lookup(cache_sim_pack_building, dirl)) return;
+
+	g_hash_table_insert(cache_sim_pack_building, g_strdup(dirl), GINT_TO_POINTER(TRUE));
+
+	build = g_new0(CacheSimPackBuild, 1);
+	build->dirl = g_strdup(dirl);
+
+#ifdef HAVE_GTHREAD
+	if (!cache_sim_pack_pool)
+		{
+		cache_sim_pack_pool = g_thread_pool_new(cache_sim_pack_build_run, NULL,
+							CACHE_SIM_PACK_THREADS, FALSE, NULL);
+		}
+	g_thread_pool_push(cache_sim_pack_pool, build, NULL);
+#else
+	cache_sim_pack_build_run(build, NULL);
+#endif
+}
+
+static gboolean cache_sim_pack_check(CacheSimPack *pack)
+{
+	const gchar *data;
+	gsize size;
+	guint32 i;
+
+	data = g_mapped_file_get_contents(pack->mapped);
+	size = g_mapped_file_get_length(pack->mapped);
+	if (!data || size < sizeof(CacheSimPackHeader)) return FALSE;
+
+	pack->header = (const CacheSimPackHeader *)data;
+	if (memcmp(pack->header->magic, CACHE_SIM_PACK_MAGIC, sizeof(pack->header->magic)) != 0 ||
+	    pack->header->version != CACHE_SIM_VERSION ||
+	    pack->header->byte_order != CACHE_SIM_BYTE_ORDER) return FALSE;
+
+	if (size != sizeof(CacheSimPackHeader) +
+		    (gsize)pack->header->count * sizeof(CacheSimPackEntry) +
+		    pack->header->names_size) return FALSE;
+
+	pack->entries = (const CacheSimPackEntry *)(data + sizeof(CacheSimPackHeader));
+	pack->names = (const gchar *)(pack->entries + pack->header->count);
+
+	if (pack->header->count == 0) return TRUE;
+	if (pack->names[pack->header->names_size - 1] != '\0') return FALSE;
+
+	for (i = 0; i < pack->header->count; i++)
+		{
+		if (pack->entries[i].name_offset >= pack->header->names_size) return FALSE;
+		}
+
+	return TRUE;
+}
+
+/**
+ * @brief Maps the sim pack of the cache folder of source.
+ * @returns NULL when there is no cache folder or no up to date pack
+ *
+ * A pack older than its folder is rebuilt in the background, NULL is
+ * returned until it is done and the sim files are to be read meanwhile.
+ * A lookup in the pack replaces a cache_sim_data_load() of each file of the folder.
+ */
+CacheSimPack *cache_sim_pack_open(const gchar *source)
+{
+	CacheSimPack *pack;
+	gchar *dir;
+	gchar *dirl;
+	gchar *pathl;
+	struct stat st_dir;
+	struct stat st;
+
+	dir = cache_get_location(CACHE_TYPE_SIM, source, FALSE, NULL);
+	if (!dir) return NULL;
+
+	dirl = path_from_utf8(dir);
+	g_free(dir);
+	pathl = g_build_filename(dirl, GQ_CACHE_SIM_PACK, NULL);
+
+	if (stat(dirl, &st_dir) != 0 ||
+	    (cache_sim_pack_building && g_hash_table_lookup(cache_sim_pack_building, dirl)))
+		{
+		g_free(pathl);
+		g_free(dirl);
+		return NULL;
+		}
+
+	if (stat(pathl, &st) != 0 || st.st_mtime < st_dir.st_mtime)
+		{
+		cache_sim_pack_build(dirl);
+		g_free(pathl);
+		g_free(dirl);
+		return NULL;
+		}
+	g_free(dirl);
+
+	pack = g_new0(CacheSimPack, 1);
+	pack->mapped = g_mapped_file_new(pathl, FALSE, NULL);
+	if (!pack->mapped || !cache_sim_pack_check(pack))
+		{
+		DEBUG_1("%s is not a sim pack of this version", pathl);
+		cache_sim_pack_close(pack);
+		pack = NULL;
+		}
+	g_free(pathl);
+
+	return pack;
+}
+
+void cache_sim_pack_close(CacheSimPack *pack)
+{
+	if (!pack) return;
+
+	if (pack->mapped) g_mapped_file_unref(pack->mapped);
+	g_free(pack);
+}
+
+/**
+ * @brief Finds the sim data of source in a pack.
+ * @param mtime modification time of source, entries of an older image are not used
+ * @returns new CacheData without path, or NULL when not in the pack
+ */
+CacheData *cache_sim_pack_lookup(CacheSimPack *pack, const gchar *source, time_t mtime)
+{
+	gchar *namel;
+	guint32 first;
+	guint32 last;
+	const CacheSimPackEntry *found = NULL;
+	CacheData *cd;
+
+	if (!pack || !source || pack->header->count == 0) return NULL;
+
+	namel = path_from_utf8(filename_from_path(source));
+
+	first = 0;
+	last = pack->header->count;
+	while (first < last)
+		{
+		guint32 mid = first + (last - first) / 2;
+		gint cmp = strcmp(namel, pack->names + pack->entries[mid].name_offset);
+
+		if (cmp == 0)
+			{
+			found = &pack->entries[mid];
+			break;
+			}
+		if (cmp < 0)
+			{
+			last = mid;
+			}
+		else
+			{
+			first = mid + 1;
+			}
+		}
+	g_free(namel);
+
+	if (!found || !found->record.flags || found->mtime != (gint64)mtime) return NULL;
+
+	cd = cache_sim_data_new();
+	cache_sim_record_to_data(&found->record, cd);
+
+	return cd;
+}
+
 /*
  *-------------------------------------------------------------------
  * sim cache setting
@@ -768,4 +1270,80 @@ const gchar *get_metadata_cache_dir(void)
 	return metadata_cache_dir;
 }
 
+const gchar *get_pan_cache_dir(void)
+{
+	static gchar *pan_cache_dir = NULL;
+
+	if (pan_cache_dir) return pan_cache_dir;
+
+	if (USE_XDG)
+		{
+		pan_cache_dir = g_build_filename(xdg_cache_home_get(),
+						 GQ_APPNAME_LC, GQ_CACHE_PAN, NULL);
+		}
+	else
+		{
+		pan_cache_dir = g_build_filename(get_rc_dir(), GQ_CACHE_PAN, NULL);
+		}
+
+	return pan_cache_dir;
+}
+
+const gchar *get_color_cache_dir(void)
+{
+	static gchar *color_cache_dir = NULL;
+
+	if (color_cache_dir) return color_cache_dir;
+
+	if (USE_XDG)
+		{
+		color_cache_dir = g_build_filename(xdg_cache_home_get(),
+						   GQ_APPNAME_LC, GQ_CACHE_COLOR, NULL);
+		}
+	else
+		{
+		color_cache_dir = g_build_filename(get_rc_dir(), GQ_CACHE_COLOR, NULL);
+		}
+
+	return color_cache_dir;
+}
+
+const gchar *get_collection_cache_dir(void)
+{
+	static gchar *collection_cache_dir = NULL;
+
+	if (collection_cache_dir) return collection_cache_dir;
+
+	if (USE_XDG)
+		{
+		collection_cache_dir = g_build_filename(xdg_cache_home_get(),
+							GQ_APPNAME_LC, GQ_CACHE_COLLECTION, NULL);
+		}
+	else
+		{
+		collection_cache_dir = g_build_filename(get_rc_dir(), GQ_CACHE_COLLECTION, NULL);
+		}
+
+	return collection_cache_dir;
+}
+
+const gchar *get_editors_cache_dir(void)
+{
+	static gchar *editors_cache_dir = NULL;
+
+	if (editors_cache_dir) return editors_cache_dir;
+
+	if (USE_XDG)
+		{
+		editors_cache_dir = g_build_filename(xdg_cache_home_get(),
+						     GQ_APPNAME_LC, GQ_CACHE_EDITORS, NULL);
+		}
+	else
+		{
+		editors_cache_dir = g_build_filename(get_rc_dir(), GQ_CACHE_EDITORS, NULL);
+		}
+
+	return editors_cache_dir;
+}
+
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -28,6 +28,10 @@
 
 #define GQ_CACHE_THUMB		"thumbnails"
 #define GQ_CACHE_METADATA    	"metadata"
+#define GQ_CACHE_PAN		"pan"
+#define GQ_CACHE_COLOR		"color"
+#define GQ_CACHE_COLLECTION	"collections"
+#define GQ_CACHE_EDITORS	"editors"
 
 #define GQ_CACHE_LOCAL_THUMB    ".thumbnails"
 #define GQ_CACHE_LOCAL_METADATA ".metadata"
@@ -37,6 +41,8 @@
 #define GQ_CACHE_EXT_METADATA   ".meta"
 #define GQ_CACHE_EXT_XMP_METADATA   ".gq.xmp"
 
+#define GQ_CACHE_SIM_PACK       ".sim.pack"
+
 
 typedef enum {
 	CACHE_TYPE_THUMB,
@@ -70,6 +76,10 @@ void cache_sim_data_free(CacheData *cd);
 gboolean cache_sim_data_save(CacheData *cd);
 CacheData *cache_sim_data_load(const gchar *path);
 
+CacheSimPack *cache_sim_pack_open(const gchar *source);
+CacheData *cache_sim_pack_lookup(CacheSimPack *pack, const gchar *source, time_t mtime);
+void cache_sim_pack_close(CacheSimPack *pack);
+
 void cache_sim_data_set_dimensions(CacheData *cd, gint w, gint h);
 void cache_sim_data_set_date(CacheData *cd, time_t date);
 void cache_sim_data_set_md5sum(CacheData *cd, guchar digest[16]);
@@ -82,6 +92,10 @@ gchar *cache_find_location(CacheType type, const gchar *source);
 const gchar *get_thumbnails_cache_dir(void);
 const gchar *get_thumbnails_standard_cache_dir(void);
 const gchar *get_metadata_cache_dir(void);
+const gchar *get_pan_cache_dir(void);
+const gchar *get_color_cache_dir(void);
+const gchar *get_collection_cache_dir(void);
+const gchar *get_editors_cache_dir(void);
 
 #endif
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -34,13 +34,44 @@
 #include "ui_utildlg.h"
 #include "window.h"
 
+#include <glib/gstdio.h>
+
+
+typedef struct _CacheScrub CacheScrub;
+typedef void (* CacheScrubTaskFunc)(CacheScrub *cs, gpointer task);
+typedef void (* CacheScrubProgressFunc)(CacheScrub *cs, gboolean finished, gpointer data);
+
+struct _CacheScrub
+{
+#ifdef HAVE_GTHREAD
+	GThreadPool *pool;	/* runs batches of tasks */
+#endif
+	GAsyncQueue *queue;	/* tasks not started yet */
+	GTimer *timer;
+
+	CacheScrubTaskFunc func_task;
+	CacheScrubProgressFunc func_progress;
+	gpointer data;
+
+	guint idle_id; /* event source id */
+
+	/* updated by the tasks, use g_atomic_int_* */
+	gint pending;
+	gint batches;
+	gint cancel;
+	gint count_folders;
+	gint count_total;
+	gint count_done;
+	gint count_removed;
+	gint count_failed;
+};
 
 typedef struct _CMData CMData;
 struct _CMData
 {
-	GList *list;
-	GList *done_list;
-	guint idle_id; /* event source id */
+	CacheScrub *cs;
+	gchar *base;		/* cache folder, in the file system encoding */
+	gsize base_length;
 	GenericDialog *gd;
 	GtkWidget *entry;
 	GtkWidget *spinner;
@@ -53,208 +84,375 @@ struct _CMData
 
 #define PURGE_DIALOG_WIDTH 400
 
+/* thumbnails rendered at once when the number of processors is unknown */
+#define CACHE_RENDER_JOBS_DEFAULT 4
+
+/* scrub threads, they mostly wait on the disk */
+#define CACHE_SCRUB_THREADS 8
+/* cache files checked by one task */
+#define CACHE_SCRUB_CHUNK 256
+/* ms between progress updates */
+#define CACHE_SCRUB_POLL_INTERVAL 100
+/* seconds of work per idle call, when running without threads */
+#define CACHE_SCRUB_TIME_BUDGET 0.02
+/* seconds of work of each thread per poll interval */
+#define CACHE_SCRUB_THREAD_BUDGET 0.05
+
 
 /*
  *-------------------------------------------------------------------
- * cache maintenance
+ * cache scrubber
  *-------------------------------------------------------------------
  */
 
-static gchar *extension_find_dot(gchar *path)
+/* The scrubber runs the tasks of a cache maintenance on a pool of threads,
+ * tasks may push more tasks. The main loop only polls the counters, so a
+ * cache of millions of files does not block the interface. Each poll hands
+ * a batch to every thread once the previous ones are done, a batch runs
+ * tasks within a time budget, so the disk is not kept busy all the time.
+ * Without threads the batches run from an idle callback.
+ */
+
+static gboolean cache_scrub_cancelled(CacheScrub *cs)
+{
+	return g_atomic_int_get(&cs->cancel);
+}
+
+static void cache_scrub_run(CacheScrub *cs, gpointer task)
 {
-	gchar *dot = NULL;
+	cs->func_task(cs, task);
+	g_atomic_int_add(&cs->pending, -1);
+}
 
-	if (!path) return NULL;
+/* runs tasks until none is left or the budget is spent */
+static void cache_scrub_batch_run(CacheScrub *cs, gdouble budget)
+{
+	GTimer *timer;
+	gpointer task;
 
-	while (*path != '\0')
+	timer = g_timer_new();
+	while (g_timer_elapsed(timer, NULL) < budget &&
+	       (task = g_async_queue_try_pop(cs->queue)) != NULL)
 		{
-		if (*path == '.') dot = path;
-		path++;
+		cache_scrub_run(cs, task);
 		}
+	g_timer_destroy(timer);
+}
+
+#ifdef HAVE_GTHREAD
+static void cache_scrub_thread_run(gpointer data, gpointer user_data)
+{
+	CacheScrub *cs = data;
 
-	return dot;
+	cache_scrub_batch_run(cs, CACHE_SCRUB_THREAD_BUDGET);
+	g_atomic_int_add(&cs->batches, -1);
 }
+#endif
 
-static gboolean isempty(const gchar *path)
+static void cache_scrub_push(CacheScrub *cs, gpointer task)
 {
-	DIR *dp;
-	struct dirent *dir;
-	gchar *pathl;
+	g_atomic_int_inc(&cs->pending);
+	g_async_queue_push(cs->queue, task);
+}
 
-	pathl = path_from_utf8(path);
-	dp = opendir(pathl);
-	g_free(pathl);
-	if (!dp) return FALSE;
+/* path is in the file system encoding */
+static gboolean cache_scrub_remove(CacheScrub *cs, const gchar *path)
+{
+	if (unlink(path) != 0)
+		{
+		g_atomic_int_inc(&cs->count_failed);
+		return FALSE;
+		}
 
-	while ((dir = readdir(dp)) != NULL)
+	g_atomic_int_inc(&cs->count_removed);
+	return TRUE;
+}
+
+static gboolean cache_scrub_idle_cb(gpointer data)
+{
+	CacheScrub *cs = data;
+
+#ifdef HAVE_GTHREAD
+	if (g_atomic_int_get(&cs->batches) == 0 && g_async_queue_length(cs->queue) > 0)
 		{
-		gchar *name = dir->d_name;
+		gint i;
 
-		if (!(name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) )
+		g_atomic_int_set(&cs->batches, CACHE_SCRUB_THREADS);
+		for (i = 0; i < CACHE_SCRUB_THREADS; i++)
 			{
-			closedir(dp);
-			return FALSE;
+			g_thread_pool_push(cs->pool, cs, NULL);
 			}
 		}
+#else
+	cache_scrub_batch_run(cs, CACHE_SCRUB_TIME_BUDGET);
+#endif
 
-	closedir(dp);
-	return TRUE;
+	if (g_atomic_int_get(&cs->pending) > 0)
+		{
+		cs->func_progress(cs, FALSE, cs->data);
+		return TRUE;
+		}
+
+	/* the callback may free cs */
+	cs->idle_id = 0;
+	cs->func_progress(cs, TRUE, cs->data);
+	return FALSE;
 }
 
-static void cache_maintain_home_close(CMData *cm)
+static CacheScrub *cache_scrub_new(CacheScrubTaskFunc func_task, CacheScrubProgressFunc func_progress, gpointer data)
 {
-	if (cm->idle_id) g_source_remove(cm->idle_id);
-	if (cm->gd) generic_dialog_close(cm->gd);
-	filelist_free(cm->list);
-	g_list_free(cm->done_list);
-	g_free(cm);
+	CacheScrub *cs;
+
+	cs = g_new0(CacheScrub, 1);
+	cs->func_task = func_task;
+	cs->func_progress = func_progress;
+	cs->data = data;
+	cs->timer = g_timer_new();
+	cs->queue = g_async_queue_new();
+
+#ifdef HAVE_GTHREAD
+	cs->pool = g_thread_pool_new(cache_scrub_thread_run, NULL, CACHE_SCRUB_THREADS, FALSE, NULL);
+	cs->idle_id = g_timeout_add(CACHE_SCRUB_POLL_INTERVAL, cache_scrub_idle_cb, cs);
+#else
+	cs->idle_id = g_idle_add(cache_scrub_idle_cb, cs);
+#endif
+
+	return cs;
 }
 
-static void cache_maintain_home_stop(CMData *cm)
+/* the tasks skip their work, the progress callback still gets the finish */
+static void cache_scrub_cancel(CacheScrub *cs)
 {
-	if (cm->idle_id)
-		{
-		g_source_remove(cm->idle_id);
-		cm->idle_id = 0;
-		}
+	g_atomic_int_set(&cs->cancel, TRUE);
+}
 
-	if (!cm->remote)
-		{
-		gtk_entry_set_text(GTK_ENTRY(cm->entry), _("done"));
-		spinner_set_interval(cm->spinner, -1);
+/* only once finished, when no task is left */
+static void cache_scrub_free(CacheScrub *cs)
+{
+	if (!cs) return;
 
-		gtk_widget_set_sensitive(cm->button_stop, FALSE);
-		gtk_widget_set_sensitive(cm->button_close, TRUE);
-		}
+	if (cs->idle_id) g_source_remove(cs->idle_id);
+#ifdef HAVE_GTHREAD
+	g_thread_pool_free(cs->pool, FALSE, TRUE);
+#endif
+	g_async_queue_unref(cs->queue);
+	g_timer_destroy(cs->timer);
+	g_free(cs);
 }
 
-static gboolean cache_maintain_home_cb(gpointer data)
+static gchar *cache_scrub_report(CacheScrub *cs)
 {
-	CMData *cm = data;
-	GList *dlist = NULL;
-	GList *list = NULL;
-	FileData *fd;
-	gboolean just_done = FALSE;
-	gboolean still_have_a_file = TRUE;
-	gsize base_length;
-	const gchar *cache_folder;
-	gboolean filter_disable;
+	gchar *buf;
+	gchar *report;
+	gdouble elapsed;
+
+	elapsed = g_timer_elapsed(cs->timer, NULL);
+	buf = g_strdup_printf(_("%d checked, %d removed in %.1f s (%.0f files/s)"),
+			      cs->count_done, cs->count_removed, elapsed,
+			      (elapsed > 0.0) ? cs->count_done / elapsed : 0.0);
+
+	if (!cs->count_failed) return buf;
+
+	report = g_strdup_printf(_("%s, %d could not be removed"), buf, cs->count_failed);
+	g_free(buf);
+
+	return report;
+}
+
+
+/*
+ *-------------------------------------------------------------------
+ * cache maintenance
+ *-------------------------------------------------------------------
+ */
+
+typedef struct _CacheScrubDir CacheScrubDir;
+struct _CacheScrubDir
+{
+	CacheScrubDir *parent;
+	gchar *path;		/* in the file system encoding */
+	gint pending;		/* own pass and the sub folders not finished */
+	gint kept;		/* entries left in the folder */
+};
+
+/* a cache file is orphaned when the file it was made for is gone, all are when clearing */
+static gboolean cache_maintain_home_orphan(CMData *cm, const gchar *path)
+{
+	gchar *source;
+	gsize len;
+	gboolean orphan;
+	struct stat st;
 
-	if (cm->metadata)
+	if (cm->clear && !cm->metadata) return TRUE;
+	if (strlen(path) <= cm->base_length) return FALSE;
+
+	/* a sim pack is made for the folder */
+	if (strcmp(filename_from_path(path), GQ_CACHE_SIM_PACK) == 0)
 		{
-		cache_folder = get_metadata_cache_dir();
+		source = remove_level_from_path(path + cm->base_length);
+		orphan = (stat(source, &st) != 0 || !S_ISDIR(st.st_mode));
+		g_free(source);
+
+		return orphan;
+		}
+
+	source = g_strdup(path + cm->base_length);
+	len = strlen(source);
+	if (len > strlen(GQ_CACHE_EXT_XMP_METADATA) &&
+	    strcmp(source + len - strlen(GQ_CACHE_EXT_XMP_METADATA), GQ_CACHE_EXT_XMP_METADATA) == 0)
+		{
+		source[len - strlen(GQ_CACHE_EXT_XMP_METADATA)] = '\0';
 		}
 	else
 		{
-		cache_folder = get_thumbnails_cache_dir();
+		gchar *dot = strrchr(source, '.');
+
+		if (dot && !strchr(dot, G_DIR_SEPARATOR)) *dot = '\0';
 		}
 
-	base_length = strlen(cache_folder);
+	orphan = (stat(source, &st) != 0 || S_ISDIR(st.st_mode));
+	g_free(source);
 
-	if (!cm->list)
+	return orphan;
+}
+
+/* removes folders left empty once they and all their sub folders are done */
+static void cache_maintain_home_dir_done(CacheScrub *cs, CacheScrubDir *sd)
+{
+	while (sd && g_atomic_int_dec_and_test(&sd->pending))
 		{
-		DEBUG_1("purge chk done.");
-		cm->idle_id = 0;
-		cache_maintain_home_stop(cm);
-		return FALSE;
-		}
+		CacheScrubDir *parent = sd->parent;
 
-	fd = cm->list->data;
+		/* the cache folder itself stays */
+		if (parent && !cache_scrub_cancelled(cs) && g_atomic_int_get(&sd->kept) == 0)
+			{
+			if (rmdir(sd->path) == 0)
+				{
+				g_atomic_int_add(&parent->kept, -1);
+				}
+			else
+				{
+				g_atomic_int_inc(&cs->count_failed);
+				}
+			}
 
-	DEBUG_1("purge chk (%d) \"%s\"", (cm->clear && !cm->metadata), fd->path);
+		g_free(sd->path);
+		g_free(sd);
+		sd = parent;
+		}
+}
 
-/**
- * It is necessary to disable the file filter when clearing the cache,
- * otherwise the .sim (file similarity) files are not deleted.
- */
-	filter_disable = options->file_filter.disable;
-	options->file_filter.disable = TRUE;
+static void cache_maintain_home_dir_run(CacheScrub *cs, gpointer task)
+{
+	CacheScrubDir *sd = task;
+	CMData *cm = cs->data;
+	DIR *dp;
+	struct dirent *dir;
 
-	if (g_list_find(cm->done_list, fd) == NULL)
+	dp = (cache_scrub_cancelled(cs)) ? NULL : opendir(sd->path);
+	if (dp)
 		{
-		cm->done_list = g_list_prepend(cm->done_list, fd);
+		g_atomic_int_inc(&cs->count_folders);
 
-		if (filelist_read(fd, &list, &dlist))
+		while ((dir = readdir(dp)) != NULL)
 			{
-			GList *work;
+			gchar *name = dir->d_name;
+			gchar *path;
+			gboolean is_dir;
+
+			if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
 
-			just_done = TRUE;
-			still_have_a_file = FALSE;
+			path = g_build_filename(sd->path, name, NULL);
 
-			work = list;
-			while (work)
+#ifdef _DIRENT_HAVE_D_TYPE
+			if (dir->d_type != DT_UNKNOWN && dir->d_type != DT_LNK)
 				{
-				FileData *fd_list = work->data;
-				gchar *path_buf = g_strdup(fd_list->path);
-				gchar *dot;
-
-				dot = extension_find_dot(path_buf);
-
-				if (dot) *dot = '\0';
-				if ((!cm->metadata && cm->clear) ||
-				    (strlen(path_buf) > base_length && !isfile(path_buf + base_length)) )
-					{
-					if (dot) *dot = '.';
-					if (!unlink_file(path_buf)) log_printf("failed to delete:%s\n", path_buf);
-					}
-				else
-					{
-					still_have_a_file = TRUE;
-					}
-				g_free(path_buf);
-				work = work->next;
+				is_dir = (dir->d_type == DT_DIR);
 				}
-			}
-		}
-	options->file_filter.disable = filter_disable;
-
-	filelist_free(list);
+			else
+#endif
+				{
+				struct stat st;
 
-	cm->list = g_list_concat(dlist, cm->list);
+				is_dir = (stat(path, &st) == 0 && S_ISDIR(st.st_mode));
+				}
 
-	if (cm->list && g_list_find(cm->done_list, cm->list->data) != NULL)
-		{
-		/* check if the dir is empty */
+			g_atomic_int_inc(&sd->kept);
 
-		if (cm->list->data == fd && just_done)
-			{
-			if (!still_have_a_file && !dlist && cm->list->next && !rmdir_utf8(fd->path))
+			if (is_dir)
 				{
-				log_printf("Unable to delete dir: %s\n", fd->path);
+				CacheScrubDir *child;
+
+				child = g_new0(CacheScrubDir, 1);
+				child->parent = sd;
+				child->path = path;
+				child->pending = 1;
+
+				g_atomic_int_inc(&sd->pending);
+				cache_scrub_push(cs, child);
+				continue;
 				}
-			}
-		else
-			{
-			/* must re-check for an empty dir */
-			if (isempty(fd->path) && cm->list->next && !rmdir_utf8(fd->path))
+
+			g_atomic_int_inc(&cs->count_done);
+			if (cache_maintain_home_orphan(cm, path) && cache_scrub_remove(cs, path))
 				{
-				log_printf("Unable to delete dir: %s\n", fd->path);
+				g_atomic_int_add(&sd->kept, -1);
 				}
+			g_free(path);
 			}
 
-		fd = cm->list->data;
-		cm->done_list = g_list_remove(cm->done_list, fd);
-		cm->list = g_list_remove(cm->list, fd);
-		file_data_unref(fd);
+		closedir(dp);
 		}
 
-	if (cm->list && !cm->remote)
-		{
-		const gchar *buf;
+	cache_maintain_home_dir_done(cs, sd);
+}
 
-		fd = cm->list->data;
-		if (strlen(fd->path) > base_length)
-			{
-			buf = fd->path + base_length;
-			}
-		else
+static void cache_maintain_home_close(CMData *cm)
+{
+	cache_scrub_free(cm->cs);
+	if (cm->gd) generic_dialog_close(cm->gd);
+	g_free(cm->base);
+	g_free(cm);
+}
+
+static void cache_maintain_home_progress(CacheScrub *cs, gboolean finished, gpointer data)
+{
+	CMData *cm = data;
+	gchar *buf;
+
+	if (!finished)
+		{
+		if (!cm->remote)
 			{
-			buf = "...";
+			buf = g_strdup_printf(_("%d folders, %d files checked"),
+					      g_atomic_int_get(&cs->count_folders),
+					      g_atomic_int_get(&cs->count_done));
+			gtk_entry_set_text(GTK_ENTRY(cm->entry), buf);
+			g_free(buf);
 			}
-		gtk_entry_set_text(GTK_ENTRY(cm->entry), buf);
+		return;
 		}
 
-	return TRUE;
+	DEBUG_1("purge chk done.");
+
+	buf = cache_scrub_report(cs);
+	cache_scrub_free(cs);
+	cm->cs = NULL;
+
+	if (cm->remote)
+		{
+		log_printf("%s\n", buf);
+		g_free(buf);
+		cache_maintain_home_close(cm);
+		return;
+		}
+
+	gtk_entry_set_text(GTK_ENTRY(cm->entry), buf);
+	g_free(buf);
+	spinner_set_interval(cm->spinner, -1);
+
+	gtk_widget_set_sensitive(cm->button_stop, FALSE);
+	gtk_widget_set_sensitive(cm->button_close, TRUE);
 }
 
 static void cache_maintain_home_close_cb(GenericDialog *gd, gpointer data)
@@ -270,18 +468,16 @@ static void cache_maintain_home_stop_cb(GenericDialog *gd, gpointer data)
 {
 	CMData *cm = data;
 
-	cache_maintain_home_stop(cm);
+	if (!cm->cs) return;
+
+	cache_scrub_cancel(cm->cs);
+	gtk_widget_set_sensitive(cm->button_stop, FALSE);
 }
 
-/* sorry for complexity (cm->done_list), but need it to remove empty dirs */
-void cache_maintain_home(gboolean metadata, gboolean clear, GtkWidget *parent)
+static CMData *cache_maintain_home_new(gboolean metadata, gboolean clear, gboolean remote)
 {
 	CMData *cm;
-	GList *dlist;
-	FileData *dir_fd;
-	const gchar *msg;
 	const gchar *cache_folder;
-	GtkWidget *hbox;
 
 	if (metadata)
 		{
@@ -292,21 +488,38 @@ void cache_maintain_home(gboolean metadata, gboolean clear, GtkWidget *parent)
 		cache_folder = get_thumbnails_cache_dir();
 		}
 
-	dir_fd = file_data_new_dir(cache_folder);
-	if (!filelist_read(dir_fd, NULL, &dlist))
-		{
-		file_data_unref(dir_fd);
-		return;
-		}
-
-	dlist = g_list_append(dlist, dir_fd);
+	if (!isdir(cache_folder)) return NULL;
 
 	cm = g_new0(CMData, 1);
-	cm->list = dlist;
-	cm->done_list = NULL;
+	cm->base = path_from_utf8(cache_folder);
+	cm->base_length = strlen(cm->base);
 	cm->clear = clear;
 	cm->metadata = metadata;
-	cm->remote = FALSE;
+	cm->remote = remote;
+
+	return cm;
+}
+
+static void cache_maintain_home_start(CMData *cm)
+{
+	CacheScrubDir *sd;
+
+	sd = g_new0(CacheScrubDir, 1);
+	sd->path = g_strdup(cm->base);
+	sd->pending = 1;
+
+	cm->cs = cache_scrub_new(cache_maintain_home_dir_run, cache_maintain_home_progress, cm);
+	cache_scrub_push(cm->cs, sd);
+}
+
+void cache_maintain_home(gboolean metadata, gboolean clear, GtkWidget *parent)
+{
+	CMData *cm;
+	const gchar *msg;
+	GtkWidget *hbox;
+
+	cm = cache_maintain_home_new(metadata, clear, FALSE);
+	if (!cm) return;
 
 	if (metadata)
 		{
@@ -351,42 +564,17 @@ void cache_maintain_home(gboolean metadata, gboolean clear, GtkWidget *parent)
 
 	gtk_widget_show(cm->gd->dialog);
 
-	cm->idle_id = g_idle_add(cache_maintain_home_cb, cm);
+	cache_maintain_home_start(cm);
 }
 
 void cache_maintain_home_remote(gboolean metadata, gboolean clear)
 {
 	CMData *cm;
-	GList *dlist;
-	FileData *dir_fd;
-	const gchar *cache_folder;
 
-	if (metadata)
-		{
-		cache_folder = get_metadata_cache_dir();
-		}
-	else
-		{
-		cache_folder = get_thumbnails_cache_dir();
-		}
+	cm = cache_maintain_home_new(metadata, clear, TRUE);
+	if (!cm) return;
 
-	dir_fd = file_data_new_dir(cache_folder);
-	if (!filelist_read(dir_fd, NULL, &dlist))
-		{
-		file_data_unref(dir_fd);
-		return;
-		}
-
-	dlist = g_list_append(dlist, dir_fd);
-
-	cm = g_new0(CMData, 1);
-	cm->list = dlist;
-	cm->done_list = NULL;
-	cm->clear = clear;
-	cm->metadata = metadata;
-	cm->remote = TRUE;
-
-	cm->idle_id = g_idle_add(cache_maintain_home_cb, cm);
+	cache_maintain_home_start(cm);
 }
 
 static void cache_file_move(const gchar *src, const gchar *dest)
@@ -553,7 +741,7 @@ typedef struct _CleanData CleanData;
 struct _CleanData
 {
 	GenericDialog *gd;
-	ThumbLoaderStd *tl;
+	CacheScrub *cs;		/* standard clean */
 
 	GList *list;
 	GList *list_dir;
@@ -579,18 +767,69 @@ struct _CleanData
 	gboolean remote;
 
 	guint idle_id; /* event source id */
+
+	/* render */
+	GList *loaders;		/* ThumbLoader, at most jobs of them */
+	gint loaders_count;
+	gint jobs;
+	gboolean filling;
+	GTimer *timer;
+	gint count_rendered;
+	gint count_recent;
+	gint64 bytes_rendered;
 };
 
+/* thumbnails rendered at once, 0 for one per processor */
+static gint cache_manager_render_jobs = 0;
+
 static void cache_manager_render_reset(CleanData *cd)
 {
+	GList *work;
+
 	filelist_free(cd->list);
 	cd->list = NULL;
 
 	filelist_free(cd->list_dir);
 	cd->list_dir = NULL;
 
-	thumb_loader_free((ThumbLoader *)cd->tl);
-	cd->tl = NULL;
+	for (work = cd->loaders; work; work = work->next)
+		{
+		thumb_loader_free((ThumbLoader *)work->data);
+		}
+	g_list_free(cd->loaders);
+	cd->loaders = NULL;
+	cd->loaders_count = 0;
+
+	if (cd->timer) g_timer_destroy(cd->timer);
+	cd->timer = NULL;
+}
+
+void cache_manager_render_set_jobs(gint jobs)
+{
+	cache_manager_render_jobs = MAX(jobs, 0);
+}
+
+static gint cache_manager_render_get_jobs(void)
+{
+	if (cache_manager_render_jobs > 0) return cache_manager_render_jobs;
+
+#if GLIB_CHECK_VERSION(2,36,0)
+	return g_get_num_processors();
+#else
+	return CACHE_RENDER_JOBS_DEFAULT;
+#endif
+}
+
+static gchar *cache_manager_render_report(CleanData *cd)
+{
+	gdouble seconds = cd->timer ? g_timer_elapsed(cd->timer, NULL) : 0.0;
+
+	if (seconds <= 0.0) seconds = 0.001;
+
+	return g_strdup_printf(_("%d rendered, %d up to date in %.1f s (%.1f files/s, %.1f MB/s)"),
+			       cd->count_rendered, cd->count_recent, seconds,
+			       (gdouble)cd->count_rendered / seconds,
+			       (gdouble)cd->bytes_rendered / seconds / (1024.0 * 1024.0));
 }
 
 static void cache_manager_render_close_cb(GenericDialog *fd, gpointer data)
@@ -606,10 +845,18 @@ static void cache_manager_render_close_cb(GenericDialog *fd, gpointer data)
 
 static void cache_manager_render_finish(CleanData *cd)
 {
+	gchar *report;
+
+	report = cache_manager_render_report(cd);
 	cache_manager_render_reset(cd);
-	if (!cd->remote)
+	if (cd->remote)
+		{
+		log_printf("%s\n", report);
+		g_free(cd);
+		}
+	else
 		{
-		gtk_entry_set_text(GTK_ENTRY(cd->progress), _("done"));
+		gtk_entry_set_text(GTK_ENTRY(cd->progress), report);
 		spinner_set_interval(cd->spinner, -1);
 
 		gtk_widget_set_sensitive(cd->group, TRUE);
@@ -617,6 +864,7 @@ static void cache_manager_render_finish(CleanData *cd)
 		gtk_widget_set_sensitive(cd->button_stop, FALSE);
 		gtk_widget_set_sensitive(cd->button_close, TRUE);
 		}
+	g_free(report);
 }
 
 static void cache_manager_render_stop_cb(GenericDialog *fd, gpointer data)
@@ -647,69 +895,127 @@ static void cache_manager_render_folder(CleanData *cd, FileData *dir_fd)
 	cd->list_dir = g_list_concat(list_d, cd->list_dir);
 }
 
-static gboolean cache_manager_render_file(CleanData *cd);
+static void cache_manager_render_fill(CleanData *cd);
 
 static void cache_manager_render_thumb_done_cb(ThumbLoader *tl, gpointer data)
 {
 	CleanData *cd = data;
 
-	thumb_loader_free((ThumbLoader *)cd->tl);
-	cd->tl = NULL;
+	cd->loaders = g_list_remove(cd->loaders, tl);
+	cd->loaders_count--;
+
+	cd->count_rendered++;
+	if (tl->fd) cd->bytes_rendered += tl->fd->size;
+
+	thumb_loader_free(tl);
+
+	if (!cd->filling) cache_manager_render_fill(cd);
+}
+
+/* the thumbnail in the cache is not older than the file, checked without loading it */
+static gboolean cache_manager_render_recent(CleanData *cd, FileData *fd)
+{
+	gchar *cache_path;
+	gboolean recent;
+
+	if (!options->thumbnails.enable_caching) return FALSE;
+
+	if (options->thumbnails.spec_standard)
+		{
+		return (thumb_std_cache_recent(fd->path, options->thumbnails.max_width, options->thumbnails.max_height, FALSE) ||
+			(cd->local && thumb_std_cache_recent(fd->path, options->thumbnails.max_width, options->thumbnails.max_height, TRUE)));
+		}
+
+	cache_path = cache_find_location(CACHE_TYPE_THUMB, fd->path);
+	recent = (cache_path && cache_time_valid(cache_path, fd->path));
+	g_free(cache_path);
 
-	while (cache_manager_render_file(cd));
+	return recent;
 }
 
-static gboolean cache_manager_render_file(CleanData *cd)
+static gboolean cache_manager_render_file(CleanData *cd, FileData *fd)
 {
-	if (cd->list)
+	ThumbLoader *tl;
+
+	if (cache_manager_render_recent(cd, fd))
+		{
+		cd->count_recent++;
+		return FALSE;
+		}
+
+	tl = thumb_loader_new(options->thumbnails.max_width, options->thumbnails.max_height);
+	thumb_loader_set_callbacks(tl,
+				   cache_manager_render_thumb_done_cb,
+				   cache_manager_render_thumb_done_cb,
+				   NULL, cd);
+	thumb_loader_set_cache(tl, TRUE, cd->local, TRUE);
+
+	cd->loaders = g_list_prepend(cd->loaders, tl);
+	cd->loaders_count++;
+
+	if (!thumb_loader_start(tl, fd))
+		{
+		if (g_list_find(cd->loaders, tl))
+			{
+			cd->loaders = g_list_remove(cd->loaders, tl);
+			cd->loaders_count--;
+			thumb_loader_free(tl);
+			}
+		return FALSE;
+		}
+
+	if (!cd->remote)
+		{
+		gtk_entry_set_text(GTK_ENTRY(cd->progress), fd->path);
+		}
+
+	return TRUE;
+}
+
+/* keeps up to jobs thumbnails rendering, folders are read only when their files are needed */
+static void cache_manager_render_fill(CleanData *cd)
+{
+	cd->filling = TRUE;
+
+	while (cd->loaders_count < cd->jobs && (cd->list || cd->list_dir))
 		{
 		FileData *fd;
-		gint success;
-
-		fd = cd->list->data;
-		cd->list = g_list_remove(cd->list, fd);
-
-		cd->tl = (ThumbLoaderStd *)thumb_loader_new(options->thumbnails.max_width, options->thumbnails.max_height);
-		thumb_loader_set_callbacks((ThumbLoader *)cd->tl,
-					   cache_manager_render_thumb_done_cb,
-					   cache_manager_render_thumb_done_cb,
-					   NULL, cd);
-		thumb_loader_set_cache((ThumbLoader *)cd->tl, TRUE, cd->local, TRUE);
-		success = thumb_loader_start((ThumbLoader *)cd->tl, fd);
-		if (success)
+
+		if (cd->list)
 			{
-			if (!cd->remote)
-				{
-				gtk_entry_set_text(GTK_ENTRY(cd->progress), fd->path);
-				}
+			fd = cd->list->data;
+			cd->list = g_list_delete_link(cd->list, cd->list);
+
+			cache_manager_render_file(cd, fd);
 			}
 		else
 			{
-			thumb_loader_free((ThumbLoader *)cd->tl);
-			cd->tl = NULL;
+			fd = cd->list_dir->data;
+			cd->list_dir = g_list_delete_link(cd->list_dir, cd->list_dir);
+
+			cache_manager_render_folder(cd, fd);
 			}
 
 		file_data_unref(fd);
-
-		return (!success);
 		}
-	else if (cd->list_dir)
-		{
-		FileData *fd;
-
-		fd = cd->list_dir->data;
-		cd->list_dir = g_list_remove(cd->list_dir, fd);
 
-		cache_manager_render_folder(cd, fd);
+	cd->filling = FALSE;
 
-		file_data_unref(fd);
+	if (!cd->loaders) cache_manager_render_finish(cd);
+}
 
-		return TRUE;
-		}
+static void cache_manager_render_begin(CleanData *cd, FileData *dir_fd)
+{
+	cd->jobs = cache_manager_render_get_jobs();
+	cd->count_rendered = 0;
+	cd->count_recent = 0;
+	cd->bytes_rendered = 0;
+	cd->timer = g_timer_new();
 
-	cache_manager_render_finish(cd);
+	DEBUG_1("cache render: %s with %d jobs", dir_fd->path, cd->jobs);
 
-	return FALSE;
+	cache_manager_render_folder(cd, dir_fd);
+	cache_manager_render_fill(cd);
 }
 
 static void cache_manager_render_start_cb(GenericDialog *fd, gpointer data)
@@ -751,9 +1057,8 @@ static void cache_manager_render_start_cb(GenericDialog *fd, gpointer data)
 			spinner_set_interval(cd->spinner, SPINNER_SPEED);
 			}
 		dir_fd = file_data_new_dir(path);
-		cache_manager_render_folder(cd, dir_fd);
+		cache_manager_render_begin(cd, dir_fd);
 		file_data_unref(dir_fd);
-		while (cache_manager_render_file(cd));
 		}
 
 	g_free(path);
@@ -769,15 +1074,15 @@ static void cache_manager_render_start_render_remote(CleanData *cd, const gchar
 	if (!isdir(path))
 		{
 		log_printf("The specified folder can not be found: %s\n", path);
+		g_free(cd);
 		}
 	else
 		{
 		FileData *dir_fd;
 
 		dir_fd = file_data_new_dir(path);
-		cache_manager_render_folder(cd, dir_fd);
+		cache_manager_render_begin(cd, dir_fd);
 		file_data_unref(dir_fd);
-		while (cache_manager_render_file(cd));
 		}
 
 	g_free(path);
@@ -856,6 +1161,13 @@ void cache_manager_render_remote(const gchar *path, gboolean recurse, gboolean l
 	cache_manager_render_start_render_remote(cd, path);
 }
 
+typedef struct _CacheScrubChunk CacheScrubChunk;
+struct _CacheScrubChunk
+{
+	gchar *folder;		/* listed into more chunks */
+	GList *paths;		/* thumbnails, in the file system encoding */
+};
+
 static void cache_manager_standard_clean_close_cb(GenericDialog *gd, gpointer data)
 {
 	CleanData *cd = data;
@@ -864,126 +1176,145 @@ static void cache_manager_standard_clean_close_cb(GenericDialog *gd, gpointer da
 
 	generic_dialog_close(cd->gd);
 
-	thumb_loader_std_thumb_file_validate_cancel(cd->tl);
-	filelist_free(cd->list);
+	cache_scrub_free(cd->cs);
 	g_free(cd);
 }
 
 static void cache_manager_standard_clean_done(CleanData *cd)
 {
-	if (!cd->remote)
-		{
-		gtk_widget_set_sensitive(cd->button_stop, FALSE);
-		gtk_widget_set_sensitive(cd->button_close, TRUE);
+	gchar *buf;
 
-		gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(cd->progress), 1.0);
-		gtk_progress_bar_set_text(GTK_PROGRESS_BAR(cd->progress), _("done"));
-		}
-	if (cd->idle_id)
+	buf = cache_scrub_report(cd->cs);
+	cache_scrub_free(cd->cs);
+	cd->cs = NULL;
+
+	if (cd->remote)
 		{
-		g_source_remove(cd->idle_id);
-		cd->idle_id = 0;
+		log_printf("%s\n", buf);
+		g_free(buf);
+		g_free(cd);
+		return;
 		}
 
-	thumb_loader_std_thumb_file_validate_cancel(cd->tl);
-	cd->tl = NULL;
+	gtk_widget_set_sensitive(cd->button_stop, FALSE);
+	gtk_widget_set_sensitive(cd->button_close, TRUE);
 
-	filelist_free(cd->list);
-	cd->list = NULL;
+	gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(cd->progress), 1.0);
+	gtk_progress_bar_set_text(GTK_PROGRESS_BAR(cd->progress), buf);
+	g_free(buf);
 }
 
 static void cache_manager_standard_clean_stop_cb(GenericDialog *gd, gpointer data)
 {
 	CleanData *cd = data;
 
-	cache_manager_standard_clean_done(cd);
+	if (!cd->cs) return;
+
+	cache_scrub_cancel(cd->cs);
+	gtk_widget_set_sensitive(cd->button_stop, FALSE);
 }
 
-static gint cache_manager_standard_clean_clear_cb(gpointer data)
+static void cache_manager_standard_clean_progress(CacheScrub *cs, gboolean finished, gpointer data)
 {
 	CleanData *cd = data;
+	gint total;
 
-	if (cd->list)
+	if (finished)
 		{
-		FileData *next_fd;
-
-		next_fd = cd->list->data;
-		cd->list = g_list_remove(cd->list, next_fd);
-
-		DEBUG_1("thumb removed: %s", next_fd->path);
-
-		unlink_file(next_fd->path);
-		file_data_unref(next_fd);
+		cache_manager_standard_clean_done(cd);
+		return;
+		}
 
-		cd->count_done++;
-		if (!cd->remote)
-			{
-			if (cd->count_total != 0)
-				{
-				gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(cd->progress),
-							      (gdouble)cd->count_done / cd->count_total);
-				}
-			}
+	if (cd->remote) return;
 
-		return TRUE;
+	/* the total grows while the folders are listed */
+	total = g_atomic_int_get(&cs->count_total);
+	if (total != 0)
+		{
+		gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(cd->progress),
+					      (gdouble)g_atomic_int_get(&cs->count_done) / total);
 		}
+}
 
-	cd->idle_id = 0;
-	cache_manager_standard_clean_done(cd);
-	return FALSE;
+static void cache_manager_standard_clean_push(CacheScrub *cs, CacheScrubChunk *chunk, gint count)
+{
+	g_atomic_int_add(&cs->count_total, count);
+	cache_scrub_push(cs, chunk);
 }
 
-static void cache_manager_standard_clean_valid_cb(const gchar *path, gboolean valid, gpointer data)
+/* splits a thumbnail folder into chunks, only the names are read */
+static void cache_manager_standard_clean_list(CacheScrub *cs, const gchar *folder)
 {
-	CleanData *cd = data;
+	DIR *dp;
+	struct dirent *dir;
+	CacheScrubChunk *chunk = NULL;
+	gint count = 0;
+
+	dp = opendir(folder);
+	if (!dp) return;
 
-	if (path)
+	g_atomic_int_inc(&cs->count_folders);
+
+	while ((dir = readdir(dp)) != NULL)
 		{
-		if (!valid)
-			{
-			DEBUG_1("thumb cleaned: %s", path);
-			unlink_file(path);
-			}
+		if (dir->d_name[0] == '.' || !g_str_has_suffix(dir->d_name, THUMB_NAME_EXTENSION)) continue;
 
-		cd->count_done++;
-		if (!cd->remote)
+		if (!chunk) chunk = g_new0(CacheScrubChunk, 1);
+		chunk->paths = g_list_prepend(chunk->paths, g_build_filename(folder, dir->d_name, NULL));
+		count++;
+
+		if (count == CACHE_SCRUB_CHUNK)
 			{
-			if (cd->count_total != 0)
-				{
-				gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(cd->progress),
-							      (gdouble)cd->count_done / cd->count_total);
-				}
+			cache_manager_standard_clean_push(cs, chunk, count);
+			chunk = NULL;
+			count = 0;
 			}
 		}
+	closedir(dp);
 
-	cd->tl = NULL;
-	if (cd->list)
-		{
-		FileData *next_fd;
+	if (chunk) cache_manager_standard_clean_push(cs, chunk, count);
+}
 
-		next_fd = cd->list->data;
-		cd->list = g_list_remove(cd->list, next_fd);
+static void cache_manager_standard_clean_run(CacheScrub *cs, gpointer task)
+{
+	CacheScrubChunk *chunk = task;
+	CleanData *cd = cs->data;
+	GList *work;
 
-		cd->tl = thumb_loader_std_thumb_file_validate(next_fd->path, cd->days,
-							      cache_manager_standard_clean_valid_cb, cd);
-		file_data_unref(next_fd);
+	if (chunk->folder)
+		{
+		if (!cache_scrub_cancelled(cs)) cache_manager_standard_clean_list(cs, chunk->folder);
+		g_free(chunk->folder);
 		}
-	else
+
+	work = chunk->paths;
+	while (work && !cache_scrub_cancelled(cs))
 		{
-		cache_manager_standard_clean_done(cd);
+		const gchar *path = work->data;
+
+		/* reads the png header only */
+		if (cd->clear || !thumb_std_cache_file_valid(path, cd->days))
+			{
+			cache_scrub_remove(cs, path);
+			}
+
+		g_atomic_int_inc(&cs->count_done);
+		work = work->next;
 		}
+
+	string_list_free(chunk->paths);
+	g_free(chunk);
 }
 
 static void cache_manager_standard_clean_start(GenericDialog *gd, gpointer data)
 {
 	CleanData *cd = data;
-	GList *list;
-	gchar *path;
-	FileData *dir_fd;
+	const gchar *folders[] = { THUMB_FOLDER_NORMAL, THUMB_FOLDER_LARGE, THUMB_FOLDER_FAIL, NULL };
+	gint i;
 
 	if (!cd->remote)
 	{
-		if (cd->list || !gtk_widget_get_sensitive(cd->button_start)) return;
+		if (cd->cs || !gtk_widget_get_sensitive(cd->button_start)) return;
 
 		gtk_widget_set_sensitive(cd->button_start, FALSE);
 		gtk_widget_set_sensitive(cd->button_stop, TRUE);
@@ -992,38 +1323,20 @@ static void cache_manager_standard_clean_start(GenericDialog *gd, gpointer data)
 		gtk_progress_bar_set_text(GTK_PROGRESS_BAR(cd->progress), _("running..."));
 	}
 
-	path = g_build_filename(get_thumbnails_standard_cache_dir(), THUMB_FOLDER_NORMAL, NULL);
-	dir_fd = file_data_new_dir(path);
-	filelist_read(dir_fd, &list, NULL);
-	cd->list = list;
-	file_data_unref(dir_fd);
-	g_free(path);
-
-	path = g_build_filename(get_thumbnails_standard_cache_dir(), THUMB_FOLDER_LARGE, NULL);
-	dir_fd = file_data_new_dir(path);
-	filelist_read(dir_fd, &list, NULL);
-	cd->list = g_list_concat(cd->list, list);
-	file_data_unref(dir_fd);
-	g_free(path);
+	cd->cs = cache_scrub_new(cache_manager_standard_clean_run, cache_manager_standard_clean_progress, cd);
 
-	path = g_build_filename(get_thumbnails_standard_cache_dir(), THUMB_FOLDER_FAIL, NULL);
-	dir_fd = file_data_new_dir(path);
-	filelist_read(dir_fd, &list, NULL);
-	cd->list = g_list_concat(cd->list, list);
-	file_data_unref(dir_fd);
-	g_free(path);
+	/* the folders are listed by the tasks too */
+	for (i = 0; folders[i]; i++)
+		{
+		CacheScrubChunk *chunk;
+		gchar *path;
 
-	cd->count_total = g_list_length(cd->list);
-	cd->count_done = 0;
+		path = g_build_filename(get_thumbnails_standard_cache_dir(), folders[i], NULL);
+		chunk = g_new0(CacheScrubChunk, 1);
+		chunk->folder = path_from_utf8(path);
+		g_free(path);
 
-	/* start iterating */
-	if (cd->clear)
-		{
-		cd->idle_id = g_idle_add(cache_manager_standard_clean_clear_cb, cd);
-		}
-	else
-		{
-		cache_manager_standard_clean_valid_cb(NULL, TRUE, cd);
+		cache_scrub_push(cd->cs, chunk);
 		}
 }
 
@@ -1077,7 +1390,6 @@ static void cache_manager_standard_process(GtkWidget *widget, gboolean clear)
 	gtk_widget_show(cd->progress);
 
 	cd->days = 30;
-	cd->tl = NULL;
 	cd->idle_id = 0;
 
 	gtk_widget_show(cd->gd->dialog);
@@ -1090,7 +1402,6 @@ void cache_manager_standard_process_remote(gboolean clear)
 	cd = g_new0(CleanData, 1);
 	cd->clear = clear;
 	cd->days = 30;
-	cd->tl = NULL;
 	cd->idle_id = 0;
 	cd->remote = TRUE;
 
@@ -1119,9 +1430,84 @@ static void dummy_cancel_cb(GenericDialog *gd, gpointer data)
 	/* no op, only so cancel button appears */
 }
 
+/* removes the pan view cache, a folder of tiles per layout and a data file per image folder */
+static void cache_manager_pan_clear(void)
+{
+	gchar *pathl;
+	GDir *dir;
+	const gchar *name;
+
+	pathl = path_from_utf8(get_pan_cache_dir());
+	dir = g_dir_open(pathl, 0, NULL);
+	if (!dir)
+		{
+		g_free(pathl);
+		return;
+		}
+
+	while ((name = g_dir_read_name(dir)))
+		{
+		gchar *layoutl;
+		GDir *layout_dir;
+
+		layoutl = g_build_filename(pathl, name, NULL);
+		layout_dir = g_dir_open(layoutl, 0, NULL);
+		if (layout_dir)
+			{
+			const gchar *tile;
+
+			while ((tile = g_dir_read_name(layout_dir)))
+				{
+				gchar *tilel = g_build_filename(layoutl, tile, NULL);
+				g_unlink(tilel);
+				g_free(tilel);
+				}
+			g_dir_close(layout_dir);
+			g_rmdir(layoutl);
+			}
+		else
+			{
+			g_unlink(layoutl);
+			}
+		g_free(layoutl);
+		}
+
+	g_dir_close(dir);
+	g_free(pathl);
+}
+
+/* removes the files of a cache folder without subfolders */
+static void cache_manager_dir_clear(const gchar *path)
+{
+	gchar *pathl;
+	GDir *dir;
+	const gchar *name;
+
+	pathl = path_from_utf8(path);
+	dir = g_dir_open(pathl, 0, NULL);
+	if (!dir)
+		{
+		g_free(pathl);
+		return;
+		}
+
+	while ((name = g_dir_read_name(dir)))
+		{
+		gchar *filel = g_build_filename(pathl, name, NULL);
+		g_unlink(filel);
+		g_free(filel);
+		}
+
+	g_dir_close(dir);
+	g_free(pathl);
+}
+
 static void cache_manager_main_clear_ok_cb(GenericDialog *gd, gpointer data)
 {
 	cache_maintain_home(FALSE, TRUE, NULL);
+	cache_manager_pan_clear();
+	cache_manager_dir_clear(get_color_cache_dir());
+	cache_manager_dir_clear(get_collection_cache_dir());
 }
 
 void cache_manager_main_clear_confirm(GtkWidget *parent)
@@ -0,0 +1,644 @@
+/*
+ * Copyright (C) 2008 - 2016 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "main.h"
+#include "collect-index.h"
+
+#include "cache.h"
+#include "collect.h"
+#include "collect-io.h"
+#include "filedata.h"
+#include "md5-util.h"
+#include "secure_save.h"
+#include "ui_fileops.h"
+
+#include <errno.h>
+
+#define COLLECT_INDEX_MAGIC "GQcolix"
+#define COLLECT_INDEX_VERSION 2
+#define COLLECT_INDEX_BYTE_ORDER 0x01020304
+#define COLLECT_INDEX_EXT ".idx"
+
+/* threads checking the files of collections loaded from an index */
+#define COLLECT_INDEX_CHECK_THREADS 2
+
+/* appended segments before the index is rewritten as one */
+#define COLLECT_INDEX_MAX_SEGMENTS 16
+
+/* the file is the header, then one segment per save that only appended
+ * files to the collection: the segment header, its entries, then
+ * strings_size bytes of nul terminated paths padded to 8 bytes,
+ * all in host byte order */
+typedef struct _CollectIndexHeader CollectIndexHeader;
+struct _CollectIndexHeader
+{
+	gchar magic[8];
+	guint32 version;
+	guint32 byte_order;
+	gint64 source_size;	/* the collection file the index was made from */
+	gint64 source_mtime;
+	gint32 window_read;
+	gint32 window_x;
+	gint32 window_y;
+	gint32 window_w;
+	gint32 window_h;
+	guint32 count;		/* entries of all segments */
+	guint32 segments;
+	guint32 reserved;
+};
+
+typedef struct _CollectIndexSegment CollectIndexSegment;
+struct _CollectIndexSegment
+{
+	guint32 count;
+	guint32 strings_size;
+};
+
+typedef struct _CollectIndexEntry CollectIndexEntry;
+struct _CollectIndexEntry
+{
+	gint64 size;
+	gint64 mtime;
+	guint32 path;		/* offset in the string table */
+	guint32 reserved;
+};
+
+typedef struct _CollectIndexCheck CollectIndexCheck;
+struct _CollectIndexCheck
+{
+	CollectionData *cd;
+	gint count;
+	FileData **fds;
+	gchar **paths;		/* copies, the worker does not touch the FileData */
+	gint64 *sizes;
+	gint64 *mtimes;
+	gint8 *state;		/* COLLECT_INDEX_FILE_* */
+};
+
+enum {
+	COLLECT_INDEX_FILE_OK = 0,
+	COLLECT_INDEX_FILE_CHANGED,
+	COLLECT_INDEX_FILE_MISSING
+};
+
+static GThreadPool *collection_index_check_pool = NULL;
+
+
+static gchar *collection_index_path(const gchar *path)
+{
+	guchar digest[16];
+	gchar *md5;
+	gchar *name;
+	gchar *index_path;
+
+	md5_get_digest((const guchar *)path, strlen(path), digest);
+	md5 = md5_digest_to_text(digest);
+	name = g_strconcat(md5, COLLECT_INDEX_EXT, NULL);
+	index_path = g_build_filename(get_collection_cache_dir(), name, NULL);
+	g_free(name);
+	g_free(md5);
+
+	return index_path;
+}
+
+/*
+ *-------------------------------------------------------------------
+ * existence check
+ *-------------------------------------------------------------------
+ */
+
+static void collection_index_check_free(CollectIndexCheck *check)
+{
+	gint i;
+
+	for (i = 0; i < check->count; i++)
+		{
+		file_data_unref(check->fds[i]);
+		g_free(check->paths[i]);
+		}
+	g_free(check->fds);
+	g_free(check->paths);
+	g_free(check->sizes);
+	g_free(check->mtimes);
+	g_free(check->state);
+	g_free(check);
+}
+
+static gboolean collection_index_check_done_cb(gpointer data)
+{
+	CollectIndexCheck *check = data;
+	CollectionData *cd = check->cd;
+	GHashTable *infos;
+	GList *missing = NULL;
+	GList *work;
+	gint i;
+
+	infos = g_hash_table_new(g_direct_hash, g_direct_equal);
+	for (work = cd->list; work; work = work->next)
+		{
+		CollectInfo *ci = work->data;
+		g_hash_table_insert(infos, ci->fd, ci);
+		}
+
+	for (i = 0; i < check->count; i++)
+		{
+		CollectInfo *ci;
+
+		if (check->state[i] == COLLECT_INDEX_FILE_OK) continue;
+
+		if (check->state[i] == COLLECT_INDEX_FILE_CHANGED)
+			{
+			file_data_check_changed_files(check->fds[i]);
+			continue;
+			}
+
+		ci = g_hash_table_lookup(infos, check->fds[i]);
+		if (ci)
+			{
+			DEBUG_1("collection missing file: %s", check->fds[i]->path);
+			missing = g_list_prepend(missing, ci);
+			}
+		}
+	g_hash_table_destroy(infos);
+
+	if (missing)
+		{
+		/* same as a load from the collection file, which skips them */
+		gboolean changed = cd->changed;
+
+		collection_remove_by_info_list(cd, missing);
+		cd->changed = changed;
+		g_list_free(missing);
+		}
+
+	collection_unref(cd);
+	collection_index_check_free(check);
+
+	return FALSE;
+}
+
+static void collection_index_check_run(gpointer data, gpointer user_data)
+{
+	CollectIndexCheck *check = data;
+	gint i;
+
+	for (i = 0; i < check->count; i++)
+		{
+		struct stat st;
+
+		if (!stat_utf8(check->paths[i], &st) || S_ISDIR(st.st_mode))
+			{
+			check->state[i] = COLLECT_INDEX_FILE_MISSING;
+			}
+		else if (st.st_size != check->sizes[i] || st.st_mtime != check->mtimes[i])
+			{
+			check->state[i] = COLLECT_INDEX_FILE_CHANGED;
+			}
+		}
+
+	g_idle_add(collection_index_check_done_cb, check);
+}
+
+/* files is a list of FileData, as loaded from the index */
+static void collection_index_check_start(CollectionData *cd, GList *files)
+{
+	CollectIndexCheck *check;
+	GList *work;
+	gint i;
+
+	check = g_new0(CollectIndexCheck, 1);
+	check->cd = cd;
+	check->count = g_list_length(files);
+	check->fds = g_new(FileData *, check->count);
+	check->paths = g_new(gchar *, check->count);
+	check->sizes = g_new(gint64, check->count);
+	check->mtimes = g_new(gint64, check->count);
+	check->state = g_new0(gint8, check->count);
+
+	i = 0;
+	for (work = files; work; work = work->next)
+		{
+		FileData *fd = work->data;
+
+		check->fds[i] = file_data_ref(fd);
+		check->paths[i] = g_strdup(fd->path);
+		check->sizes[i] = fd->size;
+		check->mtimes[i] = fd->date;
+		i++;
+		}
+
+	collection_ref(cd);
+
+#ifdef HAVE_GTHREAD
+	if (!collection_index_check_pool)
+		{
+		collection_index_check_pool = g_thread_pool_new(collection_index_check_run, NULL,
+								COLLECT_INDEX_CHECK_THREADS, FALSE, NULL);
+		}
+	g_thread_pool_push(collection_index_check_pool, check, NULL);
+#else
+	collection_index_check_run(check, NULL);
+#endif
+}
+
+/*
+ *-------------------------------------------------------------------
+ * load, save
+ *-------------------------------------------------------------------
+ */
+
+/* steps over the segment at *offset, returns FALSE when it is not complete */
+static gboolean collection_index_segment_next(const gchar *data, gsize len, gsize *offset,
+					      const CollectIndexSegment **segment,
+					      const CollectIndexEntry **entries, const gchar **strings)
+{
+	const CollectIndexSegment *seg;
+	gsize pos = *offset;
+
+	if (len - pos < sizeof(CollectIndexSegment)) return FALSE;
+	seg = (const CollectIndexSegment *)(data + pos);
+	pos += sizeof(CollectIndexSegment);
+
+	if (seg->count > (len - pos) / sizeof(CollectIndexEntry)) return FALSE;
+	*entries = (const CollectIndexEntry *)(data + pos);
+	pos += (gsize)seg->count * sizeof(CollectIndexEntry);
+
+	if (seg->strings_size > len - pos || seg->strings_size % 8 != 0) return FALSE;
+	*strings = data + pos;
+	if (seg->count > 0 && (seg->strings_size == 0 || (*strings)[seg->strings_size - 1] != '\0')) return FALSE;
+	pos += seg->strings_size;
+
+	*segment = seg;
+	*offset = pos;
+	return TRUE;
+}
+
+static gboolean collection_index_valid(const gchar *data, gsize len)
+{
+	const CollectIndexHeader *header = (const CollectIndexHeader *)data;
+	gsize offset = sizeof(CollectIndexHeader);
+	guint32 count = 0;
+	guint32 i;
+
+	for (i = 0; i < header->segments; i++)
+		{
+		const CollectIndexSegment *segment;
+		const CollectIndexEntry *entries;
+		const gchar *strings;
+
+		if (!collection_index_segment_next(data, len, &offset, &segment, &entries, &strings)) return FALSE;
+		count += segment->count;
+		}
+
+	return (offset == len && count == header->count);
+}
+
+/* returns FALSE when there is no valid index for path, nothing is changed then */
+gboolean collection_index_load(CollectionData *cd, const gchar *path, gboolean only_geometry, gboolean *has_geometry)
+{
+	gchar *index_path;
+	gchar *pathl;
+	GMappedFile *mapped;
+	struct stat st;
+	const gchar *data;
+	gsize len;
+	const CollectIndexHeader *header;
+	GList *files = NULL;
+	GList *work;
+	GPtrArray *saved;
+	gboolean window_read;
+	gsize offset;
+	guint32 i;
+
+	if (!stat_utf8(path, &st)) return FALSE;
+
+	index_path = collection_index_path(path);
+	pathl = path_from_utf8(index_path);
+	mapped = g_mapped_file_new(pathl, FALSE, NULL);
+	g_free(pathl);
+	if (!mapped)
+		{
+		g_free(index_path);
+		return FALSE;
+		}
+
+	data = g_mapped_file_get_contents(mapped);
+	len = g_mapped_file_get_length(mapped);
+	header = (const CollectIndexHeader *)data;
+
+	if (len < sizeof(CollectIndexHeader) ||
+	    memcmp(header->magic, COLLECT_INDEX_MAGIC, sizeof(header->magic)) != 0 ||
+	    header->version != COLLECT_INDEX_VERSION ||
+	    header->byte_order != COLLECT_INDEX_BYTE_ORDER ||
+	    header->source_size != (gint64)st.st_size ||
+	    header->source_mtime != (gint64)st.st_mtime ||
+	    !collection_index_valid(data, len))
+		{
+		DEBUG_1("collection index out of date: %s", index_path);
+		g_mapped_file_unref(mapped);
+		g_free(index_path);
+		return FALSE;
+		}
+
+	DEBUG_1("collection load from index: %s (%u files)", index_path, header->count);
+	g_free(index_path);
+
+	if (header->window_read)
+		{
+		cd->window_x = header->window_x;
+		cd->window_y = header->window_y;
+		cd->window_w = header->window_w;
+		cd->window_h = header->window_h;
+		cd->window_read = TRUE;
+		}
+	window_read = !!header->window_read;
+	if (has_geometry) *has_geometry = window_read;
+
+	if (only_geometry)
+		{
+		g_mapped_file_unref(mapped);
+		return TRUE;
+		}
+
+	offset = sizeof(CollectIndexHeader);
+	for (i = 0; i < header->segments; i++)
+		{
+		const CollectIndexSegment *segment;
+		const CollectIndexEntry *entries;
+		const gchar *strings;
+		guint32 j;
+
+		collection_index_segment_next(data, len, &offset, &segment, &entries, &strings);
+		for (j = 0; j < segment->count; j++)
+			{
+			if (entries[j].path >= segment->strings_size) continue;
+
+			files = g_list_prepend(files, file_data_new_cached(strings + entries[j].path,
+									   entries[j].size, (time_t)entries[j].mtime));
+			}
+		}
+	g_mapped_file_unref(mapped);
+
+	files = g_list_reverse(files);
+	collection_add_filelist(cd, files, FALSE, FALSE);
+
+	/* the files as they are in the collection file, a save appends to them */
+	saved = g_ptr_array_new();
+	for (work = files; work; work = work->next) g_ptr_array_add(saved, file_data_ref(work->data));
+	collection_saved_set(cd, path, saved, window_read);
+
+	/* the files are shown right away, missing ones are dropped when the check is done */
+	if (files) collection_index_check_start(cd, files);
+	filelist_free(files);
+
+	return TRUE;
+}
+
+static void collection_index_header_init(CollectIndexHeader *header, CollectionData *cd, struct stat *st)
+{
+	memset(header, 0, sizeof(*header));
+	memcpy(header->magic, COLLECT_INDEX_MAGIC, sizeof(header->magic));
+	header->version = COLLECT_INDEX_VERSION;
+	header->byte_order = COLLECT_INDEX_BYTE_ORDER;
+	header->source_size = st->st_size;
+	header->source_mtime = st->st_mtime;
+	header->window_read = cd->window_read;
+	header->window_x = cd->window_x;
+	header->window_y = cd->window_y;
+	header->window_w = cd->window_w;
+	header->window_h = cd->window_h;
+}
+
+/* the segment header for the files of list from work on */
+static void collection_index_segment_init(CollectIndexSegment *segment, GList *work)
+{
+	memset(segment, 0, sizeof(*segment));
+
+	for (; work; work = work->next)
+		{
+		CollectInfo *ci = work->data;
+
+		segment->count++;
+		segment->strings_size += strlen(ci->fd->path) + 1;
+		}
+	segment->strings_size = (segment->strings_size + 7) & ~7;
+}
+
+static void collection_index_entry_init(CollectIndexEntry *entry, FileData *fd, guint32 offset)
+{
+	memset(entry, 0, sizeof(*entry));
+	entry->size = fd->size;
+	entry->mtime = fd->date;
+	entry->path = offset;
+}
+
+/* path is the collection file, which must be saved already */
+void collection_index_save(CollectionData *cd, const gchar *path)
+{
+	static const gchar padding[8] = { 0 };
+	CollectIndexHeader header;
+	CollectIndexSegment segment;
+	SecureSaveInfo *ssi;
+	struct stat st;
+	gchar *index_path;
+	gchar *pathl;
+	GList *work;
+	guint32 offset;
+
+	if (!stat_utf8(path, &st)) return;
+	if (!recursive_mkdir_if_not_exists(get_collection_cache_dir(), 0755)) return;
+
+	collection_index_header_init(&header, cd, &st);
+	collection_index_segment_init(&segment, cd->list);
+	header.count = segment.count;
+	header.segments = 1;
+
+	index_path = collection_index_path(path);
+	pathl = path_from_utf8(index_path);
+	ssi = secure_open(pathl);
+	g_free(pathl);
+	if (!ssi)
+		{
+		log_printf("Unable to save collection index: %s\n", index_path);
+		g_free(index_path);
+		return;
+		}
+
+	secure_fwrite(&header, sizeof(header), 1, ssi);
+	secure_fwrite(&segment, sizeof(segment), 1, ssi);
+
+	offset = 0;
+	for (work = cd->list; work && secsave_errno == SS_ERR_NONE; work = work->next)
+		{
+		CollectInfo *ci = work->data;
+		CollectIndexEntry entry;
+
+		collection_index_entry_init(&entry, ci->fd, offset);
+		offset += strlen(ci->fd->path) + 1;
+
+		secure_fwrite(&entry, sizeof(entry), 1, ssi);
+		}
+
+	for (work = cd->list; work && secsave_errno == SS_ERR_NONE; work = work->next)
+		{
+		CollectInfo *ci = work->data;
+
+		secure_fwrite(ci->fd->path, strlen(ci->fd->path) + 1, 1, ssi);
+		}
+	if (segment.strings_size > offset) secure_fwrite(padding, segment.strings_size - offset, 1, ssi);
+
+	if (secure_close(ssi))
+		{
+		log_printf(_("error saving collection index: %s\nerror: %s\n"), index_path,
+			   secsave_strerror(secsave_errno));
+		}
+
+	g_free(index_path);
+}
+
+static gboolean collection_index_write_at(gint fd, gint64 offset, gconstpointer buf, gsize len)
+{
+	gsize written = 0;
+
+	while (written < len)
+		{
+		gssize n = pwrite(fd, (const gchar *)buf + written, len - written, offset + written);
+
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) return FALSE;
+		written += n;
+		}
+
+	return TRUE;
+}
+
+/* adds the files of the list from first on as a new segment, after the collection
+ * file was appended to, source_size and source_mtime are its state before,
+ * returns FALSE when the index has to be rewritten
+ */
+gboolean collection_index_append(CollectionData *cd, const gchar *path, guint first,
+				 gint64 source_size, gint64 source_mtime)
+{
+	CollectIndexHeader header;
+	CollectIndexHeader expected;
+	CollectIndexSegment segment;
+	struct stat st;
+	struct stat index_st;
+	GByteArray *buf;
+	gchar *index_path;
+	gchar *pathl;
+	GList *start;
+	GList *work;
+	guint32 offset;
+	gboolean success;
+	gint fd;
+
+	if (!stat_utf8(path, &st)) return FALSE;
+	start = g_list_nth(cd->list, first);
+	if (!start) return FALSE;
+
+	index_path = collection_index_path(path);
+	pathl = path_from_utf8(index_path);
+	fd = open(pathl, O_RDWR);
+	g_free(pathl);
+	if (fd < 0)
+		{
+		g_free(index_path);
+		return FALSE;
+		}
+
+	/* the index must be the one of the file before the append, with the same geometry */
+	collection_index_header_init(&expected, cd, &st);
+	if (pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+	    fstat(fd, &index_st) != 0 ||
+	    memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 ||
+	    header.version != expected.version ||
+	    header.byte_order != expected.byte_order ||
+	    header.source_size != source_size ||
+	    header.source_mtime != source_mtime ||
+	    header.window_read != expected.window_read ||
+	    (header.window_read &&
+	     (header.window_x != expected.window_x || header.window_y != expected.window_y ||
+	      header.window_w != expected.window_w || header.window_h != expected.window_h)) ||
+	    header.count != first ||
+	    header.segments >= COLLECT_INDEX_MAX_SEGMENTS)
+		{
+		close(fd);
+		g_free(index_path);
+		return FALSE;
+		}
+
+	collection_index_segment_init(&segment, start);
+
+	buf = g_byte_array_sized_new(sizeof(segment) + segment.count * sizeof(CollectIndexEntry) + segment.strings_size);
+	g_byte_array_append(buf, (const guint8 *)&segment, sizeof(segment));
+
+	offset = 0;
+	for (work = start; work; work = work->next)
+		{
+		CollectInfo *ci = work->data;
+		CollectIndexEntry entry;
+
+		collection_index_entry_init(&entry, ci->fd, offset);
+		offset += strlen(ci->fd->path) + 1;
+
+		g_byte_array_append(buf, (const guint8 *)&entry, sizeof(entry));
+		}
+	for (work = start; work; work = work->next)
+		{
+		CollectInfo *ci = work->data;
+
+		g_byte_array_append(buf, (const guint8 *)ci->fd->path, strlen(ci->fd->path) + 1);
+		}
+	while (offset < segment.strings_size)
+		{
+		static const guint8 nul = 0;
+
+		g_byte_array_append(buf, &nul, 1);
+		offset++;
+		}
+
+	/* the header is written last, until then the index stays out of date */
+	header.count += segment.count;
+	header.segments++;
+	header.source_size = st.st_size;
+	header.source_mtime = st.st_mtime;
+
+	success = collection_index_write_at(fd, index_st.st_size, buf->data, buf->len);
+#ifdef HAVE_FSYNC
+	if (success) success = (fsync(fd) == 0);
+#endif
+	if (success) success = collection_index_write_at(fd, 0, &header, sizeof(header));
+
+	if (!success)
+		{
+		log_printf(_("error saving collection index: %s\nerror: %s\n"), index_path, g_strerror(errno));
+		if (ftruncate(fd, index_st.st_size) != 0) DEBUG_1("collection index not truncated: %s", index_path);
+		}
+	else
+		{
+		DEBUG_1("collection index appended %u files: %s", segment.count, index_path);
+		}
+
+	g_byte_array_free(buf, TRUE);
+	close(fd);
+	g_free(index_path);
+
+	return success;
+}
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) 2008 - 2016 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef COLLECT_INDEX_H
+#define COLLECT_INDEX_H
+
+/* Binary index of a collection file, kept in get_collection_cache_dir().
+ * It holds the paths in string tables with the size and date of each file,
+ * and is only used while the collection file is unchanged since it was made.
+ * A save that only appends files to the collection appends them to the
+ * index as a new segment, after a few segments it is rewritten as one.
+ */
+
+gboolean collection_index_load(CollectionData *cd, const gchar *path, gboolean only_geometry, gboolean *has_geometry);
+void collection_index_save(CollectionData *cd, const gchar *path);
+gboolean collection_index_append(CollectionData *cd, const gchar *path, guint first,
+				 gint64 source_size, gint64 source_mtime);
+
+#endif
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -23,6 +23,7 @@
 #include "collect-io.h"
 
 #include "collect.h"
+#include "collect-index.h"
 #include "filedata.h"
 #include "layout_util.h"
 #include "misc.h"
@@ -30,11 +31,15 @@
 #include "thumb.h"
 #include "ui_fileops.h"
 
+#include <errno.h>
+
 #define GQ_COLLECTION_MARKER "#" GQ_APPNAME
 
 #define GQ_COLLECTION_FAIL_MIN     300
 #define GQ_COLLECTION_FAIL_PERCENT 98
 #define GQ_COLLECTION_READ_BUFSIZE 4096
+/* files added to the collection at once while loading */
+#define GQ_COLLECTION_LOAD_BATCH   1024
 
 typedef struct _CollectManagerEntry CollectManagerEntry;
 
@@ -44,6 +49,7 @@ static gboolean collection_save_private(CollectionData *cd, const gchar *path);
 static CollectManagerEntry *collect_manager_get_entry(const gchar *path);
 static void collect_manager_entry_reset(CollectManagerEntry *entry);
 static gint collect_manager_process_action(CollectManagerEntry *entry, gchar **path_ptr);
+static gboolean collect_manager_entry_has_actions(CollectManagerEntry *entry);
 
 
 static gboolean scan_geometry(gchar *buffer, gint *x, gint *y, gint *w, gint *h)
@@ -60,6 +66,24 @@ static gboolean scan_geometry(gchar *buffer, gint *x, gint *y, gint *w, gint *h)
 	return TRUE;
 }
 
+/* adds the batch of FileData, returns the number of files that could not be added */
+static guint collection_load_batch(CollectionData *cd, GList **batch)
+{
+	guint count;
+	guint added;
+
+	if (!*batch) return 0;
+
+	*batch = g_list_reverse(*batch);
+	count = g_list_length(*batch);
+	added = collection_add_filelist(cd, *batch, FALSE, TRUE);
+
+	filelist_free(*batch);
+	*batch = NULL;
+
+	return count - added;
+}
+
 static gboolean collection_load_private(CollectionData *cd, const gchar *path, CollectionLoadFlags flags)
 {
 	gchar s_buf[GQ_COLLECTION_READ_BUFSIZE];
@@ -73,6 +97,8 @@ static gboolean collection_load_private(CollectionData *cd, const gchar *path, C
 	gboolean need_header	 = TRUE;
 	guint total = 0;
 	guint fail = 0;
+	GList *batch = NULL;
+	guint batch_count = 0;
 	gboolean changed = FALSE;
 	CollectManagerEntry *entry = NULL;
 	guint flush = !!(flags & COLLECTION_LOAD_FLUSH);
@@ -99,6 +125,20 @@ static gboolean collection_load_private(CollectionData *cd, const gchar *path, C
 
 	if (!path) path = cd->path;
 
+	/* pending actions are applied while reading the collection file */
+	if (!collect_manager_entry_has_actions(entry) &&
+	    collection_index_load(cd, path, only_geometry, &has_geometry_header))
+		{
+		if (only_geometry) return has_geometry_header;
+
+		cd->list = collection_list_sort(cd->list, cd->sort_method);
+
+		if (!flush) collect_manager_entry_reset(entry);
+		if (!append) cd->changed = FALSE;
+
+		return TRUE;
+		}
+
 	pathl = path_from_utf8(path);
 
 	DEBUG_1("collection load: append=%d flush=%d only_geometry=%d path=%s",
@@ -165,30 +205,42 @@ static gboolean collection_load_private(CollectionData *cd, const gchar *path, C
 		*p = 0;
 		if (*buf)
 			{
-			gboolean valid;
-
 			if (!flush)
 				changed |= collect_manager_process_action(entry, &buf);
 
-			valid = (buf[0] == G_DIR_SEPARATOR && collection_add_check(cd, file_data_new_simple(buf), FALSE, TRUE));
-			if (!valid) DEBUG_1("collection invalid file: %s", buf);
-
 			total++;
-			if (!valid)
+			if (buf[0] == G_DIR_SEPARATOR)
+				{
+				batch = g_list_prepend(batch, file_data_new_simple(buf));
+				batch_count++;
+				}
+			else
 				{
+				DEBUG_1("collection invalid file: %s", buf);
 				fail++;
-				if (limit_failures &&
-				    fail > GQ_COLLECTION_FAIL_MIN &&
-				    fail * 100 / total > GQ_COLLECTION_FAIL_PERCENT)
-					{
-					log_printf("%d invalid filenames in unofficial collection file, closing: %s\n", fail, path);
-					success = FALSE;
-					break;
-					}
+				}
+
+			/* files are checked and added a batch at a time */
+			if (batch_count >= GQ_COLLECTION_LOAD_BATCH)
+				{
+				fail += collection_load_batch(cd, &batch);
+				batch_count = 0;
+				}
+
+			if (limit_failures &&
+			    fail > GQ_COLLECTION_FAIL_MIN &&
+			    fail * 100 / total > GQ_COLLECTION_FAIL_PERCENT)
+				{
+				log_printf("%d invalid filenames in unofficial collection file, closing: %s\n", fail, path);
+				success = FALSE;
+				break;
 				}
 			}
 		}
 
+	if (success) fail += collection_load_batch(cd, &batch);
+	filelist_free(batch);
+
 	DEBUG_1("collection files: total = %d fail = %d official=%d gqview=%d geometry=%d",
 			  total, fail, has_official_header, has_gqview_header, has_geometry_header);
 
@@ -334,11 +386,190 @@ void collection_load_stop(CollectionData *cd)
 	cd->thumb_loader = NULL;
 }
 
+/*
+ *-------------------------------------------------------------------
+ * incremental save
+ *-------------------------------------------------------------------
+ */
+
+static gchar *collection_geometry_text(CollectionData *cd)
+{
+	return g_strdup_printf("%d %d %d %d", cd->window_x, cd->window_y, cd->window_w, cd->window_h);
+}
+
+static void collection_saved_files_free(GPtrArray *files)
+{
+	guint i;
+
+	if (!files) return;
+
+	for (i = 0; i < files->len; i++) file_data_unref(g_ptr_array_index(files, i));
+	g_ptr_array_free(files, TRUE);
+}
+
+void collection_saved_clear(CollectionData *cd)
+{
+	collection_saved_files_free(cd->saved_files);
+	cd->saved_files = NULL;
+
+	g_free(cd->saved_path);
+	cd->saved_path = NULL;
+	g_free(cd->saved_geometry);
+	cd->saved_geometry = NULL;
+}
+
+/* path is the collection file just written or read with the files in file order,
+ * with_geometry when it has the current geometry of cd */
+void collection_saved_set(CollectionData *cd, const gchar *path, GPtrArray *files, gboolean with_geometry)
+{
+	struct stat st;
+
+	collection_saved_clear(cd);
+
+	if (!stat_utf8(path, &st))
+		{
+		collection_saved_files_free(files);
+		return;
+		}
+
+	cd->saved_path = g_strdup(path);
+	cd->saved_files = files;
+	cd->saved_geometry = with_geometry ? collection_geometry_text(cd) : NULL;
+	cd->saved_size = st.st_size;
+	cd->saved_mtime = st.st_mtime;
+}
+
+/* appends the files added at the end of the list since the last save to the
+ * collection file, returns FALSE when the file has to be rewritten,
+ * first is the position of the first added file
+ */
+static gboolean collection_save_append(CollectionData *cd, const gchar *path, guint *first)
+{
+	struct stat st;
+	GString *text;
+	GList *work;
+	gchar *geometry;
+	gchar *pathl;
+	gchar end[5];
+	gint64 offset;
+	gssize written = 0;
+	guint i;
+	gint fd;
+
+	if (!cd->saved_files || strcmp(path, cd->saved_path) != 0) return FALSE;
+
+	/* the geometry is only read from the top of the file */
+	geometry = cd->window_read ? collection_geometry_text(cd) : NULL;
+	if (g_strcmp0(geometry, cd->saved_geometry) != 0)
+		{
+		g_free(geometry);
+		return FALSE;
+		}
+	g_free(geometry);
+
+	work = cd->list;
+	for (i = 0; i < cd->saved_files->len; i++)
+		{
+		CollectInfo *ci;
+
+		if (!work) return FALSE;
+		ci = work->data;
+		if (ci->fd != g_ptr_array_index(cd->saved_files, i)) return FALSE;
+		work = work->next;
+		}
+
+	pathl = path_from_utf8(path);
+	fd = open(pathl, O_RDWR);
+	g_free(pathl);
+	if (fd < 0) return FALSE;
+
+	/* changed by someone else, the collection manager for example */
+	if (fstat(fd, &st) != 0 || st.st_size != cd->saved_size || st.st_mtime != cd->saved_mtime)
+		{
+		close(fd);
+		return FALSE;
+		}
+
+	*first = cd->saved_files->len;
+	if (!work)
+		{
+		close(fd);
+		return TRUE;
+		}
+
+	/* the new files replace the end marker */
+	offset = st.st_size;
+	if (offset >= (gint64)sizeof(end) && pread(fd, end, sizeof(end), offset - sizeof(end)) == sizeof(end) &&
+	    memcmp(end, "#end\n", sizeof(end)) == 0)
+		{
+		offset -= sizeof(end);
+		}
+
+	text = g_string_new(NULL);
+	for (; work; work = work->next)
+		{
+		CollectInfo *ci = work->data;
+
+		g_string_append_printf(text, "\"%s\"\n", ci->fd->path);
+		}
+	g_string_append(text, "#end\n");
+
+	while (written < (gssize)text->len)
+		{
+		gssize n = pwrite(fd, text->str + written, text->len - written, offset + written);
+
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) break;
+		written += n;
+		}
+#ifdef HAVE_FSYNC
+	if (written == (gssize)text->len && fsync(fd) != 0) written = -1;
+#endif
+
+	if (written != (gssize)text->len)
+		{
+		/* put the file back as it was */
+		log_printf(_("error saving collection file: %s\nerror: %s\n"), path, g_strerror(errno));
+		if (ftruncate(fd, offset) != 0 ||
+		    (offset < (gint64)st.st_size && pwrite(fd, "#end\n", sizeof(end), offset) != sizeof(end)))
+			{
+			log_printf("collection file may be incomplete: %s\n", path);
+			}
+		g_string_free(text, TRUE);
+		close(fd);
+		collection_saved_clear(cd);
+		return FALSE;
+		}
+	g_string_free(text, TRUE);
+
+	if (fstat(fd, &st) == 0)
+		{
+		cd->saved_size = st.st_size;
+		cd->saved_mtime = st.st_mtime;
+		}
+	close(fd);
+
+	for (work = g_list_nth(cd->list, *first); work; work = work->next)
+		{
+		CollectInfo *ci = work->data;
+
+		g_ptr_array_add(cd->saved_files, file_data_ref(ci->fd));
+		}
+
+	DEBUG_1("collection appended %u files: %s", cd->saved_files->len - *first, path);
+
+	return TRUE;
+}
+
 static gboolean collection_save_private(CollectionData *cd, const gchar *path)
 {
 	SecureSaveInfo *ssi;
+	GPtrArray *files;
 	GList *work;
 	gchar *pathl;
+	guint first;
+	gint64 index_size;
+	gint64 index_mtime;
 
 	if (!path && !cd->path) return FALSE;
 
@@ -347,6 +578,22 @@ static gboolean collection_save_private(CollectionData *cd, const gchar *path)
 		path = cd->path;
 		}
 
+	collection_update_geometry(cd);
+
+	index_size = cd->saved_size;
+	index_mtime = cd->saved_mtime;
+	if (collection_save_append(cd, path, &first))
+		{
+		cd->changed = FALSE;
+
+		if (first < cd->saved_files->len &&
+		    !collection_index_append(cd, path, first, index_size, index_mtime))
+			{
+			collection_index_save(cd, path);
+			}
+
+		return TRUE;
+		}
 
 	pathl = path_from_utf8(path);
 	ssi = secure_open(pathl);
@@ -360,17 +607,18 @@ static gboolean collection_save_private(CollectionData *cd, const gchar *path)
 	secure_fprintf(ssi, "%s collection\n", GQ_COLLECTION_MARKER);
 	secure_fprintf(ssi, "#created with %s version %s\n", GQ_APPNAME, VERSION);
 
-	collection_update_geometry(cd);
 	if (cd->window_read)
 		{
 		secure_fprintf(ssi, "#geometry: %d %d %d %d\n", cd->window_x, cd->window_y, cd->window_w, cd->window_h);
 		}
 
+	files = g_ptr_array_sized_new(g_list_length(cd->list));
 	work = cd->list;
 	while (work && secsave_errno == SS_ERR_NONE)
 		{
 		CollectInfo *ci = work->data;
 		secure_fprintf(ssi, "\"%s\"\n", ci->fd->path);
+		g_ptr_array_add(files, file_data_ref(ci->fd));
 		work = work->next;
 		}
 
@@ -380,9 +628,13 @@ static gboolean collection_save_private(CollectionData *cd, const gchar *path)
 		{
 		log_printf(_("error saving collection file: %s\nerror: %s\n"), path,
 			    secsave_strerror(secsave_errno));
+		collection_saved_clear(cd);
+		collection_saved_files_free(files);
 		return FALSE;
 		}
 
+	collection_saved_set(cd, path, files, cd->window_read);
+
 	if (!cd->path || strcmp(path, cd->path) != 0)
 		{
 		gchar *buf = cd->path;
@@ -398,6 +650,8 @@ static gboolean collection_save_private(CollectionData *cd, const gchar *path)
 
 	cd->changed = FALSE;
 
+	collection_index_save(cd, path);
+
 	return TRUE;
 }
 
@@ -556,6 +810,11 @@ static void collect_manager_entry_reset(CollectManagerEntry *entry)
 	collect_manager_entry_init_data(entry);
 }
 
+static gboolean collect_manager_entry_has_actions(CollectManagerEntry *entry)
+{
+	return (entry && !entry->empty);
+}
+
 static CollectManagerEntry *collect_manager_get_entry(const gchar *path)
 {
 	GList *work;
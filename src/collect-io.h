@@ -38,6 +38,10 @@ void collection_load_thumb_idle(CollectionData *cd);
 
 gboolean collection_save(CollectionData *cd, const gchar *path);
 
+/* the state of the collection file for incremental saves, files is taken */
+void collection_saved_set(CollectionData *cd, const gchar *path, GPtrArray *files, gboolean with_geometry);
+void collection_saved_clear(CollectionData *cd);
+
 gboolean collection_load_only_geometry(CollectionData *cd, const gchar *path);
 
 
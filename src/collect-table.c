@@ -1925,16 +1925,9 @@ static void collection_table_sync_idle(CollectTable *ct)
 
 void collection_table_add_filelist(CollectTable *ct, GList *list)
 {
-	GList *work;
-
 	if (!list) return;
 
-	work = list;
-	while (work)
-		{
-		collection_add(ct->cd, (FileData *)work->data, FALSE);
-		work = work->next;
-		}
+	collection_add_filelist(ct->cd, list, FALSE, TRUE);
 }
 
 static void collection_table_insert_filelist(CollectTable *ct, GList *list, CollectInfo *insert_info)
@@ -44,6 +44,10 @@
 #define COLLECT_DEF_WIDTH 440
 #define COLLECT_DEF_HEIGHT 450
 
+/* threads and files per task checking that added files exist */
+#define COLLECT_STAT_THREADS 4
+#define COLLECT_STAT_CHUNK 256
+
 /**
  *  list of paths to collections */
 
@@ -65,13 +69,14 @@ static void collection_window_get_geometry(CollectWindow *cw);
 static void collection_window_refresh(CollectWindow *cw);
 static void collection_window_update_title(CollectWindow *cw);
 static void collection_window_add(CollectWindow *cw, CollectInfo *ci);
+static void collection_window_add_batch(CollectWindow *cw);
 static void collection_window_insert(CollectWindow *cw, CollectInfo *ci);
 static void collection_window_remove(CollectWindow *cw, CollectInfo *ci);
 static void collection_window_update(CollectWindow *cw, CollectInfo *ci);
 
 static void collection_window_close(CollectWindow *cw);
 
-static void collection_notify_cb(FileData *fd, NotifyType type, gpointer data);
+static void collection_notify_batch_cb(const FileDataNotifyEvent *events, guint count, gpointer data);
 
 /*
  *-------------------------------------------------------------------
@@ -180,10 +185,8 @@ static gint collection_list_sort_cb(gconstpointer a, gconstpointer b)
 			break;
 		}
 
-	if (options->file_sort.case_sensitive)
-		return strcmp(cia->fd->collate_key_name, cib->fd->collate_key_name);
-	else
-		return strcmp(cia->fd->collate_key_name_nocase, cib->fd->collate_key_name_nocase);
+	return strcmp(file_data_get_collate_key(cia->fd, options->file_sort.case_sensitive),
+		      file_data_get_collate_key(cib->fd, options->file_sort.case_sensitive));
 }
 
 GList *collection_list_sort(GList *list, SortType method)
@@ -234,6 +237,43 @@ GList *collection_list_add(GList *list, CollectInfo *ci, SortType method)
 	return list;
 }
 
+/* merges two lists sorted by method, in one pass */
+GList *collection_list_merge(GList *list, GList *add, SortType method)
+{
+	GList *head = NULL;
+	GList *tail = NULL;
+
+	if (method == SORT_NONE) return g_list_concat(list, add);
+
+	collection_list_sort_method = method;
+
+	while (list || add)
+		{
+		GList *link;
+
+		if (!add || (list && collection_list_sort_cb(list->data, add->data) <= 0))
+			{
+			link = list;
+			list = list->next;
+			}
+		else
+			{
+			link = add;
+			add = add->next;
+			}
+
+		link->prev = tail;
+		link->next = NULL;
+		if (tail)
+			tail->next = link;
+		else
+			head = link;
+		tail = link;
+		}
+
+	return head;
+}
+
 GList *collection_list_insert(GList *list, CollectInfo *ci, CollectInfo *insert_ci, SortType method)
 {
 	if (method != SORT_NONE)
@@ -412,7 +452,7 @@ CollectionData *collection_new(const gchar *path)
 		untitled_counter++;
 		}
 
-	file_data_register_notify_func(collection_notify_cb, cd, NOTIFY_PRIORITY_MEDIUM);
+	file_data_register_notify_batch_func(collection_notify_batch_cb, cd, NOTIFY_PRIORITY_MEDIUM);
 
 
 	collection_list = g_list_append(collection_list, cd);
@@ -429,11 +469,12 @@ void collection_free(CollectionData *cd)
 	collection_load_stop(cd);
 	collection_list_free(cd->list);
 
-	file_data_unregister_notify_func(collection_notify_cb, cd);
+	file_data_unregister_notify_batch_func(collection_notify_batch_cb, cd);
 
 	collection_list = g_list_remove(collection_list, cd);
 
 	g_hash_table_destroy(cd->existence);
+	collection_saved_clear(cd);
 
 	g_free(cd->path);
 	g_free(cd->name);
@@ -713,6 +754,160 @@ gboolean collection_add_check(CollectionData *cd, FileData *fd, gboolean sorted,
 	return valid;
 }
 
+typedef struct _CollectStatChunk CollectStatChunk;
+struct _CollectStatChunk
+{
+	FileData **fds;
+	gboolean *valid;
+	gint count;
+	GAsyncQueue *done;	/* gets the chunk when checked */
+};
+
+static void collection_stat_chunk(CollectStatChunk *chunk)
+{
+	gint i;
+
+	for (i = 0; i < chunk->count; i++)
+		{
+		struct stat st;
+
+		chunk->valid[i] = (stat_utf8(chunk->fds[i]->path, &st) && !S_ISDIR(st.st_mode));
+		}
+}
+
+#ifdef HAVE_GTHREAD
+static GThreadPool *collection_stat_pool = NULL;
+
+static void collection_stat_thread_run(gpointer data, gpointer user_data)
+{
+	CollectStatChunk *chunk = data;
+
+	collection_stat_chunk(chunk);
+	g_async_queue_push(chunk->done, chunk);
+}
+#endif
+
+/* checks fds exist and are not folders, a large batch is spread over threads */
+static void collection_stat_files(FileData **fds, gboolean *valid, gint count)
+{
+	CollectStatChunk *chunks;
+	gint n;
+	gint i;
+
+	n = (count + COLLECT_STAT_CHUNK - 1) / COLLECT_STAT_CHUNK;
+	chunks = g_new0(CollectStatChunk, n);
+	for (i = 0; i < n; i++)
+		{
+		chunks[i].fds = fds + i * COLLECT_STAT_CHUNK;
+		chunks[i].valid = valid + i * COLLECT_STAT_CHUNK;
+		chunks[i].count = MIN(COLLECT_STAT_CHUNK, count - i * COLLECT_STAT_CHUNK);
+		}
+
+#ifdef HAVE_GTHREAD
+	if (n > 1)
+		{
+		GAsyncQueue *done;
+
+		if (!collection_stat_pool)
+			{
+			collection_stat_pool = g_thread_pool_new(collection_stat_thread_run, NULL,
+								 COLLECT_STAT_THREADS, FALSE, NULL);
+			}
+
+		done = g_async_queue_new();
+		for (i = 0; i < n; i++)
+			{
+			chunks[i].done = done;
+			g_thread_pool_push(collection_stat_pool, &chunks[i], NULL);
+			}
+
+		/* returns when all chunks are done */
+		for (i = 0; i < n; i++) g_async_queue_pop(done);
+		g_async_queue_unref(done);
+		g_free(chunks);
+		return;
+		}
+#endif
+
+	for (i = 0; i < n; i++) collection_stat_chunk(&chunks[i]);
+	g_free(chunks);
+}
+
+/**
+ * @brief Adds a list of FileData in one batch.
+ * @param sorted insert in the sort order of the collection, otherwise append
+ * @param must_exist skip files that do not exist, checked in parallel
+ * @returns number of files added, duplicates and missing files are skipped
+ *
+ * The list is merged in one pass and the window is updated once,
+ * use this instead of collection_add() for more than a few files.
+ */
+gint collection_add_filelist(CollectionData *cd, GList *list, gboolean sorted, gboolean must_exist)
+{
+	FileData **fds;
+	gboolean *valid;
+	GList *add = NULL;
+	GList *work;
+	gint count;
+	gint added = 0;
+	gint i;
+
+	count = g_list_length(list);
+	if (count == 0) return 0;
+
+	fds = g_new(FileData *, count);
+	valid = g_new(gboolean, count);
+
+	i = 0;
+	for (work = list; work; work = work->next)
+		{
+		FileData *fd = work->data;
+
+		g_assert(fd->magick == FD_MAGICK);
+		fds[i] = fd;
+		valid[i] = TRUE;
+		i++;
+		}
+
+	if (must_exist) collection_stat_files(fds, valid, count);
+
+	for (i = 0; i < count; i++)
+		{
+		CollectInfo *ci;
+
+		if (!valid[i]) continue;
+
+		/* also drops duplicates within the list */
+		ci = collection_info_new_if_not_exists(cd, NULL, fds[i]);
+		if (!ci) continue;
+		DEBUG_3("add to collection: %s", fds[i]->path);
+
+		add = g_list_prepend(add, ci);
+		added++;
+		}
+
+	g_free(fds);
+	g_free(valid);
+
+	if (!add) return 0;
+
+	add = g_list_reverse(add);
+	if (sorted && cd->sort_method != SORT_NONE)
+		{
+		add = collection_list_sort(add, cd->sort_method);
+		cd->list = collection_list_merge(cd->list, add, cd->sort_method);
+		}
+	else
+		{
+		cd->list = g_list_concat(cd->list, add);
+		}
+	cd->changed = TRUE;
+
+	collection_window_add_batch(collection_window_find(cd));
+
+	return added;
+}
+
 gboolean collection_add(CollectionData *cd, FileData *fd, gboolean sorted)
 {
 	return collection_add_check(cd, fd, sorted, TRUE);
@@ -823,30 +1018,84 @@ void collection_update_geometry(CollectionData *cd)
  *-------------------------------------------------------------------
  */
 
-static void collection_notify_cb(FileData *fd, NotifyType type, gpointer data)
+/* the whole batch is applied in one pass over the collection */
+static void collection_notify_batch_cb(const FileDataNotifyEvent *events, guint count, gpointer data)
 {
 	CollectionData *cd = data;
+	CollectWindow *cw;
+	GHashTable *changed;
+	GList *removed = NULL;
+	GList *work;
+	guint i;
 
-	if (!(type & NOTIFY_CHANGE) || !fd->change) return;
+	changed = g_hash_table_new(g_direct_hash, g_direct_equal);
+	for (i = 0; i < count; i++)
+		{
+		if (!(events[i].type & NOTIFY_CHANGE) || !events[i].change) continue;
 
-	DEBUG_1("Notify collection: %s %04x", fd->path, type);
+		switch (events[i].change_type)
+			{
+			case FILEDATA_CHANGE_MOVE:
+			case FILEDATA_CHANGE_RENAME:
+			case FILEDATA_CHANGE_DELETE:
+				g_hash_table_insert(changed, events[i].fd, (gpointer)&events[i]);
+				break;
+			case FILEDATA_CHANGE_COPY:
+			case FILEDATA_CHANGE_UNSPECIFIED:
+			case FILEDATA_CHANGE_WRITE_METADATA:
+				break;
+			}
+		}
 
-	switch (fd->change->type)
+	if (g_hash_table_size(changed) == 0)
 		{
-		case FILEDATA_CHANGE_MOVE:
-		case FILEDATA_CHANGE_RENAME:
-			collection_rename(cd, fd);
-			break;
-		case FILEDATA_CHANGE_COPY:
-			break;
-		case FILEDATA_CHANGE_DELETE:
-			while (collection_remove(cd, fd));
-			break;
-		case FILEDATA_CHANGE_UNSPECIFIED:
-		case FILEDATA_CHANGE_WRITE_METADATA:
-			break;
+		g_hash_table_destroy(changed);
+		return;
 		}
 
+	DEBUG_1("Notify collection: %u files", g_hash_table_size(changed));
+
+	cw = collection_window_find(cd);
+
+	work = cd->list;
+	while (work)
+		{
+		CollectInfo *ci = work->data;
+		GList *next = work->next;
+		const FileDataNotifyEvent *event = g_hash_table_lookup(changed, ci->fd);
+
+		if (event)
+			{
+			cd->changed = TRUE;
+			if (event->change_type == FILEDATA_CHANGE_DELETE)
+				{
+				g_hash_table_remove(cd->existence, ci->fd->path);
+				cd->list = g_list_delete_link(cd->list, work);
+				removed = g_list_prepend(removed, ci);
+				}
+			else
+				{
+				collection_window_update(cw, ci);
+				}
+			}
+		work = next;
+		}
+	g_hash_table_destroy(changed);
+
+	if (!removed) return;
+
+	if (!removed->next)
+		{
+		/* more efficient (in collect-table) to remove a single item this way */
+		collection_window_remove(cw, removed->data);
+		collection_info_free(removed->data);
+		}
+	else
+		{
+		g_list_foreach(removed, (GFunc)collection_info_free, NULL);
+		collection_window_refresh(cw);
+		}
+	g_list_free(removed);
 }
 
 
@@ -1069,6 +1318,14 @@ static void collection_window_add(CollectWindow *cw, CollectInfo *ci)
 	collection_table_file_add(cw->table, ci);
 }
 
+static void collection_window_add_batch(CollectWindow *cw)
+{
+	if (!cw) return;
+
+	collection_load_thumb_idle(cw->cd);
+	collection_table_file_add(cw->table, NULL);
+}
+
 static void collection_window_insert(CollectWindow *cw, CollectInfo *ci)
 {
 	if (!cw) return;
@@ -35,6 +35,7 @@ void collection_list_free(GList *list);
 
 GList *collection_list_sort(GList *list, SortType method);
 GList *collection_list_add(GList *list, CollectInfo *ci, SortType method);
+GList *collection_list_merge(GList *list, GList *add, SortType method);
 GList *collection_list_insert(GList *list, CollectInfo *ci, CollectInfo *insert_ci, SortType method);
 GList *collection_list_remove(GList *list, CollectInfo *ci);
 CollectInfo *collection_list_find_fd(GList *list, FileData *fd);
@@ -73,6 +74,7 @@ void collection_set_update_info_func(CollectionData *cd,
 
 gboolean collection_add(CollectionData *cd, FileData *fd, gboolean sorted);
 gboolean collection_add_check(CollectionData *cd, FileData *fd, gboolean sorted, gboolean must_exist);
+gint collection_add_filelist(CollectionData *cd, GList *list, gboolean sorted, gboolean must_exist);
 gboolean collection_insert(CollectionData *cd, FileData *fd, CollectInfo *insert_ci, gboolean sorted);
 gboolean collection_remove(CollectionData *cd, FileData *fd);
 void collection_remove_by_info_list(CollectionData *cd, GList *list);
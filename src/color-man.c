@@ -22,7 +22,10 @@
 #include "main.h"
 #include "color-man.h"
 
+#include "cache.h"
 #include "image.h"
+#include "md5-util.h"
+#include "secure_save.h"
 #include "ui_fileops.h"
 
 
@@ -35,12 +38,20 @@
 #include <lcms.h>
 #endif
 
+/* without the pixel cache a transform can be used by several threads at once */
+#ifdef HAVE_LCMS2
+#define COLOR_MAN_TRANSFORM_FLAGS cmsFLAGS_NOCACHE
+#else
+#define COLOR_MAN_TRANSFORM_FLAGS cmsFLAGS_NOTCACHE
+#endif
+
 
 typedef struct _ColorManCache ColorManCache;
 struct _ColorManCache {
 	cmsHPROFILE   profile_in;
 	cmsHPROFILE   profile_out;
 	cmsHTRANSFORM transform;
+	guint16 *lut;		/* COLOR_MAN_LUT_SIZE^3 RGB nodes, 8.8 fixed point */
 
 	ColorManProfileType profile_in_type;
 	gchar *profile_in_file;
@@ -53,9 +64,25 @@ struct _ColorManCache {
 	gint refcount;
 };
 
-/* pixels to transform per idle call */
+/* pixels to transform per idle call, or per worker task */
 #define COLOR_MAN_CHUNK_SIZE 81900
 
+/* nodes per channel of the transform lookup table */
+#define COLOR_MAN_LUT_SIZE 33
+
+/* header of the table files in get_color_cache_dir() */
+#define COLOR_MAN_LUT_HEADER "GQclut 1"
+
+/* worker threads for the full image pass */
+#define COLOR_MAN_THREADS 4
+#define COLOR_MAN_POLL_INTERVAL 20
+
+typedef struct _ColorManBand ColorManBand;
+struct _ColorManBand {
+	gint row;
+	gint rows;
+};
+
 
 static void color_man_lib_init(void)
 {
@@ -89,17 +116,17 @@ static void color_man_cache_ref(ColorManCache *cc)
 {
 	if (!cc) return;
 
-	cc->refcount++;
+	g_atomic_int_inc(&cc->refcount);
 }
 
 static void color_man_cache_unref(ColorManCache *cc)
 {
 	if (!cc) return;
 
-	cc->refcount--;
-	if (cc->refcount < 1)
+	if (g_atomic_int_dec_and_test(&cc->refcount))
 		{
 		if (cc->transform) cmsDeleteTransform(cc->transform);
+		g_free(cc->lut);
 		if (cc->profile_in) cmsCloseProfile(cc->profile_in);
 		if (cc->profile_out) cmsCloseProfile(cc->profile_out);
 
@@ -147,6 +174,249 @@ static cmsHPROFILE color_man_cache_load_profile(ColorManProfileType type, const
 	return profile;
 }
 
+/*
+ *-------------------------------------------------------------------
+ * transform lookup table
+ *-------------------------------------------------------------------
+ */
+
+/* The transform is sampled once into a 3D table, pixels are then trilinear
+ * interpolated from it. The table is read only, so any number of threads can
+ * correct pixels with it, and no lcms call is made per pixel.
+ */
+
+typedef struct _ColorManLutIndex ColorManLutIndex;
+struct _ColorManLutIndex {
+	gint offset[256];	/* node below the value, in units of nodes */
+	gint frac[256];		/* distance to it, 0 to 256 */
+};
+
+static const ColorManLutIndex *color_man_lut_index(void)
+{
+	static ColorManLutIndex index;
+	static gsize init = 0;
+
+	if (g_once_init_enter(&init))
+		{
+		gint v;
+
+		for (v = 0; v < 256; v++)
+			{
+			gint pos = v * (COLOR_MAN_LUT_SIZE - 1) * 256 / 255;
+			gint node = MIN(pos >> 8, COLOR_MAN_LUT_SIZE - 2);
+
+			index.offset[v] = node;
+			index.frac[v] = pos - (node << 8);
+			}
+
+		g_once_init_leave(&init, 1);
+		}
+
+	return &index;
+}
+
+static guint16 *color_man_lut_new(cmsHPROFILE profile_in, cmsHPROFILE profile_out, gint intent)
+{
+	cmsHTRANSFORM transform;
+	guint16 *in;
+	guint16 *lut;
+	gint n = COLOR_MAN_LUT_SIZE * COLOR_MAN_LUT_SIZE * COLOR_MAN_LUT_SIZE;
+	gint r, g, b;
+	gint i;
+
+	/* 16 bit, so the nodes sit where the 8 bit index expects them */
+	transform = cmsCreateTransform(profile_in, TYPE_RGB_16, profile_out, TYPE_RGB_16, intent, 0);
+	if (!transform) return NULL;
+
+	in = g_new(guint16, n * 3);
+	i = 0;
+	for (r = 0; r < COLOR_MAN_LUT_SIZE; r++)
+		for (g = 0; g < COLOR_MAN_LUT_SIZE; g++)
+			for (b = 0; b < COLOR_MAN_LUT_SIZE; b++)
+				{
+				in[i++] = r * 65535 / (COLOR_MAN_LUT_SIZE - 1);
+				in[i++] = g * 65535 / (COLOR_MAN_LUT_SIZE - 1);
+				in[i++] = b * 65535 / (COLOR_MAN_LUT_SIZE - 1);
+				}
+
+	lut = g_new(guint16, n * 3);
+	cmsDoTransform(transform, in, lut, n);
+	cmsDeleteTransform(transform);
+	g_free(in);
+
+	/* 0 to 255.0 in 8.8 fixed point, so the interpolation result only needs a shift */
+	for (i = 0; i < n * 3; i++) lut[i] = ((guint32)lut[i] * 65280 + 32767) / 65535;
+
+	return lut;
+}
+
+static void color_man_lut_apply(const guint16 *lut, guchar *pix, gint w, gint channels)
+{
+	const ColorManLutIndex *index = color_man_lut_index();
+	const gint sb = 3;
+	const gint sg = COLOR_MAN_LUT_SIZE * 3;
+	const gint sr = COLOR_MAN_LUT_SIZE * COLOR_MAN_LUT_SIZE * 3;
+	gint i;
+
+	for (i = 0; i < w; i++)
+		{
+		const guint16 *p;
+		gint fr, fg, fb;
+		gint c;
+
+		p = lut + index->offset[pix[0]] * sr + index->offset[pix[1]] * sg + index->offset[pix[2]] * sb;
+		fr = index->frac[pix[0]];
+		fg = index->frac[pix[1]];
+		fb = index->frac[pix[2]];
+
+		for (c = 0; c < 3; c++)
+			{
+			gint c00, c01, c10, c11, c0, c1;
+
+			c00 = p[c] + (((p[c + sb] - p[c]) * fb) >> 8);
+			c01 = p[c + sg] + (((p[c + sg + sb] - p[c + sg]) * fb) >> 8);
+			c10 = p[c + sr] + (((p[c + sr + sb] - p[c + sr]) * fb) >> 8);
+			c11 = p[c + sr + sg] + (((p[c + sr + sg + sb] - p[c + sr + sg]) * fb) >> 8);
+
+			c0 = c00 + (((c01 - c00) * fg) >> 8);
+			c1 = c10 + (((c11 - c10) * fg) >> 8);
+
+			pix[c] = (c0 + (((c1 - c0) * fr) >> 8) + 128) >> 8;
+			}
+
+		pix += channels;
+		}
+}
+
+/*
+ *-------------------------------------------------------------------
+ * transform lookup table on disk
+ *-------------------------------------------------------------------
+ */
+
+/* Building a table means a 16 bit lcms transform, by far the slowest part of
+ * showing the first color managed image. Tables are kept in get_color_cache_dir(),
+ * named by the md5 of both profiles and the intent. The header holds the lcms
+ * version and byte order, a table built otherwise is built again.
+ */
+
+static gchar *color_man_profile_hash(ColorManProfileType type, const gchar *file,
+				     guchar *data, guint data_len)
+{
+	guchar digest[16];
+
+	switch (type)
+		{
+		case COLOR_PROFILE_FILE:
+			{
+			gchar *pathl;
+			gboolean success;
+
+			if (!file) return NULL;
+			pathl = path_from_utf8(file);
+			success = md5_get_digest_from_file(pathl, digest);
+			g_free(pathl);
+			if (!success) return NULL;
+			}
+			break;
+		case COLOR_PROFILE_SRGB:
+			/* built in, these only change with lcms */
+			return g_strdup("srgb");
+		case COLOR_PROFILE_ADOBERGB:
+			return g_strdup("clayrgb1998");
+		case COLOR_PROFILE_MEM:
+			if (!data) return NULL;
+			md5_get_digest(data, data_len, digest);
+			break;
+		case COLOR_PROFILE_NONE:
+		default:
+			return NULL;
+		}
+
+	return md5_digest_to_text(digest);
+}
+
+static gchar *color_man_lut_path(const gchar *hash_in, const gchar *hash_out, gint intent)
+{
+	gchar *name;
+	gchar *path;
+
+	name = g_strdup_printf("%s_%s_%d.clut", hash_in, hash_out, intent);
+	path = g_build_filename(get_color_cache_dir(), name, NULL);
+	g_free(name);
+
+	return path;
+}
+
+static gchar *color_man_lut_header(void)
+{
+	return g_strdup_printf("%s %d %d %s\n", COLOR_MAN_LUT_HEADER, COLOR_MAN_LUT_SIZE, LCMS_VERSION,
+			       (G_BYTE_ORDER == G_LITTLE_ENDIAN) ? "le" : "be");
+}
+
+static guint16 *color_man_lut_load(const gchar *path)
+{
+	gchar *pathl;
+	gchar *buf;
+	gsize len;
+	gchar *header;
+	gsize header_len;
+	gsize lut_len = COLOR_MAN_LUT_SIZE * COLOR_MAN_LUT_SIZE * COLOR_MAN_LUT_SIZE * 3 * sizeof(guint16);
+	guint16 *lut = NULL;
+
+	pathl = path_from_utf8(path);
+	if (!g_file_get_contents(pathl, &buf, &len, NULL))
+		{
+		g_free(pathl);
+		return NULL;
+		}
+	g_free(pathl);
+
+	header = color_man_lut_header();
+	header_len = strlen(header);
+
+	if (len == header_len + lut_len && memcmp(buf, header, header_len) == 0)
+		{
+		lut = g_malloc(lut_len);
+		memcpy(lut, buf + header_len, lut_len);
+		}
+
+	g_free(header);
+	g_free(buf);
+
+	return lut;
+}
+
+static void color_man_lut_save(const gchar *path, const guint16 *lut)
+{
+	SecureSaveInfo *ssi;
+	gchar *pathl;
+	gchar *header;
+
+	if (!recursive_mkdir_if_not_exists(get_color_cache_dir(), 0755)) return;
+
+	pathl = path_from_utf8(path);
+	ssi = secure_open(pathl);
+	g_free(pathl);
+	if (!ssi)
+		{
+		log_printf("Unable to save color table: %s\n", path);
+		return;
+		}
+
+	header = color_man_lut_header();
+	secure_fputs(ssi, header);
+	g_free(header);
+
+	secure_fwrite(lut, sizeof(guint16), COLOR_MAN_LUT_SIZE * COLOR_MAN_LUT_SIZE * COLOR_MAN_LUT_SIZE * 3, ssi);
+
+	if (secure_close(ssi))
+		{
+		log_printf(_("error saving color table: %s\nerror: %s\n"), path,
+			   secsave_strerror(secsave_errno));
+		}
+}
+
 static ColorManCache *color_man_cache_new(ColorManProfileType in_type, const gchar *in_file,
 					  guchar *in_data, guint in_data_len,
 					  ColorManProfileType out_type, const gchar *out_file,
@@ -154,6 +424,9 @@ static ColorManCache *color_man_cache_new(ColorManProfileType in_type, const gch
 					  gboolean has_alpha)
 {
 	ColorManCache *cc;
+	gchar *hash_in;
+	gchar *hash_out;
+	gchar *lut_path = NULL;
 
 	color_man_lib_init();
 
@@ -184,13 +457,36 @@ static ColorManCache *color_man_cache_new(ColorManProfileType in_type, const gch
 		return NULL;
 		}
 
-	cc->transform = cmsCreateTransform(cc->profile_in,
-					   (has_alpha) ? TYPE_RGBA_8 : TYPE_RGB_8,
-					   cc->profile_out,
-					   (has_alpha) ? TYPE_RGBA_8 : TYPE_RGB_8,
-					   options->color_profile.render_intent, 0);
+	hash_in = color_man_profile_hash(in_type, in_file, in_data, in_data_len);
+	hash_out = color_man_profile_hash(out_type, out_file, out_data, out_data_len);
+	if (hash_in && hash_out)
+		{
+		lut_path = color_man_lut_path(hash_in, hash_out, options->color_profile.render_intent);
+		cc->lut = color_man_lut_load(lut_path);
+		if (cc->lut) DEBUG_1("loaded color table %s", lut_path);
+		}
+	g_free(hash_in);
+	g_free(hash_out);
 
-	if (!cc->transform)
+	if (!cc->lut)
+		{
+		cc->lut = color_man_lut_new(cc->profile_in, cc->profile_out, options->color_profile.render_intent);
+		if (cc->lut && lut_path) color_man_lut_save(lut_path, cc->lut);
+		}
+	g_free(lut_path);
+
+	if (!cc->lut)
+		{
+		DEBUG_1("failed to create color lookup table, using the transform");
+
+		cc->transform = cmsCreateTransform(cc->profile_in,
+						   (has_alpha) ? TYPE_RGBA_8 : TYPE_RGB_8,
+						   cc->profile_out,
+						   (has_alpha) ? TYPE_RGBA_8 : TYPE_RGB_8,
+						   options->color_profile.render_intent, COLOR_MAN_TRANSFORM_FLAGS);
+		}
+
+	if (!cc->lut && !cc->transform)
 		{
 		DEBUG_1("failed to create color profile transform");
 
@@ -299,6 +595,7 @@ static void color_man_done(ColorMan *cm, ColorManReturnType type)
 		}
 }
 
+/* safe to call from any thread while cm is alive */
 void color_man_correct_region(ColorMan *cm, GdkPixbuf *pixbuf, gint x, gint y, gint w, gint h)
 {
 	ColorManCache *cc;
@@ -306,6 +603,7 @@ void color_man_correct_region(ColorMan *cm, GdkPixbuf *pixbuf, gint x, gint y, g
 	gint rs;
 	gint i;
 	gint pixbuf_width, pixbuf_height;
+	gint channels;
 
 
 	pixbuf_width = gdk_pixbuf_get_width(pixbuf);
@@ -315,18 +613,26 @@ void color_man_correct_region(ColorMan *cm, GdkPixbuf *pixbuf, gint x, gint y, g
 
 	pix = gdk_pixbuf_get_pixels(pixbuf);
 	rs = gdk_pixbuf_get_rowstride(pixbuf);
+	channels = gdk_pixbuf_get_n_channels(pixbuf);
 
 	w = MIN(w, pixbuf_width - x);
 	h = MIN(h, pixbuf_height - y);
 
-	pix += x * ((cc->has_alpha) ? 4 : 3);
+	pix += x * ((cc->lut) ? channels : ((cc->has_alpha) ? 4 : 3));
 	for (i = 0; i < h; i++)
 		{
 		guchar *pbuf;
 
 		pbuf = pix + ((y + i) * rs);
 
-		cmsDoTransform(cc->transform, pbuf, pbuf, w);
+		if (cc->lut)
+			{
+			color_man_lut_apply(cc->lut, pbuf, w, channels);
+			}
+		else
+			{
+			cmsDoTransform(cc->transform, pbuf, pbuf, w);
+			}
 		}
 
 }
@@ -370,6 +676,104 @@ static gboolean color_man_idle_cb(gpointer data)
 	return TRUE;
 }
 
+#ifdef HAVE_GTHREAD
+/* The full image pass splits the rows into bands for a pool of workers,
+ * the main thread only checks for an image change and signals the finished bands.
+ */
+
+static void color_man_band_run(gpointer data, gpointer user_data)
+{
+	ColorManBand *band = data;
+	ColorMan *cm = user_data;
+
+	if (!g_atomic_int_get(&cm->cancel))
+		{
+		color_man_correct_region(cm, cm->pixbuf, 0, band->row, gdk_pixbuf_get_width(cm->pixbuf), band->rows);
+		}
+
+	g_async_queue_push(cm->bands_done, band);
+}
+
+static gboolean color_man_poll_cb(gpointer data)
+{
+	ColorMan *cm = data;
+	ColorManBand *band;
+	gint width, height;
+
+	if (cm->imd &&
+	    cm->pixbuf != image_get_pixbuf(cm->imd))
+		{
+		cm->idle_id = 0;
+		color_man_done(cm, COLOR_RETURN_IMAGE_CHANGED);
+		return FALSE;
+		}
+
+	width = gdk_pixbuf_get_width(cm->pixbuf);
+	height = gdk_pixbuf_get_height(cm->pixbuf);
+
+	while ((band = g_async_queue_try_pop(cm->bands_done)))
+		{
+		if (cm->incremental_sync && cm->imd) image_area_changed(cm->imd, 0, band->row, width, band->rows);
+		cm->bands_todo--;
+		g_free(band);
+		}
+
+	if (cm->bands_todo > 0) return TRUE;
+
+	if (!cm->incremental_sync && cm->imd)
+		{
+		image_area_changed(cm->imd, 0, 0, width, height);
+		}
+
+	cm->idle_id = 0;
+	color_man_done(cm, COLOR_RETURN_SUCCESS);
+	return FALSE;
+}
+
+static void color_man_start_threads(ColorMan *cm)
+{
+	gint width, height;
+	gint rh;
+
+	width = gdk_pixbuf_get_width(cm->pixbuf);
+	height = gdk_pixbuf_get_height(cm->pixbuf);
+	rh = COLOR_MAN_CHUNK_SIZE / width + 1;
+
+	cm->bands_done = g_async_queue_new();
+	cm->pool = g_thread_pool_new(color_man_band_run, cm, COLOR_MAN_THREADS, FALSE, NULL);
+
+	while (cm->row < height)
+		{
+		ColorManBand *band = g_new0(ColorManBand, 1);
+
+		band->row = cm->row;
+		band->rows = MIN(rh, height - cm->row);
+		cm->row += band->rows;
+		cm->bands_todo++;
+
+		g_thread_pool_push(cm->pool, band, NULL);
+		}
+
+	cm->idle_id = g_timeout_add(COLOR_MAN_POLL_INTERVAL, color_man_poll_cb, cm);
+}
+
+static void color_man_stop_threads(ColorMan *cm)
+{
+	ColorManBand *band;
+
+	if (!cm->pool) return;
+
+	/* drop the bands not yet started and wait for the others */
+	g_atomic_int_set(&cm->cancel, TRUE);
+	g_thread_pool_free(cm->pool, TRUE, TRUE);
+	cm->pool = NULL;
+
+	while ((band = g_async_queue_try_pop(cm->bands_done))) g_free(band);
+	g_async_queue_unref(cm->bands_done);
+	cm->bands_done = NULL;
+}
+#endif
+
 static ColorMan *color_man_new_real(ImageWindow *imd, GdkPixbuf *pixbuf,
 				    ColorManProfileType input_type, const gchar *input_file,
 				    guchar *input_data, guint input_data_len,
@@ -413,6 +817,13 @@ void color_man_start_bg(ColorMan *cm, ColorManDoneFunc done_func, gpointer done_
 {
 	cm->func_done = done_func;
 	cm->func_done_data = done_data;
+#ifdef HAVE_GTHREAD
+	if (cm->pixbuf && ((ColorManCache *)cm->profile)->lut)
+		{
+		color_man_start_threads(cm);
+		return;
+		}
+#endif
 	cm->idle_id = g_idle_add(color_man_idle_cb, cm);
 }
 
@@ -475,6 +886,9 @@ void color_man_free(ColorMan *cm)
 	if (!cm) return;
 
 	if (cm->idle_id) g_source_remove(cm->idle_id);
+#ifdef HAVE_GTHREAD
+	color_man_stop_threads(cm);
+#endif
 	if (cm->pixbuf) g_object_unref(cm->pixbuf);
 
 	color_man_cache_unref(cm->profile);
@@ -50,6 +50,12 @@ struct _ColorMan {
 
 	guint idle_id; /* event source id */
 
+	/* full image pass on worker threads */
+	GThreadPool *pool;
+	GAsyncQueue *bands_done;
+	gint bands_todo;
+	gint cancel;
+
 	ColorManDoneFunc func_done;
 	gpointer func_done_data;
 };
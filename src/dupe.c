@@ -86,11 +86,12 @@ static gint dupe_check_cb(gpointer data);
 
 static void dupe_second_add(DupeWindow *dw, DupeItem *di);
 static void dupe_second_remove(DupeWindow *dw, DupeItem *di);
+static void dupe_second_update_status(DupeWindow *dw);
 static GtkWidget *dupe_menu_popup_second(DupeWindow *dw, DupeItem *di);
 
 static void dupe_dnd_init(DupeWindow *dw);
 
-static void dupe_notify_cb(FileData *fd, NotifyType type, gpointer data);
+static void dupe_notify_batch_cb(const FileDataNotifyEvent *events, guint count, gpointer data);
 
 /*
  * ------------------------------------------------------------------
@@ -351,55 +352,62 @@ static DupeItem *dupe_item_find_fd(DupeWindow *dw, FileData *fd)
 }
 */
 
-static DupeItem *dupe_item_find_path_by_list(const gchar *path, GList *work)
+/*
+ * ------------------------------------------------------------------
+ * Image property cache
+ * ------------------------------------------------------------------
+ */
+
+/*
+ * the sim data of a folder is looked up in its pack, mapped once for the folder,
+ * without a pack (still being built) the sim files of the folder are read
+ */
+static CacheData *dupe_item_read_cache_pack(DupeWindow *dw, DupeItem *di)
 {
-	while (work)
-		{
-		DupeItem *di = work->data;
+	gchar *folder;
 
-		if (strcmp(di->fd->path, path) == 0) return di;
+	folder = remove_level_from_path(di->fd->path);
+	if (g_strcmp0(folder, dw->sim_pack_folder) != 0)
+		{
+		cache_sim_pack_close(dw->sim_pack);
+		dw->sim_pack = cache_sim_pack_open(di->fd->path);
 
-		work = work->next;
+		g_free(dw->sim_pack_folder);
+		dw->sim_pack_folder = folder;
+		}
+	else
+		{
+		g_free(folder);
 		}
 
-	return NULL;
-}
-
-static DupeItem *dupe_item_find_path(DupeWindow *dw, const gchar *path)
-{
-	DupeItem *di;
-
-	di = dupe_item_find_path_by_list(path, dw->list);
-	if (!di && dw->second_set) di = dupe_item_find_path_by_list(path, dw->second_list);
+	if (!dw->sim_pack) return NULL;
 
-	return di;
+	return cache_sim_pack_lookup(dw->sim_pack, di->fd->path, filetime(di->fd->path));
 }
 
-/*
- * ------------------------------------------------------------------
- * Image property cache
- * ------------------------------------------------------------------
- */
-
-static void dupe_item_read_cache(DupeItem *di)
+static void dupe_item_read_cache(DupeWindow *dw, DupeItem *di)
 {
 	gchar *path;
 	CacheData *cd;
 
 	if (!di) return;
 
-	path = cache_find_location(CACHE_TYPE_SIM, di->fd->path);
-	if (!path) return;
-
-	if (filetime(di->fd->path) != filetime(path))
+	cd = dupe_item_read_cache_pack(dw, di);
+	if (!cd)
 		{
+		path = cache_find_location(CACHE_TYPE_SIM, di->fd->path);
+		if (!path) return;
+
+		if (filetime(di->fd->path) != filetime(path))
+			{
+			g_free(path);
+			return;
+			}
+
+		cd = cache_sim_data_load(path);
 		g_free(path);
-		return;
 		}
 
-	cd = cache_sim_data_load(path);
-	g_free(path);
-
 	if (cd)
 		{
 		if (!di->simd && cd->sim)
@@ -1167,11 +1175,11 @@ static gboolean dupe_match(DupeItem *a, DupeItem *b, DupeMatchType mask, gdouble
 		}
 	if (mask & DUPE_MATCH_NAME)
 		{
-		if (strcmp(a->fd->collate_key_name, b->fd->collate_key_name) != 0) return FALSE;
+		if (strcmp(file_data_get_collate_key(a->fd, TRUE), file_data_get_collate_key(b->fd, TRUE)) != 0) return FALSE;
 		}
 	if (mask & DUPE_MATCH_NAME_CI)
 		{
-		if (strcmp(a->fd->collate_key_name_nocase, b->fd->collate_key_name_nocase) != 0) return FALSE;
+		if (strcmp(file_data_get_collate_key(a->fd, FALSE), file_data_get_collate_key(b->fd, FALSE)) != 0) return FALSE;
 		}
 	if (mask & DUPE_MATCH_SIZE)
 		{
@@ -1403,6 +1411,11 @@ static void dupe_check_stop(DupeWindow *dw)
 
 	image_loader_free(dw->img_loader);
 	dw->img_loader = NULL;
+
+	cache_sim_pack_close(dw->sim_pack);
+	dw->sim_pack = NULL;
+	g_free(dw->sim_pack_folder);
+	dw->sim_pack_folder = NULL;
 }
 
 static void dupe_loader_done_cb(ImageLoader *il, gpointer data)
@@ -1490,7 +1503,7 @@ static gboolean dupe_check_cb(gpointer data)
 
 					if (options->thumbnails.enable_caching)
 						{
-						dupe_item_read_cache(di);
+						dupe_item_read_cache(dw, di);
 						if (di->md5sum) return TRUE;
 						}
 
@@ -1523,7 +1536,7 @@ static gboolean dupe_check_cb(gpointer data)
 
 					if (options->thumbnails.enable_caching)
 						{
-						dupe_item_read_cache(di);
+						dupe_item_read_cache(dw, di);
 						if (di->width != 0 || di->height != 0) return TRUE;
 						}
 
@@ -1557,7 +1570,7 @@ static gboolean dupe_check_cb(gpointer data)
 
 					if (options->thumbnails.enable_caching)
 						{
-						dupe_item_read_cache(di);
+						dupe_item_read_cache(dw, di);
 						if (cache_sim_data_filled(di->simd))
 							{
 							image_sim_alternate_processing(di->simd);
@@ -1739,16 +1752,171 @@ static void dupe_item_remove(DupeWindow *dw, DupeItem *di)
 	dupe_window_update_count(dw, FALSE);
 }
 
-static gboolean dupe_item_remove_by_path(DupeWindow *dw, const gchar *path)
+/* one pass over list, removing the items of the set */
+static GList *dupe_item_list_remove_set(GList *list, GHashTable *set)
 {
-	DupeItem *di;
+	GList *work = list;
 
-	di = dupe_item_find_path(dw, path);
-	if (!di) return FALSE;
+	while (work)
+		{
+		GList *next = work->next;
 
-	dupe_item_remove(dw, di);
+		if (g_hash_table_lookup(set, work->data)) list = g_list_delete_link(list, work);
+		work = next;
+		}
 
-	return TRUE;
+	return list;
+}
+
+/* one pass over the rows of store, removing those of the items of the set */
+static gboolean dupe_listview_remove_set(GtkListStore *store, GHashTable *set)
+{
+	GtkTreeIter iter;
+	gboolean valid;
+	gboolean removed = FALSE;
+
+	valid = gtk_tree_model_get_iter_first(GTK_TREE_MODEL(store), &iter);
+	while (valid)
+		{
+		DupeItem *di;
+
+		gtk_tree_model_get(GTK_TREE_MODEL(store), &iter, DUPE_COLUMN_POINTER, &di, -1);
+		if (g_hash_table_lookup(set, di))
+			{
+			valid = gtk_list_store_remove(store, &iter);
+			removed = TRUE;
+			}
+		else
+			{
+			valid = gtk_tree_model_iter_next(GTK_TREE_MODEL(store), &iter);
+			}
+		}
+
+	return removed;
+}
+
+/*
+ * removes the items of the set, as dupe_item_remove() does for each of them,
+ * with one pass over the groups, the lists and the list views
+ */
+static void dupe_item_remove_set(DupeWindow *dw, GHashTable *removed)
+{
+	GHashTable *rows;
+	GHashTableIter hash_iter;
+	GtkListStore *store;
+	gpointer key;
+	gboolean thumb_removed;
+	GList *work;
+
+	if (g_hash_table_size(removed) == 0) return;
+
+	/* handle things that may be in progress... */
+	while (dw->working && g_hash_table_lookup(removed, dw->working->data))
+		{
+		dw->working = dw->working->prev;
+		}
+	thumb_removed = (dw->thumb_loader && g_hash_table_lookup(removed, dw->thumb_item));
+	if (dw->setup_point && g_hash_table_lookup(removed, dw->setup_point->data))
+		{
+		while (dw->setup_point && g_hash_table_lookup(removed, dw->setup_point->data))
+			{
+			dw->setup_point = dupe_setup_point_step(dw, dw->setup_point);
+			}
+		if (dw->img_loader)
+			{
+			image_loader_free(dw->img_loader);
+			dw->img_loader = NULL;
+			dw->idle_id = g_idle_add(dupe_check_cb, dw);
+			}
+		}
+
+	/* groups left with one item are reset, a removed parent passes its group on */
+	rows = g_hash_table_new(g_direct_hash, g_direct_equal);
+	work = dw->dupes;
+	while (work)
+		{
+		DupeItem *parent = work->data;
+		GList *next = work->next;
+		GList *kept = NULL;
+		GList *temp;
+
+		for (temp = parent->group; temp; temp = temp->next)
+			{
+			DupeMatch *dm = temp->data;
+
+			if (dm->di != parent && !g_hash_table_lookup(removed, dm->di)) kept = g_list_append(kept, dm);
+			}
+
+		if (!g_hash_table_lookup(removed, parent))
+			{
+			if (!kept)
+				{
+				dupe_match_link_clear(parent, TRUE);
+				g_hash_table_insert(rows, parent, parent);
+				dw->dupes = g_list_delete_link(dw->dupes, work);
+				}
+			}
+		else if (g_list_length(kept) < 2)
+			{
+			for (temp = kept; temp; temp = temp->next)
+				{
+				DupeMatch *dm = temp->data;
+				DupeItem *child = dm->di;
+
+				dupe_match_link_clear(child, TRUE);
+				g_hash_table_insert(rows, child, child);
+				}
+			dw->dupes = g_list_delete_link(dw->dupes, work);
+			}
+		else
+			{
+			DupeMatch *dm = kept->data;
+			DupeItem *new_parent = dm->di;
+
+			dupe_match_link_clear(new_parent, TRUE);
+			for (temp = kept->next; temp; temp = temp->next)
+				{
+				dm = temp->data;
+				dupe_match_link_child(dm->di, new_parent, dm->rank);
+				dupe_match_link_child(new_parent, dm->di, dm->rank);
+				}
+			dupe_match_rank_update(new_parent);
+			work->data = new_parent;
+			}
+
+		g_list_free(kept);
+		work = next;
+		}
+
+	g_hash_table_iter_init(&hash_iter, removed);
+	while (g_hash_table_iter_next(&hash_iter, &key, NULL))
+		{
+		dupe_match_link_clear(key, TRUE);
+		g_hash_table_insert(rows, key, key);
+		}
+
+	store = GTK_LIST_STORE(gtk_tree_view_get_model(GTK_TREE_VIEW(dw->listview)));
+	if (dupe_listview_remove_set(store, rows) && !dw->color_frozen) dupe_listview_realign_colors(dw);
+	g_hash_table_destroy(rows);
+
+	dw->list = dupe_item_list_remove_set(dw->list, removed);
+	if (dw->second_list)
+		{
+		store = GTK_LIST_STORE(gtk_tree_view_get_model(GTK_TREE_VIEW(dw->second_listview)));
+		dupe_listview_remove_set(store, removed);
+		dw->second_list = dupe_item_list_remove_set(dw->second_list, removed);
+		dupe_second_update_status(dw);
+		}
+
+	if (thumb_removed) dupe_thumb_step(dw);
+
+	g_hash_table_iter_init(&hash_iter, removed);
+	while (g_hash_table_iter_next(&hash_iter, &key, NULL))
+		{
+		dupe_item_free(key);
+		}
+
+	dupe_window_update_count(dw, FALSE);
 }
 
 static void dupe_files_add(DupeWindow *dw, CollectionData *collection, CollectInfo *info,
@@ -1870,9 +2038,15 @@ void dupe_window_add_files(DupeWindow *dw, GList *list, gboolean recurse)
 	dupe_check_start(dw);
 }
 
+/* renaming an item changes the matches only when matching by name or path */
+static gboolean dupe_match_by_name(DupeWindow *dw)
+{
+	return (dw->match_mask & (DUPE_MATCH_NAME | DUPE_MATCH_PATH | DUPE_MATCH_NAME_CI)) != 0;
+}
+
 static void dupe_item_update(DupeWindow *dw, DupeItem *di)
 {
-	if ( (dw->match_mask & DUPE_MATCH_NAME) || (dw->match_mask & DUPE_MATCH_PATH || (dw->match_mask & DUPE_MATCH_NAME_CI)) )
+	if (dupe_match_by_name(dw))
 		{
 		/* only effects matches on name or path */
 /*
@@ -1919,24 +2093,6 @@ static void dupe_item_update(DupeWindow *dw, DupeItem *di)
 
 }
 
-static void dupe_item_update_fd_in_list(DupeWindow *dw, FileData *fd, GList *work)
-{
-	while (work)
-		{
-		DupeItem *di = work->data;
-
-		if (di->fd == fd)
-			dupe_item_update(dw, di);
-
-		work = work->next;
-		}
-}
-
-static void dupe_item_update_fd(DupeWindow *dw, FileData *fd)
-{
-	dupe_item_update_fd_in_list(dw, fd, dw->list);
-	if (dw->second_set) dupe_item_update_fd_in_list(dw, fd, dw->second_list);
-}
 
 
 /*
@@ -3203,7 +3359,7 @@ void dupe_window_close(DupeWindow *dw)
 
 	dupe_list_free(dw->second_list);
 
-	file_data_unregister_notify_func(dupe_notify_cb, dw);
+	file_data_unregister_notify_batch_func(dupe_notify_batch_cb, dw);
 
 	g_free(dw);
 }
@@ -3433,7 +3589,7 @@ DupeWindow *dupe_window_new()
 
 	dupe_window_list = g_list_append(dupe_window_list, dw);
 
-	file_data_register_notify_func(dupe_notify_cb, dw, NOTIFY_PRIORITY_MEDIUM);
+	file_data_register_notify_batch_func(dupe_notify_batch_cb, dw, NOTIFY_PRIORITY_MEDIUM);
 
 	return dw;
 }
@@ -3711,29 +3867,79 @@ static void dupe_dnd_init(DupeWindow *dw)
  *-------------------------------------------------------------------
  */
 
-static void dupe_notify_cb(FileData *fd, NotifyType type, gpointer data)
+static void dupe_notify_collect(GList *work, GHashTable *changed, GHashTable *removed, GList **updated)
+{
+	while (work)
+		{
+		DupeItem *di = work->data;
+		const FileDataNotifyEvent *event = g_hash_table_lookup(changed, di->fd);
+
+		work = work->next;
+		if (!event) continue;
+
+		if (event->change_type == FILEDATA_CHANGE_DELETE)
+			g_hash_table_insert(removed, di, di);
+		else
+			*updated = g_list_prepend(*updated, di);
+		}
+}
+
+static void dupe_notify_batch_cb(const FileDataNotifyEvent *events, guint count, gpointer data)
 {
 	DupeWindow *dw = data;
+	GHashTable *changed;
+	GHashTable *removed;
+	GList *updated = NULL;
+	GList *work;
+	guint i;
 
-	if (!(type & NOTIFY_CHANGE) || !fd->change) return;
+	changed = g_hash_table_new(g_direct_hash, g_direct_equal);
+	removed = g_hash_table_new(g_direct_hash, g_direct_equal);
+	for (i = 0; i < count; i++)
+		{
+		if (!(events[i].type & NOTIFY_CHANGE) || !events[i].change) continue;
 
-	DEBUG_1("Notify dupe: %s %04x", fd->path, type);
+		switch (events[i].change_type)
+			{
+			case FILEDATA_CHANGE_MOVE:
+			case FILEDATA_CHANGE_RENAME:
+			case FILEDATA_CHANGE_DELETE:
+				g_hash_table_insert(changed, events[i].fd, (gpointer)&events[i]);
+				break;
+			case FILEDATA_CHANGE_COPY:
+			case FILEDATA_CHANGE_UNSPECIFIED:
+			case FILEDATA_CHANGE_WRITE_METADATA:
+				break;
+			}
+		}
 
-	switch (fd->change->type)
+	if (g_hash_table_size(changed) > 0)
 		{
-		case FILEDATA_CHANGE_MOVE:
-		case FILEDATA_CHANGE_RENAME:
-			dupe_item_update_fd(dw, fd);
-			break;
-		case FILEDATA_CHANGE_COPY:
-			break;
-		case FILEDATA_CHANGE_DELETE:
-			while (dupe_item_remove_by_path(dw, fd->path));
-			break;
-		case FILEDATA_CHANGE_UNSPECIFIED:
-		case FILEDATA_CHANGE_WRITE_METADATA:
-			break;
+		DEBUG_1("Notify dupe: %u files", g_hash_table_size(changed));
+
+		/* one pass over the lists, removing items while walking them is not safe */
+		dupe_notify_collect(dw->list, changed, removed, &updated);
+		if (dw->second_set) dupe_notify_collect(dw->second_list, changed, removed, &updated);
 		}
+	g_hash_table_destroy(changed);
 
+	dupe_item_remove_set(dw, removed);
+	g_hash_table_destroy(removed);
+
+	if (updated && dupe_match_by_name(dw))
+		{
+		/* restart once for the whole batch */
+		dupe_check_start(dw);
+		}
+	else
+		{
+		work = updated;
+		while (work)
+			{
+			dupe_item_update(dw, work->data);
+			work = work->next;
+			}
+		}
+	g_list_free(updated);
 }
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -113,6 +113,8 @@ struct _DupeWindow
 	DupeItem *thumb_item;
 
 	ImageLoader *img_loader;
+	CacheSimPack *sim_pack;		/* sim data of the folder being read */
+	gchar *sim_pack_folder;
 
 	/* second set comparison stuff */
 
@@ -22,10 +22,12 @@
 #include "main.h"
 #include "editors.h"
 
+#include "cache.h"
 #include "filedata.h"
 #include "filefilter.h"
 #include "misc.h"
 #include "pixbuf_util.h"
+#include "secure_save.h"
 #include "ui_fileops.h"
 #include "ui_spinner.h"
 #include "ui_utildlg.h"
@@ -37,6 +39,11 @@
 #define EDITOR_WINDOW_WIDTH 500
 #define EDITOR_WINDOW_HEIGHT 300
 
+#define EDITOR_CACHE_FILE "editors.cache"
+#define EDITOR_CACHE_GROUP "Editor Cache"
+/* change when the cached fields or their meaning change */
+#define EDITOR_CACHE_VERSION 1
+
 
 
 typedef struct _EditorVerboseData EditorVerboseData;
@@ -80,6 +87,9 @@ GHashTable *editors = NULL;
 GtkListStore *desktop_file_list;
 gboolean editors_finished = FALSE;
 
+/* state of the desktop file folders at the last scan, see editor_table_save_cache() */
+static gchar *editor_cache_stamp = NULL;
+
 #ifdef G_KEY_FILE_DESKTOP_GROUP
 #define DESKTOP_GROUP G_KEY_FILE_DESKTOP_GROUP
 #else
@@ -163,6 +173,19 @@ static GList *editor_mime_types_to_extensions(gchar **mime_types)
 	return list;
 }
 
+static void editor_desktop_file_list_add(EditorDescription *editor)
+{
+	GtkTreeIter iter;
+
+	gtk_list_store_append(desktop_file_list, &iter);
+	gtk_list_store_set(desktop_file_list, &iter,
+			   DESKTOP_FILE_COLUMN_KEY, editor->key,
+			   DESKTOP_FILE_COLUMN_NAME, editor->name,
+			   DESKTOP_FILE_COLUMN_HIDDEN, editor->hidden ? _("yes") : _("no"),
+			   DESKTOP_FILE_COLUMN_WRITABLE, access_file(editor->file, W_OK),
+			   DESKTOP_FILE_COLUMN_PATH, editor->file, -1);
+}
+
 gboolean editor_read_desktop_file(const gchar *path)
 {
 	GKeyFile *key_file;
@@ -172,7 +195,6 @@ gboolean editor_read_desktop_file(const gchar *path)
 	const gchar *key = filename_from_path(path);
 	gchar **categories, **only_show_in, **not_show_in;
 	gchar *try_exec;
-	GtkTreeIter iter;
 	gboolean category_geeqie = FALSE;
 
 	if (g_hash_table_lookup(editors, key)) return FALSE; /* the file found earlier wins */
@@ -342,13 +364,7 @@ gboolean editor_read_desktop_file(const gchar *path)
 
 	if (editor->ignored) return TRUE;
 
-	gtk_list_store_append(desktop_file_list, &iter);
-	gtk_list_store_set(desktop_file_list, &iter,
-			   DESKTOP_FILE_COLUMN_KEY, key,
-			   DESKTOP_FILE_COLUMN_NAME, editor->name,
-			   DESKTOP_FILE_COLUMN_HIDDEN, editor->hidden ? _("yes") : _("no"),
-			   DESKTOP_FILE_COLUMN_WRITABLE, access_file(path, W_OK),
-			   DESKTOP_FILE_COLUMN_PATH, path, -1);
+	editor_desktop_file_list_add(editor);
 
 	return TRUE;
 }
@@ -413,14 +429,13 @@ static GList *editor_add_desktop_dir(GList *list, const gchar *path)
 	return list;
 }
 
-GList *editor_get_desktop_files(void)
+/* the applications folders, the first one has the highest priority */
+static gchar **editor_get_desktop_dirs(void)
 {
-	gchar *path;
 	gchar *xdg_data_dirs;
 	gchar *all_dirs;
 	gchar **split_dirs;
 	gint i;
-	GList *list = NULL;
 
 	xdg_data_dirs = getenv("XDG_DATA_DIRS");
 	if (xdg_data_dirs && xdg_data_dirs[0])
@@ -436,18 +451,351 @@ GList *editor_get_desktop_files(void)
 
 	g_free(all_dirs);
 
-	for (i = 0; split_dirs[i]; i++);
+	for (i = 0; split_dirs[i]; i++)
+		{
+		gchar *path = g_build_filename(split_dirs[i], "applications", NULL);
+
+		g_free(split_dirs[i]);
+		split_dirs[i] = path;
+		}
+
+	return split_dirs;
+}
+
+/*
+ * Checksum of the names, modification times and sizes of the desktop files
+ * of a folder, so that a file edited in place is noticed as well.
+ */
+static gchar *editor_desktop_dir_checksum(const gchar *path)
+{
+	GChecksum *checksum;
+	GList *names = NULL;
+	GList *work;
+	DIR *dp;
+	struct dirent *dir;
+	gchar *pathl;
+	gchar *ret;
+
+	pathl = path_from_utf8(path);
+	dp = opendir(pathl);
+	if (!dp)
+		{
+		g_free(pathl);
+		return g_strdup("-");
+		}
+	while ((dir = readdir(dp)) != NULL)
+		{
+		if (g_str_has_suffix(dir->d_name, ".desktop")) names = g_list_prepend(names, g_strdup(dir->d_name));
+		}
+	closedir(dp);
+
+	/* readdir order is not stable */
+	names = g_list_sort(names, (GCompareFunc)strcmp);
+
+	checksum = g_checksum_new(G_CHECKSUM_MD5);
+	for (work = names; work; work = work->next)
+		{
+		gchar *filel = g_build_filename(pathl, work->data, NULL);
+		struct stat st;
+		gchar *entry;
+
+		if (stat(filel, &st) == 0)
+			entry = g_strdup_printf("%s %" G_GINT64_FORMAT " %" G_GINT64_FORMAT "\n",
+						(gchar *)work->data, (gint64)st.st_mtime, (gint64)st.st_size);
+		else
+			entry = g_strdup_printf("%s -\n", (gchar *)work->data);
+		g_checksum_update(checksum, (const guchar *)entry, strlen(entry));
+		g_free(entry);
+		g_free(filel);
+		}
+	string_list_free(names);
+	g_free(pathl);
+
+	ret = g_strdup(g_checksum_get_string(checksum));
+	g_checksum_free(checksum);
+
+	return ret;
+}
+
+/*
+ * Describes everything the parsed table depends on: the modification times
+ * of the folders and of their desktop files, the languages of the localized
+ * names and the PATH used by TryExec. Adding, removing or replacing a desktop
+ * file changes its folder, editing one in place changes the checksum.
+ */
+static gchar *editor_desktop_dirs_stamp(gchar **dirs)
+{
+	GString *stamp;
+	const gchar * const *languages;
+	const gchar *env_path;
+	gint i;
+
+	stamp = g_string_new(NULL);
+	g_string_append_printf(stamp, "%d", EDITOR_CACHE_VERSION);
+
+	for (languages = g_get_language_names(); *languages; languages++)
+		{
+		g_string_append_printf(stamp, " %s", *languages);
+		}
+
+	env_path = getenv("PATH");
+	g_string_append_printf(stamp, "\n%s", env_path ? env_path : "");
+
+	for (i = 0; dirs[i]; i++)
+		{
+		struct stat st;
+
+		if (stat_utf8(dirs[i], &st))
+			{
+			gchar *checksum = editor_desktop_dir_checksum(dirs[i]);
+
+			g_string_append_printf(stamp, "\n%s %" G_GINT64_FORMAT " %s", dirs[i], (gint64)st.st_mtime, checksum);
+			g_free(checksum);
+			}
+		else
+			{
+			g_string_append_printf(stamp, "\n%s -", dirs[i]);
+			}
+		}
+
+	return g_string_free(stamp, FALSE);
+}
+
+GList *editor_get_desktop_files(void)
+{
+	gchar **dirs;
+	gint i;
+	GList *list = NULL;
+
+	dirs = editor_get_desktop_dirs();
+
+	/* taken before reading, a folder changed meanwhile invalidates the cache */
+	g_free(editor_cache_stamp);
+	editor_cache_stamp = editor_desktop_dirs_stamp(dirs);
+
+	for (i = 0; dirs[i]; i++);
 	for (--i; i >= 0; i--)
 		{
-		path = g_build_filename(split_dirs[i], "applications", NULL);
-		list = editor_add_desktop_dir(list, path);
-		g_free(path);
+		list = editor_add_desktop_dir(list, dirs[i]);
 		}
 
-	g_strfreev(split_dirs);
+	g_strfreev(dirs);
 	return list;
 }
 
+/*
+ *-----------------------------------------------------------------------------
+ * editor table cache
+ *-----------------------------------------------------------------------------
+ */
+
+/* The parsed editors are saved to a key file in the cache folder, so a start
+ * with unchanged desktop file folders reads one file instead of every
+ * desktop file of every installed application. Ignored desktop files are not
+ * saved, the precedence between equally named files is already resolved.
+ */
+
+static const gchar *editor_cache_path(void)
+{
+	static gchar *cache_path = NULL;
+
+	if (!cache_path) cache_path = g_build_filename(get_editors_cache_dir(), EDITOR_CACHE_FILE, NULL);
+
+	return cache_path;
+}
+
+static void editor_cache_set_string(GKeyFile *key_file, const gchar *group, const gchar *key, const gchar *value)
+{
+	if (value) g_key_file_set_string(key_file, group, key, value);
+}
+
+/* to be called after the desktop files are read, before editor_table_finish() */
+void editor_table_save_cache(void)
+{
+	GKeyFile *key_file;
+	GtkTreeModel *store;
+	GtkTreeIter iter;
+	gboolean valid;
+	GPtrArray *keys;
+	gchar *data;
+	gsize length;
+	gchar *dir;
+	gchar *pathl;
+	SecureSaveInfo *ssi;
+
+	if (!editor_cache_stamp || !editors || !desktop_file_list) return;
+
+	key_file = g_key_file_new();
+	g_key_file_set_string(key_file, EDITOR_CACHE_GROUP, "Stamp", editor_cache_stamp);
+
+	keys = g_ptr_array_new();
+	store = GTK_TREE_MODEL(desktop_file_list);
+	valid = gtk_tree_model_get_iter_first(store, &iter);
+	while (valid)
+		{
+		EditorDescription *editor;
+		gchar *key;
+
+		gtk_tree_model_get(store, &iter, DESKTOP_FILE_COLUMN_KEY, &key, -1);
+		editor = g_hash_table_lookup(editors, key);
+		g_free(key);
+
+		valid = gtk_tree_model_iter_next(store, &iter);
+		if (!editor) continue;
+
+		g_ptr_array_add(keys, editor->key);
+
+		editor_cache_set_string(key_file, editor->key, "File", editor->file);
+		editor_cache_set_string(key_file, editor->key, "Name", editor->name);
+		editor_cache_set_string(key_file, editor->key, "Icon", editor->icon);
+		editor_cache_set_string(key_file, editor->key, "Exec", editor->exec);
+		editor_cache_set_string(key_file, editor->key, "MenuPath", editor->menu_path);
+		editor_cache_set_string(key_file, editor->key, "Hotkey", editor->hotkey);
+		editor_cache_set_string(key_file, editor->key, "Comment", editor->comment);
+		g_key_file_set_integer(key_file, editor->key, "Flags", editor->flags);
+		g_key_file_set_boolean(key_file, editor->key, "Hidden", editor->hidden);
+
+		if (editor->ext_list)
+			{
+			GPtrArray *exts = g_ptr_array_new();
+			GList *work;
+
+			for (work = editor->ext_list; work; work = work->next) g_ptr_array_add(exts, work->data);
+			g_key_file_set_string_list(key_file, editor->key, "Extensions",
+						   (const gchar * const *)exts->pdata, exts->len);
+			g_ptr_array_free(exts, TRUE);
+			}
+		}
+	g_key_file_set_string_list(key_file, EDITOR_CACHE_GROUP, "Editors",
+				   (const gchar * const *)keys->pdata, keys->len);
+	g_ptr_array_free(keys, TRUE);
+
+	data = g_key_file_to_data(key_file, &length, NULL);
+	g_key_file_free(key_file);
+
+	dir = remove_level_from_path(editor_cache_path());
+	if (!recursive_mkdir_if_not_exists(dir, 0755))
+		{
+		g_free(dir);
+		g_free(data);
+		return;
+		}
+	g_free(dir);
+
+	pathl = path_from_utf8(editor_cache_path());
+	ssi = secure_open(pathl);
+	g_free(pathl);
+	if (ssi)
+		{
+		secure_fwrite(data, 1, length, ssi);
+		if (secure_close(ssi))
+			{
+			log_printf(_("error saving editor cache file: %s\nerror: %s\n"), editor_cache_path(),
+				   secsave_strerror(secsave_errno));
+			}
+		}
+	g_free(data);
+
+	DEBUG_1("%s editor cache saved", get_exec_time());
+}
+
+/*
+ * Fills the table cleared by editor_table_clear() from the cache,
+ * returns FALSE and leaves the table empty if the cache is missing or stale.
+ */
+gboolean editor_table_load_cache(void)
+{
+	GKeyFile *key_file;
+	gchar **dirs;
+	gchar *stamp;
+	gchar *cached_stamp;
+	gchar **keys;
+	gchar *pathl;
+	gboolean ret;
+	gint i;
+
+	key_file = g_key_file_new();
+	pathl = path_from_utf8(editor_cache_path());
+	ret = g_key_file_load_from_file(key_file, pathl, 0, NULL);
+	g_free(pathl);
+	if (!ret)
+		{
+		g_key_file_free(key_file);
+		return FALSE;
+		}
+
+	dirs = editor_get_desktop_dirs();
+	stamp = editor_desktop_dirs_stamp(dirs);
+	g_strfreev(dirs);
+
+	cached_stamp = g_key_file_get_string(key_file, EDITOR_CACHE_GROUP, "Stamp", NULL);
+	keys = g_key_file_get_string_list(key_file, EDITOR_CACHE_GROUP, "Editors", NULL, NULL);
+	ret = (cached_stamp && keys && strcmp(cached_stamp, stamp) == 0);
+	g_free(cached_stamp);
+	g_free(stamp);
+
+	for (i = 0; ret && keys[i]; i++)
+		{
+		EditorDescription *editor;
+		gchar **exts;
+		gint j;
+
+		if (!g_key_file_has_group(key_file, keys[i]) || g_hash_table_lookup(editors, keys[i]))
+			{
+			ret = FALSE;
+			break;
+			}
+
+		editor = g_new0(EditorDescription, 1);
+		editor->key = g_strdup(keys[i]);
+		editor->file = g_key_file_get_string(key_file, keys[i], "File", NULL);
+		editor->name = g_key_file_get_string(key_file, keys[i], "Name", NULL);
+		editor->icon = g_key_file_get_string(key_file, keys[i], "Icon", NULL);
+		editor->exec = g_key_file_get_string(key_file, keys[i], "Exec", NULL);
+		editor->menu_path = g_key_file_get_string(key_file, keys[i], "MenuPath", NULL);
+		editor->hotkey = g_key_file_get_string(key_file, keys[i], "Hotkey", NULL);
+		editor->comment = g_key_file_get_string(key_file, keys[i], "Comment", NULL);
+		editor->flags = g_key_file_get_integer(key_file, keys[i], "Flags", NULL);
+		editor->hidden = g_key_file_get_boolean(key_file, keys[i], "Hidden", NULL);
+
+		exts = g_key_file_get_string_list(key_file, keys[i], "Extensions", NULL, NULL);
+		for (j = 0; exts && exts[j]; j++)
+			{
+			editor->ext_list = g_list_prepend(editor->ext_list, exts[j]);
+			}
+		editor->ext_list = g_list_reverse(editor->ext_list);
+		g_free(exts); /* the strings are now owned by ext_list */
+
+		g_hash_table_insert(editors, editor->key, editor);
+
+		if (!editor->file || !editor->menu_path)
+			{
+			ret = FALSE;
+			break;
+			}
+
+		if (editor->icon && !register_theme_icon_as_stock(editor->key, editor->icon))
+			{
+			g_free(editor->icon);
+			editor->icon = NULL;
+			}
+
+		editor_desktop_file_list_add(editor);
+		}
+
+	g_strfreev(keys);
+	g_key_file_free(key_file);
+
+	if (!ret)
+		{
+		editor_table_clear();
+		return FALSE;
+		}
+
+	DEBUG_1("%s editor cache loaded: %d editors", get_exec_time(), i);
+	return TRUE;
+}
+
 static void editor_list_add_cb(gpointer key, gpointer value, gpointer data)
 {
 	GList **listp = data;
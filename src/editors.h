@@ -90,6 +90,8 @@ void editor_table_finish(void);
 void editor_table_clear(void);
 GList *editor_get_desktop_files(void);
 gboolean editor_read_desktop_file(const gchar *path);
+gboolean editor_table_load_cache(void);
+void editor_table_save_cache(void);
 
 GList *editor_list_get(void);
 
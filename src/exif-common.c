@@ -56,6 +56,7 @@
 #include "ui_fileops.h"
 #include "cache.h"
 #include "jpeg_parser.h"
+#include "perf.h"
 
 
 static gdouble exif_rational_to_double(ExifRational *r, gint sign)
@@ -664,9 +665,27 @@ void exif_init_cache(void)
 	exif_cache = file_cache_new(exif_release_cb, 4);
 }
 
+/* the XMP sidecar exif_read_fd() merges into the data of fd, or NULL */
+gchar *exif_get_sidecar_path_fd(FileData *fd)
+{
+	gchar *sidecar_path = NULL;
+
+	/* CACHE_TYPE_XMP_METADATA file should exist only if the metadata are
+	 * not writable directly, thus it should contain the most up-to-date version */
+#ifdef HAVE_EXIV2
+	/* we are not able to handle XMP sidecars without exiv2 */
+	sidecar_path = cache_find_location(CACHE_TYPE_XMP_METADATA, fd->path);
+
+	if (!sidecar_path) sidecar_path = file_data_get_sidecar_path(fd, TRUE);
+#endif
+
+	return sidecar_path;
+}
+
 ExifData *exif_read_fd(FileData *fd)
 {
 	gchar *sidecar_path;
+	PERF_TIMER_DECLARE(timer);
 
 	if (!exif_cache) exif_init_cache();
 
@@ -675,18 +694,11 @@ ExifData *exif_read_fd(FileData *fd)
 	if (file_cache_get(exif_cache, fd)) return fd->exif;
 	g_assert(fd->exif == NULL);
 
-	/* CACHE_TYPE_XMP_METADATA file should exist only if the metadata are
-	 * not writable directly, thus it should contain the most up-to-date version */
-	sidecar_path = NULL;
-
-#ifdef HAVE_EXIV2
-	/* we are not able to handle XMP sidecars without exiv2 */
-	sidecar_path = cache_find_location(CACHE_TYPE_XMP_METADATA, fd->path);
-
-	if (!sidecar_path) sidecar_path = file_data_get_sidecar_path(fd, TRUE);
-#endif
+	sidecar_path = exif_get_sidecar_path_fd(fd);
 
-	fd->exif = exif_read(fd->path, sidecar_path, fd->modified_xmp);
+	PERF_TIMER_START(timer);
+	fd->exif = exif_read(fd->path, sidecar_path, fd->cold ? fd->cold->modified_xmp : NULL);
+	PERF_TIMER_STOP(timer, PERF_EXIF_READ);
 
 	g_free(sidecar_path);
 	file_cache_put(exif_cache, fd, 1);
@@ -106,6 +106,7 @@ void exif_init(void);
 ExifData *exif_read(gchar *path, gchar *sidecar_path, GHashTable *modified_xmp);
 
 ExifData *exif_read_fd(FileData *fd);
+gchar *exif_get_sidecar_path_fd(FileData *fd);
 void exif_free_fd(FileData *fd, ExifData *exif);
 
 /* exif_read returns processed data (merged from image and sidecar, etc.)
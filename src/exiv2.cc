@@ -453,6 +453,10 @@ void exif_init(void)
 #ifdef EXV_ENABLE_NLS
 	bind_textdomain_codeset (EXV_PACKAGE, "UTF-8");
 #endif
+#if EXIV2_TEST_VERSION(0,21,0)
+	/* the XMP toolkit must be set up before metadata is read on other threads */
+	Exiv2::XmpParser::initialize();
+#endif
 }
 
 
@@ -20,6 +20,7 @@
 
 #include "main.h"
 #include "filecache.h"
+#include "perf.h"
 
 /* Set to TRUE to add file cache dumps to the debug output */
 const gboolean debug_file_cache = FALSE;
@@ -29,6 +30,7 @@ const gboolean debug_file_cache = FALSE;
 struct _FileCacheData {
 	FileCacheReleaseFunc release;
 	GList *list;
+	GHashTable *index; /* FileData -> its link in list */
 	gulong max_size;
 	gulong size;
 };
@@ -48,6 +50,7 @@ FileCacheData *file_cache_new(FileCacheReleaseFunc release, gulong max_size)
 
 	fc->release = release;
 	fc->list = NULL;
+	fc->index = g_hash_table_new(g_direct_hash, g_direct_equal);
 	fc->max_size = max_size;
 	fc->size = 0;
 
@@ -62,31 +65,28 @@ gboolean file_cache_get(FileCacheData *fc, FileData *fd)
 
 	g_assert(fc && fd);
 
-	work = fc->list;
-	while (work)
+	work = g_hash_table_lookup(fc->index, fd);
+	if (work)
 		{
-		FileCacheEntry *fce = work->data;
-		if (fce->fd == fd)
-			{
-			/* entry exists */
-			DEBUG_2("cache hit: fc=%p %s", fc, fd->path);
-			if (work == fc->list) return TRUE; /* already at the beginning */
-			/* move it to the beginning */
-			DEBUG_2("cache move to front: fc=%p %s", fc, fd->path);
-			fc->list = g_list_remove_link(fc->list, work);
-			fc->list = g_list_concat(work, fc->list);
-
-			if (file_data_check_changed_files(fd)) {
-				/* file has been changed, cance entry is no longer valid */
-				file_cache_remove_fd(fc, fd);
-				return FALSE;
-			}
-			if (debug_file_cache) file_cache_dump(fc);
-			return TRUE;
-			}
-		work = work->next;
+		/* entry exists */
+		DEBUG_2("cache hit: fc=%p %s", fc, fd->path);
+		PERF_COUNT(PERF_FILE_CACHE_HIT);
+		if (work == fc->list) return TRUE; /* already at the beginning */
+		/* move it to the beginning */
+		DEBUG_2("cache move to front: fc=%p %s", fc, fd->path);
+		fc->list = g_list_remove_link(fc->list, work);
+		fc->list = g_list_concat(work, fc->list);
+
+		if (file_data_check_changed_files(fd)) {
+			/* file has been changed, cance entry is no longer valid */
+			file_cache_remove_fd(fc, fd);
+			return FALSE;
+		}
+		if (debug_file_cache) file_cache_dump(fc);
+		return TRUE;
 		}
 	DEBUG_2("cache miss: fc=%p %s", fc, fd->path);
+	PERF_COUNT(PERF_FILE_CACHE_MISS);
 	return FALSE;
 }
 
@@ -104,6 +104,7 @@ void file_cache_set_size(FileCacheData *fc, gulong size)
 		last_fe = work->data;
 		prev = work->prev;
 		fc->list = g_list_delete_link(fc->list, work);
+		g_hash_table_remove(fc->index, last_fe->fd);
 		work = prev;
 
 		DEBUG_2("file changed - cache remove: fc=%p %s", fc, last_fe->fd->path);
@@ -125,6 +126,7 @@ void file_cache_put(FileCacheData *fc, FileData *fd, gulong size)
 	fe->fd = file_data_ref(fd);
 	fe->size = size;
 	fc->list = g_list_prepend(fc->list, fe);
+	g_hash_table_insert(fc->index, fe->fd, fc->list);
 	fc->size += size;
 
 	file_cache_set_size(fc, fc->max_size);
@@ -153,24 +155,18 @@ static void file_cache_remove_fd(FileCacheData *fc, FileData *fd)
 
 	if (debug_file_cache) file_cache_dump(fc);
 
-	work = fc->list;
-	while (work)
-		{
-		GList *current = work;
-		fe = work->data;
-		work = work->next;
+	work = g_hash_table_lookup(fc->index, fd);
+	if (!work) return;
 
-		if (fe->fd == fd)
-			{
-			fc->list = g_list_delete_link(fc->list, current);
+	fe = work->data;
+	fc->list = g_list_delete_link(fc->list, work);
+	g_hash_table_remove(fc->index, fd);
 
-			DEBUG_1("cache remove: fc=%p %s", fc, fe->fd->path);
-			fc->size -= fe->size;
-			fc->release(fe->fd);
-			file_data_unref(fe->fd);
-			g_free(fe);
-			}
-		}
+	DEBUG_1("cache remove: fc=%p %s", fc, fe->fd->path);
+	fc->size -= fe->size;
+	fc->release(fe->fd);
+	file_data_unref(fe->fd);
+	g_free(fe);
 }
 
 void file_cache_dump(FileCacheData *fc)
@@ -46,8 +46,6 @@ static void file_data_check_sidecars(const GList *basename_list);
 static void file_data_disconnect_sidecar_file(FileData *target, FileData *sfd);
 
 
-static SortType filelist_sort_method = SORT_NONE;
-static gboolean filelist_sort_ascend = TRUE;
 
 /*
  *-----------------------------------------------------------------------------
@@ -268,35 +266,212 @@ gboolean file_data_check_changed_files(FileData *fd)
  *-----------------------------------------------------------------------------
  */
 
-static void file_data_set_collate_keys(FileData *fd)
+static void file_data_reset_collate_keys(FileData *fd)
 {
-	gchar *caseless_name;
+	g_free(fd->collate_key_name);
+	g_free(fd->collate_key_name_nocase);
+	fd->collate_key_name = NULL;
+	fd->collate_key_name_nocase = NULL;
+}
+
+/**
+ * \brief Returns the collate key of the file name
+ *
+ * Keys are computed on first use, most FileData are never sorted by name
+ * in both cases. They are recomputed when options->file_sort.natural changes.
+ */
+const gchar *file_data_get_collate_key(FileData *fd, gboolean case_sensitive)
+{
+	gboolean natural = FALSE;
+	gchar **key;
 	gchar *valid_name;
 
+#if GTK_CHECK_VERSION(2, 8, 0)
+	natural = !!options->file_sort.natural;
+#endif
+
+	if (fd->collate_natural != natural)
+		{
+		file_data_reset_collate_keys(fd);
+		fd->collate_natural = natural;
+		}
+
+	key = case_sensitive ? &fd->collate_key_name : &fd->collate_key_name_nocase;
+	if (*key) return *key;
+
 	valid_name = g_filename_display_name(fd->name);
-	caseless_name = g_utf8_casefold(valid_name, -1);
 
-	g_free(fd->collate_key_name);
-	g_free(fd->collate_key_name_nocase);
+	if (case_sensitive)
+		{
+#if GTK_CHECK_VERSION(2, 8, 0)
+		if (natural)
+			*key = g_utf8_collate_key_for_filename(fd->name, -1);
+		else
+#endif
+			*key = g_utf8_collate_key(valid_name, -1);
+		}
+	else
+		{
+		gchar *caseless_name = g_utf8_casefold(valid_name, -1);
 
 #if GTK_CHECK_VERSION(2, 8, 0)
-	if (options->file_sort.natural)
+		if (natural)
+			*key = g_utf8_collate_key_for_filename(caseless_name, -1);
+		else
+#endif
+			*key = g_utf8_collate_key(caseless_name, -1);
+
+		g_free(caseless_name);
+		}
+
+	g_free(valid_name);
+	return *key;
+}
+
+/*
+ *-----------------------------------------------------------------------------
+ * path strings, one arena per folder
+ *-----------------------------------------------------------------------------
+ */
+
+/* FileData of one folder are created and released together, so their paths
+ * are packed into a few shared blocks instead of one allocation per string.
+ * Strings are never freed individually from an arena, so a path set again by
+ * a rename is a separate allocation and the FileData leaves its arena, else
+ * the old paths would pile up until the last FileData of that folder is freed.
+ *
+ * A FileData that outlives the others of its folder (the current image, a
+ * collection entry) keeps the arena alive, and each visit of the folder would
+ * append the paths again. The bytes of freed FileData are counted as dead, an
+ * arena that is mostly dead is retired: it is freed with its last FileData and
+ * the next FileData of the folder start a new one.
+ */
+#define FILE_DATA_ARENA_BLOCK_MIN 256
+#define FILE_DATA_ARENA_BLOCK_MAX 4096
+
+struct _FileDataArena {
+	gchar *dir; /* key to file_data_arena_pool, interned folder prefix */
+	GSList *blocks;
+	gchar *next;
+	gsize left;
+	gsize allocated;
+	gsize used;
+	gsize dead; /* part of used that belongs to freed FileData */
+	gint ref;
+	gboolean retired; /* no longer in file_data_arena_pool */
+};
+
+static GHashTable *file_data_arena_pool = NULL;
+static guint file_data_arena_retired_count = 0;
+static gsize file_data_arena_retired_bytes = 0;
+
+static gboolean file_data_arena_mostly_dead(FileDataArena *arena)
+{
+	return (arena->dead >= FILE_DATA_ARENA_BLOCK_MAX && arena->dead > arena->used / 2);
+}
+
+static FileDataArena *file_data_arena_ref(const gchar *path)
+{
+	FileDataArena *arena;
+	gchar *dir;
+
+	if (!file_data_arena_pool)
+		file_data_arena_pool = g_hash_table_new(g_str_hash, g_str_equal);
+
+	dir = g_strndup(path, filename_from_path(path) - path);
+
+	arena = g_hash_table_lookup(file_data_arena_pool, dir);
+	if (arena && file_data_arena_mostly_dead(arena))
+		{
+		g_hash_table_remove(file_data_arena_pool, arena->dir);
+		arena->retired = TRUE;
+		file_data_arena_retired_count++;
+		file_data_arena_retired_bytes += arena->allocated;
+		}
+	else if (arena)
+		{
+		g_free(dir);
+		arena->ref++;
+		return arena;
+		}
+
+	arena = g_new0(FileDataArena, 1);
+	arena->dir = dir;
+	arena->ref = 1;
+	g_hash_table_insert(file_data_arena_pool, arena->dir, arena);
+
+	return arena;
+}
+
+static void file_data_arena_unref(FileDataArena *arena)
+{
+	arena->ref--;
+	if (arena->ref > 0) return;
+
+	if (arena->retired)
 		{
-	 	fd->collate_key_name = g_utf8_collate_key_for_filename(fd->name, -1);
-	 	fd->collate_key_name_nocase = g_utf8_collate_key_for_filename(caseless_name, -1);
+		file_data_arena_retired_count--;
+		file_data_arena_retired_bytes -= arena->allocated;
 		}
 	else
 		{
-		fd->collate_key_name = g_utf8_collate_key(valid_name, -1);
-		fd->collate_key_name_nocase = g_utf8_collate_key(caseless_name, -1);
+		g_hash_table_remove(file_data_arena_pool, arena->dir);
 		}
-#else
-	fd->collate_key_name = g_utf8_collate_key(valid_name, -1);
-	fd->collate_key_name_nocase = g_utf8_collate_key(caseless_name, -1);
-#endif
+	g_slist_foreach(arena->blocks, (GFunc)g_free, NULL);
+	g_slist_free(arena->blocks);
+	g_free(arena->dir);
+	g_free(arena);
+}
 
-	g_free(valid_name);
-	g_free(caseless_name);
+static gchar *file_data_arena_strdup(FileDataArena *arena, const gchar *str)
+{
+	gsize len = strlen(str) + 1;
+	gchar *ret;
+
+	if (len > arena->left)
+		{
+		/* blocks grow with the folder, small folders waste little */
+		gsize size = CLAMP(arena->allocated, FILE_DATA_ARENA_BLOCK_MIN, FILE_DATA_ARENA_BLOCK_MAX);
+
+		size = MAX(size, len);
+		arena->next = g_malloc(size);
+		arena->left = size;
+		arena->allocated += size;
+		arena->blocks = g_slist_prepend(arena->blocks, arena->next);
+		}
+
+	ret = arena->next;
+	memcpy(ret, str, len);
+	arena->next += len;
+	arena->left -= len;
+	arena->used += len;
+
+	return ret;
+}
+
+/* a FileData without arena owns its strings */
+static gchar *file_data_path_strdup(FileData *fd, const gchar *str)
+{
+	if (fd->arena) return file_data_arena_strdup(fd->arena, str);
+	return g_strdup(str);
+}
+
+static void file_data_path_free(FileData *fd)
+{
+	if (fd->arena)
+		{
+		fd->arena->dead += strlen(fd->original_path) + 1;
+		if (fd->path != fd->original_path) fd->arena->dead += strlen(fd->path) + 1;
+		file_data_arena_unref(fd->arena);
+		fd->arena = NULL;
+		}
+	else
+		{
+		if (fd->path != fd->original_path) g_free(fd->path);
+		g_free(fd->original_path);
+		}
+	fd->path = NULL;
+	fd->original_path = NULL;
 }
 
 static void file_data_set_path(FileData *fd, const gchar *path)
@@ -304,49 +479,58 @@ static void file_data_set_path(FileData *fd, const gchar *path)
 	g_assert(path /* && *path*/); /* view_dir_tree uses FileData with zero length path */
 	g_assert(file_data_pool);
 
-	g_free(fd->path);
-
 	if (fd->original_path)
 		{
 		g_hash_table_remove(file_data_pool, fd->original_path);
-		g_free(fd->original_path);
 		}
 
 	g_assert(!g_hash_table_lookup(file_data_pool, path));
 
-	fd->original_path = g_strdup(path);
+	/* only a new FileData uses the arena of its folder, see above */
+	if (fd->original_path)
+		{
+		file_data_path_free(fd);
+		}
+	else
+		{
+		fd->arena = file_data_arena_ref(path);
+		}
+
+	fd->original_path = file_data_path_strdup(fd, path);
+	fd->path = fd->original_path;
 	g_hash_table_insert(file_data_pool, fd->original_path, fd);
 
+	file_data_reset_collate_keys(fd);
+
 	if (strcmp(path, G_DIR_SEPARATOR_S) == 0)
 		{
-		fd->path = g_strdup(path);
 		fd->name = fd->path;
 		fd->extension = fd->name + 1;
-		file_data_set_collate_keys(fd);
 		return;
 		}
 
-	fd->path = g_strdup(path);
 	fd->name = filename_from_path(fd->path);
 
 	if (strcmp(fd->name, "..") == 0)
 		{
 		gchar *dir = remove_level_from_path(path);
-		g_free(fd->path);
-		fd->path = remove_level_from_path(dir);
+		gchar *parent = remove_level_from_path(dir);
+
+		fd->path = file_data_path_strdup(fd, parent);
+		g_free(parent);
 		g_free(dir);
 		fd->name = "..";
 		fd->extension = fd->name + 2;
-		file_data_set_collate_keys(fd);
 		return;
 		}
 	else if (strcmp(fd->name, ".") == 0)
 		{
-		g_free(fd->path);
-		fd->path = remove_level_from_path(path);
+		gchar *dir = remove_level_from_path(path);
+
+		fd->path = file_data_path_strdup(fd, dir);
+		g_free(dir);
 		fd->name = ".";
 		fd->extension = fd->name + 1;
-		file_data_set_collate_keys(fd);
 		return;
 		}
 
@@ -357,7 +541,147 @@ static void file_data_set_path(FileData *fd, const gchar *path)
 		}
 
 	fd->sidecar_priority = sidecar_file_priority(fd->extension);
-	file_data_set_collate_keys(fd);
+}
+
+/**
+ * \brief Returns the rarely used members of fd, allocating them on first use
+ */
+FileDataCold *file_data_cold(FileData *fd)
+{
+	if (!fd->cold) fd->cold = g_new0(FileDataCold, 1);
+	return fd->cold;
+}
+
+/*
+ *-----------------------------------------------------------------------------
+ * memory report
+ *-----------------------------------------------------------------------------
+ */
+
+/* rough bookkeeping cost of one heap allocation, glibc needs 8 to 24 bytes */
+#define FILE_DATA_ALLOC_OVERHEAD 16
+
+typedef struct _FileDataMemory FileDataMemory;
+struct _FileDataMemory
+{
+	guint count;
+	guint keys;
+	guint cold;
+	gsize key_bytes;
+	gsize key_missing_bytes;
+	gsize cold_bytes;
+	gsize legacy_bytes;
+	guint renamed;
+	gsize renamed_bytes;
+};
+
+static void file_data_memory_count(gpointer key, gpointer value, gpointer data)
+{
+	FileData *fd = value;
+	FileDataMemory *mem = data;
+
+	mem->count++;
+
+	/* separate path and original_path copies, the cold pointers and two gboolean in the struct */
+	mem->legacy_bytes += strlen(fd->path) + strlen(fd->original_path) + 2 * (1 + FILE_DATA_ALLOC_OVERHEAD);
+	mem->legacy_bytes += 4 * sizeof(gpointer) - sizeof(fd->arena) - sizeof(fd->cold) + sizeof(gboolean);
+
+	if (!fd->arena)
+		{
+		mem->renamed++;
+		mem->renamed_bytes += strlen(fd->original_path) + 1 + FILE_DATA_ALLOC_OVERHEAD;
+		if (fd->path != fd->original_path) mem->renamed_bytes += strlen(fd->path) + 1 + FILE_DATA_ALLOC_OVERHEAD;
+		}
+
+	if (fd->collate_key_name)
+		{
+		mem->keys++;
+		mem->key_bytes += strlen(fd->collate_key_name) + 1 + FILE_DATA_ALLOC_OVERHEAD;
+		}
+	if (fd->collate_key_name_nocase)
+		{
+		mem->keys++;
+		mem->key_bytes += strlen(fd->collate_key_name_nocase) + 1 + FILE_DATA_ALLOC_OVERHEAD;
+		}
+
+	if (!fd->collate_key_name || !fd->collate_key_name_nocase)
+		{
+		/* the cost of the keys that were never needed */
+		gchar *key = g_utf8_collate_key(fd->name, -1);
+		gsize key_bytes = strlen(key) + 1 + FILE_DATA_ALLOC_OVERHEAD;
+
+		if (!fd->collate_key_name) mem->key_missing_bytes += key_bytes;
+		if (!fd->collate_key_name_nocase) mem->key_missing_bytes += key_bytes;
+		g_free(key);
+		}
+
+	if (fd->cold)
+		{
+		mem->cold++;
+		mem->cold_bytes += sizeof(FileDataCold) + FILE_DATA_ALLOC_OVERHEAD;
+		}
+}
+
+/**
+ * \brief Describes the memory used by all FileData
+ *
+ * Counts the struct, the folder arenas holding the paths, the collate keys
+ * and the cold data, and estimates the cost of the same FileData with one
+ * allocation per string and eagerly computed keys.
+ */
+gchar *file_data_memory_report(void)
+{
+	FileDataMemory mem;
+	GHashTableIter iter;
+	gpointer value;
+	guint arenas = 0;
+	gsize arena_bytes = 0;
+	gsize arena_used = 0;
+	gsize struct_bytes;
+	gsize total;
+	gsize legacy;
+	gdouble n;
+
+	memset(&mem, 0, sizeof(mem));
+	if (file_data_pool) g_hash_table_foreach(file_data_pool, file_data_memory_count, &mem);
+
+	if (file_data_arena_pool)
+		{
+		g_hash_table_iter_init(&iter, file_data_arena_pool);
+		while (g_hash_table_iter_next(&iter, NULL, &value))
+			{
+			FileDataArena *arena = value;
+
+			arenas++;
+			arena_used += arena->used - arena->dead;
+			arena_bytes += arena->allocated + g_slist_length(arena->blocks) * FILE_DATA_ALLOC_OVERHEAD;
+			arena_bytes += sizeof(FileDataArena) + strlen(arena->dir) + 1 + 2 * FILE_DATA_ALLOC_OVERHEAD;
+			}
+		}
+	/* kept by their remaining FileData, mostly dead */
+	arenas += file_data_arena_retired_count;
+	arena_bytes += file_data_arena_retired_bytes;
+
+	struct_bytes = mem.count * (sizeof(FileData) + FILE_DATA_ALLOC_OVERHEAD);
+	total = struct_bytes + arena_bytes + mem.renamed_bytes + mem.key_bytes + mem.cold_bytes;
+
+	legacy = struct_bytes + mem.legacy_bytes + mem.key_bytes + mem.key_missing_bytes;
+
+	n = mem.count ? (gdouble)mem.count : 1.0;
+
+	return g_strdup_printf(_("FileData: %u items, %.1f bytes per item (%" G_GSIZE_FORMAT " bytes total)\n"
+				 "  struct: %" G_GSIZE_FORMAT " bytes each\n"
+				 "  paths: %.1f bytes per item in %u folder arenas (%u retired), %.0f%% used, %u renamed items with own paths\n"
+				 "  collate keys: %u of %u computed, %.1f bytes per item\n"
+				 "  cold data: %u items, %.1f bytes per item\n"
+				 "  separate strings and eager keys: about %.1f bytes per item\n"),
+			       mem.count, total / n, total,
+			       sizeof(FileData),
+			       (arena_bytes + mem.renamed_bytes) / n, arenas, file_data_arena_retired_count, arena_bytes ? 100.0 * arena_used / arena_bytes : 0.0,
+			       mem.renamed,
+			       mem.keys, mem.count * 2, mem.key_bytes / n,
+			       mem.cold, mem.cold_bytes / n,
+			       legacy / n);
 }
 
 /*
@@ -433,7 +757,7 @@ static FileData *file_data_new(const gchar *path_utf8, struct stat *st, gboolean
 
 	if (disable_sidecars) fd->disable_grouping = TRUE;
 
-	file_data_set_path(fd, path_utf8); /* set path, name, collate_key_*, original_path */
+	file_data_set_path(fd, path_utf8); /* set path, name, original_path */
 
 	return fd;
 }
@@ -534,6 +858,25 @@ void set_rating_data(GList *files)
 		}
 }
 
+/* size and date come from a cache of the file, nothing is read from disk */
+FileData *file_data_new_cached(const gchar *path_utf8, gint64 size, time_t date)
+{
+	struct stat st;
+	FileData *fd;
+
+	/* a file already known is more recent than the cache */
+	fd = file_data_pool ? g_hash_table_lookup(file_data_pool, path_utf8) : NULL;
+	if (fd) return file_data_ref(fd);
+
+	memset(&st, 0, sizeof(st));
+	st.st_mode = S_IFREG;
+	st.st_size = size;
+	st.st_mtime = date;
+	st.st_ctime = date;
+
+	return file_data_new(path_utf8, &st, TRUE);
+}
+
 FileData *file_data_new_no_grouping(const gchar *path_utf8)
 {
 	struct stat st;
@@ -607,13 +950,15 @@ static void file_data_free(FileData *fd)
 	metadata_cache_free(fd);
 	g_hash_table_remove(file_data_pool, fd->original_path);
 
-	g_free(fd->path);
-	g_free(fd->original_path);
-	g_free(fd->collate_key_name);
-	g_free(fd->collate_key_name_nocase);
-	g_free(fd->extended_extension);
+	file_data_path_free(fd);
+	file_data_reset_collate_keys(fd);
+	if (fd->cold)
+		{
+		g_free(fd->cold->extended_extension);
+		histmap_free(fd->cold->histmap);
+		g_free(fd->cold);
+		}
 	if (fd->thumb_pixbuf) g_object_unref(fd->thumb_pixbuf);
-	histmap_free(fd->histmap);
 
 	g_assert(fd->sidecar_files == NULL); /* sidecar files must be freed before calling this */
 
@@ -939,8 +1284,11 @@ static void file_data_disconnect_sidecar_file(FileData *target, FileData *sfd)
 
 	target->sidecar_files = g_list_remove(target->sidecar_files, sfd);
 	sfd->parent = NULL;
-	g_free(sfd->extended_extension);
-	sfd->extended_extension = NULL;
+	if (sfd->cold)
+		{
+		g_free(sfd->cold->extended_extension);
+		sfd->cold->extended_extension = NULL;
+		}
 
 	file_data_unref(target);
 	file_data_unref(sfd);
@@ -1012,157 +1360,382 @@ void file_data_disable_grouping_list(GList *fd_list, gboolean disable)
  */
 
 
-gint filelist_sort_compare_filedata(FileData *fa, FileData *fb)
+/* lists this long are sorted in chunks on several threads, then merged */
+#define FILELIST_SORT_PARALLEL 16384
+#define FILELIST_SORT_THREADS_DEFAULT 4
+#define FILELIST_SORT_THREADS_MAX 8
+
+typedef struct _FileListSortParam FileListSortParam;
+struct _FileListSortParam
 {
-	gint ret;
-	if (!filelist_sort_ascend)
-		{
-		FileData *tmp = fa;
-		fa = fb;
-		fb = tmp;
-		}
+	SortType method;
+	gboolean ascend;
+	gboolean case_sensitive;
+};
+
+/* everything the comparison needs, packed so that a sort touches FileData
+ * only for ties; the first bytes of the collate key are kept as a big endian
+ * integer which orders like strcmp() */
+typedef struct _FileListSortItem FileListSortItem;
+struct _FileListSortItem
+{
+	gint64 value;
+	guint64 prefix;
+	const gchar *key;
+	FileData *fd;
+};
+
+static void filelist_sort_param_init(FileListSortParam *param, SortType method, gboolean ascend)
+{
+	param->method = method;
+	param->ascend = ascend;
+	param->case_sensitive = options->file_sort.case_sensitive;
+}
 
-	switch (filelist_sort_method)
+/* computes the collate key if needed, call from the main thread only */
+static void filelist_sort_item_set(FileListSortItem *item, FileData *fd, const FileListSortParam *param)
+{
+	const guchar *key;
+	guint i;
+
+	switch (param->method)
 		{
-		case SORT_NAME:
-			break;
 		case SORT_SIZE:
-			if (fa->size < fb->size) return -1;
-			if (fa->size > fb->size) return 1;
-			/* fall back to name */
+			item->value = fd->size;
 			break;
 		case SORT_TIME:
-			if (fa->date < fb->date) return -1;
-			if (fa->date > fb->date) return 1;
-			/* fall back to name */
+			item->value = fd->date;
 			break;
 		case SORT_CTIME:
-			if (fa->cdate < fb->cdate) return -1;
-			if (fa->cdate > fb->cdate) return 1;
-			/* fall back to name */
+			item->value = fd->cdate;
 			break;
 		case SORT_EXIFTIME:
-			if (fa->exifdate < fb->exifdate) return -1;
-			if (fa->exifdate > fb->exifdate) return 1;
-			/* fall back to name */
+			item->value = fd->exifdate;
 			break;
 		case SORT_RATING:
-			if (fa->rating < fb->rating) return -1;
-			if (fa->rating > fb->rating) return 1;
-			/* fall back to name */
-			break;
-#ifdef HAVE_STRVERSCMP
-		case SORT_NUMBER:
-			ret = strverscmp(fa->name, fb->name);
-			if (ret != 0) return ret;
+			item->value = fd->rating;
 			break;
-#endif
 		default:
+			item->value = 0;
 			break;
 		}
 
-	if (options->file_sort.case_sensitive)
-		ret = strcmp(fa->collate_key_name, fb->collate_key_name);
-	else
-		ret = strcmp(fa->collate_key_name_nocase, fb->collate_key_name_nocase);
+	item->key = file_data_get_collate_key(fd, param->case_sensitive);
+	item->fd = fd;
+
+	item->prefix = 0;
+	key = (const guchar *)item->key;
+	for (i = 0; i < sizeof(item->prefix); i++)
+		{
+		item->prefix = (item->prefix << 8) | *key;
+		if (*key) key++;
+		}
+}
+
+static gint filelist_sort_compare_items(gconstpointer a, gconstpointer b, gpointer data)
+{
+	const FileListSortItem *ia = a;
+	const FileListSortItem *ib = b;
+	const FileListSortParam *param = data;
+	gint ret;
+
+	if (!param->ascend)
+		{
+		const FileListSortItem *tmp = ia;
+		ia = ib;
+		ib = tmp;
+		}
+
+	/* value is 0 for the name based methods */
+	if (ia->value < ib->value) return -1;
+	if (ia->value > ib->value) return 1;
+
+#ifdef HAVE_STRVERSCMP
+	if (param->method == SORT_NUMBER)
+		{
+		ret = strverscmp(ia->fd->name, ib->fd->name);
+		if (ret != 0) return ret;
+		}
+#endif
+
+	if (ia->prefix < ib->prefix) return -1;
+	if (ia->prefix > ib->prefix) return 1;
 
+	ret = strcmp(ia->key, ib->key);
 	if (ret != 0) return ret;
 
 	/* do not return 0 unless the files are really the same
 	   file_data_pool ensures that original_path is unique
 	*/
-	return strcmp(fa->original_path, fb->original_path);
+	return strcmp(ia->fd->original_path, ib->fd->original_path);
 }
 
-gint filelist_sort_compare_filedata_full(FileData *fa, FileData *fb, SortType method, gboolean ascend)
+static gint filelist_sort_compare_filedata_param(FileData *fa, FileData *fb, const FileListSortParam *param)
 {
-	filelist_sort_method = method;
-	filelist_sort_ascend = ascend;
-	return filelist_sort_compare_filedata(fa, fb);
+	FileListSortItem ia;
+	FileListSortItem ib;
+
+	filelist_sort_item_set(&ia, fa, param);
+	filelist_sort_item_set(&ib, fb, param);
+
+	return filelist_sort_compare_items(&ia, &ib, (gpointer)param);
 }
 
-static gint filelist_sort_file_cb(gpointer a, gpointer b)
+gint filelist_sort_compare_filedata_full(FileData *fa, FileData *fb, SortType method, gboolean ascend)
 {
-	return filelist_sort_compare_filedata(a, b);
+	FileListSortParam param;
+
+	filelist_sort_param_init(&param, method, ascend);
+	return filelist_sort_compare_filedata_param(fa, fb, &param);
 }
 
-GList *filelist_sort_full(GList *list, SortType method, gboolean ascend, GCompareFunc cb)
+#ifdef HAVE_GTHREAD
+typedef struct _FileListSortChunk FileListSortChunk;
+struct _FileListSortChunk
 {
-	filelist_sort_method = method;
-	filelist_sort_ascend = ascend;
-	return g_list_sort(list, cb);
-}
+	FileListSortItem *items;
+	guint count;
+	const FileListSortParam *param;
+	GAsyncQueue *done;	/* gets the chunk when sorted */
+};
+
+/* shared by all sorts, which may run in several threads */
+G_LOCK_DEFINE_STATIC(filelist_sort_pool);
+static GThreadPool *filelist_sort_pool = NULL;
 
-GList *filelist_insert_sort_full(GList *list, gpointer data, SortType method, gboolean ascend, GCompareFunc cb)
+static void filelist_sort_thread_run(gpointer data, gpointer user_data)
 {
-	filelist_sort_method = method;
-	filelist_sort_ascend = ascend;
-	return g_list_insert_sorted(list, data, cb);
+	FileListSortChunk *chunk = data;
+
+	g_qsort_with_data(chunk->items, chunk->count, sizeof(FileListSortItem), filelist_sort_compare_items, (gpointer)chunk->param);
+	g_async_queue_push(chunk->done, chunk);
 }
 
-GList *filelist_sort(GList *list, SortType method, gboolean ascend)
+static void filelist_sort_merge(FileListSortItem *dest, const FileListSortItem *a, guint na,
+				const FileListSortItem *b, guint nb, const FileListSortParam *param)
 {
-	if (method == SORT_EXIFTIME)
-		{
-		set_exif_time_data(list);
-		}
-	if (method == SORT_RATING)
+	while (na > 0 && nb > 0)
 		{
-		set_rating_data(list);
+		/* take from a on ties, keeps the merge stable */
+		if (filelist_sort_compare_items(b, a, (gpointer)param) < 0)
+			{
+			*dest++ = *b++;
+			nb--;
+			}
+		else
+			{
+			*dest++ = *a++;
+			na--;
+			}
 		}
-	return filelist_sort_full(list, method, ascend, (GCompareFunc) filelist_sort_file_cb);
+
+	memcpy(dest, a, na * sizeof(FileListSortItem));
+	memcpy(dest + na, b, nb * sizeof(FileListSortItem));
 }
 
-GList *filelist_insert_sort(GList *list, FileData *fd, SortType method, gboolean ascend)
+static void filelist_sort_items_parallel(FileListSortItem *items, guint count, const FileListSortParam *param)
 {
-	return filelist_insert_sort_full(list, fd, method, ascend, (GCompareFunc) filelist_sort_file_cb);
-}
+	FileListSortChunk chunks[FILELIST_SORT_THREADS_MAX];
+	guint bounds[FILELIST_SORT_THREADS_MAX + 1];
+	FileListSortItem *src = items;
+	FileListSortItem *dest;
+	GAsyncQueue *done;
+	guint n;
+	guint i;
 
-/*
- *-----------------------------------------------------------------------------
- * basename hash - grouping of sidecars in filelist
- *-----------------------------------------------------------------------------
- */
+#if GLIB_CHECK_VERSION(2,36,0)
+	n = CLAMP(g_get_num_processors(), 2, FILELIST_SORT_THREADS_MAX);
+#else
+	n = FILELIST_SORT_THREADS_DEFAULT;
+#endif
 
+	for (i = 0; i <= n; i++) bounds[i] = (guint)((guint64)count * i / n);
 
-static GHashTable *file_data_basename_hash_new(void)
-{
-	return g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
-}
+	G_LOCK(filelist_sort_pool);
+	if (!filelist_sort_pool)
+		{
+		filelist_sort_pool = g_thread_pool_new(filelist_sort_thread_run, NULL, FILELIST_SORT_THREADS_MAX, FALSE, NULL);
+		}
+	G_UNLOCK(filelist_sort_pool);
 
-static GList * file_data_basename_hash_insert(GHashTable *basename_hash, FileData *fd)
-{
-	GList *list;
-	gchar *basename = g_strndup(fd->path, fd->extension - fd->path);
+	done = g_async_queue_new();
+	for (i = 0; i < n; i++)
+		{
+		chunks[i].items = items + bounds[i];
+		chunks[i].count = bounds[i + 1] - bounds[i];
+		chunks[i].param = param;
+		chunks[i].done = done;
+		g_thread_pool_push(filelist_sort_pool, &chunks[i], NULL);
+		}
 
-	list = g_hash_table_lookup(basename_hash, basename);
+	/* returns when all chunks are sorted */
+	for (i = 0; i < n; i++) g_async_queue_pop(done);
+	g_async_queue_unref(done);
 
-	if (!list)
+	/* merge neighbouring runs until one is left */
+	dest = g_new(FileListSortItem, count);
+	while (n > 1)
 		{
-		DEBUG_1("TG: basename_hash not found for %s",fd->path);
-		const gchar *parent_extension = registered_extension_from_path(basename);
+		guint runs = 0;
+		FileListSortItem *tmp;
 
-		if (parent_extension)
+		for (i = 0; i < n; i += 2)
 			{
-			DEBUG_1("TG: parent extension %s",parent_extension);
-			gchar *parent_basename = g_strndup(basename, parent_extension - basename);
-			DEBUG_1("TG: parent basename %s",parent_basename);
-			FileData *parent_fd = g_hash_table_lookup(file_data_pool, basename);
-			if (parent_fd)
+			if (i + 1 < n)
 				{
-				DEBUG_1("TG: parent fd found");
-				list = g_hash_table_lookup(basename_hash, parent_basename);
-				if (!g_list_find(list, parent_fd))
-					{
-					DEBUG_1("TG: parent fd doesn't fit");
-					g_free(parent_basename);
-					list = NULL;
+				filelist_sort_merge(dest + bounds[i], src + bounds[i], bounds[i + 1] - bounds[i],
+						    src + bounds[i + 1], bounds[i + 2] - bounds[i + 1], param);
+				bounds[runs] = bounds[i];
+				}
+			else
+				{
+				memcpy(dest + bounds[i], src + bounds[i], (bounds[i + 1] - bounds[i]) * sizeof(FileListSortItem));
+				bounds[runs] = bounds[i];
+				}
+			runs++;
+			}
+		bounds[runs] = count;
+		n = runs;
+
+		tmp = src;
+		src = dest;
+		dest = tmp;
+		}
+
+	if (src != items)
+		{
+		memcpy(items, src, count * sizeof(FileListSortItem));
+		g_free(src);
+		}
+	else
+		{
+		g_free(dest);
+		}
+}
+#endif
+
+static void filelist_sort_items(FileListSortItem *items, guint count, const FileListSortParam *param)
+{
+#ifdef HAVE_GTHREAD
+	if (count >= FILELIST_SORT_PARALLEL)
+		{
+		filelist_sort_items_parallel(items, count, param);
+		return;
+		}
+#endif
+
+	g_qsort_with_data(items, count, sizeof(FileListSortItem), filelist_sort_compare_items, (gpointer)param);
+}
+
+/**
+ * \brief Sorts a list of FileData
+ *
+ * The sort keys of the active method are packed into an array, which is
+ * sorted and written back into the same list nodes. Collate keys are
+ * computed once per FileData and reused by later sorts.
+ */
+GList *filelist_sort(GList *list, SortType method, gboolean ascend)
+{
+	FileListSortParam param;
+	FileListSortItem *items;
+	GList *work;
+	guint count;
+	guint i;
+
+	if (!list || !list->next) return list;
+
+	if (method == SORT_EXIFTIME)
+		{
+		set_exif_time_data(list);
+		}
+	if (method == SORT_RATING)
+		{
+		set_rating_data(list);
+		}
+
+	filelist_sort_param_init(&param, method, ascend);
+
+	count = g_list_length(list);
+	items = g_new(FileListSortItem, count);
+
+	i = 0;
+	for (work = list; work; work = work->next)
+		{
+		filelist_sort_item_set(&items[i], work->data, &param);
+		i++;
+		}
+
+	filelist_sort_items(items, count, &param);
+
+	i = 0;
+	for (work = list; work; work = work->next)
+		{
+		work->data = items[i].fd;
+		i++;
+		}
+
+	g_free(items);
+	return list;
+}
+
+static gint filelist_insert_sort_cb(gconstpointer a, gconstpointer b, gpointer data)
+{
+	return filelist_sort_compare_filedata_param((FileData *)a, (FileData *)b, data);
+}
+
+GList *filelist_insert_sort(GList *list, FileData *fd, SortType method, gboolean ascend)
+{
+	FileListSortParam param;
+
+	filelist_sort_param_init(&param, method, ascend);
+	return g_list_insert_sorted_with_data(list, fd, filelist_insert_sort_cb, &param);
+}
+
+/*
+ *-----------------------------------------------------------------------------
+ * basename hash - grouping of sidecars in filelist
+ *-----------------------------------------------------------------------------
+ */
+
+
+static GHashTable *file_data_basename_hash_new(void)
+{
+	return g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+}
+
+static GList * file_data_basename_hash_insert(GHashTable *basename_hash, FileData *fd)
+{
+	GList *list;
+	gchar *basename = g_strndup(fd->path, fd->extension - fd->path);
+
+	list = g_hash_table_lookup(basename_hash, basename);
+
+	if (!list)
+		{
+		DEBUG_1("TG: basename_hash not found for %s",fd->path);
+		const gchar *parent_extension = registered_extension_from_path(basename);
+
+		if (parent_extension)
+			{
+			DEBUG_1("TG: parent extension %s",parent_extension);
+			gchar *parent_basename = g_strndup(basename, parent_extension - basename);
+			DEBUG_1("TG: parent basename %s",parent_basename);
+			FileData *parent_fd = g_hash_table_lookup(file_data_pool, basename);
+			if (parent_fd)
+				{
+				DEBUG_1("TG: parent fd found");
+				list = g_hash_table_lookup(basename_hash, parent_basename);
+				if (!g_list_find(list, parent_fd))
+					{
+					DEBUG_1("TG: parent fd doesn't fit");
+					g_free(parent_basename);
+					list = NULL;
 					}
 				else
 					{
 					g_free(basename);
 					basename = parent_basename;
-					fd->extended_extension = g_strconcat(parent_extension, fd->extension, NULL);
+					file_data_cold(fd)->extended_extension = g_strconcat(parent_extension, fd->extension, NULL);
 					}
 				}
 			}
@@ -2167,7 +2740,7 @@ static void file_data_update_ci_dest_preserve_ext(FileData *fd, const gchar *des
 	gchar *base = remove_extension_from_path(dest_path);
 	gchar *old_path = fd->change->dest;
 
-	fd->change->dest = g_strconcat(base, fd->extended_extension ? fd->extended_extension : extension, NULL);
+	fd->change->dest = g_strconcat(base, (fd->cold && fd->cold->extended_extension) ? fd->cold->extended_extension : extension, NULL);
 	file_data_update_planned_change_hash(fd, old_path, fd->change->dest);
 
 	g_free(old_path);
@@ -2307,7 +2880,7 @@ gint file_data_verify_ci(FileData *fd, GList *list)
 	    fd->change->type != FILEDATA_CHANGE_MOVE && /* the unsaved metadata should survive move and rename operations */
 	    fd->change->type != FILEDATA_CHANGE_RENAME &&
 	    fd->change->type != FILEDATA_CHANGE_WRITE_METADATA &&
-	    fd->modified_xmp)
+	    fd->cold && fd->cold->modified_xmp)
 		{
 		ret |= CHANGE_WARN_UNSAVED_META;
 		DEBUG_1("Change checked: unsaved metadata: %s", fd->path);
@@ -3005,6 +3578,338 @@ gboolean file_data_send_notification_idle_cb(gpointer data)
 	return FALSE;
 }
 
+/*
+ * listeners of one FileData or one folder, looked up by hash
+ */
+
+static GHashTable *notify_fd_hash = NULL; /* FileData -> GList of NotifyData */
+static GHashTable *notify_dir_hash = NULL; /* folder path with trailing separator -> GList of NotifyData */
+
+static gboolean file_data_notify_hash_add(GHashTable *hash, gpointer key, FileDataNotifyFunc func, gpointer data)
+{
+	GList *list = g_hash_table_lookup(hash, key);
+	GList *work = list;
+	NotifyData *nd;
+
+	while (work)
+		{
+		nd = work->data;
+		if (nd->func == func && nd->data == data)
+			{
+			g_warning("Notify func already registered");
+			return FALSE;
+			}
+		work = work->next;
+		}
+
+	nd = g_new(NotifyData, 1);
+	nd->func = func;
+	nd->data = data;
+	nd->priority = NOTIFY_PRIORITY_LOW;
+
+	/* an existing key is kept, only the value is replaced */
+	g_hash_table_insert(hash, key, g_list_append(list, nd));
+
+	return TRUE;
+}
+
+/* returns the key that is no longer used by hash, or NULL */
+static gpointer file_data_notify_hash_remove(GHashTable *hash, gconstpointer key, FileDataNotifyFunc func, gpointer data, gboolean *found)
+{
+	gpointer orig_key;
+	gpointer value;
+	GList *work;
+
+	*found = FALSE;
+	if (!hash || !g_hash_table_lookup_extended(hash, key, &orig_key, &value)) return NULL;
+
+	work = value;
+	while (work)
+		{
+		NotifyData *nd = work->data;
+
+		if (nd->func == func && nd->data == data)
+			{
+			GList *list = g_list_delete_link(value, work);
+
+			g_free(nd);
+			*found = TRUE;
+			if (list)
+				{
+				g_hash_table_insert(hash, orig_key, list);
+				return NULL;
+				}
+
+			g_hash_table_remove(hash, orig_key);
+			return orig_key;
+			}
+		work = work->next;
+		}
+
+	return NULL;
+}
+
+/**
+ * \brief Calls func only for notifications about fd
+ *
+ * The listener does not need to compare fd itself and costs nothing
+ * for notifications about other files. It does not hold a reference.
+ */
+gboolean file_data_register_notify_fd_func(FileData *fd, FileDataNotifyFunc func, gpointer data)
+{
+	if (!fd) return FALSE;
+
+	if (!notify_fd_hash) notify_fd_hash = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+	return file_data_notify_hash_add(notify_fd_hash, fd, func, data);
+}
+
+gboolean file_data_unregister_notify_fd_func(FileData *fd, FileDataNotifyFunc func, gpointer data)
+{
+	gboolean found;
+
+	if (!fd) return FALSE;
+
+	file_data_notify_hash_remove(notify_fd_hash, fd, func, data, &found);
+	if (!found) g_warning("Notify func not found");
+
+	return found;
+}
+
+static gchar *file_data_notify_dir_key(const gchar *path)
+{
+	gsize len = strlen(path);
+
+	if (len > 0 && path[len - 1] == G_DIR_SEPARATOR) return g_strdup(path);
+	return g_strconcat(path, G_DIR_SEPARATOR_S, NULL);
+}
+
+/**
+ * \brief Calls func for notifications about the files directly in folder path
+ *
+ * Moves and renames are also sent to the folders the file comes from and goes to.
+ */
+gboolean file_data_register_notify_dir_func(const gchar *path, FileDataNotifyFunc func, gpointer data)
+{
+	gpointer orig_key;
+	gchar *key;
+
+	if (!path) return FALSE;
+
+	if (!notify_dir_hash) notify_dir_hash = g_hash_table_new(g_str_hash, g_str_equal);
+
+	key = file_data_notify_dir_key(path);
+	if (g_hash_table_lookup_extended(notify_dir_hash, key, &orig_key, NULL))
+		{
+		g_free(key);
+		key = orig_key;
+		}
+
+	return file_data_notify_hash_add(notify_dir_hash, key, func, data);
+}
+
+gboolean file_data_unregister_notify_dir_func(const gchar *path, FileDataNotifyFunc func, gpointer data)
+{
+	gchar *key;
+	gboolean found;
+
+	if (!path) return FALSE;
+
+	key = file_data_notify_dir_key(path);
+	g_free(file_data_notify_hash_remove(notify_dir_hash, key, func, data, &found));
+	g_free(key);
+	if (!found) g_warning("Notify func not found");
+
+	return found;
+}
+
+static void file_data_notify_list(GList *work, FileData *fd, NotifyType type)
+{
+	while (work)
+		{
+		NotifyData *nd = (NotifyData *)work->data;
+
+		work = work->next;
+		nd->func(fd, type, nd->data);
+		}
+}
+
+static gboolean file_data_notify_same_dir(const gchar *a, const gchar *b)
+{
+	gsize len = filename_from_path(a) - a;
+
+	return len == (gsize)(filename_from_path(b) - b) && strncmp(a, b, len) == 0;
+}
+
+static void file_data_notify_dir(const gchar *path, FileData *fd, NotifyType type)
+{
+	gchar *dir = g_strndup(path, filename_from_path(path) - path);
+
+	file_data_notify_list(g_hash_table_lookup(notify_dir_hash, dir), fd, type);
+	g_free(dir);
+}
+
+/*
+ * batched listeners, events are collected and delivered once per main loop iteration
+ */
+
+typedef struct _NotifyBatchData NotifyBatchData;
+
+struct _NotifyBatchData {
+	FileDataNotifyBatchFunc func;
+	gpointer data;
+	NotifyPriority priority;
+};
+
+static GList *notify_batch_list = NULL;
+static GArray *notify_batch_events = NULL;
+static GHashTable *notify_batch_index = NULL; /* FileData -> position in notify_batch_events + 1 */
+static guint notify_batch_idle_id = 0; /* event source id */
+
+static gint file_data_notify_batch_sort(gconstpointer a, gconstpointer b)
+{
+	NotifyBatchData *nba = (NotifyBatchData *)a;
+	NotifyBatchData *nbb = (NotifyBatchData *)b;
+
+	if (nba->priority < nbb->priority) return -1;
+	if (nba->priority > nbb->priority) return 1;
+	return 0;
+}
+
+/**
+ * \brief Registers a listener that receives notifications in batches
+ *
+ * All notifications sent during one main loop iteration are delivered
+ * together from an idle callback, one event per FileData with the types
+ * merged. Use this for listeners that have to search their own lists.
+ */
+gboolean file_data_register_notify_batch_func(FileDataNotifyBatchFunc func, gpointer data, NotifyPriority priority)
+{
+	NotifyBatchData *nbd;
+	GList *work = notify_batch_list;
+
+	while (work)
+		{
+		nbd = (NotifyBatchData *)work->data;
+
+		if (nbd->func == func && nbd->data == data)
+			{
+			g_warning("Notify func already registered");
+			return FALSE;
+			}
+		work = work->next;
+		}
+
+	nbd = g_new(NotifyBatchData, 1);
+	nbd->func = func;
+	nbd->data = data;
+	nbd->priority = priority;
+
+	notify_batch_list = g_list_insert_sorted(notify_batch_list, nbd, file_data_notify_batch_sort);
+	DEBUG_2("Notify batch func registered: %p", nbd);
+
+	return TRUE;
+}
+
+gboolean file_data_unregister_notify_batch_func(FileDataNotifyBatchFunc func, gpointer data)
+{
+	GList *work = notify_batch_list;
+
+	while (work)
+		{
+		NotifyBatchData *nbd = (NotifyBatchData *)work->data;
+
+		if (nbd->func == func && nbd->data == data)
+			{
+			notify_batch_list = g_list_delete_link(notify_batch_list, work);
+			g_free(nbd);
+			DEBUG_2("Notify batch func unregistered: %p", nbd);
+			return TRUE;
+			}
+		work = work->next;
+		}
+
+	g_warning("Notify func not found");
+	return FALSE;
+}
+
+static gboolean file_data_notify_batch_idle_cb(gpointer data)
+{
+	GArray *events;
+	GList *work;
+	guint i;
+
+	notify_batch_idle_id = 0;
+
+	if (!notify_batch_events || notify_batch_events->len == 0) return FALSE;
+
+	/* notifications sent by the listeners go to the next batch */
+	events = notify_batch_events;
+	notify_batch_events = NULL;
+	g_hash_table_remove_all(notify_batch_index);
+
+	DEBUG_1("Notify batch: %u files", events->len);
+
+	work = notify_batch_list;
+	while (work)
+		{
+		NotifyBatchData *nbd = (NotifyBatchData *)work->data;
+
+		work = work->next;
+		nbd->func((FileDataNotifyEvent *)events->data, events->len, nbd->data);
+		}
+
+	for (i = 0; i < events->len; i++)
+		{
+		file_data_unref(g_array_index(events, FileDataNotifyEvent, i).fd);
+		}
+	g_array_free(events, TRUE);
+
+	return FALSE;
+}
+
+static void file_data_notify_batch_add(FileData *fd, NotifyType type)
+{
+	FileDataNotifyEvent *event;
+	guint pos;
+
+	if (!notify_batch_events)
+		notify_batch_events = g_array_new(FALSE, FALSE, sizeof(FileDataNotifyEvent));
+	if (!notify_batch_index)
+		notify_batch_index = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+	pos = GPOINTER_TO_UINT(g_hash_table_lookup(notify_batch_index, fd));
+	if (pos)
+		{
+		event = &g_array_index(notify_batch_events, FileDataNotifyEvent, pos - 1);
+		event->type |= type;
+		}
+	else
+		{
+		FileDataNotifyEvent new_event;
+
+		new_event.fd = file_data_ref(fd);
+		new_event.type = type;
+		new_event.change = FALSE;
+		new_event.change_type = FILEDATA_CHANGE_UNSPECIFIED;
+		g_array_append_val(notify_batch_events, new_event);
+		g_hash_table_insert(notify_batch_index, fd, GUINT_TO_POINTER(notify_batch_events->len));
+		event = &g_array_index(notify_batch_events, FileDataNotifyEvent, notify_batch_events->len - 1);
+		}
+
+	/* fd->change is usually gone when the batch is delivered */
+	if (fd->change)
+		{
+		event->change = TRUE;
+		event->change_type = fd->change->type;
+		}
+
+	if (!notify_batch_idle_id)
+		{
+		notify_batch_idle_id = g_idle_add_full(G_PRIORITY_HIGH, file_data_notify_batch_idle_cb, NULL, NULL);
+		}
+}
+
 void file_data_send_notification(FileData *fd, NotifyType type)
 {
 	GList *work = notify_func_list;
@@ -3016,6 +3921,33 @@ void file_data_send_notification(FileData *fd, NotifyType type)
 		nd->func(fd, type, nd->data);
 		work = work->next;
 		}
+
+	if (notify_fd_hash)
+		{
+		file_data_notify_list(g_hash_table_lookup(notify_fd_hash, fd), fd, type);
+		}
+
+	if (notify_dir_hash && g_hash_table_size(notify_dir_hash) > 0)
+		{
+		file_data_notify_dir(fd->path, fd, type);
+		if (fd->change && fd->change->source &&
+		    !file_data_notify_same_dir(fd->change->source, fd->path))
+			{
+			file_data_notify_dir(fd->change->source, fd, type);
+			}
+		/* a planned change is sent before fd is moved there */
+		if (fd->change && fd->change->dest &&
+		    !file_data_notify_same_dir(fd->change->dest, fd->path) &&
+		    (!fd->change->source || !file_data_notify_same_dir(fd->change->dest, fd->change->source)))
+			{
+			file_data_notify_dir(fd->change->dest, fd, type);
+			}
+		}
+
+	if (notify_batch_list)
+		{
+		file_data_notify_batch_add(fd, type);
+		}
     /*
 	NotifyIdleData *nid = g_new0(NotifyIdleData, 1);
 	nid->fd = file_data_ref(fd);
@@ -3024,77 +3956,232 @@ void file_data_send_notification(FileData *fd, NotifyType type)
     */
 }
 
-static GHashTable *file_data_monitor_pool = NULL;
+/*
+ * real time monitoring
+ *
+ * Monitored files are watched through one GFileMonitor per folder, which
+ * uses inotify or the equivalent of the platform. Events are collected for
+ * a short time and then only the monitored FileData of the folders that
+ * changed are checked. Folders that can not be watched are polled.
+ */
+
+#define FILE_DATA_MONITOR_DEBOUNCE 300 /* ms */
+#define FILE_DATA_MONITOR_POLL_INTERVAL 5000 /* ms */
+
+typedef struct _FileDataMonitorDir FileDataMonitorDir;
+struct _FileDataMonitorDir {
+	gchar *path; /* key to file_data_monitor_dirs */
+	GFileMonitor *monitor; /* NULL when the folder is polled */
+	GList *fds; /* monitored FileData in this folder */
+	gboolean changed; /* has events since the last check */
+};
+
+typedef struct _FileDataMonitor FileDataMonitor;
+struct _FileDataMonitor {
+	gint count;
+	FileDataMonitorDir *dir;
+};
+
+static GHashTable *file_data_monitor_pool = NULL; /* FileData -> FileDataMonitor */
+static GHashTable *file_data_monitor_dirs = NULL; /* folder path -> FileDataMonitorDir */
+static guint file_data_monitor_polled = 0; /* number of polled folders */
 static guint realtime_monitor_id = 0; /* event source id */
+static guint realtime_monitor_changed_id = 0; /* event source id */
 
-static void realtime_monitor_check_cb(gpointer key, gpointer value, gpointer data)
+/* checking sends notifications, the listeners may change the monitors meanwhile */
+static void realtime_monitor_check(gboolean polled)
 {
-	FileData *fd = key;
+	GHashTableIter iter;
+	gpointer value;
+	GList *list = NULL;
+	GList *work;
+
+	if (!file_data_monitor_dirs) return;
+
+	g_hash_table_iter_init(&iter, file_data_monitor_dirs);
+	while (g_hash_table_iter_next(&iter, NULL, &value))
+		{
+		FileDataMonitorDir *dir = value;
 
-	file_data_check_changed_files(fd);
+		if (polled ? !dir->monitor : dir->changed)
+			{
+			dir->changed = FALSE;
+			list = g_list_concat(filelist_copy(dir->fds), list);
+			}
+		}
+
+	work = list;
+	while (work)
+		{
+		FileData *fd = work->data;
 
-	DEBUG_1("monitor %s", fd->path);
+		DEBUG_1("monitor %s", fd->path);
+		file_data_check_changed_files(fd);
+		work = work->next;
+		}
+	filelist_free(list);
 }
 
 static gboolean realtime_monitor_cb(gpointer data)
 {
 	if (!options->update_on_time_change) return TRUE;
-	g_hash_table_foreach(file_data_monitor_pool, realtime_monitor_check_cb, NULL);
+
+	realtime_monitor_check(TRUE);
 	return TRUE;
 }
 
+static gboolean realtime_monitor_changed_cb(gpointer data)
+{
+	realtime_monitor_changed_id = 0;
+	if (!options->update_on_time_change) return FALSE;
+
+	realtime_monitor_check(FALSE);
+	return FALSE;
+}
+
+static void realtime_monitor_event_cb(GFileMonitor *monitor, GFile *file, GFile *other_file,
+				      GFileMonitorEvent event_type, gpointer data)
+{
+	FileDataMonitorDir *dir = data;
+
+	dir->changed = TRUE;
+
+	/* a burst of events is handled by one check */
+	if (!realtime_monitor_changed_id)
+		{
+		realtime_monitor_changed_id = g_timeout_add(FILE_DATA_MONITOR_DEBOUNCE, realtime_monitor_changed_cb, NULL);
+		}
+}
+
+static void realtime_monitor_poll_update(void)
+{
+	if (file_data_monitor_polled > 0 && !realtime_monitor_id)
+		{
+		realtime_monitor_id = g_timeout_add(FILE_DATA_MONITOR_POLL_INTERVAL, realtime_monitor_cb, NULL);
+		}
+	else if (file_data_monitor_polled == 0 && realtime_monitor_id)
+		{
+		g_source_remove(realtime_monitor_id);
+		realtime_monitor_id = 0;
+		}
+}
+
+/* folders are watched themselves, files through their folder */
+static FileDataMonitorDir *realtime_monitor_dir_ref(FileData *fd)
+{
+	FileDataMonitorDir *dir;
+	gchar *path;
+	GFile *file;
+	GError *error = NULL;
+
+	path = S_ISDIR(fd->mode) ? g_strdup(fd->path) : remove_level_from_path(fd->path);
+
+	if (!file_data_monitor_dirs)
+		file_data_monitor_dirs = g_hash_table_new(g_str_hash, g_str_equal);
+
+	dir = g_hash_table_lookup(file_data_monitor_dirs, path);
+	if (dir)
+		{
+		g_free(path);
+		dir->fds = g_list_prepend(dir->fds, fd);
+		return dir;
+		}
+
+	dir = g_new0(FileDataMonitorDir, 1);
+	dir->path = path;
+	dir->fds = g_list_prepend(NULL, fd);
+	g_hash_table_insert(file_data_monitor_dirs, dir->path, dir);
+
+	file = g_file_new_for_path(path);
+	dir->monitor = g_file_monitor_directory(file, G_FILE_MONITOR_NONE, NULL, &error);
+	g_object_unref(file);
+
+	if (dir->monitor)
+		{
+		g_signal_connect(G_OBJECT(dir->monitor), "changed", G_CALLBACK(realtime_monitor_event_cb), dir);
+		}
+	else
+		{
+		DEBUG_1("monitor %s: polling, %s", path, error ? error->message : "not supported");
+		if (error) g_error_free(error);
+		file_data_monitor_polled++;
+		realtime_monitor_poll_update();
+		}
+
+	return dir;
+}
+
+static void realtime_monitor_dir_unref(FileDataMonitorDir *dir, FileData *fd)
+{
+	dir->fds = g_list_remove(dir->fds, fd);
+	if (dir->fds) return;
+
+	g_hash_table_remove(file_data_monitor_dirs, dir->path);
+
+	if (dir->monitor)
+		{
+		g_signal_handlers_disconnect_by_func(dir->monitor, realtime_monitor_event_cb, dir);
+		g_file_monitor_cancel(dir->monitor);
+		g_object_unref(dir->monitor);
+		}
+	else
+		{
+		file_data_monitor_polled--;
+		realtime_monitor_poll_update();
+		}
+
+	g_free(dir->path);
+	g_free(dir);
+}
+
 gboolean file_data_register_real_time_monitor(FileData *fd)
 {
-	gint count;
+	FileDataMonitor *fdm;
 
 	file_data_ref(fd);
 
 	if (!file_data_monitor_pool)
 		file_data_monitor_pool = g_hash_table_new(g_direct_hash, g_direct_equal);
 
-	count = GPOINTER_TO_INT(g_hash_table_lookup(file_data_monitor_pool, fd));
-
-	DEBUG_1("Register realtime %d %s", count, fd->path);
-
-	count++;
-	g_hash_table_insert(file_data_monitor_pool, fd, GINT_TO_POINTER(count));
-
-	if (!realtime_monitor_id)
+	fdm = g_hash_table_lookup(file_data_monitor_pool, fd);
+	if (!fdm)
 		{
-		realtime_monitor_id = g_timeout_add(5000, realtime_monitor_cb, NULL);
+		fdm = g_new0(FileDataMonitor, 1);
+		fdm->dir = realtime_monitor_dir_ref(fd);
+		g_hash_table_insert(file_data_monitor_pool, fd, fdm);
 		}
 
+	DEBUG_1("Register realtime %d %s", fdm->count, fd->path);
+
+	fdm->count++;
+
 	return TRUE;
 }
 
 gboolean file_data_unregister_real_time_monitor(FileData *fd)
 {
-	gint count;
+	FileDataMonitor *fdm;
 
 	g_assert(file_data_monitor_pool);
 
-	count = GPOINTER_TO_INT(g_hash_table_lookup(file_data_monitor_pool, fd));
+	fdm = g_hash_table_lookup(file_data_monitor_pool, fd);
 
-	DEBUG_1("Unregister realtime %d %s", count, fd->path);
+	g_assert(fdm && fdm->count > 0);
 
-	g_assert(count > 0);
+	DEBUG_1("Unregister realtime %d %s", fdm->count, fd->path);
 
-	count--;
+	fdm->count--;
 
-	if (count == 0)
+	if (fdm->count == 0)
+		{
+		/* the folder is kept even if fd was renamed meanwhile */
+		realtime_monitor_dir_unref(fdm->dir, fd);
 		g_hash_table_remove(file_data_monitor_pool, fd);
-	else
-		g_hash_table_insert(file_data_monitor_pool, fd, GINT_TO_POINTER(count));
+		g_free(fdm);
+		}
 
 	file_data_unref(fd);
 
-	if (g_hash_table_size(file_data_monitor_pool) == 0)
-		{
-		g_source_remove(realtime_monitor_id);
-		realtime_monitor_id = 0;
-		return FALSE;
-		}
-
-	return TRUE;
+	return (g_hash_table_size(file_data_monitor_pool) > 0);
 }
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
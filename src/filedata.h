@@ -43,6 +43,9 @@ FileData *file_data_new_dir(const gchar *path_utf8);
 
 FileData *file_data_new_simple(const gchar *path_utf8);
 
+/* should be used on files from a cache, checked later by the caller */
+FileData *file_data_new_cached(const gchar *path_utf8, gint64 size, time_t date);
+
 #ifdef DEBUG_FILEDATA
 FileData *file_data_ref_debug(const gchar *file, gint line, FileData *fd);
 void file_data_unref_debug(const gchar *file, gint line, FileData *fd);
@@ -53,6 +56,10 @@ FileData *file_data_ref(FileData *fd);
 void file_data_unref(FileData *fd);
 #endif
 
+FileDataCold *file_data_cold(FileData *fd);
+const gchar *file_data_get_collate_key(FileData *fd, gboolean case_sensitive);
+gchar *file_data_memory_report(void);
+
 void file_data_lock(FileData *fd);
 void file_data_unlock(FileData *fd);
 void file_data_lock_list(GList *list);
@@ -68,12 +75,9 @@ void file_data_change_info_free(FileDataChangeInfo *fdci, FileData *fd);
 void file_data_disable_grouping(FileData *fd, gboolean disable);
 void file_data_disable_grouping_list(GList *fd_list, gboolean disable);
 
-gint filelist_sort_compare_filedata(FileData *fa, FileData *fb);
 gint filelist_sort_compare_filedata_full(FileData *fa, FileData *fb, SortType method, gboolean ascend);
 GList *filelist_sort(GList *list, SortType method, gboolean ascend);
 GList *filelist_insert_sort(GList *list, FileData *fd, SortType method, gboolean ascend);
-GList *filelist_sort_full(GList *list, SortType method, gboolean ascend, GCompareFunc cb);
-GList *filelist_insert_sort_full(GList *list, gpointer data, SortType method, gboolean ascend, GCompareFunc cb);
 
 gboolean filelist_read(FileData *dir_fd, GList **files, GList **dirs);
 gboolean filelist_read_lstat(FileData *dir_fd, GList **files, GList **dirs);
@@ -158,6 +162,23 @@ gboolean file_data_register_notify_func(FileDataNotifyFunc func, gpointer data,
 gboolean file_data_unregister_notify_func(FileDataNotifyFunc func, gpointer data);
 void file_data_send_notification(FileData *fd, NotifyType type);
 
+gboolean file_data_register_notify_fd_func(FileData *fd, FileDataNotifyFunc func, gpointer data);
+gboolean file_data_unregister_notify_fd_func(FileData *fd, FileDataNotifyFunc func, gpointer data);
+gboolean file_data_register_notify_dir_func(const gchar *path, FileDataNotifyFunc func, gpointer data);
+gboolean file_data_unregister_notify_dir_func(const gchar *path, FileDataNotifyFunc func, gpointer data);
+
+typedef struct _FileDataNotifyEvent FileDataNotifyEvent;
+struct _FileDataNotifyEvent {
+	FileData *fd;
+	NotifyType type; /* all types sent for fd since the last batch */
+	gboolean change; /* fd->change was set when sent, change_type is valid */
+	FileDataChangeType change_type;
+};
+
+typedef void (*FileDataNotifyBatchFunc)(const FileDataNotifyEvent *events, guint count, gpointer data);
+gboolean file_data_register_notify_batch_func(FileDataNotifyBatchFunc func, gpointer data, NotifyPriority priority);
+gboolean file_data_unregister_notify_batch_func(FileDataNotifyBatchFunc func, gpointer data);
+
 gboolean file_data_register_real_time_monitor(FileData *fd);
 gboolean file_data_unregister_real_time_monitor(FileData *fd);
 
@@ -0,0 +1,1013 @@
+/*
+ * Copyright (C) 2008 - 2016 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Headless benchmarks of image decoding, thumbnail generation, image
+ * similarity, directory reading and md5 hashing. They run on the same code
+ * as geeqie, on fixtures generated from a fixed seed, and write the results
+ * as JSON.
+ *
+ * Build and run with "make bench" in src, which writes bench-results.json,
+ * see ./geeqie-bench --help for the options.
+ */
+
+#include "main.h"
+
+#include "exif.h"
+#include "filedata.h"
+#include "filefilter.h"
+#include "image-load.h"
+#include "md5-util.h"
+#include "similar.h"
+#include "thumb_standard.h"
+#include "ui_fileops.h"
+
+#include <errno.h>
+#include <glib/gstdio.h>
+
+#define BENCH_SEED 1
+#define BENCH_IMAGE_WIDTH 3000
+#define BENCH_IMAGE_HEIGHT 2000
+#define BENCH_SIM_COUNT 200
+#define BENCH_MD5_BUFFER_SIZE (64 * 1024 * 1024)
+
+static const struct {
+	const gchar *format;
+	const gchar *name;
+	const gchar *ext;
+} bench_formats[] = {
+	{ "jpeg",	"jpeg",	".jpg" },
+	{ "tiff",	"tiff",	".tif" },
+	{ "png",	"png",	".png" }
+};
+
+/* 0 x 0 is the full image */
+static const struct {
+	gint width;
+	gint height;
+} bench_sizes[] = {
+	{ 0,	0 },
+	{ 1920,	1080 },
+	{ 640,	480 },
+	{ 160,	120 }
+};
+
+static const struct {
+	const gchar *name;
+	gint groups;
+	const gchar *exts[3];
+} bench_trees[] = {
+	{ "flat 1000 files",		1000,	{ ".jpg", NULL, NULL } },
+	{ "flat 10000 files",		10000,	{ ".jpg", NULL, NULL } },
+	{ "3000 files in sidecar groups", 1000,	{ ".cr2", ".jpg", ".xmp" } }
+};
+
+typedef struct _BenchResult BenchResult;
+struct _BenchResult
+{
+	gchar *suite;
+	gchar *name;
+	gchar *skipped;		/* the reason, NULL when measured */
+
+	gint iterations;
+	gdouble min_ms;
+	gdouble median_ms;
+	gdouble mean_ms;
+	gdouble max_ms;
+
+	gint64 bytes;		/* processed by one iteration, 0 when it does not apply */
+	gint width;		/* of the produced image, 0 when it does not apply */
+	gint height;
+};
+
+static gint bench_iterations = 5;
+static gchar *bench_output = NULL;
+static gchar *bench_fixtures = NULL;
+static gchar **bench_raw_files = NULL;
+static gchar **bench_suites = NULL;
+
+static GList *bench_results = NULL;
+static GMainLoop *bench_loop = NULL;
+
+
+/*
+ *-----------------------------------------------------------------------------
+ * symbols the rest of geeqie expects from main.c
+ *-----------------------------------------------------------------------------
+ */
+
+gboolean thumb_format_changed = FALSE;
+
+void keyboard_scroll_calc(gint *x, gint *y, GdkEventKey *event)
+{
+}
+
+void exit_program(void)
+{
+	exit(0);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ * results
+ *-----------------------------------------------------------------------------
+ */
+
+static BenchResult *bench_result_add(const gchar *suite, const gchar *name)
+{
+	BenchResult *br;
+
+	br = g_new0(BenchResult, 1);
+	br->suite = g_strdup(suite);
+	br->name = g_strdup(name);
+	bench_results = g_list_prepend(bench_results, br);
+
+	return br;
+}
+
+static void bench_skip(const gchar *suite, const gchar *name, const gchar *reason)
+{
+	BenchResult *br = bench_result_add(suite, name);
+
+	br->skipped = g_strdup(reason);
+	fprintf(stderr, "%-10s %-40s skipped: %s\n", suite, name, reason);
+}
+
+static gint bench_time_compare(gconstpointer a, gconstpointer b)
+{
+	gdouble ta = *(const gdouble *)a;
+	gdouble tb = *(const gdouble *)b;
+
+	return (ta > tb) - (ta < tb);
+}
+
+static void bench_result_set_times(BenchResult *br, GArray *times)
+{
+	gdouble sum = 0.0;
+	guint i;
+
+	g_array_sort(times, bench_time_compare);
+	for (i = 0; i < times->len; i++) sum += g_array_index(times, gdouble, i);
+
+	br->iterations = times->len;
+	br->min_ms = g_array_index(times, gdouble, 0);
+	br->max_ms = g_array_index(times, gdouble, times->len - 1);
+	br->mean_ms = sum / times->len;
+	br->median_ms = (times->len % 2) ? g_array_index(times, gdouble, times->len / 2) :
+			(g_array_index(times, gdouble, times->len / 2 - 1) + g_array_index(times, gdouble, times->len / 2)) / 2.0;
+
+	fprintf(stderr, "%-10s %-40s median %10.3f ms  min %10.3f ms\n",
+		br->suite, br->name, br->median_ms, br->min_ms);
+}
+
+static void bench_times_add(GArray *times, gint64 start)
+{
+	gdouble ms = (gdouble)(g_get_monotonic_time() - start) / 1000.0;
+
+	g_array_append_val(times, ms);
+}
+
+static void bench_json_string(GString *out, const gchar *text)
+{
+	const gchar *p;
+
+	g_string_append_c(out, '"');
+	for (p = text; *p; p++)
+		{
+		if (*p == '"' || *p == '\\')
+			{
+			g_string_append_c(out, '\\');
+			g_string_append_c(out, *p);
+			}
+		else if ((guchar)*p < 0x20)
+			{
+			g_string_append_printf(out, "\\u%04x", (guchar)*p);
+			}
+		else
+			{
+			g_string_append_c(out, *p);
+			}
+		}
+	g_string_append_c(out, '"');
+}
+
+/* numbers are printed in the C locale, whatever LC_NUMERIC says */
+static void bench_json_double(GString *out, const gchar *key, gdouble value)
+{
+	gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+	g_string_append_printf(out, ", \"%s\": %s", key, g_ascii_formatd(buf, sizeof(buf), "%.4f", value));
+}
+
+static gchar *bench_results_to_json(void)
+{
+	GString *out;
+	GList *work;
+
+	out = g_string_new("{\n");
+	g_string_append_printf(out, "  \"program\": \"geeqie-bench\",\n");
+	g_string_append_printf(out, "  \"version\": \"%s\",\n", VERSION);
+	g_string_append_printf(out, "  \"iterations\": %d,\n", bench_iterations);
+	g_string_append_printf(out, "  \"seed\": %d,\n", BENCH_SEED);
+	g_string_append_printf(out, "  \"results\": [");
+
+	work = g_list_last(bench_results);
+	while (work)
+		{
+		BenchResult *br = work->data;
+
+		g_string_append(out, "\n    { \"suite\": ");
+		bench_json_string(out, br->suite);
+		g_string_append(out, ", \"case\": ");
+		bench_json_string(out, br->name);
+
+		if (br->skipped)
+			{
+			g_string_append(out, ", \"skipped\": ");
+			bench_json_string(out, br->skipped);
+			}
+		else
+			{
+			g_string_append_printf(out, ", \"iterations\": %d", br->iterations);
+			bench_json_double(out, "min_ms", br->min_ms);
+			bench_json_double(out, "median_ms", br->median_ms);
+			bench_json_double(out, "mean_ms", br->mean_ms);
+			bench_json_double(out, "max_ms", br->max_ms);
+			if (br->bytes > 0)
+				{
+				g_string_append_printf(out, ", \"bytes\": %" G_GINT64_FORMAT, br->bytes);
+				if (br->median_ms > 0.0)
+					{
+					bench_json_double(out, "mb_per_s", (gdouble)br->bytes / 1000.0 / br->median_ms);
+					}
+				}
+			if (br->width > 0)
+				{
+				g_string_append_printf(out, ", \"width\": %d, \"height\": %d", br->width, br->height);
+				}
+			}
+		g_string_append(out, " }");
+		if (work->prev) g_string_append_c(out, ',');
+
+		work = work->prev;
+		}
+
+	g_string_append(out, "\n  ]\n}\n");
+
+	return g_string_free(out, FALSE);
+}
+
+static void bench_result_free(BenchResult *br)
+{
+	g_free(br->suite);
+	g_free(br->name);
+	g_free(br->skipped);
+	g_free(br);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ * fixtures
+ *-----------------------------------------------------------------------------
+ */
+
+/* a gradient with noise and a few blocks, the same for every seed */
+static GdkPixbuf *bench_pixbuf_new(gint width, gint height, guint32 seed)
+{
+	GdkPixbuf *pixbuf;
+	guchar *pixels;
+	gint rs;
+	gint x, y;
+	gint i;
+	GRand *rand;
+
+	pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, width, height);
+	pixels = gdk_pixbuf_get_pixels(pixbuf);
+	rs = gdk_pixbuf_get_rowstride(pixbuf);
+
+	rand = g_rand_new_with_seed(seed);
+	for (y = 0; y < height; y++)
+		{
+		guchar *p = pixels + y * rs;
+
+		for (x = 0; x < width; x++)
+			{
+			p[0] = (x * 255 / width + g_rand_int_range(rand, 0, 16)) & 0xff;
+			p[1] = (y * 255 / height + g_rand_int_range(rand, 0, 16)) & 0xff;
+			p[2] = ((x + y) * 127 / (width + height) + g_rand_int_range(rand, 0, 16)) & 0xff;
+			p += 3;
+			}
+		}
+
+	for (i = 0; i < 8; i++)
+		{
+		gint bx = g_rand_int_range(rand, 0, width / 2);
+		gint by = g_rand_int_range(rand, 0, height / 2);
+		gint bw = g_rand_int_range(rand, 1, width / 2);
+		gint bh = g_rand_int_range(rand, 1, height / 2);
+		GdkPixbuf *block = gdk_pixbuf_new_subpixbuf(pixbuf, bx, by, bw, bh);
+
+		gdk_pixbuf_fill(block, g_rand_int(rand) | 0xff);
+		g_object_unref(block);
+		}
+	g_rand_free(rand);
+
+	return pixbuf;
+}
+
+static gboolean bench_mkdir(const gchar *path)
+{
+	if (g_mkdir_with_parents(path, 0755) == 0) return TRUE;
+
+	fprintf(stderr, "geeqie-bench: can not create %s: %s\n", path, g_strerror(errno));
+	return FALSE;
+}
+
+static void bench_remove_tree(const gchar *path)
+{
+	GDir *dir;
+	const gchar *name;
+
+	dir = g_dir_open(path, 0, NULL);
+	if (dir)
+		{
+		while ((name = g_dir_read_name(dir)))
+			{
+			gchar *child = g_build_filename(path, name, NULL);
+
+			if (g_file_test(child, G_FILE_TEST_IS_DIR) && !g_file_test(child, G_FILE_TEST_IS_SYMLINK))
+				{
+				bench_remove_tree(child);
+				}
+			else
+				{
+				g_unlink(child);
+				}
+			g_free(child);
+			}
+		g_dir_close(dir);
+		}
+	g_rmdir(path);
+}
+
+/* returns the path of the saved image, or NULL with error set */
+static gchar *bench_fixture_image(GdkPixbuf *pixbuf, guint i, GError **error)
+{
+	gchar *path;
+	gboolean ret;
+
+	path = g_strconcat(bench_fixtures, G_DIR_SEPARATOR_S, "image", bench_formats[i].ext, NULL);
+	if (isfile(path)) return path;
+
+	if (strcmp(bench_formats[i].format, "jpeg") == 0)
+		{
+		ret = gdk_pixbuf_save(pixbuf, path, "jpeg", error, "quality", "90", NULL);
+		}
+	else
+		{
+		ret = gdk_pixbuf_save(pixbuf, path, bench_formats[i].format, error, NULL);
+		}
+
+	if (!ret)
+		{
+		g_unlink(path);
+		g_free(path);
+		return NULL;
+		}
+
+	return path;
+}
+
+static gchar *bench_fixture_tree(guint i)
+{
+	gchar *path;
+	gchar *stamp;
+	gint n;
+
+	path = g_strdup_printf("%s" G_DIR_SEPARATOR_S "tree%d", bench_fixtures, i);
+	stamp = g_build_filename(path, ".complete", NULL);
+	if (isfile(stamp))
+		{
+		g_free(stamp);
+		return path;
+		}
+
+	bench_mkdir(path);
+	for (n = 0; n < bench_trees[i].groups; n++)
+		{
+		guint e;
+
+		for (e = 0; e < G_N_ELEMENTS(bench_trees[i].exts) && bench_trees[i].exts[e]; e++)
+			{
+			gchar *name = g_strdup_printf("%s" G_DIR_SEPARATOR_S "IMG_%05d%s", path, n, bench_trees[i].exts[e]);
+
+			g_file_set_contents(name, "", 0, NULL);
+			g_free(name);
+			}
+		}
+	g_file_set_contents(stamp, "", 0, NULL);
+	g_free(stamp);
+
+	return path;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ * drivers
+ *-----------------------------------------------------------------------------
+ */
+
+typedef struct _BenchWait BenchWait;
+struct _BenchWait
+{
+	gboolean done;
+	gboolean success;
+};
+
+static void bench_wait_run(BenchWait *wait)
+{
+	while (!wait->done) g_main_loop_run(bench_loop);
+}
+
+static void bench_wait_finish(BenchWait *wait, gboolean success)
+{
+	wait->done = TRUE;
+	wait->success = success;
+	g_main_loop_quit(bench_loop);
+}
+
+static void bench_loader_done_cb(ImageLoader *il, gpointer data)
+{
+	bench_wait_finish(data, TRUE);
+}
+
+static void bench_loader_error_cb(ImageLoader *il, gpointer data)
+{
+	bench_wait_finish(data, FALSE);
+}
+
+static gboolean bench_decode_once(FileData *fd, gint width, gint height, BenchResult *br)
+{
+	ImageLoader *il;
+	BenchWait wait = { FALSE, FALSE };
+	GdkPixbuf *pixbuf;
+
+	il = image_loader_new(fd);
+	image_loader_set_requested_size(il, width, height);
+	g_signal_connect(G_OBJECT(il), "done", (GCallback)bench_loader_done_cb, &wait);
+	g_signal_connect(G_OBJECT(il), "error", (GCallback)bench_loader_error_cb, &wait);
+
+	if (!image_loader_start(il))
+		{
+		image_loader_free(il);
+		return FALSE;
+		}
+	bench_wait_run(&wait);
+
+	pixbuf = image_loader_get_pixbuf(il);
+	if (!pixbuf) wait.success = FALSE;
+	if (wait.success && br)
+		{
+		br->width = gdk_pixbuf_get_width(pixbuf);
+		br->height = gdk_pixbuf_get_height(pixbuf);
+		}
+	image_loader_free(il);
+
+	return wait.success;
+}
+
+static void bench_decode_file(const gchar *kind, const gchar *path)
+{
+	FileData *fd;
+	guint i;
+
+	fd = file_data_new_group(path);
+
+	for (i = 0; i < G_N_ELEMENTS(bench_sizes); i++)
+		{
+		gchar *name;
+		BenchResult *br;
+		GArray *times;
+		gint n;
+
+		if (bench_sizes[i].width == 0)
+			{
+			name = g_strdup_printf("%s full size", kind);
+			}
+		else
+			{
+			name = g_strdup_printf("%s to %dx%d", kind, bench_sizes[i].width, bench_sizes[i].height);
+			}
+
+		/* warm up, this also checks that the format can be loaded */
+		if (!bench_decode_once(fd, bench_sizes[i].width, bench_sizes[i].height, NULL))
+			{
+			bench_skip("decode", name, "the image can not be loaded");
+			g_free(name);
+			continue;
+			}
+
+		br = bench_result_add("decode", name);
+		br->bytes = fd->size;
+		times = g_array_new(FALSE, FALSE, sizeof(gdouble));
+		for (n = 0; n < bench_iterations; n++)
+			{
+			gint64 start = g_get_monotonic_time();
+
+			bench_decode_once(fd, bench_sizes[i].width, bench_sizes[i].height, br);
+			bench_times_add(times, start);
+			}
+		bench_result_set_times(br, times);
+
+		g_array_free(times, TRUE);
+		g_free(name);
+		}
+
+	file_data_unref(fd);
+}
+
+static void bench_thumb_done_cb(ThumbLoaderStd *tl, gpointer data)
+{
+	bench_wait_finish(data, TRUE);
+}
+
+static void bench_thumb_error_cb(ThumbLoaderStd *tl, gpointer data)
+{
+	bench_wait_finish(data, FALSE);
+}
+
+static gboolean bench_thumb_once(FileData *fd, gboolean cache, gboolean *cache_hit, BenchResult *br)
+{
+	ThumbLoaderStd *tl;
+	BenchWait wait = { FALSE, FALSE };
+
+	tl = thumb_loader_std_new(options->thumbnails.max_width, options->thumbnails.max_height);
+	thumb_loader_std_set_callbacks(tl, bench_thumb_done_cb, bench_thumb_error_cb, NULL, &wait);
+	thumb_loader_std_set_cache(tl, cache, FALSE, TRUE);
+
+	if (!thumb_loader_std_start(tl, fd))
+		{
+		thumb_loader_std_free(tl);
+		return FALSE;
+		}
+	bench_wait_run(&wait);
+
+	if (cache_hit) *cache_hit = tl->cache_hit;
+	if (wait.success && br)
+		{
+		GdkPixbuf *pixbuf = thumb_loader_std_get_pixbuf(tl);
+
+		br->width = gdk_pixbuf_get_width(pixbuf);
+		br->height = gdk_pixbuf_get_height(pixbuf);
+		g_object_unref(pixbuf);
+		}
+	thumb_loader_std_free(tl);
+
+	return wait.success;
+}
+
+static void bench_thumb_file(const gchar *kind, const gchar *path)
+{
+	FileData *fd;
+	gint cache;
+
+	fd = file_data_new_group(path);
+
+	for (cache = 0; cache < 2; cache++)
+		{
+		gchar *name;
+		BenchResult *br;
+		GArray *times;
+		gboolean cache_hit = FALSE;
+		gint n;
+
+		name = g_strdup_printf("%s %s", kind, cache ? "from cache" : "generate");
+
+		/* warm up, with the cache enabled this writes the cached thumbnail */
+		if (!bench_thumb_once(fd, cache, NULL, NULL))
+			{
+			bench_skip("thumbnail", name, "the thumbnail can not be created");
+			g_free(name);
+			continue;
+			}
+
+		br = bench_result_add("thumbnail", name);
+		times = g_array_new(FALSE, FALSE, sizeof(gdouble));
+		for (n = 0; n < bench_iterations; n++)
+			{
+			gint64 start = g_get_monotonic_time();
+
+			bench_thumb_once(fd, cache, &cache_hit, br);
+			bench_times_add(times, start);
+			}
+		bench_result_set_times(br, times);
+		if (cache && !cache_hit)
+			{
+			fprintf(stderr, "geeqie-bench: the thumbnail of %s was not read from the cache\n", path);
+			}
+
+		g_array_free(times, TRUE);
+		g_free(name);
+		}
+
+	file_data_unref(fd);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ * suites
+ *-----------------------------------------------------------------------------
+ */
+
+static void bench_suite_decode(GdkPixbuf *pixbuf)
+{
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS(bench_formats); i++)
+		{
+		GError *error = NULL;
+		gchar *path = bench_fixture_image(pixbuf, i, &error);
+
+		if (!path)
+			{
+			bench_skip("decode", bench_formats[i].name, error ? error->message : "the fixture can not be saved");
+			if (error) g_error_free(error);
+			continue;
+			}
+		bench_decode_file(bench_formats[i].name, path);
+		g_free(path);
+		}
+
+	if (!bench_raw_files || !bench_raw_files[0])
+		{
+		bench_skip("decode", "raw", "no RAW sample, use --raw=FILE");
+		return;
+		}
+	for (i = 0; bench_raw_files[i]; i++)
+		{
+		gchar *kind = g_strconcat("raw ", filename_from_path(bench_raw_files[i]), NULL);
+
+		bench_decode_file(kind, bench_raw_files[i]);
+		g_free(kind);
+		}
+}
+
+static void bench_suite_thumbnail(GdkPixbuf *pixbuf)
+{
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS(bench_formats); i++)
+		{
+		gchar *path = bench_fixture_image(pixbuf, i, NULL);
+
+		if (!path)
+			{
+			bench_skip("thumbnail", bench_formats[i].name, "the fixture can not be saved");
+			continue;
+			}
+		bench_thumb_file(bench_formats[i].name, path);
+		g_free(path);
+		}
+
+	if (!bench_raw_files || !bench_raw_files[0])
+		{
+		bench_skip("thumbnail", "raw", "no RAW sample, use --raw=FILE");
+		return;
+		}
+	for (i = 0; bench_raw_files[i]; i++)
+		{
+		gchar *kind = g_strconcat("raw ", filename_from_path(bench_raw_files[i]), NULL);
+
+		bench_thumb_file(kind, bench_raw_files[i]);
+		g_free(kind);
+		}
+}
+
+static void bench_suite_similar(GdkPixbuf *pixbuf)
+{
+	ImageSimilarityData *sims[BENCH_SIM_COUNT];
+	BenchResult *br;
+	GArray *times;
+	gchar *name;
+	gint i, j, n;
+
+	name = g_strdup_printf("fill %dx%d", gdk_pixbuf_get_width(pixbuf), gdk_pixbuf_get_height(pixbuf));
+	br = bench_result_add("similar", name);
+	times = g_array_new(FALSE, FALSE, sizeof(gdouble));
+	for (n = 0; n < bench_iterations; n++)
+		{
+		ImageSimilarityData *sd = image_sim_new();
+		gint64 start = g_get_monotonic_time();
+
+		image_sim_fill_data(sd, pixbuf);
+		bench_times_add(times, start);
+		image_sim_free(sd);
+		}
+	bench_result_set_times(br, times);
+	g_array_free(times, TRUE);
+	g_free(name);
+
+	for (i = 0; i < BENCH_SIM_COUNT; i++)
+		{
+		GdkPixbuf *small = bench_pixbuf_new(128, 96, BENCH_SEED + i);
+
+		sims[i] = image_sim_new_from_pixbuf(small);
+		g_object_unref(small);
+		}
+
+	for (j = 0; j < 2; j++)
+		{
+		name = g_strdup_printf("compare %d x %d%s", BENCH_SIM_COUNT, BENCH_SIM_COUNT, j ? " fast, 95%" : "");
+		br = bench_result_add("similar", name);
+		times = g_array_new(FALSE, FALSE, sizeof(gdouble));
+		for (n = 0; n < bench_iterations; n++)
+			{
+			gint64 start = g_get_monotonic_time();
+			gint a, b;
+
+			for (a = 0; a < BENCH_SIM_COUNT; a++)
+				{
+				for (b = a + 1; b < BENCH_SIM_COUNT; b++)
+					{
+					if (j)
+						{
+						image_sim_compare_fast(sims[a], sims[b], 0.95);
+						}
+					else
+						{
+						image_sim_compare(sims[a], sims[b]);
+						}
+					}
+				}
+			bench_times_add(times, start);
+			}
+		bench_result_set_times(br, times);
+		g_array_free(times, TRUE);
+		g_free(name);
+		}
+
+	for (i = 0; i < BENCH_SIM_COUNT; i++) image_sim_free(sims[i]);
+}
+
+static void bench_suite_filelist(void)
+{
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS(bench_trees); i++)
+		{
+		gchar *path = bench_fixture_tree(i);
+		FileData *dir_fd = file_data_new_dir(path);
+		BenchResult *br;
+		GArray *times;
+		GList *files = NULL;
+		gint n;
+
+		/* warm up, fills the kernel caches */
+		filelist_read(dir_fd, &files, NULL);
+		filelist_free(files);
+
+		br = bench_result_add("filelist", bench_trees[i].name);
+		times = g_array_new(FALSE, FALSE, sizeof(gdouble));
+		for (n = 0; n < bench_iterations; n++)
+			{
+			gint64 start = g_get_monotonic_time();
+
+			filelist_read(dir_fd, &files, NULL);
+			filelist_free(files);
+			bench_times_add(times, start);
+			}
+		bench_result_set_times(br, times);
+
+		g_array_free(times, TRUE);
+		file_data_unref(dir_fd);
+		g_free(path);
+		}
+}
+
+static void bench_suite_md5(GdkPixbuf *pixbuf)
+{
+	guchar *buffer;
+	guchar digest[16];
+	BenchResult *br;
+	GArray *times;
+	GRand *rand;
+	gchar *path;
+	gint i, n;
+
+	buffer = g_malloc(BENCH_MD5_BUFFER_SIZE);
+	rand = g_rand_new_with_seed(BENCH_SEED);
+	for (i = 0; i < BENCH_MD5_BUFFER_SIZE; i += 4)
+		{
+		guint32 v = g_rand_int(rand);
+
+		memcpy(buffer + i, &v, 4);
+		}
+	g_rand_free(rand);
+
+	br = bench_result_add("md5", "64 MiB buffer");
+	br->bytes = BENCH_MD5_BUFFER_SIZE;
+	times = g_array_new(FALSE, FALSE, sizeof(gdouble));
+	for (n = 0; n < bench_iterations; n++)
+		{
+		gint64 start = g_get_monotonic_time();
+
+		md5_get_digest(buffer, BENCH_MD5_BUFFER_SIZE, digest);
+		bench_times_add(times, start);
+		}
+	bench_result_set_times(br, times);
+	g_array_free(times, TRUE);
+	g_free(buffer);
+
+	/* the jpeg fixture, as duplicate search and the thumbnail cache hash files */
+	path = bench_fixture_image(pixbuf, 0, NULL);
+	if (!path)
+		{
+		bench_skip("md5", "jpeg file", "the fixture can not be saved");
+		return;
+		}
+
+	br = bench_result_add("md5", "jpeg file");
+	br->bytes = filesize(path);
+	times = g_array_new(FALSE, FALSE, sizeof(gdouble));
+	md5_get_digest_from_file(path, digest);
+	for (n = 0; n < bench_iterations; n++)
+		{
+		gint64 start = g_get_monotonic_time();
+
+		md5_get_digest_from_file(path, digest);
+		bench_times_add(times, start);
+		}
+	bench_result_set_times(br, times);
+	g_array_free(times, TRUE);
+	g_free(path);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ * main
+ *-----------------------------------------------------------------------------
+ */
+
+static const gchar *bench_suite_names[] = { "decode", "thumbnail", "similar", "filelist", "md5" };
+
+static gboolean bench_suite_enabled(const gchar *suite)
+{
+	gint i;
+
+	if (!bench_suites || !bench_suites[0]) return TRUE;
+
+	for (i = 0; bench_suites[i]; i++)
+		{
+		if (strcmp(bench_suites[i], suite) == 0) return TRUE;
+		}
+
+	return FALSE;
+}
+
+static GOptionEntry bench_options[] = {
+	{ "iterations", 'n', 0, G_OPTION_ARG_INT, &bench_iterations, "Measured runs of each case, after one warm up run (default 5)", "N" },
+	{ "output", 'o', 0, G_OPTION_ARG_FILENAME, &bench_output, "Write the JSON results to FILE instead of stdout", "FILE" },
+	{ "fixtures", 'f', 0, G_OPTION_ARG_FILENAME, &bench_fixtures, "Keep the generated fixtures in DIR and reuse them in later runs", "DIR" },
+	{ "raw", 'r', 0, G_OPTION_ARG_FILENAME_ARRAY, &bench_raw_files, "Also decode and thumbnail this RAW file, can be repeated", "FILE" },
+	{ G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_STRING_ARRAY, &bench_suites, NULL, NULL },
+	{ NULL }
+};
+
+int main(int argc, char *argv[])
+{
+	GOptionContext *context;
+	GError *error = NULL;
+	GdkPixbuf *pixbuf = NULL;
+	gboolean keep_fixtures;
+	gchar *cache_dir;
+	gchar *json;
+	guint i;
+
+#ifdef HAVE_GTHREAD
+#if !GLIB_CHECK_VERSION(2,32,0)
+	g_thread_init(NULL);
+#endif
+#endif
+#if !GLIB_CHECK_VERSION(2,36,0)
+	g_type_init();
+#endif
+
+	context = g_option_context_new("[decode|thumbnail|similar|filelist|md5...]");
+	g_option_context_set_summary(context, "Runs the given benchmark suites, or all of them, on generated fixtures.");
+	g_option_context_add_main_entries(context, bench_options, NULL);
+	if (!g_option_context_parse(context, &argc, &argv, &error))
+		{
+		fprintf(stderr, "geeqie-bench: %s\n", error->message);
+		g_error_free(error);
+		return 1;
+		}
+	g_option_context_free(context);
+
+	for (i = 0; bench_suites && bench_suites[i]; i++)
+		{
+		guint j;
+
+		for (j = 0; j < G_N_ELEMENTS(bench_suite_names); j++)
+			{
+			if (strcmp(bench_suites[i], bench_suite_names[j]) == 0) break;
+			}
+		if (j == G_N_ELEMENTS(bench_suite_names))
+			{
+			fprintf(stderr, "geeqie-bench: unknown suite %s\n", bench_suites[i]);
+			return 1;
+			}
+		}
+	bench_iterations = MAX(1, bench_iterations);
+
+	keep_fixtures = (bench_fixtures != NULL);
+	if (!keep_fixtures)
+		{
+		bench_fixtures = g_build_filename(g_get_tmp_dir(), "geeqie-bench-XXXXXX", NULL);
+		if (!mkdtemp(bench_fixtures))
+			{
+			fprintf(stderr, "geeqie-bench: can not create %s: %s\n", bench_fixtures, g_strerror(errno));
+			return 1;
+			}
+		}
+	else if (!bench_mkdir(bench_fixtures))
+		{
+		return 1;
+		}
+
+	/* keep the thumbnails away from the user's cache, and start every run without them */
+	cache_dir = g_build_filename(bench_fixtures, "cache", NULL);
+	g_setenv("XDG_CACHE_HOME", cache_dir, TRUE);
+	bench_remove_tree(cache_dir);
+	g_free(cache_dir);
+
+	exif_init();
+
+	options = init_options(NULL);
+	setup_default_options(options);
+	filter_add_defaults();
+	filter_rebuild();
+
+	bench_loop = g_main_loop_new(NULL, FALSE);
+
+	if (bench_suite_enabled("decode") || bench_suite_enabled("thumbnail") ||
+	    bench_suite_enabled("similar") || bench_suite_enabled("md5"))
+		{
+		pixbuf = bench_pixbuf_new(BENCH_IMAGE_WIDTH, BENCH_IMAGE_HEIGHT, BENCH_SEED);
+		}
+
+	if (bench_suite_enabled("decode")) bench_suite_decode(pixbuf);
+	if (bench_suite_enabled("thumbnail")) bench_suite_thumbnail(pixbuf);
+	if (bench_suite_enabled("similar")) bench_suite_similar(pixbuf);
+	if (bench_suite_enabled("filelist")) bench_suite_filelist();
+	if (bench_suite_enabled("md5")) bench_suite_md5(pixbuf);
+
+	if (pixbuf) g_object_unref(pixbuf);
+	g_main_loop_unref(bench_loop);
+
+	json = bench_results_to_json();
+	if (bench_output)
+		{
+		if (!g_file_set_contents(bench_output, json, -1, &error))
+			{
+			fprintf(stderr, "geeqie-bench: %s\n", error->message);
+			g_error_free(error);
+			g_free(json);
+			return 1;
+			}
+		fprintf(stderr, "results written to %s\n", bench_output);
+		}
+	else
+		{
+		fputs(json, stdout);
+		}
+	g_free(json);
+
+	g_list_foreach(bench_results, (GFunc)bench_result_free, NULL);
+	g_list_free(bench_results);
+
+	if (!keep_fixtures) bench_remove_tree(bench_fixtures);
+	g_free(bench_fixtures);
+
+	return 0;
+}
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
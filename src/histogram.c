@@ -197,7 +197,9 @@ static gboolean histmap_read(HistMap *histmap, gboolean whole)
 
 const HistMap *histmap_get(FileData *fd)
 {
-	if (fd->histmap && !fd->histmap->idle_id) return fd->histmap; /* histmap exists and is finished */
+	HistMap *histmap = fd->cold ? fd->cold->histmap : NULL;
+
+	if (histmap && !histmap->idle_id) return histmap; /* histmap exists and is finished */
 
 	return NULL;
 }
@@ -205,12 +207,14 @@ const HistMap *histmap_get(FileData *fd)
 static gboolean histmap_idle_cb(gpointer data)
 {
 	FileData *fd = data;
-	if (histmap_read(fd->histmap, FALSE))
+	HistMap *histmap = fd->cold->histmap;
+
+	if (histmap_read(histmap, FALSE))
 		{
 		/* finished */
-		g_object_unref(fd->histmap->pixbuf); /*pixbuf is no longer needed */
-		fd->histmap->pixbuf = NULL;
-		fd->histmap->idle_id = 0;
+		g_object_unref(histmap->pixbuf); /*pixbuf is no longer needed */
+		histmap->pixbuf = NULL;
+		histmap->idle_id = 0;
 		file_data_send_notification(fd, NOTIFY_HISTMAP);
 		return FALSE;
 		}
@@ -219,13 +223,16 @@ static gboolean histmap_idle_cb(gpointer data)
 
 gboolean histmap_start_idle(FileData *fd)
 {
-	if (fd->histmap || !fd->pixbuf) return FALSE;
+	HistMap *histmap;
+
+	if ((fd->cold && fd->cold->histmap) || !fd->pixbuf) return FALSE;
 
-	fd->histmap = histmap_new();
-	fd->histmap->pixbuf = fd->pixbuf;
-	g_object_ref(fd->histmap->pixbuf);
+	histmap = histmap_new();
+	histmap->pixbuf = fd->pixbuf;
+	g_object_ref(histmap->pixbuf);
+	file_data_cold(fd)->histmap = histmap;
 
-	fd->histmap->idle_id = g_idle_add_full(G_PRIORITY_DEFAULT_IDLE, histmap_idle_cb, fd, NULL);
+	histmap->idle_id = g_idle_add_full(G_PRIORITY_DEFAULT_IDLE, histmap_idle_cb, fd, NULL);
 	return TRUE;
 }
 
@@ -388,11 +395,11 @@ gboolean histogram_draw(Histogram *histogram, const HistMap *histmap, GdkPixbuf
 
 void histogram_notify_cb(FileData *fd, NotifyType type, gpointer data)
 {
-	if ((type & NOTIFY_REREAD) && fd->histmap)
+	if ((type & NOTIFY_REREAD) && fd->cold && fd->cold->histmap)
 		{
 		DEBUG_1("Notify histogram: %s %04x", fd->path, type);
-		histmap_free(fd->histmap);
-		fd->histmap = NULL;
+		histmap_free(fd->cold->histmap);
+		fd->cold->histmap = NULL;
 		}
 }
 
@@ -29,6 +29,7 @@
 #include "filedata.h"
 #include "ui_fileops.h"
 #include "gq-marshal.h"
+#include "perf.h"
 
 #include <fcntl.h>
 #include <sys/mman.h>
@@ -963,6 +964,7 @@ static void image_loader_thread_run(gpointer data, gpointer user_data)
 	ImageLoader *il = data;
 	gboolean cont;
 	gboolean err;
+	PERF_TIMER_DECLARE(timer);
 
 	if (il->idle_priority > G_PRIORITY_DEFAULT_IDLE)
 		{
@@ -975,6 +977,7 @@ static void image_loader_thread_run(gpointer data, gpointer user_data)
 		image_loader_thread_enter_high();
 		}
 
+	PERF_TIMER_START(timer);
 	err = !image_loader_begin(il);
 
 	if (err)
@@ -999,6 +1002,7 @@ static void image_loader_thread_run(gpointer data, gpointer user_data)
 		cont = image_loader_continue(il);
 		}
 	image_loader_stop_loader(il);
+	PERF_TIMER_STOP(timer, PERF_IMAGE_DECODE);
 
 	if (il->idle_priority <= G_PRIORITY_DEFAULT_IDLE)
 		{
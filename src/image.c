@@ -34,6 +34,7 @@
 #include "layout_image.h"
 #include "pixbuf-renderer.h"
 #include "pixbuf_util.h"
+#include "startup_trace.h"
 #include "ui_fileops.h"
 
 #include "filedata.h"
@@ -227,6 +228,15 @@ static gboolean image_get_x11_screen_profile(ImageWindow *imd, guchar **screen_p
 				 &type, &format, screen_profile_len, screen_profile) && *screen_profile_len > 0);
 }
 
+static void image_color_man_free(ImageWindow *imd)
+{
+	/* the tile render threads may be using it */
+	pixbuf_renderer_post_process_lock((PixbufRenderer *)imd->pr);
+	color_man_free((ColorMan *)imd->cm);
+	imd->cm = NULL;
+	pixbuf_renderer_post_process_unlock((PixbufRenderer *)imd->pr);
+}
+
 static gboolean image_post_process_color(ImageWindow *imd, gint start_row, gboolean run_in_bg)
 {
 	ColorMan *cm;
@@ -658,6 +668,7 @@ static void image_load_done_cb(ImageLoader *il, gpointer data)
 	ImageWindow *imd = data;
 
 	DEBUG_1("%s image done", get_exec_time());
+	startup_trace_end("image decode");
 
 	if (options->image.enable_read_ahead && imd->image_fd && !imd->image_fd->pixbuf && image_loader_get_pixbuf(imd->il))
 		{
@@ -825,6 +836,8 @@ static gboolean image_load_begin(ImageWindow *imd, FileData *fd)
 
 	image_load_set_signals(imd, FALSE);
 
+	startup_trace_begin("image decode");
+
 	if (!image_loader_start(imd->il))
 		{
 		DEBUG_1("image start error");
@@ -861,8 +874,7 @@ static void image_reset(ImageWindow *imd)
 	image_loader_free(imd->il);
 	imd->il = NULL;
 
-	color_man_free((ColorMan *)imd->cm);
-	imd->cm = NULL;
+	image_color_man_free(imd);
 
 	imd->delay_alter_type = ALTER_NONE;
 
@@ -1142,11 +1154,7 @@ void image_change_pixbuf(ImageWindow *imd, GdkPixbuf *pixbuf, gdouble zoom, gboo
 		}
 
 	pixbuf_renderer_set_post_process_func((PixbufRenderer *)imd->pr, NULL, NULL, FALSE);
-	if (imd->cm)
-		{
-		color_man_free(imd->cm);
-		imd->cm = NULL;
-		}
+	image_color_man_free(imd);
 
 	if (lazy)
 		{
@@ -1251,8 +1259,7 @@ void image_move_from_image(ImageWindow *imd, ImageWindow *source)
 	imd->color_profile_enable = source->color_profile_enable;
 	imd->color_profile_input = source->color_profile_input;
 	imd->color_profile_use_image = source->color_profile_use_image;
-	color_man_free((ColorMan *)imd->cm);
-	imd->cm = NULL;
+	image_color_man_free(imd);
 	if (source->cm)
 		{
 		ColorMan *cm;
@@ -1303,8 +1310,7 @@ void image_copy_from_image(ImageWindow *imd, ImageWindow *source)
 	imd->color_profile_enable = source->color_profile_enable;
 	imd->color_profile_input = source->color_profile_input;
 	imd->color_profile_use_image = source->color_profile_use_image;
-	color_man_free((ColorMan *)imd->cm);
-	imd->cm = NULL;
+	image_color_man_free(imd);
 	if (source->cm)
 		{
 		ColorMan *cm;
@@ -1960,6 +1966,8 @@ ImageWindow *image_new(gboolean frame)
 	imd->orientation = 1;
 
 	imd->pr = GTK_WIDGET(pixbuf_renderer_new());
+	/* the color and desaturate post process is thread safe */
+	pixbuf_renderer_set_post_process_threaded((PixbufRenderer *)imd->pr, TRUE);
 
 	image_options_set(imd);
 
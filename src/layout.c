@@ -49,6 +49,7 @@
 #include "bar_sort.h"
 #include "preferences.h"
 #include "shortcuts.h"
+#include "startup_trace.h"
 #ifdef HAVE_LIRC
 #include "lirc.h"
 #endif
@@ -995,8 +996,10 @@ static void layout_sync_path(LayoutWindow *lw)
 
 	if (lw->path_entry) gtk_entry_set_text(GTK_ENTRY(lw->path_entry), lw->dir_fd->path);
 
+	startup_trace_begin("folder read");
 	if (lw->vd) vd_set_fd(lw->vd, lw->dir_fd);
 	if (lw->vf) vf_set_fd(lw->vf, lw->dir_fd);
+	startup_trace_end("folder read");
 }
 
 gboolean layout_set_path(LayoutWindow *lw, const gchar *path)
@@ -2286,6 +2289,7 @@ LayoutWindow *layout_new_with_geometry(FileData *dir_fd, LayoutOptions *lop,
 	Histogram *histogram;
 
 	DEBUG_1("%s layout_new: start", get_exec_time());
+	startup_trace_begin("layout");
 	lw = g_new0(LayoutWindow, 1);
 
 	if (lop)
@@ -2414,6 +2418,7 @@ LayoutWindow *layout_new_with_geometry(FileData *dir_fd, LayoutOptions *lop,
 	file_data_register_notify_func(layout_image_notify_cb, lw, NOTIFY_PRIORITY_LOW);
 
 	DEBUG_1("%s layout_new: end", get_exec_time());
+	startup_trace_end("layout");
 
 	return lw;
 }
@@ -47,6 +47,7 @@
 #include "rcfile.h"
 #include "search.h"
 #include "slideshow.h"
+#include "startup_trace.h"
 #include "ui_fileops.h"
 #include "ui_menu.h"
 #include "ui_misc.h"
@@ -2491,11 +2492,48 @@ void layout_actions_setup(LayoutWindow *lw)
 
 static gint layout_editors_reload_idle_id = -1;
 static GList *layout_editors_desktop_files = NULL;
+/* only the first load uses the cache, a reload is explicit */
+static gboolean layout_editors_use_cache = TRUE;
+
+static void layout_editors_reload_done(void)
+{
+	GList *work;
+
+	DEBUG_1("%s layout_editors_reload_idle_cb: setup_editors", get_exec_time());
+	editor_table_finish();
+
+	work = layout_window_list;
+	while (work)
+		{
+		LayoutWindow *lw = work->data;
+		work = work->next;
+		layout_actions_setup_editors(lw);
+		if (lw->bar_sort_enabled)
+			{
+			layout_bar_sort_toggle(lw);
+			}
+		}
+
+	DEBUG_1("%s layout_editors_reload_idle_cb: setup_editors done", get_exec_time());
+	startup_trace_end("editors");
+
+	layout_editors_reload_idle_id = -1;
+}
 
 static gboolean layout_editors_reload_idle_cb(gpointer data)
 {
 	if (!layout_editors_desktop_files)
 		{
+		if (layout_editors_use_cache)
+			{
+			layout_editors_use_cache = FALSE;
+			if (editor_table_load_cache())
+				{
+				layout_editors_reload_done();
+				return FALSE;
+				}
+			}
+
 		DEBUG_1("%s layout_editors_reload_idle_cb: get_desktop_files", get_exec_time());
 		layout_editors_desktop_files = editor_get_desktop_files();
 		return TRUE;
@@ -2508,25 +2546,8 @@ static gboolean layout_editors_reload_idle_cb(gpointer data)
 
 	if (!layout_editors_desktop_files)
 		{
-		GList *work;
-		DEBUG_1("%s layout_editors_reload_idle_cb: setup_editors", get_exec_time());
-		editor_table_finish();
-
-		work = layout_window_list;
-		while (work)
-			{
-			LayoutWindow *lw = work->data;
-			work = work->next;
-			layout_actions_setup_editors(lw);
-			if (lw->bar_sort_enabled)
-				{
-				layout_bar_sort_toggle(lw);
-				}
-			}
-
-		DEBUG_1("%s layout_editors_reload_idle_cb: setup_editors done", get_exec_time());
-
-		layout_editors_reload_idle_id = -1;
+		editor_table_save_cache();
+		layout_editors_reload_done();
 		return FALSE;
 		}
 	return TRUE;
@@ -2543,6 +2564,7 @@ void layout_editors_reload_start(void)
 		}
 
 	editor_table_clear();
+	startup_trace_begin("editors");
 	layout_editors_reload_idle_id = g_idle_add(layout_editors_reload_idle_cb, NULL);
 }
 
@@ -43,9 +43,11 @@
 #include "layout_image.h"
 #include "layout_util.h"
 #include "options.h"
+#include "perf.h"
 #include "remote.h"
 #include "secure_save.h"
 #include "similar.h"
+#include "startup_trace.h"
 #include "ui_fileops.h"
 #include "ui_utildlg.h"
 #include "cache_maint.h"
@@ -324,6 +326,10 @@ static void parse_command_line(gint argc, gchar *argv[])
 				{
 				command_line->log_file = g_strdup(cmd_line + 11);
 				}
+			else if (strncmp(cmd_line, "--trace-startup:", 16) == 0)
+				{
+				startup_trace_set_file(cmd_line + 16);
+				}
 			else if (strncmp(cmd_line, "-g:", 3) == 0)
 				{
 				set_regexp(g_strdup(cmd_line+3));
@@ -375,6 +381,7 @@ static void parse_command_line(gint argc, gchar *argv[])
 #endif
 				print_term(_("  +w, --show-log-window            show log window\n"));
 				print_term(_("  -o:<file>, --log-file:<file>     save log data to file\n"));
+				print_term(_("      --trace-startup:<file>       save startup timings to file, in Chrome trace format\n"));
 				print_term(_("  -v, --version                    print version info\n"));
 				print_term(_("  -h, --help                       show this message\n\n"));
 
@@ -662,6 +669,7 @@ static void exit_program_final(void)
 
 	remote_close(remote_connection);
 
+	startup_trace_finish();
 	collect_manager_flush();
 
 	save_options(options);
@@ -794,6 +802,9 @@ gint main(gint argc, gchar *argv[])
 
 	/* init execution time counter (debug only) */
 	init_exec_time();
+	startup_trace_init();
+	perf_init();
+	startup_trace_begin("init");
 
 	/* setup locale, i18n */
 	setlocale(LC_ALL, "");
@@ -826,7 +837,9 @@ gint main(gint argc, gchar *argv[])
 	gtkrc_load();
 
 	parse_command_line_for_debug_option(argc, argv);
+	startup_trace_end("init");
 	DEBUG_1("%s main: gtk_init", get_exec_time());
+	startup_trace_begin("gtk_init");
 #ifdef HAVE_CLUTTER
 	if (gtk_clutter_init(&argc, &argv) != CLUTTER_INIT_SUCCESS)
 		{
@@ -836,6 +849,7 @@ gint main(gint argc, gchar *argv[])
 #else
 	gtk_init(&argc, &argv);
 #endif
+	startup_trace_end("gtk_init");
 
 	if (gtk_major_version < GTK_MAJOR_VERSION ||
 	    (gtk_major_version == GTK_MAJOR_VERSION && gtk_minor_version < GTK_MINOR_VERSION) )
@@ -848,14 +862,18 @@ gint main(gint argc, gchar *argv[])
 		}
 
 	DEBUG_1("%s main: pixbuf_inline_register_stock_icons", get_exec_time());
+	startup_trace_begin("stock icons");
 	pixbuf_inline_register_stock_icons();
+	startup_trace_end("stock icons");
 
 	DEBUG_1("%s main: setting default options before commandline handling", get_exec_time());
 	options = init_options(NULL);
 	setup_default_options(options);
 
 	DEBUG_1("%s main: parse_command_line", get_exec_time());
+	startup_trace_begin("command line");
 	parse_command_line(argc, argv);
+	startup_trace_end("command line");
 
 	DEBUG_1("%s main: mkdir_if_not_exists", get_exec_time());
 	/* these functions don't depend on config file */
@@ -866,13 +884,16 @@ gint main(gint argc, gchar *argv[])
 
 	setup_env_path();
 
+	startup_trace_begin("keymap");
 	keys_load();
 	accel_map_load();
+	startup_trace_end("keymap");
 
 	/* restore session from the config file */
 
 
 	DEBUG_1("%s main: load_options", get_exec_time());
+	startup_trace_begin("config");
 	if (!load_options(options))
 		{
 		/* load_options calls these functions after it parses global options, we have to call it here if it fails */
@@ -886,6 +907,7 @@ gint main(gint argc, gchar *argv[])
 		/* broken or no config file */
 		layout_new_from_config(NULL, NULL, TRUE);
 		}
+	startup_trace_end("config");
 
 	layout_editors_reload_start();
 
@@ -940,12 +962,7 @@ gint main(gint argc, gchar *argv[])
 
 		collection_path_changed(cd);
 
-		work = command_line->cmd_list;
-		while (work)
-			{
-			collection_add(cd, (FileData *)work->data, FALSE);
-			work = work->next;
-			}
+		collection_add_filelist(cd, command_line->cmd_list, FALSE, TRUE);
 
 		work = command_line->collection_list;
 		while (work)
@@ -976,6 +993,7 @@ gint main(gint argc, gchar *argv[])
 	g_free(buf);
 
 	DEBUG_1("%s main: gtk_main", get_exec_time());
+	startup_trace_main_loop();
 	gtk_main();
 #ifdef HAVE_GTHREAD
 	gdk_threads_leave();
@@ -82,9 +82,10 @@ static gboolean metadata_file_read(gchar *path, GList **keywords, gchar **commen
 
 static void metadata_cache_update(FileData *fd, const gchar *key, const GList *values)
 {
+	FileDataCold *cold = file_data_cold(fd);
 	GList *work;
 
-	work = fd->cached_metadata;
+	work = cold->cached_metadata;
 	while (work)
 		{
 		GList *entry = work->data;
@@ -105,7 +106,7 @@ static void metadata_cache_update(FileData *fd, const gchar *key, const GList *v
 		}
 
 	/* key not found - prepend new entry */
-	fd->cached_metadata = g_list_prepend(fd->cached_metadata,
+	cold->cached_metadata = g_list_prepend(cold->cached_metadata,
 				g_list_prepend(string_list_copy(values), g_strdup(key)));
 	DEBUG_1("added %s %s\n", key, fd->path);
 
@@ -115,7 +116,7 @@ static const GList *metadata_cache_get(FileData *fd, const gchar *key)
 {
 	GList *work;
 
-	work = fd->cached_metadata;
+	work = fd->cold ? fd->cold->cached_metadata : NULL;
 	while (work)
 		{
 		GList *entry = work->data;
@@ -137,7 +138,7 @@ static void metadata_cache_remove(FileData *fd, const gchar *key)
 {
 	GList *work;
 
-	work = fd->cached_metadata;
+	work = fd->cold ? fd->cold->cached_metadata : NULL;
 	while (work)
 		{
 		GList *entry = work->data;
@@ -147,7 +148,7 @@ static void metadata_cache_remove(FileData *fd, const gchar *key)
 			{
 			/* key found */
 			string_list_free(entry);
-			fd->cached_metadata = g_list_delete_link(fd->cached_metadata, work);
+			fd->cold->cached_metadata = g_list_delete_link(fd->cold->cached_metadata, work);
 			DEBUG_1("removed %s %s\n", key, fd->path);
 			return;
 			}
@@ -159,9 +160,11 @@ static void metadata_cache_remove(FileData *fd, const gchar *key)
 void metadata_cache_free(FileData *fd)
 {
 	GList *work;
-	if (fd->cached_metadata) DEBUG_1("freed %s\n", fd->path);
 
-	work = fd->cached_metadata;
+	if (!fd->cold || !fd->cold->cached_metadata) return;
+	DEBUG_1("freed %s\n", fd->path);
+
+	work = fd->cold->cached_metadata;
 	while (work)
 		{
 		GList *entry = work->data;
@@ -169,8 +172,8 @@ void metadata_cache_free(FileData *fd)
 
 		work = work->next;
 		}
-	g_list_free(fd->cached_metadata);
-	fd->cached_metadata = NULL;
+	g_list_free(fd->cold->cached_metadata);
+	fd->cold->cached_metadata = NULL;
 }
 
 
@@ -212,8 +215,11 @@ static void metadata_write_queue_add(FileData *fd)
 
 gboolean metadata_write_queue_remove(FileData *fd)
 {
-	g_hash_table_destroy(fd->modified_xmp);
-	fd->modified_xmp = NULL;
+	if (fd->cold && fd->cold->modified_xmp)
+		{
+		g_hash_table_destroy(fd->cold->modified_xmp);
+		fd->cold->modified_xmp = NULL;
+		}
 
 	metadata_write_queue = g_list_remove(metadata_write_queue, fd);
 
@@ -353,11 +359,11 @@ static gboolean metadata_check_key(const gchar *keys[], const gchar *key)
 
 gboolean metadata_write_revert(FileData *fd, const gchar *key)
 {
-	if (!fd->modified_xmp) return FALSE;
+	if (!fd->cold || !fd->cold->modified_xmp) return FALSE;
 
-	g_hash_table_remove(fd->modified_xmp, key);
+	g_hash_table_remove(fd->cold->modified_xmp, key);
 
-	if (g_hash_table_size(fd->modified_xmp) == 0)
+	if (g_hash_table_size(fd->cold->modified_xmp) == 0)
 		{
 		metadata_write_queue_remove(fd);
 		}
@@ -372,11 +378,13 @@ gboolean metadata_write_revert(FileData *fd, const gchar *key)
 
 gboolean metadata_write_list(FileData *fd, const gchar *key, const GList *values)
 {
-	if (!fd->modified_xmp)
+	FileDataCold *cold = file_data_cold(fd);
+
+	if (!cold->modified_xmp)
 		{
-		fd->modified_xmp = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)string_list_free);
+		cold->modified_xmp = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)string_list_free);
 		}
-	g_hash_table_insert(fd->modified_xmp, g_strdup(key), string_list_copy((GList *)values));
+	g_hash_table_insert(cold->modified_xmp, g_strdup(key), string_list_copy((GList *)values));
 
 	metadata_cache_remove(fd, key);
 
@@ -472,12 +480,12 @@ static gboolean metadata_legacy_write(FileData *fd)
 
 	DEBUG_1("Saving comment: %s", fd->change->dest);
 
-	if (!fd->modified_xmp) return TRUE;
+	if (!fd->cold || !fd->cold->modified_xmp) return TRUE;
 
 	metadata_pathl = path_from_utf8(fd->change->dest);
 
-	have_keywords = g_hash_table_lookup_extended(fd->modified_xmp, KEYWORD_KEY, NULL, &keywords);
-	have_comment = g_hash_table_lookup_extended(fd->modified_xmp, COMMENT_KEY, NULL, &comment_l);
+	have_keywords = g_hash_table_lookup_extended(fd->cold->modified_xmp, KEYWORD_KEY, NULL, &keywords);
+	have_comment = g_hash_table_lookup_extended(fd->cold->modified_xmp, COMMENT_KEY, NULL, &comment_l);
 	comment = (have_comment && comment_l) ? ((GList *)comment_l)->data : NULL;
 
 	if (!have_keywords || !have_comment) metadata_file_read(metadata_pathl, &orig_keywords, &orig_comment);
@@ -669,9 +677,9 @@ GList *metadata_read_list(FileData *fd, const gchar *key, MetadataFormat format)
 	if (!fd) return NULL;
 
 	/* unwritten data overide everything */
-	if (fd->modified_xmp && format == METADATA_PLAIN)
+	if (fd->cold && fd->cold->modified_xmp && format == METADATA_PLAIN)
 		{
-	        list = g_hash_table_lookup(fd->modified_xmp, key);
+	        list = g_hash_table_lookup(fd->cold->modified_xmp, key);
 		if (list) return string_list_copy(list);
 		}
 
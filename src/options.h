@@ -84,6 +84,7 @@ struct _ConfOptions
 		gboolean safe_delete_enable;
 		gchar *safe_delete_path;
 		gint safe_delete_folder_maxsize;
+		gint transfer_jobs; /* concurrent copies, moves or deletes per device */
 	} file_ops;
 
 	/* image */
@@ -0,0 +1,356 @@
+/*
+ * Copyright (C) 2008 - 2016 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "pan-cache.h"
+
+#include "cache.h"
+#include "exif.h"
+#include "md5-util.h"
+#include "metadata.h"
+#include "secure_save.h"
+#include "ui_fileops.h"
+
+/*
+ * Image metadata for the pan view layouts.
+ *
+ * The data is read on worker threads, so only functions that do not touch
+ * the FileData or any global state beyond the read only options are used
+ * there. What needs the FileData, the XMP sidecar to merge for the date,
+ * is looked up before on the main thread. The results are stored per folder
+ * in a single pack file under the pan cache, validated against the file
+ * time and size of each image.
+ */
+
+#define PAN_CACHE_PACK_HEADER "PANmeta 1"
+#define PAN_CACHE_PACK_EXT ".meta"
+
+#define PAN_CACHE_PACK_DIMENSIONS (1 << 0)
+#define PAN_CACHE_PACK_DATE (1 << 1)
+
+typedef struct _PanCacheEntry PanCacheEntry;
+struct _PanCacheEntry {
+	gint64 mtime;
+	gint64 size;
+	gint flags;
+	gint width;
+	gint height;
+	gint64 date;
+};
+
+/* the date is the "formatted.DateTime" of metadata_read_string(), as the
+ * cache loader and the info bar read it, text is freed
+ */
+static time_t pan_cache_date_from_text(gchar *text)
+{
+	struct tm t;
+	time_t date = -1;
+
+	if (!text) return -1;
+
+	memset(&t, 0, sizeof(t));
+
+	if (sscanf(text, "%d:%d:%d %d:%d:%d", &t.tm_year, &t.tm_mon, &t.tm_mday,
+		   &t.tm_hour, &t.tm_min, &t.tm_sec) == 6)
+		{
+		t.tm_year -= 1900;
+		t.tm_mon -= 1;
+		t.tm_isdst = -1;
+		date = mktime(&t);
+		}
+	g_free(text);
+
+	return date;
+}
+
+/* the worker thread version of exif_read_fd(), with the sidecar looked up before */
+static time_t pan_cache_read_date(const gchar *path, const gchar *sidecar_path)
+{
+	ExifData *exif;
+	time_t date;
+
+	exif = exif_read((gchar *)path, (gchar *)sidecar_path, NULL);
+	if (!exif) return -1;
+
+	date = pan_cache_date_from_text(exif_get_data_as_text(exif, "formatted.DateTime"));
+	exif_free(exif);
+
+	return date;
+}
+
+/* main thread, before pan_cache_data_read() */
+void pan_cache_data_prepare(PanCacheData *pc, CacheDataType mask)
+{
+	if (!(mask & CACHE_LOADER_DATE)) return;
+
+	/* unsaved metadata changes are only known to the FileData */
+	if (pc->fd->cold && pc->fd->cold->modified_xmp)
+		{
+		pc->date_modified = TRUE;
+		return;
+		}
+
+	pc->sidecar_path = exif_get_sidecar_path_fd(pc->fd);
+}
+
+/* main thread, after pan_cache_data_read() */
+void pan_cache_data_finish(PanCacheData *pc, CacheDataType mask)
+{
+	if (!(mask & CACHE_LOADER_DATE) || !pc->date_modified) return;
+
+	if (!pc->cd) pc->cd = cache_sim_data_new();
+	cache_sim_data_set_date(pc->cd, pan_cache_date_from_text(
+				metadata_read_string(pc->fd, "formatted.DateTime", METADATA_FORMATTED)));
+}
+
+/* safe to call from a worker thread */
+void pan_cache_data_read(PanCacheData *pc, CacheDataType mask)
+{
+	struct stat st;
+	gchar *found;
+	gint64 mtime;
+
+	if (!stat_utf8(pc->fd->path, &st)) return;
+
+	/* an edited sidecar changes the date too */
+	mtime = st.st_mtime;
+	if (pc->sidecar_path)
+		{
+		struct stat sst;
+
+		if (stat_utf8(pc->sidecar_path, &sst)) mtime = MAX(mtime, (gint64)sst.st_mtime);
+		}
+
+	if (pc->cd && pc->mtime == mtime && pc->size == (gint64)st.st_size)
+		{
+		if ((!(mask & CACHE_LOADER_DIMENSIONS) || pc->cd->dimensions) &&
+		    (!(mask & CACHE_LOADER_DATE) || pc->cd->have_date)) return;
+		}
+	else
+		{
+		cache_sim_data_free(pc->cd);
+		pc->cd = NULL;
+		}
+
+	pc->mtime = mtime;
+	pc->size = st.st_size;
+	pc->changed = TRUE;
+
+	if (!pc->cd)
+		{
+		found = cache_find_location(CACHE_TYPE_SIM, pc->fd->path);
+		if (found && filetime(found) == st.st_mtime)
+			{
+			pc->cd = cache_sim_data_load(found);
+			}
+		g_free(found);
+		}
+	if (!pc->cd) pc->cd = cache_sim_data_new();
+
+	if (mask & CACHE_LOADER_DIMENSIONS && !pc->cd->dimensions)
+		{
+		gchar *pathl;
+		gint w, h;
+
+		pathl = path_from_utf8(pc->fd->path);
+		if (gdk_pixbuf_get_file_info(pathl, &w, &h) && w > 0 && h > 0)
+			{
+			cache_sim_data_set_dimensions(pc->cd, w, h);
+			}
+		else
+			{
+			/* formats without a header reader, leave it to the image loaders */
+			pc->fallback = TRUE;
+			}
+		g_free(pathl);
+		}
+
+	if (mask & CACHE_LOADER_DATE && !pc->cd->have_date && !pc->date_modified)
+		{
+		cache_sim_data_set_date(pc->cd, pan_cache_read_date(pc->fd->path, pc->sidecar_path));
+		}
+}
+
+void pan_cache_data_free(PanCacheData *pc)
+{
+	if (!pc) return;
+
+	cache_sim_data_free(pc->cd);
+	file_data_unref(pc->fd);
+	g_free(pc->sidecar_path);
+	g_free(pc);
+}
+
+/*
+ *-----------------------------------------------------------------------------
+ * folder packs
+ *-----------------------------------------------------------------------------
+ */
+
+static gchar *pan_cache_pack_path(const gchar *dir_path)
+{
+	guchar digest[16];
+	gchar *md5;
+	gchar *name;
+	gchar *path;
+
+	md5_get_digest((const guchar *)dir_path, strlen(dir_path), digest);
+	md5 = md5_digest_to_text(digest);
+	name = g_strconcat(md5, PAN_CACHE_PACK_EXT, NULL);
+	path = g_build_filename(get_pan_cache_dir(), name, NULL);
+	g_free(name);
+	g_free(md5);
+
+	return path;
+}
+
+GHashTable *pan_cache_pack_load(const gchar *dir_path)
+{
+	GHashTable *pack;
+	gchar *path;
+	gchar *pathl;
+	gchar *buf;
+	gchar **lines;
+	gint i;
+
+	path = pan_cache_pack_path(dir_path);
+	pathl = path_from_utf8(path);
+	g_free(path);
+
+	if (!g_file_get_contents(pathl, &buf, NULL, NULL))
+		{
+		g_free(pathl);
+		return NULL;
+		}
+	g_free(pathl);
+
+	lines = g_strsplit(buf, "\n", -1);
+	g_free(buf);
+
+	if (!lines[0] || strcmp(lines[0], PAN_CACHE_PACK_HEADER) != 0)
+		{
+		g_strfreev(lines);
+		return NULL;
+		}
+
+	pack = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+	for (i = 1; lines[i]; i++)
+		{
+		PanCacheEntry entry;
+		gint n = 0;
+
+		if (lines[i][0] == '#' || lines[i][0] == '\0') continue;
+
+		if (sscanf(lines[i], "%" G_GINT64_FORMAT " %" G_GINT64_FORMAT " %d %d %d %" G_GINT64_FORMAT " %n",
+			   &entry.mtime, &entry.size, &entry.flags,
+			   &entry.width, &entry.height, &entry.date, &n) == 6 && n > 0 && lines[i][n])
+			{
+			g_hash_table_insert(pack, g_strdup(lines[i] + n), g_memdup(&entry, sizeof(entry)));
+			}
+		}
+
+	g_strfreev(lines);
+
+	return pack;
+}
+
+/* fills in the pack data for pc, it is validated when the file is read */
+void pan_cache_pack_apply(GHashTable *pack, PanCacheData *pc)
+{
+	PanCacheEntry *entry;
+
+	if (!pack || pc->cd) return;
+
+	entry = g_hash_table_lookup(pack, pc->fd->name);
+	if (!entry) return;
+
+	pc->cd = cache_sim_data_new();
+	pc->mtime = entry->mtime;
+	pc->size = entry->size;
+
+	if (entry->flags & PAN_CACHE_PACK_DIMENSIONS)
+		{
+		cache_sim_data_set_dimensions(pc->cd, entry->width, entry->height);
+		}
+	if (entry->flags & PAN_CACHE_PACK_DATE)
+		{
+		cache_sim_data_set_date(pc->cd, (time_t)entry->date);
+		}
+}
+
+/* list is of PanCacheData, all within dir_path */
+gboolean pan_cache_pack_save(const gchar *dir_path, GList *list)
+{
+	SecureSaveInfo *ssi;
+	gchar *path;
+	gchar *pathl;
+	GList *work;
+
+	path = pan_cache_pack_path(dir_path);
+	if (!recursive_mkdir_if_not_exists(get_pan_cache_dir(), 0755))
+		{
+		g_free(path);
+		return FALSE;
+		}
+
+	pathl = path_from_utf8(path);
+	ssi = secure_open(pathl);
+	g_free(pathl);
+	if (!ssi)
+		{
+		log_printf("Unable to save pan view data: %s\n", path);
+		g_free(path);
+		return FALSE;
+		}
+
+	secure_fprintf(ssi, "%s\n#%s %s\n#%s\n", PAN_CACHE_PACK_HEADER, PACKAGE, VERSION, dir_path);
+
+	work = list;
+	while (work)
+		{
+		PanCacheData *pc = work->data;
+		gint flags = 0;
+
+		work = work->next;
+
+		if (!pc->cd || strchr(pc->fd->name, '\n')) continue;
+
+		if (pc->cd->dimensions) flags |= PAN_CACHE_PACK_DIMENSIONS;
+		/* a date from unsaved metadata changes is not kept */
+		if (pc->cd->have_date && !pc->date_modified) flags |= PAN_CACHE_PACK_DATE;
+
+		secure_fprintf(ssi, "%" G_GINT64_FORMAT " %" G_GINT64_FORMAT " %d %d %d %" G_GINT64_FORMAT " %s\n",
+			       pc->mtime, pc->size, flags,
+			       pc->cd->dimensions ? pc->cd->width : 0,
+			       pc->cd->dimensions ? pc->cd->height : 0,
+			       pc->cd->have_date ? (gint64)pc->cd->date : (gint64)-1,
+			       pc->fd->name);
+		}
+
+	if (secure_close(ssi))
+		{
+		log_printf(_("error saving pan view data: %s\nerror: %s\n"), path,
+			   secsave_strerror(secsave_errno));
+		g_free(path);
+		return FALSE;
+		}
+
+	g_free(path);
+	return TRUE;
+}
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
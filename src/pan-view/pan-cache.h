@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) 2008 - 2016 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef PAN_VIEW_PAN_CACHE_H
+#define PAN_VIEW_PAN_CACHE_H
+
+#include "main.h"
+#include "pan-types.h"
+
+void pan_cache_data_prepare(PanCacheData *pc, CacheDataType mask);
+void pan_cache_data_read(PanCacheData *pc, CacheDataType mask);
+void pan_cache_data_finish(PanCacheData *pc, CacheDataType mask);
+void pan_cache_data_free(PanCacheData *pc);
+
+GHashTable *pan_cache_pack_load(const gchar *dir_path);
+void pan_cache_pack_apply(GHashTable *pack, PanCacheData *pc);
+gboolean pan_cache_pack_save(const gchar *dir_path, GList *list);
+
+#endif
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -203,14 +203,11 @@ void pan_calendar_compute(PanWindow *pw, FileData *dir_fd, gint *width, gint *he
 	list = pan_list_tree(dir_fd, SORT_NONE, TRUE, pw->ignore_symlinks);
 	pan_filter_fd_list(&list, pw->filter_ui->filter_elements);
 
-	if (pw->cache_list && pw->exif_date_enable)
+	if (pw->exif_date_enable)
 		{
-		pw->cache_list = pan_cache_sort(pw->cache_list, SORT_NAME, TRUE);
-		list = filelist_sort(list, SORT_NAME, TRUE);
 		pan_cache_sync_date(pw, list);
 		}
 
-	pw->cache_list = pan_cache_sort(pw->cache_list, SORT_TIME, TRUE);
 	list = filelist_sort(list, SORT_TIME, TRUE);
 
 	day_max = 0;
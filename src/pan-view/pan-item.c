@@ -22,6 +22,7 @@
 #include "pan-item.h"
 
 #include "image.h"
+#include "pan-view.h"
 #include "pixbuf_util.h"
 #include "ui_misc.h"
 
@@ -66,9 +67,8 @@ void pan_item_remove(PanWindow *pw, PanItem *pi)
 	if (!pi) return;
 
 	if (pw->click_pi == pi) pw->click_pi = NULL;
-	if (pw->queue_pi == pi)	pw->queue_pi = NULL;
 	if (pw->search_pi == pi) pw->search_pi = NULL;
-	pw->queue = g_list_remove(pw->queue, pi);
+	pan_queue_remove(pw, pi);
 
 	pw->list = g_list_remove(pw->list, pi);
 	image_area_changed(pw->imd, pi->x, pi->y, pi->width, pi->height);
@@ -604,33 +604,16 @@ gint pan_item_thumb_draw(PanWindow *pw, PanItem *pi, GdkPixbuf *pixbuf, PixbufRe
 
 static void pan_item_image_find_size(PanWindow *pw, PanItem *pi, gint w, gint h)
 {
-	GList *work;
+	PanCacheData *pc;
 
 	pi->width = w;
 	pi->height = h;
 
-	if (!pi->fd) return;
-
-	work = pw->cache_list;
-	while (work)
+	pc = pan_cache_find(pw, pi->fd);
+	if (pc && pc->cd && pc->cd->dimensions)
 		{
-		PanCacheData *pc;
-
-		pc = work->data;
-		work = work->next;
-
-		if (pc->cd && pc->cd->dimensions &&
-		    pc->fd && pc->fd == pi->fd)
-			{
-			pi->width = MAX(1, pc->cd->width * pw->image_size / 100);
-			pi->height = MAX(1, pc->cd->height * pw->image_size / 100);
-
-			pw->cache_list = g_list_remove(pw->cache_list, pc);
-			cache_sim_data_free(pc->cd);
-			file_data_unref(pc->fd);
-			g_free(pc);
-			return;
-			}
+		pi->width = MAX(1, pc->cd->width * pw->image_size / 100);
+		pi->height = MAX(1, pc->cd->height * pw->image_size / 100);
 		}
 }
 
@@ -839,7 +822,7 @@ PanItem *pan_item_find_by_coord(PanWindow *pw, PanItemType type,
 	pi = pan_item_find_by_coord_l(pw->list, type, x, y, key);
 	if (pi) return pi;
 
-	return pan_item_find_by_coord_l(pw->list_static, type, x, y, key);
+	return pan_item_find_by_coord_l(pan_layout_cell_list(pw, x, y), type, x, y, key);
 }
 
 
@@ -0,0 +1,575 @@
+/*
+ * Copyright (C) 2008 - 2016 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "pan-lod.h"
+
+#include "cache.h"
+#include "md5-util.h"
+#include "pan-view.h"
+#include "pixbuf-renderer.h"
+#include "pixbuf_util.h"
+#include "ui_fileops.h"
+
+#include <utime.h>
+
+/*
+ * Reduced resolution (level of detail) tiles for the zoomed out pan view.
+ *
+ * A tile of level L covers PAN_TILE_SIZE << L canvas pixels at PAN_TILE_SIZE
+ * resolution. Tiles are rendered on request, and once all items on a tile
+ * are loaded the tile is stored in a small memory cache and on disk, in a
+ * folder named after a checksum of the layout. Later views of the same layout
+ * are then drawn from the stored tiles without loading any thumbnail.
+ *
+ * Any change of the folder, sort or quality is a new layout, so the layout
+ * folders are kept to PAN_LOD_DISK_SIZE: a view touches its folder, and the
+ * least recently used folders beyond the limit are removed by a thread.
+ */
+
+#define PAN_LOD_VERSION 1
+#define PAN_LOD_CACHE_TILES 32
+/* bytes of tiles kept on disk for all layouts */
+#define PAN_LOD_DISK_SIZE (256 * 1024 * 1024)
+/* seconds a used layout folder is kept regardless of the size, it may be open */
+#define PAN_LOD_DISK_KEEP (60 * 60)
+
+
+typedef struct _PanLodTile PanLodTile;
+struct _PanLodTile {
+	gchar *key;
+	GdkPixbuf *pixbuf;
+	GList *link;
+};
+
+static void pan_lod_tile_free(gpointer data)
+{
+	PanLodTile *lt = data;
+
+	g_free(lt->key);
+	if (lt->pixbuf) g_object_unref(lt->pixbuf);
+	g_free(lt);
+}
+
+gint pan_lod_level(gint width, GdkPixbuf *pixbuf)
+{
+	gint pixbuf_width;
+	gint level = 0;
+
+	pixbuf_width = gdk_pixbuf_get_width(pixbuf);
+	if (pixbuf_width < 1) return 0;
+
+	while ((pixbuf_width << level) < width) level++;
+
+	return level;
+}
+
+/*
+ *-----------------------------------------------------------------------------
+ * layout checksum
+ *-----------------------------------------------------------------------------
+ */
+
+static void pan_lod_md5_int(MD5Context *ctx, gint64 value)
+{
+	md5_update(ctx, (guchar *)&value, sizeof(value));
+}
+
+static void pan_lod_md5_string(MD5Context *ctx, const gchar *text)
+{
+	if (text)
+		{
+		md5_update(ctx, (const guchar *)text, strlen(text) + 1);
+		}
+	else
+		{
+		pan_lod_md5_int(ctx, 0);
+		}
+}
+
+static gchar *pan_lod_layout_checksum(PanWindow *pw)
+{
+	MD5Context ctx;
+	guchar digest[16];
+	GList *work;
+
+	md5_init(&ctx);
+
+	pan_lod_md5_int(&ctx, PAN_LOD_VERSION);
+	pan_lod_md5_int(&ctx, PAN_TILE_SIZE);
+	pan_lod_md5_int(&ctx, pw->layout);
+	pan_lod_md5_int(&ctx, pw->size);
+	pan_lod_md5_int(&ctx, options->image.zoom_quality);
+	pan_lod_md5_string(&ctx, pw->dir_fd ? pw->dir_fd->path : NULL);
+
+	work = pw->list_static;
+	while (work)
+		{
+		PanItem *pi = work->data;
+		work = work->next;
+
+		pan_lod_md5_int(&ctx, pi->type);
+		pan_lod_md5_int(&ctx, pi->x);
+		pan_lod_md5_int(&ctx, pi->y);
+		pan_lod_md5_int(&ctx, pi->width);
+		pan_lod_md5_int(&ctx, pi->height);
+		pan_lod_md5_int(&ctx, pi->border);
+		pan_lod_md5_int(&ctx, pi->text_attr);
+		pan_lod_md5_int(&ctx, ((gint64)pi->color_r << 24) | (pi->color_g << 16) | (pi->color_b << 8) | pi->color_a);
+		pan_lod_md5_int(&ctx, ((gint64)pi->color2_r << 24) | (pi->color2_g << 16) | (pi->color2_b << 8) | pi->color2_a);
+		pan_lod_md5_string(&ctx, pi->key);
+		pan_lod_md5_string(&ctx, pi->text);
+
+		if (pi->fd)
+			{
+			pan_lod_md5_string(&ctx, pi->fd->path);
+			pan_lod_md5_int(&ctx, pi->fd->date);
+			pan_lod_md5_int(&ctx, pi->fd->size);
+			}
+		}
+
+	md5_final(&ctx, digest);
+
+	return md5_digest_to_text(digest);
+}
+
+/*
+ *-----------------------------------------------------------------------------
+ * disk limit
+ *-----------------------------------------------------------------------------
+ */
+
+typedef struct _PanLodFolder PanLodFolder;
+struct _PanLodFolder {
+	gchar *pathl;
+	time_t mtime;
+	gint64 size;
+};
+
+#ifdef HAVE_GTHREAD
+static GThreadPool *pan_lod_prune_pool = NULL;
+#endif
+static gint pan_lod_prune_running = FALSE;
+
+/* the layout folders are named by a md5 checksum, the other files are image data */
+static gboolean pan_lod_is_layout_folder(const gchar *name)
+{
+	gint i;
+
+	for (i = 0; i < 32; i++)
+		{
+		if (!g_ascii_isxdigit(name[i])) return FALSE;
+		}
+
+	return (name[32] == '\0');
+}
+
+/* returns the size of the tiles, removes them when remove is set */
+static gint64 pan_lod_folder_scan(const gchar *pathl, gboolean remove)
+{
+	DIR *dp;
+	struct dirent *dir;
+	gint64 size = 0;
+
+	dp = opendir(pathl);
+	if (!dp) return 0;
+
+	while ((dir = readdir(dp)) != NULL)
+		{
+		gchar *tilel;
+		struct stat st;
+
+		if (dir->d_name[0] == '.') continue;
+
+		tilel = g_build_filename(pathl, dir->d_name, NULL);
+		if (remove)
+			{
+			unlink(tilel);
+			}
+		else if (stat(tilel, &st) == 0)
+			{
+			size += st.st_size;
+			}
+		g_free(tilel);
+		}
+	closedir(dp);
+
+	if (remove) rmdir(pathl);
+
+	return size;
+}
+
+static gint pan_lod_folder_sort_cb(gconstpointer a, gconstpointer b)
+{
+	const PanLodFolder *fa = a;
+	const PanLodFolder *fb = b;
+
+	if (fa->mtime > fb->mtime) return -1;
+	if (fa->mtime < fb->mtime) return 1;
+	return 0;
+}
+
+/* run by a thread, data is the pan cache folder in the file system encoding */
+static void pan_lod_prune_run(gpointer data, gpointer user_data)
+{
+	gchar *cachel = data;
+	GList *folders = NULL;
+	GList *work;
+	DIR *dp;
+	struct dirent *dir;
+	gint64 total = 0;
+	time_t now = time(NULL);
+
+	dp = opendir(cachel);
+	if (dp)
+		{
+		while ((dir = readdir(dp)) != NULL)
+			{
+			PanLodFolder *lf;
+			gchar *pathl;
+			struct stat st;
+
+			if (!pan_lod_is_layout_folder(dir->d_name)) continue;
+
+			pathl = g_build_filename(cachel, dir->d_name, NULL);
+			if (stat(pathl, &st) != 0 || !S_ISDIR(st.st_mode))
+				{
+				g_free(pathl);
+				continue;
+				}
+
+			lf = g_new0(PanLodFolder, 1);
+			lf->pathl = pathl;
+			lf->mtime = st.st_mtime;
+			folders = g_list_prepend(folders, lf);
+			}
+		closedir(dp);
+		}
+
+	/* most recently used first, the ones past the limit go */
+	folders = g_list_sort(folders, pan_lod_folder_sort_cb);
+	for (work = folders; work; work = work->next)
+		{
+		PanLodFolder *lf = work->data;
+
+		lf->size = pan_lod_folder_scan(lf->pathl, FALSE);
+		total += lf->size;
+
+		if (total > PAN_LOD_DISK_SIZE && now - lf->mtime > PAN_LOD_DISK_KEEP)
+			{
+			pan_lod_folder_scan(lf->pathl, TRUE);
+			}
+
+		g_free(lf->pathl);
+		g_free(lf);
+		}
+	g_list_free(folders);
+	g_free(cachel);
+
+	g_atomic_int_set(&pan_lod_prune_running, FALSE);
+}
+
+static void pan_lod_prune(void)
+{
+	gchar *cachel;
+
+	if (!g_atomic_int_compare_and_exchange(&pan_lod_prune_running, FALSE, TRUE)) return;
+
+	cachel = path_from_utf8(get_pan_cache_dir());
+#ifdef HAVE_GTHREAD
+	if (!pan_lod_prune_pool)
+		{
+		pan_lod_prune_pool = g_thread_pool_new(pan_lod_prune_run, NULL, 1, FALSE, NULL);
+		}
+	g_thread_pool_push(pan_lod_prune_pool, cachel, NULL);
+#else
+	pan_lod_prune_run(cachel, NULL);
+#endif
+}
+
+/*
+ *-----------------------------------------------------------------------------
+ * tile cache
+ *-----------------------------------------------------------------------------
+ */
+
+void pan_lod_init(PanWindow *pw)
+{
+	gchar *checksum;
+	gchar *dirl;
+
+	pan_lod_free(pw);
+
+	if (!pw->list_static) return;
+
+	checksum = pan_lod_layout_checksum(pw);
+	pw->lod_path = g_build_filename(get_pan_cache_dir(), checksum, NULL);
+	g_free(checksum);
+
+	/* marks the layout as used, for the disk limit */
+	dirl = path_from_utf8(pw->lod_path);
+	utime(dirl, NULL);
+	g_free(dirl);
+	pan_lod_prune();
+
+	pw->lod_tiles = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, pan_lod_tile_free);
+	pw->lod_missing = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	pw->lod_lru = g_queue_new();
+
+	DEBUG_1("pan tile cache: %s", pw->lod_path);
+}
+
+void pan_lod_free(PanWindow *pw)
+{
+	if (pw->lod_idle_id)
+		{
+		g_source_remove(pw->lod_idle_id);
+		pw->lod_idle_id = 0;
+		}
+
+	if (pw->lod_lru) g_queue_free(pw->lod_lru);
+	pw->lod_lru = NULL;
+	if (pw->lod_tiles) g_hash_table_destroy(pw->lod_tiles);
+	pw->lod_tiles = NULL;
+	if (pw->lod_missing) g_hash_table_destroy(pw->lod_missing);
+	pw->lod_missing = NULL;
+
+	g_free(pw->lod_path);
+	pw->lod_path = NULL;
+}
+
+static gchar *pan_lod_tile_path(PanWindow *pw, const gchar *key)
+{
+	gchar *name;
+	gchar *path;
+	gchar *pathl;
+
+	name = g_strconcat(key, GQ_CACHE_EXT_THUMB, NULL);
+	path = g_build_filename(pw->lod_path, name, NULL);
+	pathl = path_from_utf8(path);
+	g_free(path);
+	g_free(name);
+
+	return pathl;
+}
+
+static void pan_lod_cache_insert(PanWindow *pw, gchar *key, GdkPixbuf *pixbuf)
+{
+	PanLodTile *lt;
+
+	lt = g_new0(PanLodTile, 1);
+	lt->key = key;
+	lt->pixbuf = pixbuf;
+
+	g_queue_push_head(pw->lod_lru, lt);
+	lt->link = g_queue_peek_head_link(pw->lod_lru);
+	g_hash_table_insert(pw->lod_tiles, lt->key, lt);
+
+	while (g_queue_get_length(pw->lod_lru) > PAN_LOD_CACHE_TILES)
+		{
+		PanLodTile *old;
+
+		old = g_queue_pop_tail(pw->lod_lru);
+		g_hash_table_remove(pw->lod_tiles, old->key);
+		}
+}
+
+static GdkPixbuf *pan_lod_cache_find(PanWindow *pw, gint level, gint x, gint y)
+{
+	PanLodTile *lt;
+	GdkPixbuf *pixbuf;
+	gchar *key;
+	gchar *pathl;
+
+	key = g_strdup_printf("%d_%d_%d", level, x, y);
+
+	lt = g_hash_table_lookup(pw->lod_tiles, key);
+	if (lt)
+		{
+		g_free(key);
+
+		g_queue_unlink(pw->lod_lru, lt->link);
+		g_queue_push_head_link(pw->lod_lru, lt->link);
+		return lt->pixbuf;
+		}
+
+	if (g_hash_table_lookup(pw->lod_missing, key))
+		{
+		g_free(key);
+		return NULL;
+		}
+
+	pathl = pan_lod_tile_path(pw, key);
+	pixbuf = gdk_pixbuf_new_from_file(pathl, NULL);
+	g_free(pathl);
+
+	if (!pixbuf ||
+	    gdk_pixbuf_get_width(pixbuf) != PAN_TILE_SIZE ||
+	    gdk_pixbuf_get_height(pixbuf) != PAN_TILE_SIZE)
+		{
+		if (pixbuf) g_object_unref(pixbuf);
+		g_hash_table_insert(pw->lod_missing, key, GINT_TO_POINTER(1));
+		return NULL;
+		}
+
+	pan_lod_cache_insert(pw, key, pixbuf);
+
+	return pixbuf;
+}
+
+gboolean pan_lod_get(PanWindow *pw, gint x, gint y, gint width, gint height, GdkPixbuf *pixbuf)
+{
+	GdkPixbuf *tile;
+	gint level;
+	gint span;
+	gint tx, ty;
+
+	if (!pw->lod_path) return FALSE;
+
+	level = pan_lod_level(width, pixbuf);
+	if (level < 1) return FALSE;
+
+	span = PAN_TILE_SIZE << level;
+	tx = ROUND_DOWN(x, span);
+	ty = ROUND_DOWN(y, span);
+	if (x + width > tx + span || y + height > ty + span) return FALSE;
+
+	tile = pan_lod_cache_find(pw, level, tx, ty);
+	if (!tile) return FALSE;
+
+	gdk_pixbuf_copy_area(tile, (x - tx) >> level, (y - ty) >> level,
+			     gdk_pixbuf_get_width(pixbuf), gdk_pixbuf_get_height(pixbuf),
+			     pixbuf, 0, 0);
+
+	return TRUE;
+}
+
+/* a tile is stored only when it shows every item in its final state */
+static gboolean pan_lod_tile_complete(PanWindow *pw, gint x, gint y, gint width, gint height)
+{
+	GList *list;
+	GList *work;
+	gboolean complete = TRUE;
+
+	list = pan_layout_intersect(pw, x, y, width, height);
+	work = list;
+	while (work && complete)
+		{
+		PanItem *pi = work->data;
+		work = work->next;
+
+		if (g_list_find(pw->list, pi))
+			{
+			/* info and day bubbles come and go */
+			complete = FALSE;
+			}
+		else if ((pi->type == PAN_ITEM_THUMB || pi->type == PAN_ITEM_IMAGE) &&
+			 !pi->pixbuf && pw->size > PAN_IMAGE_SIZE_THUMB_NONE)
+			{
+			complete = FALSE;
+			}
+		}
+	g_list_free(list);
+
+	return complete;
+}
+
+static void pan_lod_sync(PanWindow *pw)
+{
+	PixbufRenderer *pr;
+	GList *work;
+	gboolean have_dir = FALSE;
+
+	if (!pw->lod_path) return;
+
+	pr = PIXBUF_RENDERER(pw->imd->pr);
+	if (!pr->source_tiles_enabled) return;
+
+	work = pr->source_tiles.head;
+	while (work)
+		{
+		SourceTile *st = work->data;
+		gint span;
+		gchar *key;
+		gchar *pathl;
+
+		work = work->next;
+
+		if (st->level < 1 || st->blank) continue;
+
+		key = g_strdup_printf("%d_%d_%d", st->level, st->x, st->y);
+		span = PAN_TILE_SIZE << st->level;
+
+		if (g_hash_table_lookup(pw->lod_tiles, key) ||
+		    !pan_lod_tile_complete(pw, st->x, st->y, span, span))
+			{
+			g_free(key);
+			continue;
+			}
+
+		if (!have_dir)
+			{
+			gchar *dirl = path_from_utf8(pw->lod_path);
+
+			have_dir = recursive_mkdir_if_not_exists(dirl, 0755);
+			g_free(dirl);
+			if (!have_dir)
+				{
+				g_free(key);
+				return;
+				}
+			}
+
+		pathl = pan_lod_tile_path(pw, key);
+		if (!isfile(pathl))
+			{
+			DEBUG_1("pan tile cache: saving %s", key);
+			pixbuf_to_file_as_png(st->pixbuf, pathl);
+			}
+		g_free(pathl);
+
+		g_hash_table_remove(pw->lod_missing, key);
+		pan_lod_cache_insert(pw, key, gdk_pixbuf_copy(st->pixbuf));
+		}
+}
+
+static gboolean pan_lod_sync_idle_cb(gpointer data)
+{
+	PanWindow *pw = data;
+	gint i;
+
+	pw->lod_idle_id = 0;
+
+	/* wait until the visible items are loaded */
+	if (pw->queue) return FALSE;
+	for (i = 0; i < PAN_QUEUE_LOADERS; i++)
+		{
+		if (pw->loaders[i].pi) return FALSE;
+		}
+
+	pan_lod_sync(pw);
+
+	return FALSE;
+}
+
+void pan_lod_sync_idle(PanWindow *pw)
+{
+	if (!pw->lod_path || pw->lod_idle_id) return;
+
+	pw->lod_idle_id = g_idle_add_full(G_PRIORITY_LOW, pan_lod_sync_idle_cb, pw, NULL);
+}
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
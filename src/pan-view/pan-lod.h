@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2008 - 2016 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef PAN_VIEW_PAN_LOD_H
+#define PAN_VIEW_PAN_LOD_H
+
+#include "main.h"
+#include "pan-types.h"
+
+gint pan_lod_level(gint width, GdkPixbuf *pixbuf);
+
+void pan_lod_init(PanWindow *pw);
+void pan_lod_free(PanWindow *pw);
+
+gboolean pan_lod_get(PanWindow *pw, gint x, gint y, gint width, gint height, GdkPixbuf *pixbuf);
+void pan_lod_sync_idle(PanWindow *pw);
+
+#endif
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
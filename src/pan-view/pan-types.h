@@ -81,6 +81,21 @@
 
 #define PAN_GROUP_MAX 16
 
+/* tiles, loader queue */
+
+#define PAN_TILE_SIZE 512
+#define PAN_LOD_LEVELS 4
+
+#define PAN_QUEUE_LOADERS 4
+#define PAN_PIXBUF_CACHE_SIZE (128 * 1024 * 1024)
+
+/* image data (dimensions, dates) read ahead of the layout */
+
+#define PAN_CACHE_THREADS 4
+#define PAN_CACHE_BATCH 64
+#define PAN_CACHE_POLL_INTERVAL 50	/* ms */
+#define PAN_CACHE_RELAYOUT_INTERVAL 2000000	/* us */
+
 
 
 typedef enum {
@@ -167,6 +182,22 @@ struct _PanItem {
 	gpointer data;
 
 	gboolean queued;
+	GList *cache_link;	/* link in the pixbuf cache while off screen */
+
+	guint grid_stamp;	/* last spatial index query that visited this item */
+	gint grid_order;	/* creation order, used to keep the draw order */
+};
+
+typedef struct _PanGrid PanGrid;
+
+typedef struct _PanWindow PanWindow;
+
+typedef struct _PanLoader PanLoader;
+struct _PanLoader {
+	PanWindow *pw;
+	PanItem *pi;
+	ImageLoader *il;
+	ThumbLoader *tl;
 };
 
 typedef struct _PanViewSearchUi PanViewSearchUi;
@@ -182,7 +213,6 @@ struct _PanViewSearchUi
 // Defined in pan-view-filter.h
 typedef struct _PanViewFilterUi PanViewFilterUi;
 
-typedef struct _PanWindow PanWindow;
 struct _PanWindow
 {
 	GtkWidget *window;
@@ -218,19 +248,33 @@ struct _PanWindow
 
 	GList *list;
 	GList *list_static;
-	GList *list_grid;
+	PanGrid *grid;
 
-	GList *cache_list;
-	GList *cache_todo;
+	GHashTable *cache_hash;		/* FileData -> PanCacheData */
+	GList *cache_list;		/* all PanCacheData, in folder order */
+	GList *cache_todo;		/* PanCacheData still to be read */
+	GList *cache_fallback;		/* PanCacheData that need a full decode */
 	gint cache_count;
 	gint cache_total;
-	gint cache_tick;
+	gint cache_passes;		/* layouts done while the data is read */
+	gint64 cache_layout_time;	/* time of the last progressive layout */
+	CacheDataType cache_mask;
 	CacheLoader *cache_cl;
+	GThreadPool *cache_pool;
+	GAsyncQueue *cache_done;
 
-	ImageLoader *il;
-	ThumbLoader *tl;
-	PanItem *queue_pi;
+	PanLoader loaders[PAN_QUEUE_LOADERS];
 	GList *queue;
+	guint queue_idle_id;
+
+	GQueue *pixbuf_cache;
+	gint64 pixbuf_cache_size;
+
+	gchar *lod_path;
+	GHashTable *lod_tiles;
+	GHashTable *lod_missing;
+	GQueue *lod_lru;
+	guint lod_idle_id;
 
 	PanItem *click_pi;
 	PanItem *search_pi;
@@ -238,19 +282,27 @@ struct _PanWindow
 	gint idle_id;
 };
 
-typedef struct _PanGrid PanGrid;
+/* uniform grid spatial index over list_static */
 struct _PanGrid {
-	gint x;
-	gint y;
-	gint w;
-	gint h;
-	GList *list;
+	gint cell_w;
+	gint cell_h;
+	gint cols;
+	gint rows;
+	GList **cells;		/* cols * rows item lists, row major */
+	guint stamp;
 };
 
 typedef struct _PanCacheData PanCacheData;
 struct _PanCacheData {
 	FileData *fd;
 	CacheData *cd;
+	gint64 mtime;		/* file time and size the data is valid for */
+	gint64 size;
+	gchar *sidecar_path;	/* XMP sidecar merged for the date, set on the main thread */
+	gboolean date_modified;	/* the date comes from unsaved metadata, read on the main thread */
+	gboolean changed;	/* read from the file, the folder pack needs saving */
+	gboolean fallback;	/* no header reader, dimensions need a full decode */
+	gboolean done;		/* back from the worker, owned by the main thread */
 };
 
 #endif
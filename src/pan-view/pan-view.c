@@ -32,10 +32,12 @@
 #include "menu.h"
 #include "metadata.h"
 #include "misc.h"
+#include "pan-cache.h"
 #include "pan-calendar.h"
 #include "pan-folder.h"
 #include "pan-grid.h"
 #include "pan-item.h"
+#include "pan-lod.h"
 #include "pan-timeline.h"
 #include "pan-util.h"
 #include "pan-view-filter.h"
@@ -60,8 +62,6 @@
 #define PAN_WINDOW_DEFAULT_WIDTH 720
 #define PAN_WINDOW_DEFAULT_HEIGHT 500
 
-#define PAN_TILE_SIZE 512
-
 #define ZOOM_INCREMENT 1.0
 #define ZOOM_LABEL_WIDTH 64
 
@@ -77,6 +77,7 @@ static GList *pan_window_list = NULL;
 
 
 static void pan_layout_update_idle(PanWindow *pw);
+static gint pan_layout_update_idle_cb(gpointer data);
 
 static void pan_fullscreen_toggle(PanWindow *pw, gboolean force_off);
 
@@ -86,6 +87,9 @@ static GtkWidget *pan_popup_menu(PanWindow *pw);
 
 static void pan_window_dnd_init(PanWindow *pw);
 
+static GList *pan_layout_intersect_l(GList *list, GList *item_list,
+				     gint x, gint y, gint width, gint height);
+
 
 /*
  *-----------------------------------------------------------------------------
@@ -93,56 +97,85 @@ static void pan_window_dnd_init(PanWindow *pw);
  *-----------------------------------------------------------------------------
  */
 
-static gboolean pan_queue_step(PanWindow *pw);
+static void pan_queue_run(PanWindow *pw);
 
 
-static void pan_queue_thumb_done_cb(ThumbLoader *tl, gpointer data)
+/*
+ * Pixbufs of items that are no longer on any tile are kept in a size limited
+ * cache, most recently used first, so that revisiting a region is instant.
+ */
+static void pan_pixbuf_cache_remove(PanWindow *pw, PanItem *pi)
 {
-	PanWindow *pw = data;
+	if (!pi->cache_link) return;
 
-	if (pw->queue_pi)
+	g_queue_delete_link(pw->pixbuf_cache, pi->cache_link);
+	pi->cache_link = NULL;
+
+	if (pi->pixbuf)
 		{
-		PanItem *pi;
-		gint rc;
+		pw->pixbuf_cache_size -= (gint64)gdk_pixbuf_get_rowstride(pi->pixbuf) * gdk_pixbuf_get_height(pi->pixbuf);
+		}
+}
 
-		pi = pw->queue_pi;
-		pw->queue_pi = NULL;
+static void pan_pixbuf_cache_add(PanWindow *pw, PanItem *pi)
+{
+	if (!pi->pixbuf || pi->cache_link) return;
 
-		pi->queued = FALSE;
+	g_queue_push_head(pw->pixbuf_cache, pi);
+	pi->cache_link = g_queue_peek_head_link(pw->pixbuf_cache);
+	pw->pixbuf_cache_size += (gint64)gdk_pixbuf_get_rowstride(pi->pixbuf) * gdk_pixbuf_get_height(pi->pixbuf);
 
-		if (pi->pixbuf) g_object_unref(pi->pixbuf);
-		pi->pixbuf = thumb_loader_get_pixbuf(tl);
+	while (pw->pixbuf_cache_size > PAN_PIXBUF_CACHE_SIZE)
+		{
+		PanItem *old;
 
-		rc = pi->refcount;
-		image_area_changed(pw->imd, pi->x, pi->y, pi->width, pi->height);
-		pi->refcount = rc;
+		old = g_queue_peek_tail(pw->pixbuf_cache);
+		pan_pixbuf_cache_remove(pw, old);
+
+		g_object_unref(old->pixbuf);
+		old->pixbuf = NULL;
+		}
+}
+
+static void pan_pixbuf_cache_clear(PanWindow *pw)
+{
+	while (!g_queue_is_empty(pw->pixbuf_cache))
+		{
+		pan_pixbuf_cache_remove(pw, g_queue_peek_head(pw->pixbuf_cache));
 		}
+	pw->pixbuf_cache_size = 0;
+}
 
-	thumb_loader_free(pw->tl);
-	pw->tl = NULL;
+static void pan_loader_reset(PanLoader *pl)
+{
+	image_loader_free(pl->il);
+	pl->il = NULL;
+	thumb_loader_free(pl->tl);
+	pl->tl = NULL;
 
-	while (pan_queue_step(pw));
+	if (pl->pi) pl->pi->queued = FALSE;
+	pl->pi = NULL;
 }
 
-static void pan_queue_image_done_cb(ImageLoader *il, gpointer data)
+static void pan_loader_done(PanLoader *pl, GdkPixbuf *pixbuf)
 {
-	PanWindow *pw = data;
+	PanWindow *pw = pl->pw;
+	PanItem *pi;
 
-	if (pw->queue_pi)
+	pi = pl->pi;
+	pl->pi = NULL;
+
+	if (pi)
 		{
-		PanItem *pi;
 		gint rc;
 
-		pi = pw->queue_pi;
-		pw->queue_pi = NULL;
-
 		pi->queued = FALSE;
 
 		if (pi->pixbuf) g_object_unref(pi->pixbuf);
-		pi->pixbuf = image_loader_get_pixbuf(pw->il);
+		pi->pixbuf = pixbuf;
 		if (pi->pixbuf) g_object_ref(pi->pixbuf);
 
-		if (pi->pixbuf && pw->size != PAN_IMAGE_SIZE_100 &&
+		if (pi->pixbuf && pi->type == PAN_ITEM_IMAGE && pw->size != PAN_IMAGE_SIZE_100 &&
 		    (gdk_pixbuf_get_width(pi->pixbuf) > pi->width ||
 		     gdk_pixbuf_get_height(pi->pixbuf) > pi->height))
 			{
@@ -159,80 +192,152 @@ static void pan_queue_image_done_cb(ImageLoader *il, gpointer data)
 		pi->refcount = rc;
 		}
 
-	image_loader_free(pw->il);
-	pw->il = NULL;
+	pan_loader_reset(pl);
+
+	pan_queue_run(pw);
+
+	if (!pw->queue) pan_lod_sync_idle(pw);
+}
+
+static void pan_queue_thumb_done_cb(ThumbLoader *tl, gpointer data)
+{
+	PanLoader *pl = data;
+	GdkPixbuf *pixbuf;
+
+	pixbuf = thumb_loader_get_pixbuf(tl);
+	pan_loader_done(pl, pixbuf);
+	if (pixbuf) g_object_unref(pixbuf);
+}
+
+static void pan_queue_image_done_cb(ImageLoader *il, gpointer data)
+{
+	PanLoader *pl = data;
 
-	while (pan_queue_step(pw));
+	pan_loader_done(pl, image_loader_get_pixbuf(il));
 }
 
-static gboolean pan_queue_step(PanWindow *pw)
+/* the queued item closest to the center of the visible area is loaded first */
+static PanItem *pan_queue_next(PanWindow *pw)
 {
+	GdkRectangle rect;
+	GList *work;
+	GList *best = NULL;
+	gint64 best_dist = 0;
+	gint cx, cy;
 	PanItem *pi;
 
-	if (!pw->queue) return FALSE;
+	if (!pw->queue) return NULL;
 
-	pi = pw->queue->data;
-	pw->queue = g_list_remove(pw->queue, pi);
-	pw->queue_pi = pi;
+	if (pixbuf_renderer_get_visible_rect(PIXBUF_RENDERER(pw->imd->pr), &rect))
+		{
+		cx = rect.x + rect.width / 2;
+		cy = rect.y + rect.height / 2;
+
+		work = pw->queue;
+		while (work)
+			{
+			PanItem *pi = work->data;
+			gint64 dx, dy, dist;
 
-	if (!pw->queue_pi->fd)
+			dx = pi->x + pi->width / 2 - cx;
+			dy = pi->y + pi->height / 2 - cy;
+			dist = dx * dx + dy * dy;
+
+			if (!best || dist < best_dist)
+				{
+				best = work;
+				best_dist = dist;
+				}
+			work = work->next;
+			}
+		}
+	else
 		{
-		pw->queue_pi->queued = FALSE;
-		pw->queue_pi = NULL;
-		return TRUE;
+		best = pw->queue;
 		}
 
-	image_loader_free(pw->il);
-	pw->il = NULL;
-	thumb_loader_free(pw->tl);
-	pw->tl = NULL;
+	pi = best->data;
+	pw->queue = g_list_delete_link(pw->queue, best);
+
+	return pi;
+}
+
+static gboolean pan_queue_step(PanWindow *pw, PanLoader *pl)
+{
+	PanItem *pi;
+
+	if (pl->pi) return FALSE;
+
+	pi = pan_queue_next(pw);
+	if (!pi) return FALSE;
+
+	pl->pi = pi;
+
+	if (!pi->fd)
+		{
+		pan_loader_reset(pl);
+		return TRUE;
+		}
 
 	if (pi->type == PAN_ITEM_IMAGE)
 		{
-		pw->il = image_loader_new(pi->fd);
+		pl->il = image_loader_new(pi->fd);
 
 		if (pw->size != PAN_IMAGE_SIZE_100)
 			{
-			image_loader_set_requested_size(pw->il, pi->width, pi->height);
+			image_loader_set_requested_size(pl->il, pi->width, pi->height);
 			}
 
-		g_signal_connect(G_OBJECT(pw->il), "error", (GCallback)pan_queue_image_done_cb, pw);
-		g_signal_connect(G_OBJECT(pw->il), "done", (GCallback)pan_queue_image_done_cb, pw);
-
-		if (image_loader_start(pw->il)) return FALSE;
+		g_signal_connect(G_OBJECT(pl->il), "error", (GCallback)pan_queue_image_done_cb, pl);
+		g_signal_connect(G_OBJECT(pl->il), "done", (GCallback)pan_queue_image_done_cb, pl);
 
-		image_loader_free(pw->il);
-		pw->il = NULL;
+		if (image_loader_start(pl->il)) return FALSE;
 		}
 	else if (pi->type == PAN_ITEM_THUMB)
 		{
-		pw->tl = thumb_loader_new(PAN_THUMB_SIZE, PAN_THUMB_SIZE);
+		pl->tl = thumb_loader_new(PAN_THUMB_SIZE, PAN_THUMB_SIZE);
 
-		if (!pw->tl->standard_loader)
+		if (!pl->tl->standard_loader)
 			{
 			/* The classic loader will recreate a thumbnail any time we
 			 * request a different size than what exists. This view will
 			 * almost never use the user configured sizes so disable cache.
 			 */
-			thumb_loader_set_cache(pw->tl, FALSE, FALSE, FALSE);
+			thumb_loader_set_cache(pl->tl, FALSE, FALSE, FALSE);
 			}
 
-		thumb_loader_set_callbacks(pw->tl,
+		thumb_loader_set_callbacks(pl->tl,
 					   pan_queue_thumb_done_cb,
 					   pan_queue_thumb_done_cb,
-					   NULL, pw);
+					   NULL, pl);
 
-		if (thumb_loader_start(pw->tl, pi->fd)) return FALSE;
-
-		thumb_loader_free(pw->tl);
-		pw->tl = NULL;
+		if (thumb_loader_start(pl->tl, pi->fd)) return FALSE;
 		}
 
-	pw->queue_pi->queued = FALSE;
-	pw->queue_pi = NULL;
+	pan_loader_reset(pl);
 	return TRUE;
 }
 
+static void pan_queue_run(PanWindow *pw)
+{
+	gint i;
+
+	for (i = 0; i < PAN_QUEUE_LOADERS && pw->queue; i++)
+		{
+		while (pan_queue_step(pw, &pw->loaders[i]));
+		}
+}
+
+static gboolean pan_queue_run_idle_cb(gpointer data)
+{
+	PanWindow *pw = data;
+
+	pw->queue_idle_id = 0;
+	pan_queue_run(pw);
+
+	return FALSE;
+}
+
 static void pan_queue_add(PanWindow *pw, PanItem *pi)
 {
 	if (!pi || pi->queued || pi->pixbuf) return;
@@ -245,7 +350,57 @@ static void pan_queue_add(PanWindow *pw, PanItem *pi)
 	pi->queued = TRUE;
 	pw->queue = g_list_prepend(pw->queue, pi);
 
-	if (!pw->tl && !pw->il) while (pan_queue_step(pw));
+	pan_queue_run(pw);
+}
+
+/* drops the item from the queue, cancelling a load in progress */
+void pan_queue_remove(PanWindow *pw, PanItem *pi)
+{
+	gint i;
+
+	pan_pixbuf_cache_remove(pw, pi);
+
+	if (!pi->queued) return;
+
+	pw->queue = g_list_remove(pw->queue, pi);
+
+	for (i = 0; i < PAN_QUEUE_LOADERS; i++)
+		{
+		if (pw->loaders[i].pi == pi)
+			{
+			pan_loader_reset(&pw->loaders[i]);
+
+			/* called from tile dispose, restart the freed loader later */
+			if (pw->queue && !pw->queue_idle_id)
+				{
+				pw->queue_idle_id = g_idle_add(pan_queue_run_idle_cb, pw);
+				}
+			}
+		}
+
+	pi->queued = FALSE;
+}
+
+static void pan_queue_clear(PanWindow *pw)
+{
+	gint i;
+
+	if (pw->queue_idle_id)
+		{
+		g_source_remove(pw->queue_idle_id);
+		pw->queue_idle_id = 0;
+		}
+
+	g_list_free(pw->queue);
+	pw->queue = NULL;
+
+	for (i = 0; i < PAN_QUEUE_LOADERS; i++)
+		{
+		pw->loaders[i].pi = NULL;
+		pan_loader_reset(&pw->loaders[i]);
+		}
+
+	pan_pixbuf_cache_clear(pw);
 }
 
 
@@ -255,12 +410,8 @@ static void pan_queue_add(PanWindow *pw, PanItem *pi)
  *-----------------------------------------------------------------------------
  */
 
-static gboolean pan_window_request_tile_cb(PixbufRenderer *pr, gint x, gint y,
-				       	   gint width, gint height, GdkPixbuf *pixbuf, gpointer data)
+static void pan_window_draw_background(GdkPixbuf *pixbuf, gint x, gint y, gint width, gint height)
 {
-	PanWindow *pw = data;
-	GList *list;
-	GList *work;
 	gint i;
 
 	pixbuf_set_rect_fill(pixbuf,
@@ -293,42 +444,146 @@ static gboolean pan_window_request_tile_cb(PixbufRenderer *pr, gint x, gint y,
 					      PAN_GRID_COLOR, PAN_GRID_ALPHA);
 			}
 		}
+}
+
+/* returns TRUE when the item image needs to be loaded */
+static gboolean pan_window_draw_item(PanWindow *pw, PanItem *pi, GdkPixbuf *pixbuf, PixbufRenderer *pr,
+				     gint x, gint y, gint width, gint height)
+{
+	gboolean queue = FALSE;
+
+	switch (pi->type)
+		{
+		case PAN_ITEM_BOX:
+			queue = pan_item_box_draw(pw, pi, pixbuf, pr, x, y, width, height);
+			break;
+		case PAN_ITEM_TRIANGLE:
+			queue = pan_item_tri_draw(pw, pi, pixbuf, pr, x, y, width, height);
+			break;
+		case PAN_ITEM_TEXT:
+			queue = pan_item_text_draw(pw, pi, pixbuf, pr, x, y, width, height);
+			break;
+		case PAN_ITEM_THUMB:
+			queue = pan_item_thumb_draw(pw, pi, pixbuf, pr, x, y, width, height);
+			break;
+		case PAN_ITEM_IMAGE:
+			queue = pan_item_image_draw(pw, pi, pixbuf, pr, x, y, width, height);
+			break;
+		case PAN_ITEM_NONE:
+		default:
+			break;
+		}
+
+	return queue;
+}
+
+/*
+ * Reduced resolution tile, the pixbuf is smaller than the region by a factor of 2^level.
+ * It is taken from the tile cache when possible, otherwise the region is drawn
+ * at full size one PAN_TILE_SIZE block at a time and scaled down.
+ */
+static gboolean pan_window_request_tile_lod(PanWindow *pw, PixbufRenderer *pr, gint x, gint y,
+					    gint width, gint height, GdkPixbuf *pixbuf, gint level)
+{
+	GList *list;
+	GList *work;
+	GList *transient;
 
 	list = pan_layout_intersect(pw, x, y, width, height);
 	work = list;
 	while (work)
 		{
-		PanItem *pi;
-		gboolean queue = FALSE;
-
-		pi = work->data;
+		PanItem *pi = work->data;
 		work = work->next;
 
+		if (pi->refcount == 0) pan_pixbuf_cache_remove(pw, pi);
 		pi->refcount++;
+		}
+
+	transient = pan_layout_intersect_l(NULL, pw->list, x, y, width, height);
+
+	if (transient || !pan_lod_get(pw, x, y, width, height, pixbuf))
+		{
+		GdkPixbuf *block;
+		gint bx, by;
 
-		switch (pi->type)
+		block = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, PAN_TILE_SIZE, PAN_TILE_SIZE);
+
+		for (by = y; by < y + height; by += PAN_TILE_SIZE)
+			for (bx = x; bx < x + width; bx += PAN_TILE_SIZE)
+				{
+				gint bw, bh;
+
+				bw = MIN(PAN_TILE_SIZE, x + width - bx);
+				bh = MIN(PAN_TILE_SIZE, y + height - by);
+
+				pan_window_draw_background(block, bx, by, bw, bh);
+
+				work = list;
+				while (work)
+					{
+					PanItem *pi = work->data;
+					work = work->next;
+
+					pan_window_draw_item(pw, pi, block, pr, bx, by, bw, bh);
+					}
+
+				gdk_pixbuf_scale(block, pixbuf,
+						 (bx - x) >> level, (by - y) >> level, bw >> level, bh >> level,
+						 (gdouble)((bx - x) >> level), (gdouble)((by - y) >> level),
+						 1.0 / (1 << level), 1.0 / (1 << level),
+						 GDK_INTERP_BILINEAR);
+				}
+
+		g_object_unref(block);
+
+		work = list;
+		while (work)
 			{
-			case PAN_ITEM_BOX:
-				queue = pan_item_box_draw(pw, pi, pixbuf, pr, x, y, width, height);
-				break;
-			case PAN_ITEM_TRIANGLE:
-				queue = pan_item_tri_draw(pw, pi, pixbuf, pr, x, y, width, height);
-				break;
-			case PAN_ITEM_TEXT:
-				queue = pan_item_text_draw(pw, pi, pixbuf, pr, x, y, width, height);
-				break;
-			case PAN_ITEM_THUMB:
-				queue = pan_item_thumb_draw(pw, pi, pixbuf, pr, x, y, width, height);
-				break;
-			case PAN_ITEM_IMAGE:
-				queue = pan_item_image_draw(pw, pi, pixbuf, pr, x, y, width, height);
-				break;
-			case PAN_ITEM_NONE:
-			default:
-				break;
+			PanItem *pi = work->data;
+			work = work->next;
+
+			if ((pi->type == PAN_ITEM_THUMB || pi->type == PAN_ITEM_IMAGE) && !pi->pixbuf)
+				{
+				pan_queue_add(pw, pi);
+				}
 			}
 
-		if (queue) pan_queue_add(pw, pi);
+		pan_lod_sync_idle(pw);
+		}
+
+	g_list_free(transient);
+	g_list_free(list);
+
+	return TRUE;
+}
+
+static gboolean pan_window_request_tile_cb(PixbufRenderer *pr, gint x, gint y,
+				       	   gint width, gint height, GdkPixbuf *pixbuf, gpointer data)
+{
+	PanWindow *pw = data;
+	GList *list;
+	GList *work;
+	gint level;
+
+	level = pan_lod_level(width, pixbuf);
+	if (level > 0) return pan_window_request_tile_lod(pw, pr, x, y, width, height, pixbuf, level);
+
+	pan_window_draw_background(pixbuf, x, y, width, height);
+
+	list = pan_layout_intersect(pw, x, y, width, height);
+	work = list;
+	while (work)
+		{
+		PanItem *pi;
+
+		pi = work->data;
+		work = work->next;
+
+		if (pi->refcount == 0) pan_pixbuf_cache_remove(pw, pi);
+		pi->refcount++;
+
+		if (pan_window_draw_item(pw, pi, pixbuf, pr, x, y, width, height)) pan_queue_add(pw, pi);
 		}
 
 	g_list_free(list);
@@ -358,17 +613,8 @@ static void pan_window_dispose_tile_cb(PixbufRenderer *pr, gint x, gint y,
 
 			if (pi->refcount == 0)
 				{
-				if (pi->queued)
-					{
-					pw->queue = g_list_remove(pw->queue, pi);
-					pi->queued = FALSE;
-					}
-				if (pw->queue_pi == pi) pw->queue_pi = NULL;
-				if (pi->pixbuf)
-					{
-					g_object_unref(pi->pixbuf);
-					pi->pixbuf = NULL;
-					}
+				pan_queue_remove(pw, pi);
+				pan_pixbuf_cache_add(pw, pi);
 				}
 			}
 		}
@@ -491,22 +737,25 @@ static void pan_window_zoom_limit(PanWindow *pw)
  *-----------------------------------------------------------------------------
  */
 
-static gint pan_cache_sort_file_cb(gpointer a, gpointer b)
-{
-	PanCacheData *pca = a;
-	PanCacheData *pcb = b;
-	return filelist_sort_compare_filedata(pca->fd, pcb->fd);
-}
-GList *pan_cache_sort(GList *list, SortType method, gboolean ascend)
-{
-	return filelist_sort_full(list, method, ascend, (GCompareFunc) pan_cache_sort_file_cb);
-}
-
-
 static void pan_cache_free(PanWindow *pw)
 {
 	GList *work;
 
+	if (pw->cache_pool)
+		{
+		/* drop the files not yet started and wait for the others */
+		g_thread_pool_free(pw->cache_pool, TRUE, TRUE);
+		pw->cache_pool = NULL;
+		}
+	if (pw->cache_done)
+		{
+		g_async_queue_unref(pw->cache_done);
+		pw->cache_done = NULL;
+		}
+
+	cache_loader_free(pw->cache_cl);
+	pw->cache_cl = NULL;
+
 	work = pw->cache_list;
 	while (work)
 		{
@@ -515,51 +764,172 @@ static void pan_cache_free(PanWindow *pw)
 		pc = work->data;
 		work = work->next;
 
-		cache_sim_data_free(pc->cd);
-		file_data_unref(pc->fd);
-		g_free(pc);
+		pan_cache_data_free(pc);
 		}
 
 	g_list_free(pw->cache_list);
 	pw->cache_list = NULL;
 
-	filelist_free(pw->cache_todo);
+	g_list_free(pw->cache_todo);
 	pw->cache_todo = NULL;
 
+	g_list_free(pw->cache_fallback);
+	pw->cache_fallback = NULL;
+
+	if (pw->cache_hash)
+		{
+		g_hash_table_destroy(pw->cache_hash);
+		pw->cache_hash = NULL;
+		}
+
 	pw->cache_count = 0;
 	pw->cache_total = 0;
-	pw->cache_tick = 0;
-
-	cache_loader_free(pw->cache_cl);
-	pw->cache_cl = NULL;
+	pw->cache_passes = 0;
 }
 
 static void pan_cache_fill(PanWindow *pw, FileData *dir_fd)
 {
 	GList *list;
+	GList *work;
+	GHashTable *pack = NULL;
+	gchar *pack_dir = NULL;
 
 	pan_cache_free(pw);
 
+	pw->cache_mask = CACHE_LOADER_NONE;
+	if (pw->size > PAN_IMAGE_SIZE_THUMB_LARGE) pw->cache_mask |= CACHE_LOADER_DIMENSIONS;
+	if (pw->exif_date_enable) pw->cache_mask |= CACHE_LOADER_DATE;
+
+	/* set up the cache locations before any worker looks for them */
+	get_thumbnails_cache_dir();
+
+	pw->cache_hash = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+	/* the files of a folder are next to each other in the tree list */
 	list = pan_list_tree(dir_fd, SORT_NAME, TRUE, pw->ignore_symlinks);
-	pw->cache_todo = g_list_reverse(list);
+	work = list;
+	while (work)
+		{
+		FileData *fd;
+		PanCacheData *pc;
+		gchar *dir;
+
+		fd = work->data;
+		work = work->next;
+
+		dir = remove_level_from_path(fd->path);
+		if (!pack_dir || strcmp(dir, pack_dir) != 0)
+			{
+			if (pack) g_hash_table_destroy(pack);
+			g_free(pack_dir);
+			pack_dir = dir;
+			pack = pan_cache_pack_load(pack_dir);
+			}
+		else
+			{
+			g_free(dir);
+			}
+
+		pc = g_new0(PanCacheData, 1);
+		pc->fd = fd;
+		pan_cache_pack_apply(pack, pc);
+		pan_cache_data_prepare(pc, pw->cache_mask);
 
-	pw->cache_total = g_list_length(pw->cache_todo);
+		pw->cache_list = g_list_prepend(pw->cache_list, pc);
+		g_hash_table_insert(pw->cache_hash, fd, pc);
+		}
+
+	if (pack) g_hash_table_destroy(pack);
+	g_free(pack_dir);
+
+	/* the references of the file list are now held by the cache data */
+	g_list_free(list);
+
+	pw->cache_list = g_list_reverse(pw->cache_list);
+	pw->cache_todo = g_list_copy(pw->cache_list);
+	pw->cache_total = g_list_length(pw->cache_list);
+	pw->cache_layout_time = g_get_monotonic_time();
 }
 
-static void pan_cache_step_done_cb(CacheLoader *cl, gint error, gpointer data)
+static void pan_cache_save(PanWindow *pw)
 {
-	PanWindow *pw = data;
+	GList *work;
+	GList *group = NULL;
+	gchar *group_dir = NULL;
+	gboolean changed = FALSE;
 
-	if (pw->cache_list)
+	if (!options->thumbnails.enable_caching) return;
+
+	work = pw->cache_list;
+	while (work || group)
 		{
-		PanCacheData *pc;
-		pc = pw->cache_list->data;
+		PanCacheData *pc = NULL;
+		gchar *dir = NULL;
 
-		if (!pc->cd)
+		if (work)
 			{
-			pc->cd = cl->cd;
-			cl->cd = NULL;
+			pc = work->data;
+			work = work->next;
+			dir = remove_level_from_path(pc->fd->path);
 			}
+
+		if (group && (!dir || strcmp(dir, group_dir) != 0))
+			{
+			if (changed) pan_cache_pack_save(group_dir, group);
+
+			g_list_free(group);
+			group = NULL;
+			g_free(group_dir);
+			group_dir = NULL;
+			changed = FALSE;
+			}
+
+		if (!pc) break;
+
+		if (!group_dir)
+			{
+			group_dir = dir;
+			}
+		else
+			{
+			g_free(dir);
+			}
+
+		group = g_list_prepend(group, pc);
+		if (pc->changed) changed = TRUE;
+		}
+
+	g_free(group_dir);
+}
+
+#ifdef HAVE_GTHREAD
+static void pan_cache_thread_run(gpointer data, gpointer user_data)
+{
+	PanCacheData *pc = data;
+	PanWindow *pw = user_data;
+
+	pan_cache_data_read(pc, pw->cache_mask);
+	g_async_queue_push(pw->cache_done, pc);
+}
+#endif
+
+static void pan_cache_data_done(PanWindow *pw, PanCacheData *pc)
+{
+	pan_cache_data_finish(pc, pw->cache_mask);
+	pc->done = TRUE;
+	if (pc->fallback) pw->cache_fallback = g_list_prepend(pw->cache_fallback, pc);
+	pw->cache_count++;
+}
+
+static void pan_cache_step_done_cb(CacheLoader *cl, gint error, gpointer data)
+{
+	PanWindow *pw = data;
+	PanCacheData *pc;
+
+	pc = g_hash_table_lookup(pw->cache_hash, cl->fd);
+	if (pc && pc->cd && cl->cd && cl->cd->dimensions)
+		{
+		cache_sim_data_set_dimensions(pc->cd, cl->cd->width, cl->cd->height);
 		}
 
 	cache_loader_free(cl);
@@ -568,75 +938,101 @@ static void pan_cache_step_done_cb(CacheLoader *cl, gint error, gpointer data)
 	pan_layout_update_idle(pw);
 }
 
+/* returns TRUE when all the image data is in */
 static gboolean pan_cache_step(PanWindow *pw)
 {
-	FileData *fd;
 	PanCacheData *pc;
-	CacheDataType load_mask;
 
-	if (!pw->cache_todo) return TRUE;
+#ifdef HAVE_GTHREAD
+	if (pw->cache_todo)
+		{
+		GList *work;
 
-	fd = pw->cache_todo->data;
-	pw->cache_todo = g_list_remove(pw->cache_todo, fd);
+		pw->cache_done = g_async_queue_new();
+		pw->cache_pool = g_thread_pool_new(pan_cache_thread_run, pw, PAN_CACHE_THREADS, FALSE, NULL);
 
-	pc = g_new0(PanCacheData, 1);
-	pc->fd = file_data_ref(fd);
+		work = pw->cache_todo;
+		while (work)
+			{
+			g_thread_pool_push(pw->cache_pool, work->data, NULL);
+			work = work->next;
+			}
 
-	pc->cd = NULL;
+		g_list_free(pw->cache_todo);
+		pw->cache_todo = NULL;
+		}
 
-	pw->cache_list = g_list_prepend(pw->cache_list, pc);
+	if (pw->cache_done)
+		{
+		while ((pc = g_async_queue_try_pop(pw->cache_done)))
+			{
+			pan_cache_data_done(pw, pc);
+			}
+		}
+#else
+	gint n = 0;
 
-	cache_loader_free(pw->cache_cl);
+	while (pw->cache_todo && n < PAN_CACHE_BATCH)
+		{
+		pc = pw->cache_todo->data;
+		pw->cache_todo = g_list_delete_link(pw->cache_todo, pw->cache_todo);
 
-	load_mask = CACHE_LOADER_NONE;
-	if (pw->size > PAN_IMAGE_SIZE_THUMB_LARGE) load_mask |= CACHE_LOADER_DIMENSIONS;
-	if (pw->exif_date_enable) load_mask |= CACHE_LOADER_DATE;
-	pw->cache_cl = cache_loader_new(pc->fd, load_mask,
-					pan_cache_step_done_cb, pw);
-	return (pw->cache_cl == NULL);
+		pan_cache_data_read(pc, pw->cache_mask);
+		pan_cache_data_done(pw, pc);
+		n++;
+		}
+#endif
+
+	if (pw->cache_count < pw->cache_total || pw->cache_cl) return FALSE;
+
+	/* formats without a header reader are decoded here, one at a time */
+	while (pw->cache_fallback)
+		{
+		pc = pw->cache_fallback->data;
+		pw->cache_fallback = g_list_delete_link(pw->cache_fallback, pw->cache_fallback);
+
+		pw->cache_cl = cache_loader_new(pc->fd, CACHE_LOADER_DIMENSIONS,
+						pan_cache_step_done_cb, pw);
+		if (pw->cache_cl) return FALSE;
+		}
+
+	return TRUE;
 }
 
-/* This sync date function is optimized for lists with a common sort */
 void pan_cache_sync_date(PanWindow *pw, GList *list)
 {
-	GList *haystack;
 	GList *work;
 
-	haystack = g_list_copy(pw->cache_list);
+	if (!pw->cache_hash) return;
 
 	work = list;
 	while (work)
 		{
 		FileData *fd;
-		GList *needle;
+		PanCacheData *pc;
 
 		fd = work->data;
 		work = work->next;
 
-		needle = haystack;
-		while (needle)
+		pc = g_hash_table_lookup(pw->cache_hash, fd);
+		if (pc && pc->done && pc->cd && pc->cd->have_date && pc->cd->date >= 0)
 			{
-			PanCacheData *pc;
-
-			pc = needle->data;
-			if (pc->fd == fd)
-				{
-				if (pc->cd && pc->cd->have_date && pc->cd->date >= 0)
-					{
-					fd->date = pc->cd->date;
-					}
-
-				haystack = g_list_delete_link(haystack, needle);
-				needle = NULL;
-				}
-			else
-				{
-				needle = needle->next;
-				}
+			fd->date = pc->cd->date;
 			}
 		}
+}
 
-	g_list_free(haystack);
+/* returns the cache data of fd, once it has been read */
+PanCacheData *pan_cache_find(PanWindow *pw, FileData *fd)
+{
+	PanCacheData *pc;
+
+	if (!pw->cache_hash || !fd) return NULL;
+
+	pc = g_hash_table_lookup(pw->cache_hash, fd);
+	if (!pc || !pc->done) return NULL;
+
+	return pc;
 }
 
 /*
@@ -647,34 +1043,52 @@ void pan_cache_sync_date(PanWindow *pw, GList *list)
 
 static void pan_grid_clear(PanWindow *pw)
 {
-	GList *work;
+	PanGrid *pg;
+	gint i;
 
-	work = pw->list_grid;
-	while (work)
+	pg = pw->grid;
+	if (pg)
 		{
-		PanGrid *pg;
-
-		pg = work->data;
-		work = work->next;
-
-		g_list_free(pg->list);
+		for (i = 0; i < pg->cols * pg->rows; i++)
+			{
+			g_list_free(pg->cells[i]);
+			}
+		g_free(pg->cells);
 		g_free(pg);
+		pw->grid = NULL;
 		}
 
-	g_list_free(pw->list_grid);
-	pw->list_grid = NULL;
-
 	pw->list = g_list_concat(pw->list, pw->list_static);
 	pw->list_static = NULL;
 }
 
+/* returns the range of cells covered by the region, FALSE if it is outside the grid */
+static gboolean pan_grid_cell_range(PanGrid *pg, gint x, gint y, gint width, gint height,
+				    gint *col1, gint *row1, gint *col2, gint *row2)
+{
+	width = MAX(width, 1);
+	height = MAX(height, 1);
+
+	if (x + width <= 0 || y + height <= 0) return FALSE;
+
+	*col1 = MAX(x, 0) / pg->cell_w;
+	*row1 = MAX(y, 0) / pg->cell_h;
+	if (*col1 >= pg->cols || *row1 >= pg->rows) return FALSE;
+
+	*col2 = MIN((x + width - 1) / pg->cell_w, pg->cols - 1);
+	*row2 = MIN((y + height - 1) / pg->cell_h, pg->rows - 1);
+
+	return TRUE;
+}
+
 static void pan_grid_build(PanWindow *pw, gint width, gint height, gint grid_size)
 {
+	PanGrid *pg;
 	GList *work;
-	gint col, row;
-	gint cw, ch;
+	gint cell;
+	gint order;
 	gint l;
-	gint i, j;
+	gint i;
 
 	pan_grid_clear(pw);
 
@@ -682,77 +1096,55 @@ static void pan_grid_build(PanWindow *pw, gint width, gint height, gint grid_siz
 
 	if (l < 1) return;
 
-	col = (gint)(sqrt((gdouble)l / grid_size) * width / height + 0.999);
-	col = CLAMP(col, 1, l / grid_size + 1);
-	row = (gint)((gdouble)l / grid_size / col);
-	if (row < 1) row = 1;
-
-	/* limit minimum size of grid so that a tile will always fit regardless of position */
-	cw = MAX((gint)ceil((gdouble)width / col), PAN_TILE_SIZE * 2);
-	ch = MAX((gint)ceil((gdouble)height / row), PAN_TILE_SIZE * 2);
-
-	row = row * 2 - 1;
-	col = col * 2 - 1;
-
-	DEBUG_1("intersect speedup grid is %dx%d, based on %d average per grid", col, row, grid_size);
-
-	for (j = 0; j < row; j++)
-	    for (i = 0; i < col; i++)
-		{
-		if ((i + 1) * cw / 2 < width && (j + 1) * ch / 2 < height)
-			{
-			PanGrid *pg;
-
-			pg = g_new0(PanGrid, 1);
-			pg->x = i * cw / 2;
-			pg->y = j * ch / 2;
-			pg->w = cw;
-			pg->h = ch;
-
-			pw->list_grid = g_list_prepend(pw->list_grid, pg);
-
-			DEBUG_1("grid section: %d,%d (%dx%d)", pg->x, pg->y, pg->w, pg->h);
-			}
-		}
-
+	/* uniform grid of square cells, sized to hold about grid_size items each,
+	 * an item is referenced by every cell it overlaps
+	 */
+	cell = (gint)ceil(sqrt((gdouble)width * height * grid_size / l));
+	cell = MAX(cell, PAN_TILE_SIZE / 4);
+
+	pg = g_new0(PanGrid, 1);
+	pg->cell_w = cell;
+	pg->cell_h = cell;
+	pg->cols = MAX((width + cell - 1) / cell, 1);
+	pg->rows = MAX((height + cell - 1) / cell, 1);
+	pg->cells = g_new0(GList *, pg->cols * pg->rows);
+	pg->stamp = 0;
+
+	DEBUG_1("intersect speedup grid is %dx%d, cell size %d, based on %d average per cell",
+		pg->cols, pg->rows, cell, grid_size);
+
+	/* pw->list is newest first, the order is used to draw oldest first */
+	order = l;
 	work = pw->list;
 	while (work)
 		{
 		PanItem *pi;
-		GList *grid;
+		gint col1, row1, col2, row2;
+		gint col, row;
 
 		pi = work->data;
 		work = work->next;
 
-		grid = pw->list_grid;
-		while (grid)
-			{
-			PanGrid *pg;
-			gint rx, ry, rw, rh;
+		pi->grid_order = --order;
+		pi->grid_stamp = 0;
 
-			pg = grid->data;
-			grid = grid->next;
+		if (!pan_grid_cell_range(pg, pi->x, pi->y, pi->width, pi->height,
+					 &col1, &row1, &col2, &row2)) continue;
 
-			if (util_clip_region(pi->x, pi->y, pi->width, pi->height,
-					     pg->x, pg->y, pg->w, pg->h,
-					     &rx, &ry, &rw, &rh))
+		for (row = row1; row <= row2; row++)
+			for (col = col1; col <= col2; col++)
 				{
-				pg->list = g_list_prepend(pg->list, pi);
+				pg->cells[row * pg->cols + col] = g_list_prepend(pg->cells[row * pg->cols + col], pi);
 				}
-			}
 		}
 
-	work = pw->list_grid;
-	while (work)
+	for (i = 0; i < pg->cols * pg->rows; i++)
 		{
-		PanGrid *pg;
-
-		pg = work->data;
-		work = work->next;
-
-		pg->list = g_list_reverse(pg->list);
+		pg->cells[i] = g_list_reverse(pg->cells[i]);
 		}
 
+	pw->grid = pg;
+
 	pw->list_static = pw->list;
 	pw->list = NULL;
 }
@@ -768,6 +1160,8 @@ static void pan_window_items_free(PanWindow *pw)
 {
 	GList *work;
 
+	pan_lod_free(pw);
+	pan_queue_clear(pw);
 	pan_grid_clear(pw);
 
 	work = pw->list;
@@ -782,16 +1176,6 @@ static void pan_window_items_free(PanWindow *pw)
 	g_list_free(pw->list);
 	pw->list = NULL;
 
-	g_list_free(pw->queue);
-	pw->queue = NULL;
-	pw->queue_pi = NULL;
-
-	image_loader_free(pw->il);
-	pw->il = NULL;
-
-	thumb_loader_free(pw->tl);
-	pw->tl = NULL;
-
 	pw->click_pi = NULL;
 	pw->search_pi = NULL;
 }
@@ -879,8 +1263,6 @@ static void pan_layout_compute(PanWindow *pw, FileData *dir_fd,
 			break;
 		}
 
-	pan_cache_free(pw);
-
 	DEBUG_1("computed %d objects", g_list_length(pw->list));
 }
 
@@ -909,37 +1291,77 @@ static GList *pan_layout_intersect_l(GList *list, GList *item_list,
 	return list;
 }
 
+static gint pan_layout_intersect_sort_cb(gconstpointer a, gconstpointer b)
+{
+	const PanItem *pia = a;
+	const PanItem *pib = b;
+
+	return pia->grid_order - pib->grid_order;
+}
+
 GList *pan_layout_intersect(PanWindow *pw, gint x, gint y, gint width, gint height)
 {
 	GList *list = NULL;
-	GList *grid;
-	PanGrid *pg = NULL;
+	GList *found = NULL;
+	PanGrid *pg;
+	gint col1, row1, col2, row2;
+	gint col, row;
 
-	grid = pw->list_grid;
-	while (grid && !pg)
+	list = pan_layout_intersect_l(list, pw->list, x, y, width, height);
+
+	pg = pw->grid;
+	if (!pg)
 		{
-		pg = grid->data;
-		grid = grid->next;
+		return pan_layout_intersect_l(list, pw->list_static, x, y, width, height);
+		}
+
+	if (!pan_grid_cell_range(pg, x, y, width, height, &col1, &row1, &col2, &row2)) return list;
 
-		if (x < pg->x || x + width > pg->x + pg->w ||
-		    y < pg->y || y + height > pg->y + pg->h)
+	/* items spanning several cells are reported once, tagged with the query stamp */
+	pg->stamp++;
+
+	for (row = row1; row <= row2; row++)
+		for (col = col1; col <= col2; col++)
 			{
-			pg = NULL;
+			GList *work;
+
+			work = pg->cells[row * pg->cols + col];
+			while (work)
+				{
+				PanItem *pi;
+				gint rx, ry, rw, rh;
+
+				pi = work->data;
+				work = work->next;
+
+				if (pi->grid_stamp == pg->stamp) continue;
+				pi->grid_stamp = pg->stamp;
+
+				if (util_clip_region(x, y, width, height,
+						     pi->x, pi->y, pi->width, pi->height,
+						     &rx, &ry, &rw, &rh))
+					{
+					found = g_list_prepend(found, pi);
+					}
+				}
 			}
-		}
 
-	list = pan_layout_intersect_l(list, pw->list, x, y, width, height);
+	found = g_list_sort(found, pan_layout_intersect_sort_cb);
 
-	if (pg)
-		{
-		list = pan_layout_intersect_l(list, pg->list, x, y, width, height);
-		}
-	else
-		{
-		list = pan_layout_intersect_l(list, pw->list_static, x, y, width, height);
-		}
+	return g_list_concat(found, list);
+}
 
-	return list;
+GList *pan_layout_cell_list(PanWindow *pw, gint x, gint y)
+{
+	PanGrid *pg;
+	gint col1, row1, col2, row2;
+
+	pg = pw->grid;
+	if (!pg) return pw->list_static;
+
+	if (!pan_grid_cell_range(pg, x, y, 1, 1, &col1, &row1, &col2, &row2)) return NULL;
+
+	return pg->cells[row1 * pg->cols + col1];
 }
 
 void pan_layout_resize(PanWindow *pw)
@@ -982,6 +1404,26 @@ void pan_layout_resize(PanWindow *pw)
 	pixbuf_renderer_set_tiles_size(PIXBUF_RENDERER(pw->imd->pr), width, height);
 }
 
+/* keeps the layout update going while the image data is read */
+static gboolean pan_layout_update_continue(PanWindow *pw)
+{
+	if (pw->cache_cl)
+		{
+		/* restarted by the done callback of the cache loader */
+		pw->idle_id = 0;
+		return FALSE;
+		}
+
+	if (pw->cache_pool && pw->cache_count < pw->cache_total)
+		{
+		/* the workers do the reading, just poll for their results */
+		pw->idle_id = g_timeout_add(PAN_CACHE_POLL_INTERVAL, pan_layout_update_idle_cb, pw);
+		return FALSE;
+		}
+
+	return TRUE;
+}
+
 static gint pan_layout_update_idle_cb(gpointer data)
 {
 	PanWindow *pw = data;
@@ -989,43 +1431,31 @@ static gint pan_layout_update_idle_cb(gpointer data)
 	gint height;
 	gint scroll_x;
 	gint scroll_y;
+	gboolean loading = FALSE;
 
 	if (pw->size > PAN_IMAGE_SIZE_THUMB_LARGE ||
 	    (pw->exif_date_enable && (pw->layout == PAN_LAYOUT_TIMELINE || pw->layout == PAN_LAYOUT_CALENDAR)))
 		{
-		if (!pw->cache_list && !pw->cache_todo)
+		if (!pw->cache_hash)
 			{
 			pan_cache_fill(pw, pw->dir_fd);
-			if (pw->cache_todo)
-				{
-				pan_window_message(pw, _("Reading image data..."));
-				return TRUE;
-				}
 			}
-		if (pw->cache_todo)
+
+		if (!pan_cache_step(pw))
 			{
-			pw->cache_count++;
-			pw->cache_tick++;
-			if (pw->cache_count == pw->cache_total)
-				{
-				pan_window_message(pw, _("Sorting..."));
-				}
-			else if (pw->cache_tick > 9)
-				{
-				gchar *buf;
+			gchar *buf;
 
-				buf = g_strdup_printf("%s %d / %d", _("Reading image data..."),
-						      pw->cache_count, pw->cache_total);
-				pan_window_message(pw, buf);
-				g_free(buf);
+			buf = g_strdup_printf("%s %d / %d", _("Reading image data..."),
+					      pw->cache_count, pw->cache_total);
+			pan_window_message(pw, buf);
+			g_free(buf);
 
-				pw->cache_tick = 0;
+			/* lay out what is known so far every now and then */
+			if (g_get_monotonic_time() - pw->cache_layout_time < PAN_CACHE_RELAYOUT_INTERVAL)
+				{
+				return pan_layout_update_continue(pw);
 				}
-
-			if (pan_cache_step(pw)) return TRUE;
-
-			pw->idle_id = 0;
-			return FALSE;
+			loading = TRUE;
 			}
 		}
 
@@ -1035,28 +1465,59 @@ static gint pan_layout_update_idle_cb(gpointer data)
 
 	if (width > 0 && height > 0)
 		{
+		PixbufRenderer *pr = PIXBUF_RENDERER(pw->imd->pr);
 		gdouble align;
 
 		DEBUG_1("Canvas size is %d x %d", width, height);
 
-		pan_grid_build(pw, width, height, 1000);
+		pan_grid_build(pw, width, height, 16);
+		pan_lod_init(pw);
 
-		pixbuf_renderer_set_tiles(PIXBUF_RENDERER(pw->imd->pr), width, height,
-					  PAN_TILE_SIZE, PAN_TILE_SIZE, 10,
-					  pan_window_request_tile_cb,
-					  pan_window_dispose_tile_cb, pw, 1.0);
+		pixbuf_renderer_set_tiles_levels(pr, PAN_LOD_LEVELS);
 
-		if (scroll_x == 0 && scroll_y == 0)
+		if (pw->cache_passes > 0)
 			{
-			align = 0.0;
+			gdouble zoom;
+			gdouble x, y;
+
+			/* a refined layout of the same images, keep the view */
+			zoom = pixbuf_renderer_zoom_get(pr);
+			pixbuf_renderer_get_scroll_center(pr, &x, &y);
+			pixbuf_renderer_set_tiles(pr, width, height,
+						  PAN_TILE_SIZE, PAN_TILE_SIZE, 10,
+						  pan_window_request_tile_cb,
+						  pan_window_dispose_tile_cb, pw, zoom);
+			pixbuf_renderer_set_scroll_center(pr, x, y);
 			}
 		else
 			{
-			align = 0.5;
+			pixbuf_renderer_set_tiles(pr, width, height,
+						  PAN_TILE_SIZE, PAN_TILE_SIZE, 10,
+						  pan_window_request_tile_cb,
+						  pan_window_dispose_tile_cb, pw, 1.0);
+
+			if (scroll_x == 0 && scroll_y == 0)
+				{
+				align = 0.0;
+				}
+			else
+				{
+				align = 0.5;
+				}
+			pixbuf_renderer_scroll_to_point(pr, scroll_x, scroll_y, align, align);
 			}
-		pixbuf_renderer_scroll_to_point(PIXBUF_RENDERER(pw->imd->pr), scroll_x, scroll_y, align, align);
 		}
 
+	if (loading)
+		{
+		pw->cache_passes++;
+		pw->cache_layout_time = g_get_monotonic_time();
+		return pan_layout_update_continue(pw);
+		}
+
+	pan_cache_save(pw);
+	pan_cache_free(pw);
+
 	pan_window_message(pw, NULL);
 
 	pw->idle_id = 0;
@@ -1090,6 +1551,7 @@ static void pan_layout_set_fd(PanWindow *pw, FileData *dir_fd)
 	file_data_unref(pw->dir_fd);
 	pw->dir_fd = file_data_ref(dir_fd);
 
+	pan_cache_free(pw);
 	pan_layout_update(pw);
 }
 
@@ -1743,6 +2205,7 @@ static void pan_window_close(PanWindow *pw)
 
 	pan_window_items_free(pw);
 	pan_cache_free(pw);
+	g_queue_free(pw->pixbuf_cache);
 
 	file_data_unref(pw->dir_fd);
 
@@ -1767,6 +2230,7 @@ static void pan_window_new_real(FileData *dir_fd)
 	GtkWidget *frame;
 	GtkWidget *table;
 	GdkGeometry geometry;
+	gint i;
 
 	pw = g_new0(PanWindow, 1);
 
@@ -1793,6 +2257,12 @@ static void pan_window_new_real(FileData *dir_fd)
 
 	pw->idle_id = 0;
 
+	for (i = 0; i < PAN_QUEUE_LOADERS; i++)
+		{
+		pw->loaders[i].pw = pw;
+		}
+	pw->pixbuf_cache = g_queue_new();
+
 	pw->window = window_new(GTK_WINDOW_TOPLEVEL, "panview", NULL, NULL, _("Pan View"));
 
 	geometry.min_width = DEFAULT_MINIMAL_WINDOW_SIZE;
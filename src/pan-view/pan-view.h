@@ -27,11 +27,13 @@
 
 void pan_layout_update(PanWindow *pw);
 GList *pan_layout_intersect(PanWindow *pw, gint x, gint y, gint width, gint height);
+GList *pan_layout_cell_list(PanWindow *pw, gint x, gint y);
+
+void pan_queue_remove(PanWindow *pw, PanItem *pi);
 void pan_layout_resize(PanWindow *pw);
 
 void pan_cache_sync_date(PanWindow *pw, GList *list);
-
-GList *pan_cache_sort(GList *list, SortType method, gboolean ascend);
+PanCacheData *pan_cache_find(PanWindow *pw, FileData *fd);
 
 void pan_info_update(PanWindow *pw, PanItem *pi);
 
@@ -0,0 +1,280 @@
+/*
+ * Copyright (C) 2008 - 2016 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "main.h"
+#include "perf.h"
+
+/*
+ *-----------------------------------------------------------------------------
+ * performance counters
+ *-----------------------------------------------------------------------------
+ */
+
+/* Each thread updates its own counters without locking, the threads are only
+ * locked to register a new thread. The report reads the counters of running
+ * threads without synchronization, a value being updated at the same time
+ * can be off by one event, which is fine for a diagnostic.
+ * The counters of a thread that exits are added to perf_retired, pool threads
+ * come and go and would otherwise leave an entry each.
+ *
+ * The report has no empty line, the remote protocol ends an answer there.
+ */
+
+#ifdef PERF_COUNTERS
+
+typedef struct _PerfCounterData PerfCounterData;
+struct _PerfCounterData {
+	gint64 count;
+	gint64 usec;
+	gint64 max_usec;
+};
+
+typedef struct _PerfThread PerfThread;
+struct _PerfThread {
+	gint id;
+	gboolean main_thread;
+	PerfCounterData counters[PERF_COUNTER_COUNT];
+};
+
+static const gchar *perf_counter_names[PERF_COUNTER_COUNT] = {
+	"image decode",
+	"file cache hit",
+	"file cache miss",
+	"thumbnail",
+	"tile render",
+	"exif read"
+};
+
+G_LOCK_DEFINE_STATIC(perf_threads);
+static GList *perf_threads = NULL; /* PerfThread of the running threads */
+static PerfCounterData perf_retired[PERF_COUNTER_COUNT]; /* of the threads that exited */
+static gint perf_thread_next_id = 0;
+static GThread *perf_main_thread = NULL;
+
+static void perf_thread_retire(gpointer data);
+
+#if GLIB_CHECK_VERSION(2,32,0)
+static GPrivate perf_thread_key = G_PRIVATE_INIT(perf_thread_retire);
+#define PERF_THREAD_KEY (&perf_thread_key)
+#else
+static GPrivate *perf_thread_key = NULL;
+#define PERF_THREAD_KEY (perf_thread_key)
+#endif
+
+/* in the main thread, after the thread system is initialized */
+void perf_init(void)
+{
+	perf_main_thread = g_thread_self();
+#if !GLIB_CHECK_VERSION(2,32,0)
+	if (!perf_thread_key) perf_thread_key = g_private_new(perf_thread_retire);
+#endif
+}
+
+static void perf_counter_add(PerfCounterData *total, PerfCounterData *data)
+{
+	total->count += data->count;
+	total->usec += data->usec;
+	total->max_usec = MAX(total->max_usec, data->max_usec);
+}
+
+/* called by glib when a thread with counters exits */
+static void perf_thread_retire(gpointer data)
+{
+	PerfThread *pt = data;
+	gint i;
+
+	G_LOCK(perf_threads);
+	for (i = 0; i < PERF_COUNTER_COUNT; i++)
+		{
+		perf_counter_add(&perf_retired[i], &pt->counters[i]);
+		}
+	perf_threads = g_list_remove(perf_threads, pt);
+	G_UNLOCK(perf_threads);
+
+	g_free(pt);
+}
+
+static PerfThread *perf_thread_get(void)
+{
+	PerfThread *pt = g_private_get(PERF_THREAD_KEY);
+
+	if (pt) return pt;
+
+	pt = g_new0(PerfThread, 1);
+	pt->main_thread = (g_thread_self() == perf_main_thread);
+
+	G_LOCK(perf_threads);
+	pt->id = perf_thread_next_id++;
+	perf_threads = g_list_append(perf_threads, pt);
+	G_UNLOCK(perf_threads);
+
+	g_private_set(PERF_THREAD_KEY, pt);
+	return pt;
+}
+
+gint64 perf_now(void)
+{
+#if GLIB_CHECK_VERSION(2,28,0)
+	return g_get_monotonic_time();
+#else
+	GTimeVal tv;
+
+	g_get_current_time(&tv);
+	return (gint64)tv.tv_sec * G_USEC_PER_SEC + tv.tv_usec;
+#endif
+}
+
+/* counts one event, usec is 0 for events without duration */
+void perf_add(PerfCounter counter, gint64 usec)
+{
+	PerfCounterData *data;
+
+	if (!perf_main_thread) return;
+
+	data = &perf_thread_get()->counters[counter];
+	data->count++;
+	data->usec += usec;
+	if (usec > data->max_usec) data->max_usec = usec;
+}
+
+void perf_reset(void)
+{
+	GList *work;
+
+	G_LOCK(perf_threads);
+	for (work = perf_threads; work; work = work->next)
+		{
+		PerfThread *pt = work->data;
+
+		memset(pt->counters, 0, sizeof(pt->counters));
+		}
+	memset(perf_retired, 0, sizeof(perf_retired));
+	G_UNLOCK(perf_threads);
+}
+
+static void perf_report_line(GString *report, const gchar *name, PerfCounterData *data)
+{
+	g_string_append_printf(report, "%-20s %10" G_GINT64_FORMAT, name, data->count);
+
+	if (data->usec > 0)
+		{
+		g_string_append_printf(report, " %12.3f %10.3f %10.3f", data->usec / 1000.0,
+				       data->usec / 1000.0 / data->count, data->max_usec / 1000.0);
+		}
+
+	g_string_append(report, "\n");
+}
+
+gchar *perf_report(void)
+{
+	GString *report;
+	GList *work;
+	gboolean header;
+	gint i;
+
+	report = g_string_new(NULL);
+	g_string_append_printf(report, "%-20s %10s %12s %10s %10s\n", "counter", "count", "total ms", "avg ms", "max ms");
+
+	G_LOCK(perf_threads);
+	for (i = 0; i < PERF_COUNTER_COUNT; i++)
+		{
+		PerfCounterData total = perf_retired[i];
+
+		for (work = perf_threads; work; work = work->next)
+			{
+			PerfThread *pt = work->data;
+
+			perf_counter_add(&total, &pt->counters[i]);
+			}
+		perf_report_line(report, perf_counter_names[i], &total);
+		}
+
+	for (work = perf_threads; work; work = work->next)
+		{
+		PerfThread *pt = work->data;
+
+		header = FALSE;
+		for (i = 0; i < PERF_COUNTER_COUNT; i++)
+			{
+			gchar *name;
+
+			if (!pt->counters[i].count) continue;
+
+			if (!header)
+				{
+				if (pt->main_thread)
+					g_string_append(report, "main thread\n");
+				else
+					g_string_append_printf(report, "thread %d\n", pt->id);
+				header = TRUE;
+				}
+
+			name = g_strconcat("  ", perf_counter_names[i], NULL);
+			perf_report_line(report, name, &pt->counters[i]);
+			g_free(name);
+			}
+		}
+
+	header = FALSE;
+	for (i = 0; i < PERF_COUNTER_COUNT; i++)
+		{
+		gchar *name;
+
+		if (!perf_retired[i].count) continue;
+
+		if (!header)
+			{
+			g_string_append(report, "exited threads\n");
+			header = TRUE;
+			}
+
+		name = g_strconcat("  ", perf_counter_names[i], NULL);
+		perf_report_line(report, name, &perf_retired[i]);
+		g_free(name);
+		}
+	G_UNLOCK(perf_threads);
+
+	return g_string_free(report, FALSE);
+}
+
+#else /* PERF_COUNTERS */
+
+void perf_init(void)
+{
+}
+
+gint64 perf_now(void)
+{
+	return 0;
+}
+
+void perf_add(PerfCounter counter, gint64 usec)
+{
+}
+
+void perf_reset(void)
+{
+}
+
+gchar *perf_report(void)
+{
+	return g_strdup("performance counters are disabled in this build (configure --enable-perf-counters)\n");
+}
+
+#endif /* PERF_COUNTERS */
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
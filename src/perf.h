@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2008 - 2016 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef PERF_H
+#define PERF_H
+
+/*
+ * Counters and timers of the hot paths, aggregated per thread.
+ * Without PERF_COUNTERS (configure --disable-perf-counters) the macros
+ * compile to nothing and perf_report() only says so.
+ */
+
+typedef enum {
+	PERF_IMAGE_DECODE,	/* image loader, from start to the last byte */
+	PERF_FILE_CACHE_HIT,
+	PERF_FILE_CACHE_MISS,
+	PERF_THUMBNAIL,		/* standard thumbnail loader, from start to done */
+	PERF_TILE_RENDER,
+	PERF_EXIF_READ,
+	PERF_COUNTER_COUNT
+} PerfCounter;
+
+void perf_init(void);
+gint64 perf_now(void);
+void perf_add(PerfCounter counter, gint64 usec);
+void perf_reset(void);
+gchar *perf_report(void);
+
+#ifdef PERF_COUNTERS
+
+#define PERF_TIMER_DECLARE(timer) gint64 timer
+#define PERF_TIMER_START(timer) ((timer) = perf_now())
+#define PERF_TIMER_STOP(timer, counter) perf_add((counter), perf_now() - (timer))
+#define PERF_COUNT(counter) perf_add((counter), 0)
+
+#else /* PERF_COUNTERS */
+
+#define PERF_TIMER_DECLARE(timer) G_GNUC_UNUSED gint timer
+#define PERF_TIMER_START(timer) do { } while(0)
+#define PERF_TIMER_STOP(timer, counter) do { } while(0)
+#define PERF_COUNT(counter) do { } while(0)
+
+#endif /* PERF_COUNTERS */
+
+#endif /* PERF_H */
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -134,6 +134,8 @@ static void pr_scroller_timer_set(PixbufRenderer *pr, gboolean start);
 
 
 static void pr_source_tile_free_all(PixbufRenderer *pr);
+static guint pr_source_tile_hash(gconstpointer key);
+static gboolean pr_source_tile_equal(gconstpointer a, gconstpointer b);
 
 static void pr_zoom_sync(PixbufRenderer *pr, gdouble zoom,
 			 PrZoomFlags flags, gint px, gint py);
@@ -437,7 +439,16 @@ static void pixbuf_renderer_init(PixbufRenderer *pr)
 	pr->y_mouse = -1;
 
 	pr->source_tiles_enabled = FALSE;
-	pr->source_tiles = NULL;
+	g_queue_init(&pr->source_tiles);
+	pr->source_tiles_hash = g_hash_table_new(pr_source_tile_hash, pr_source_tile_equal);
+
+#ifdef HAVE_GTHREAD
+#if GLIB_CHECK_VERSION(2,32,0)
+	g_rw_lock_init(&pr->post_process_lock);
+#else
+	g_static_rw_lock_init(&pr->post_process_lock);
+#endif
+#endif
 
 	pr->orientation = 1;
 
@@ -477,6 +488,16 @@ static void pixbuf_renderer_finalize(GObject *object)
 	pr_scroller_timer_set(pr, FALSE);
 
 	pr_source_tile_free_all(pr);
+	g_hash_table_destroy(pr->source_tiles_hash);
+	pr->source_tiles_hash = NULL;
+
+#ifdef HAVE_GTHREAD
+#if GLIB_CHECK_VERSION(2,32,0)
+	g_rw_lock_clear(&pr->post_process_lock);
+#else
+	g_static_rw_lock_free(&pr->post_process_lock);
+#endif
+#endif
 }
 
 PixbufRenderer *pixbuf_renderer_new(void)
@@ -945,6 +966,25 @@ void pixbuf_renderer_set_color(PixbufRenderer *pr, GdkColor *color)
  *-------------------------------------------------------------------
  */
 
+/* source tiles are kept in pr->source_tiles, most recently used first,
+ * and indexed by position and level in pr->source_tiles_hash
+ */
+
+static guint pr_source_tile_hash(gconstpointer key)
+{
+	const SourceTile *st = key;
+
+	return ((guint)st->x * 2654435761u) ^ ((guint)st->y * 40503u) ^ (guint)st->level;
+}
+
+static gboolean pr_source_tile_equal(gconstpointer a, gconstpointer b)
+{
+	const SourceTile *sa = a;
+	const SourceTile *sb = b;
+
+	return (sa->x == sb->x && sa->y == sb->y && sa->level == sb->level);
+}
+
 static void pr_source_tile_free(SourceTile *st)
 {
 	if (!st) return;
@@ -957,7 +997,9 @@ static void pr_source_tile_free_all(PixbufRenderer *pr)
 {
 	GList *work;
 
-	work = pr->source_tiles;
+	if (pr->source_tiles_hash) g_hash_table_remove_all(pr->source_tiles_hash);
+
+	work = pr->source_tiles.head;
 	while (work)
 		{
 		SourceTile *st;
@@ -968,8 +1010,7 @@ static void pr_source_tile_free_all(PixbufRenderer *pr)
 		pr_source_tile_free(st);
 		}
 
-	g_list_free(pr->source_tiles);
-	pr->source_tiles = NULL;
+	g_queue_clear(&pr->source_tiles);
 }
 
 static void pr_source_tile_unset(PixbufRenderer *pr)
@@ -978,12 +1019,38 @@ static void pr_source_tile_unset(PixbufRenderer *pr)
 	pr->source_tiles_enabled = FALSE;
 }
 
-static gboolean pr_source_tile_visible(PixbufRenderer *pr, SourceTile *st)
+static void pr_source_tile_take(PixbufRenderer *pr, PixbufRenderer *source)
+{
+	GHashTable *hash;
+
+	pr_source_tile_free_all(pr);
+
+	hash = pr->source_tiles_hash;
+	pr->source_tiles_hash = source->source_tiles_hash;
+	source->source_tiles_hash = hash;
+
+	pr->source_tiles = source->source_tiles;
+	g_queue_init(&source->source_tiles);
+}
+
+static gint pr_source_tile_level(PixbufRenderer *pr)
+{
+	gint level = 0;
+
+	while (level < pr->source_tiles_max_level && pr->scale * (1 << (level + 1)) <= 1.0) level++;
+
+	return level;
+}
+
+static gboolean pr_source_tile_visible(PixbufRenderer *pr, SourceTile *st, gint level)
 {
 	gint x1, y1, x2, y2;
 
 	if (!st) return FALSE;
 
+	/* tiles of another resolution level are never used at the current zoom */
+	if (st->level != level) return FALSE;
+
 //	x1 = ROUND_DOWN(pr->x_scroll, pr->tile_width);
 //	y1 = ROUND_DOWN(pr->y_scroll, pr->tile_height);
 //	x2 = ROUND_UP(pr->x_scroll + pr->vis_width, pr->tile_width);
@@ -994,55 +1061,60 @@ static gboolean pr_source_tile_visible(PixbufRenderer *pr, SourceTile *st)
 	y2 = pr->y_scroll + pr->vis_height;
 
 	return !((gdouble)st->x * pr->scale > (gdouble)x2 ||
-		 (gdouble)(st->x + pr->source_tile_width) * pr->scale < (gdouble)x1 ||
+		 (gdouble)(st->x + (pr->source_tile_width << st->level)) * pr->scale < (gdouble)x1 ||
 		 (gdouble)st->y * pr->scale > (gdouble)y2 ||
-		 (gdouble)(st->y + pr->source_tile_height) * pr->scale < (gdouble)y1);
+		 (gdouble)(st->y + (pr->source_tile_height << st->level)) * pr->scale < (gdouble)y1);
 }
 
 static SourceTile *pr_source_tile_new(PixbufRenderer *pr, gint x, gint y)
 {
 	SourceTile *st = NULL;
-	gint count;
+	gint level;
+	guint checked = 0;
 
 	g_return_val_if_fail(pr->source_tile_width >= 1 && pr->source_tile_height >= 1, NULL);
 
 	if (pr->source_tiles_cache_size < 4) pr->source_tiles_cache_size = 4;
 
-	count = g_list_length(pr->source_tiles);
-	if (count >= pr->source_tiles_cache_size)
-		{
-		GList *work;
+	level = pr_source_tile_level(pr);
 
-		work = g_list_last(pr->source_tiles);
-		while (work && count >= pr->source_tiles_cache_size)
-			{
-			SourceTile *needle;
+	/* evict from the least recently used end; visible tiles are still in use,
+	 * so they go back to the front and each tile is looked at only once
+	 */
+	while (pr->source_tiles.length >= (guint)pr->source_tiles_cache_size &&
+	       checked < pr->source_tiles.length)
+		{
+		GList *link;
+		SourceTile *needle;
 
-			needle = work->data;
-			work = work->prev;
+		link = g_queue_pop_tail_link(&pr->source_tiles);
+		needle = link->data;
+		checked++;
 
-			if (!pr_source_tile_visible(pr, needle))
-				{
-				pr->source_tiles = g_list_remove(pr->source_tiles, needle);
+		if (pr_source_tile_visible(pr, needle, level))
+			{
+			g_queue_push_head_link(&pr->source_tiles, link);
+			continue;
+			}
 
-				if (pr->func_tile_dispose)
-					{
-					pr->func_tile_dispose(pr, needle->x, needle->y,
-							      pr->source_tile_width, pr->source_tile_height,
-							      needle->pixbuf, pr->func_tile_data);
-					}
+		g_list_free_1(link);
+		g_hash_table_remove(pr->source_tiles_hash, needle);
 
-				if (!st)
-					{
-					st = needle;
-					}
-				else
-					{
-					pr_source_tile_free(needle);
-					}
+		if (pr->func_tile_dispose)
+			{
+			pr->func_tile_dispose(pr, needle->x, needle->y,
+					      pr->source_tile_width << needle->level,
+					      pr->source_tile_height << needle->level,
+					      needle->pixbuf, pr->func_tile_data);
+			}
 
-				count--;
-				}
+		if (!st)
+			{
+			st = needle;
+			}
+		else
+			{
+			pr_source_tile_free(needle);
 			}
 		}
 
@@ -1053,11 +1125,14 @@ static SourceTile *pr_source_tile_new(PixbufRenderer *pr, gint x, gint y)
 					    pr->source_tile_width, pr->source_tile_height);
 		}
 
-	st->x = ROUND_DOWN(x, pr->source_tile_width);
-	st->y = ROUND_DOWN(y, pr->source_tile_height);
+	st->x = ROUND_DOWN(x, pr->source_tile_width << level);
+	st->y = ROUND_DOWN(y, pr->source_tile_height << level);
+	st->level = level;
 	st->blank = TRUE;
 
-	pr->source_tiles = g_list_prepend(pr->source_tiles, st);
+	g_queue_push_head(&pr->source_tiles, st);
+	st->link = pr->source_tiles.head;
+	g_hash_table_replace(pr->source_tiles_hash, st, st);
 
 	return st;
 }
@@ -1065,48 +1140,45 @@ static SourceTile *pr_source_tile_new(PixbufRenderer *pr, gint x, gint y)
 static SourceTile *pr_source_tile_request(PixbufRenderer *pr, gint x, gint y)
 {
 	SourceTile *st;
+	gint tw, th;
 
 	st = pr_source_tile_new(pr, x, y);
 	if (!st) return NULL;
 
+	tw = pr->source_tile_width << st->level;
+	th = pr->source_tile_height << st->level;
+
 	if (pr->func_tile_request &&
 	    pr->func_tile_request(pr, st->x, st->y,
-				   pr->source_tile_width, pr->source_tile_height, st->pixbuf, pr->func_tile_data))
+				   tw, th, st->pixbuf, pr->func_tile_data))
 		{
 		st->blank = FALSE;
 		}
 
 	pr->renderer->invalidate_region(pr->renderer, st->x * pr->scale, st->y * pr->scale,
-				  pr->source_tile_width * pr->scale, pr->source_tile_height * pr->scale);
+				  tw * pr->scale, th * pr->scale);
 	if (pr->renderer2) pr->renderer2->invalidate_region(pr->renderer2, st->x * pr->scale, st->y * pr->scale,
-				  pr->source_tile_width * pr->scale, pr->source_tile_height * pr->scale);
+				  tw * pr->scale, th * pr->scale);
 	return st;
 }
 
 static SourceTile *pr_source_tile_find(PixbufRenderer *pr, gint x, gint y)
 {
-	GList *work;
+	SourceTile key;
+	SourceTile *st;
 
-	work = pr->source_tiles;
-	while (work)
-		{
-		SourceTile *st = work->data;
+	key.level = pr_source_tile_level(pr);
+	key.x = ROUND_DOWN(x, pr->source_tile_width << key.level);
+	key.y = ROUND_DOWN(y, pr->source_tile_height << key.level);
 
-		if (x >= st->x && x < st->x + pr->source_tile_width &&
-		    y >= st->y && y < st->y + pr->source_tile_height)
-			{
-			if (work != pr->source_tiles)
-				{
-				pr->source_tiles = g_list_remove_link(pr->source_tiles, work);
-				pr->source_tiles = g_list_concat(work, pr->source_tiles);
-				}
-			return st;
-			}
-
-		work = work->next;
+	st = g_hash_table_lookup(pr->source_tiles_hash, &key);
+	if (st && st->link != pr->source_tiles.head)
+		{
+		g_queue_unlink(&pr->source_tiles, st->link);
+		g_queue_push_head_link(&pr->source_tiles, st->link);
 		}
 
-	return NULL;
+	return st;
 }
 
 GList *pr_source_tile_compute_region(PixbufRenderer *pr, gint x, gint y, gint w, gint h, gboolean request)
@@ -1114,18 +1186,24 @@ GList *pr_source_tile_compute_region(PixbufRenderer *pr, gint x, gint y, gint w,
 	gint x1, y1;
 	GList *list = NULL;
 	gint sx, sy;
+	gint tw, th;
+	gint level;
 
 	if (x < 0) x = 0;
 	if (y < 0) y = 0;
 	if (w > pr->image_width) w = pr->image_width;
 	if (h > pr->image_height) h = pr->image_height;
 
-	sx = ROUND_DOWN(x, pr->source_tile_width);
-	sy = ROUND_DOWN(y, pr->source_tile_height);
+	level = pr_source_tile_level(pr);
+	tw = pr->source_tile_width << level;
+	th = pr->source_tile_height << level;
 
-	for (x1 = sx; x1 < x + w; x1+= pr->source_tile_width)
+	sx = ROUND_DOWN(x, tw);
+	sy = ROUND_DOWN(y, th);
+
+	for (x1 = sx; x1 < x + w; x1+= tw)
 		{
-		for (y1 = sy; y1 < y + h; y1 += pr->source_tile_height)
+		for (y1 = sy; y1 < y + h; y1 += th)
 			{
 			SourceTile *st;
 
@@ -1139,37 +1217,90 @@ GList *pr_source_tile_compute_region(PixbufRenderer *pr, gint x, gint y, gint w,
 	return g_list_reverse(list);
 }
 
+static void pr_source_tile_update(PixbufRenderer *pr, SourceTile *st, gint x, gint y, gint width, gint height)
+{
+	gint rx, ry, rw, rh;
+
+	if (pr_clip_region(st->x, st->y, pr->source_tile_width << st->level, pr->source_tile_height << st->level,
+			   x, y, width, height,
+			   &rx, &ry, &rw, &rh))
+		{
+		GdkPixbuf *pixbuf;
+
+		if (st->level > 0)
+			{
+			gint step = 1 << st->level;
+
+			/* align the region to whole pixels of the reduced tile */
+			rw = ROUND_UP(rx + rw, step);
+			rh = ROUND_UP(ry + rh, step);
+			rx = ROUND_DOWN(rx, step);
+			ry = ROUND_DOWN(ry, step);
+			rw -= rx;
+			rh -= ry;
+			}
+
+		pixbuf = gdk_pixbuf_new_subpixbuf(st->pixbuf, (rx - st->x) >> st->level, (ry - st->y) >> st->level,
+						  rw >> st->level, rh >> st->level);
+		if (pr->func_tile_request &&
+		    pr->func_tile_request(pr, rx, ry, rw, rh, pixbuf, pr->func_tile_data))
+			{
+				pr->renderer->invalidate_region(pr->renderer, rx * pr->scale, ry * pr->scale,
+						      rw * pr->scale, rh * pr->scale);
+				if (pr->renderer2) pr->renderer2->invalidate_region(pr->renderer2, rx * pr->scale, ry * pr->scale,
+							rw * pr->scale, rh * pr->scale);
+			}
+		g_object_unref(pixbuf);
+		}
+}
+
 static void pr_source_tile_changed(PixbufRenderer *pr, gint x, gint y, gint width, gint height)
 {
-	GList *work;
+	gint level;
+	guint cells = 0;
 
 	if (width < 1 || height < 1) return;
 
-	work = pr->source_tiles;
-	while (work)
+	for (level = 0; level <= pr->source_tiles_max_level; level++)
 		{
-		SourceTile *st;
-		gint rx, ry, rw, rh;
+		gint tw = pr->source_tile_width << level;
+		gint th = pr->source_tile_height << level;
 
-		st = work->data;
-		work = work->next;
+		cells += (guint)((ROUND_UP(x + width, tw) - ROUND_DOWN(x, tw)) / tw) *
+			 (guint)((ROUND_UP(y + height, th) - ROUND_DOWN(y, th)) / th);
+		}
+
+	if (cells > pr->source_tiles.length)
+		{
+		GList *work;
 
-		if (pr_clip_region(st->x, st->y, pr->source_tile_width, pr->source_tile_height,
-				   x, y, width, height,
-				   &rx, &ry, &rw, &rh))
+		/* the region spans more cells than there are tiles */
+		work = pr->source_tiles.head;
+		while (work)
 			{
-			GdkPixbuf *pixbuf;
+			SourceTile *st = work->data;
+			work = work->next;
 
-			pixbuf = gdk_pixbuf_new_subpixbuf(st->pixbuf, rx - st->x, ry - st->y, rw, rh);
-			if (pr->func_tile_request &&
-			    pr->func_tile_request(pr, rx, ry, rw, rh, pixbuf, pr->func_tile_data))
+			pr_source_tile_update(pr, st, x, y, width, height);
+			}
+		return;
+		}
+
+	for (level = 0; level <= pr->source_tiles_max_level; level++)
+		{
+		SourceTile key;
+		gint tw = pr->source_tile_width << level;
+		gint th = pr->source_tile_height << level;
+
+		key.level = level;
+		for (key.y = ROUND_DOWN(y, th); key.y < y + height; key.y += th)
+			{
+			for (key.x = ROUND_DOWN(x, tw); key.x < x + width; key.x += tw)
 				{
-					pr->renderer->invalidate_region(pr->renderer, rx * pr->scale, ry * pr->scale,
-							      rw * pr->scale, rh * pr->scale);
-					if (pr->renderer2) pr->renderer2->invalidate_region(pr->renderer2, rx * pr->scale, ry * pr->scale,
-								rw * pr->scale, rh * pr->scale);
+				SourceTile *st = g_hash_table_lookup(pr->source_tiles_hash, &key);
+
+				if (st) pr_source_tile_update(pr, st, x, y, width, height);
 				}
-			g_object_unref(pixbuf);
 			}
 		}
 }
@@ -1209,6 +1340,16 @@ void pixbuf_renderer_set_tiles(PixbufRenderer *pr, gint width, gint height,
 	pr_zoom_sync(pr, zoom, PR_ZOOM_FORCE | PR_ZOOM_NEW, 0, 0);
 }
 
+void pixbuf_renderer_set_tiles_levels(PixbufRenderer *pr, gint max_level)
+{
+	g_return_if_fail(IS_PIXBUF_RENDERER(pr));
+
+	if (pr->source_tiles_max_level == max_level) return;
+
+	pr_source_tile_free_all(pr);
+	pr->source_tiles_max_level = MAX(max_level, 0);
+}
+
 void pixbuf_renderer_set_tiles_size(PixbufRenderer *pr, gint width, gint height)
 {
 	g_return_if_fail(IS_PIXBUF_RENDERER(pr));
@@ -2525,10 +2666,65 @@ void pixbuf_renderer_set_post_process_func(PixbufRenderer *pr, PixbufRendererPos
 {
 	g_return_if_fail(IS_PIXBUF_RENDERER(pr));
 
+	pixbuf_renderer_post_process_lock(pr);
 	pr->func_post_process = func;
 	pr->post_process_user_data = user_data;
 	pr->post_process_slow = func && slow;
+	pixbuf_renderer_post_process_unlock(pr);
+
+}
+
+void pixbuf_renderer_set_post_process_threaded(PixbufRenderer *pr, gboolean threaded)
+{
+	g_return_if_fail(IS_PIXBUF_RENDERER(pr));
+
+	pr->post_process_threaded = threaded;
+}
+
+/* the main thread, to change the func or its data */
+void pixbuf_renderer_post_process_lock(PixbufRenderer *pr)
+{
+#ifdef HAVE_GTHREAD
+#if GLIB_CHECK_VERSION(2,32,0)
+	g_rw_lock_writer_lock(&pr->post_process_lock);
+#else
+	g_static_rw_lock_writer_lock(&pr->post_process_lock);
+#endif
+#endif
+}
 
+void pixbuf_renderer_post_process_unlock(PixbufRenderer *pr)
+{
+#ifdef HAVE_GTHREAD
+#if GLIB_CHECK_VERSION(2,32,0)
+	g_rw_lock_writer_unlock(&pr->post_process_lock);
+#else
+	g_static_rw_lock_writer_unlock(&pr->post_process_lock);
+#endif
+#endif
+}
+
+/* the tile render threads, around a call of the func */
+void pixbuf_renderer_post_process_read_lock(PixbufRenderer *pr)
+{
+#ifdef HAVE_GTHREAD
+#if GLIB_CHECK_VERSION(2,32,0)
+	g_rw_lock_reader_lock(&pr->post_process_lock);
+#else
+	g_static_rw_lock_reader_lock(&pr->post_process_lock);
+#endif
+#endif
+}
+
+void pixbuf_renderer_post_process_read_unlock(PixbufRenderer *pr)
+{
+#ifdef HAVE_GTHREAD
+#if GLIB_CHECK_VERSION(2,32,0)
+	g_rw_lock_reader_unlock(&pr->post_process_lock);
+#else
+	g_static_rw_lock_reader_unlock(&pr->post_process_lock);
+#endif
+#endif
 }
 
 
@@ -2558,9 +2754,12 @@ void pixbuf_renderer_move(PixbufRenderer *pr, PixbufRenderer *source)
 	scroll_reset = pr->scroll_reset;
 	pr->scroll_reset = PR_SCROLL_RESET_NOCHANGE;
 
+	pixbuf_renderer_post_process_lock(pr);
 	pr->func_post_process = source->func_post_process;
 	pr->post_process_user_data = source->post_process_user_data;
 	pr->post_process_slow = source->post_process_slow;
+	pr->post_process_threaded = source->post_process_threaded;
+	pixbuf_renderer_post_process_unlock(pr);
 	pr->orientation = source->orientation;
 	pr->stereo_data = source->stereo_data;
 
@@ -2572,6 +2771,7 @@ void pixbuf_renderer_move(PixbufRenderer *pr, PixbufRenderer *source)
 		pr->source_tiles_cache_size = source->source_tiles_cache_size;
 		pr->source_tile_width = source->source_tile_width;
 		pr->source_tile_height = source->source_tile_height;
+		pr->source_tiles_max_level = source->source_tiles_max_level;
 		pr->image_width = source->image_width;
 		pr->image_height = source->image_height;
 
@@ -2579,8 +2779,7 @@ void pixbuf_renderer_move(PixbufRenderer *pr, PixbufRenderer *source)
 		pr->func_tile_dispose = source->func_tile_dispose;
 		pr->func_tile_data = source->func_tile_data;
 
-		pr->source_tiles = source->source_tiles;
-		source->source_tiles = NULL;
+		pr_source_tile_take(pr, source);
 
 		pr_zoom_sync(pr, source->zoom, PR_ZOOM_FORCE | PR_ZOOM_NEW, 0, 0);
 		}
@@ -2629,6 +2828,7 @@ void pixbuf_renderer_copy(PixbufRenderer *pr, PixbufRenderer *source)
 		pr->source_tiles_cache_size = source->source_tiles_cache_size;
 		pr->source_tile_width = source->source_tile_width;
 		pr->source_tile_height = source->source_tile_height;
+		pr->source_tiles_max_level = source->source_tiles_max_level;
 		pr->image_width = source->image_width;
 		pr->image_height = source->image_height;
 
@@ -2636,8 +2836,7 @@ void pixbuf_renderer_copy(PixbufRenderer *pr, PixbufRenderer *source)
 		pr->func_tile_dispose = source->func_tile_dispose;
 		pr->func_tile_data = source->func_tile_data;
 
-		pr->source_tiles = source->source_tiles;
-		source->source_tiles = NULL;
+		pr_source_tile_take(pr, source);
 
 		pr_zoom_sync(pr, source->zoom, PR_ZOOM_FORCE | PR_ZOOM_NEW, 0, 0);
 		}
@@ -171,9 +171,11 @@ struct _PixbufRenderer
 	gboolean source_tiles_enabled;
 	gint source_tiles_cache_size;
 
-	GList *source_tiles;	/* list of active source tiles */
+	GQueue source_tiles;	/* active source tiles, most recently used first */
+	GHashTable *source_tiles_hash;	/* SourceTile by position and level */
 	gint source_tile_width;
 	gint source_tile_height;
+	gint source_tiles_max_level;	/* reduced resolution tiles used when zoomed out */
 
 	PixbufRendererTileRequestFunc func_tile_request;
 	PixbufRendererTileDisposeFunc func_tile_dispose;
@@ -183,6 +185,12 @@ struct _PixbufRenderer
 	PixbufRendererPostProcessFunc func_post_process;
 	gpointer post_process_user_data;
 	gint post_process_slow;
+	gboolean post_process_threaded;	/* the func may run on the tile render threads */
+#if GLIB_CHECK_VERSION(2,32,0)
+	GRWLock post_process_lock;	/* read locked while the func runs on a thread */
+#else
+	GStaticRWLock post_process_lock;
+#endif
 
 	gboolean delay_flip;
 	gboolean loading;
@@ -255,6 +263,13 @@ gint pixbuf_renderer_get_orientation(PixbufRenderer *pr);
 void pixbuf_renderer_set_stereo_data(PixbufRenderer *pr, StereoPixbufData stereo_data);
 
 void pixbuf_renderer_set_post_process_func(PixbufRenderer *pr, PixbufRendererPostProcessFunc func, gpointer user_data, gboolean slow);
+/* the post process func is thread safe, the tile render threads then call it concurrently
+ * with the read lock held, the main thread takes the write lock to change the data the func uses */
+void pixbuf_renderer_set_post_process_threaded(PixbufRenderer *pr, gboolean threaded);
+void pixbuf_renderer_post_process_lock(PixbufRenderer *pr);
+void pixbuf_renderer_post_process_unlock(PixbufRenderer *pr);
+void pixbuf_renderer_post_process_read_lock(PixbufRenderer *pr);
+void pixbuf_renderer_post_process_read_unlock(PixbufRenderer *pr);
 
 /* display an on-request array of pixbuf tiles */
 
@@ -265,6 +280,10 @@ void pixbuf_renderer_set_tiles(PixbufRenderer *pr, gint width, gint height,
 			       gpointer user_data,
 			       gdouble zoom);
 void pixbuf_renderer_set_tiles_size(PixbufRenderer *pr, gint width, gint height);
+/* allows tiles at 1/2 .. 1/(2^max_level) resolution when zoomed out,
+ * the request function then gets a pixbuf smaller than the requested region
+ */
+void pixbuf_renderer_set_tiles_levels(PixbufRenderer *pr, gint max_level);
 gint pixbuf_renderer_get_tiles(PixbufRenderer *pr);
 
 /* move image data from source to pr, source is then set to NULL image */
@@ -338,8 +357,11 @@ struct _SourceTile
 {
 	gint x;
 	gint y;
+	gint level;	/* the tile covers source_tile_width << level, at source_tile_width resolution */
 	GdkPixbuf *pixbuf;
 	gboolean blank;
+
+	GList *link;	/* node of the tile in PixbufRenderer source_tiles */
 };
 
 
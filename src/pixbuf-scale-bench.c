@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2008 - 2016 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Compares pixbuf_scale_region() with gdk_pixbuf_scale() on the tile sizes
+ * used by the renderer: 128 pixel render tiles filled from the whole image
+ * and from 512 pixel source tiles.
+ *
+ * Build with "make pixbuf-scale-bench" in src, then run
+ * ./pixbuf-scale-bench [iterations]
+ */
+
+#include "main.h"
+#include "pixbuf-scale.h"
+
+#define BENCH_TILE_SIZE 128
+#define BENCH_SOURCE_TILE_SIZE 512
+#define BENCH_IMAGE_SIZE 2048
+
+static const gdouble bench_scales[] = { 0.125, 0.25, 0.33, 0.5, 0.75, 1.5, 2.0, 4.0 };
+
+static const struct {
+	GdkInterpType type;
+	const gchar *name;
+} bench_interps[] = {
+	{ GDK_INTERP_NEAREST,	"nearest" },
+	{ GDK_INTERP_TILES,	"tiles" },
+	{ GDK_INTERP_BILINEAR,	"bilinear" },
+	{ GDK_INTERP_HYPER,	"hyper" }
+};
+
+static GdkPixbuf *bench_pixbuf_new(gint width, gint height, gboolean has_alpha)
+{
+	GdkPixbuf *pixbuf;
+	guchar *pixels;
+	gint rs;
+	gint n_ch;
+	gint x, y;
+	GRand *rand;
+
+	pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, has_alpha, 8, width, height);
+	pixels = gdk_pixbuf_get_pixels(pixbuf);
+	rs = gdk_pixbuf_get_rowstride(pixbuf);
+	n_ch = gdk_pixbuf_get_n_channels(pixbuf);
+
+	/* a gradient with noise, the same for every run */
+	rand = g_rand_new_with_seed(1);
+	for (y = 0; y < height; y++)
+		{
+		guchar *p = pixels + y * rs;
+
+		for (x = 0; x < width; x++)
+			{
+			p[0] = (x * 255 / width + g_rand_int_range(rand, 0, 32)) & 0xff;
+			p[1] = (y * 255 / height + g_rand_int_range(rand, 0, 32)) & 0xff;
+			p[2] = g_rand_int_range(rand, 0, 256);
+			if (has_alpha) p[3] = 128 + g_rand_int_range(rand, 0, 128);
+			p += n_ch;
+			}
+		}
+	g_rand_free(rand);
+
+	return pixbuf;
+}
+
+static gint bench_max_diff(GdkPixbuf *a, GdkPixbuf *b)
+{
+	gint rs = gdk_pixbuf_get_rowstride(a);
+	gint len = gdk_pixbuf_get_width(a) * gdk_pixbuf_get_n_channels(a);
+	guchar *pa = gdk_pixbuf_get_pixels(a);
+	guchar *pb = gdk_pixbuf_get_pixels(b);
+	gint diff = 0;
+	gint x, y;
+
+	for (y = 0; y < gdk_pixbuf_get_height(a); y++)
+		{
+		for (x = 0; x < len; x++)
+			{
+			diff = MAX(diff, ABS((gint)pa[y * rs + x] - (gint)pb[y * rs + x]));
+			}
+		}
+
+	return diff;
+}
+
+/* renders every tile of the scaled source once, returns the time in ms */
+static gdouble bench_run(GdkPixbuf *src, GdkPixbuf *dest, gdouble scale,
+			 GdkInterpType type, gboolean gdk, gint iterations)
+{
+	gint64 start;
+	gint width;
+	gint height;
+	gint i;
+
+	width = CLAMP(gdk_pixbuf_get_width(src) * scale, BENCH_TILE_SIZE, 8 * BENCH_TILE_SIZE);
+	height = CLAMP(gdk_pixbuf_get_height(src) * scale, BENCH_TILE_SIZE, 8 * BENCH_TILE_SIZE);
+
+	start = g_get_monotonic_time();
+	for (i = 0; i < iterations; i++)
+		{
+		gint x, y;
+
+		for (y = 0; y + BENCH_TILE_SIZE <= height; y += BENCH_TILE_SIZE)
+			{
+			for (x = 0; x + BENCH_TILE_SIZE <= width; x += BENCH_TILE_SIZE)
+				{
+				if (gdk)
+					{
+					gdk_pixbuf_scale(src, dest, 0, 0, BENCH_TILE_SIZE, BENCH_TILE_SIZE,
+							 -x, -y, scale, scale, type);
+					}
+				else
+					{
+					pixbuf_scale_region(src, dest, 0, 0, BENCH_TILE_SIZE, BENCH_TILE_SIZE,
+							    -x, -y, scale, scale, type);
+					}
+				}
+			}
+		}
+
+	return (gdouble)(g_get_monotonic_time() - start) / 1000.0 / iterations;
+}
+
+static void bench_source(const gchar *name, GdkPixbuf *src, gint iterations)
+{
+	GdkPixbuf *dest_gdk;
+	GdkPixbuf *dest;
+	guint i, j;
+
+	dest_gdk = gdk_pixbuf_new(GDK_COLORSPACE_RGB, gdk_pixbuf_get_has_alpha(src), 8,
+				  BENCH_TILE_SIZE, BENCH_TILE_SIZE);
+	dest = gdk_pixbuf_new(GDK_COLORSPACE_RGB, gdk_pixbuf_get_has_alpha(src), 8,
+			      BENCH_TILE_SIZE, BENCH_TILE_SIZE);
+
+	printf("%s, %d x %d\n", name, gdk_pixbuf_get_width(src), gdk_pixbuf_get_height(src));
+	printf("%-10s %7s %12s %12s %8s %8s\n", "filter", "scale", "gdk ms", "geeqie ms", "speedup", "diff");
+
+	for (i = 0; i < G_N_ELEMENTS(bench_interps); i++)
+		{
+		for (j = 0; j < G_N_ELEMENTS(bench_scales); j++)
+			{
+			gdouble t_gdk;
+			gdouble t;
+
+			t_gdk = bench_run(src, dest_gdk, bench_scales[j], bench_interps[i].type, TRUE, iterations);
+			t = bench_run(src, dest, bench_scales[j], bench_interps[i].type, FALSE, iterations);
+
+			printf("%-10s %7.3f %12.2f %12.2f %7.2fx %8d\n",
+			       bench_interps[i].name, bench_scales[j], t_gdk, t,
+			       (t > 0.0) ? t_gdk / t : 0.0,
+			       bench_max_diff(dest_gdk, dest));
+			}
+		}
+	printf("\n");
+
+	g_object_unref(dest_gdk);
+	g_object_unref(dest);
+}
+
+int main(int argc, char *argv[])
+{
+	GdkPixbuf *src;
+	gint iterations = 3;
+
+	if (argc > 1) iterations = MAX(1, atoi(argv[1]));
+
+#if !GLIB_CHECK_VERSION(2,36,0)
+	g_type_init();
+#endif
+
+	src = bench_pixbuf_new(BENCH_IMAGE_SIZE, BENCH_IMAGE_SIZE, FALSE);
+	bench_source("RGB image", src, iterations);
+	g_object_unref(src);
+
+	src = bench_pixbuf_new(BENCH_IMAGE_SIZE, BENCH_IMAGE_SIZE, TRUE);
+	bench_source("RGBA image", src, iterations);
+	g_object_unref(src);
+
+	src = bench_pixbuf_new(BENCH_SOURCE_TILE_SIZE, BENCH_SOURCE_TILE_SIZE, FALSE);
+	bench_source("RGB source tile", src, iterations);
+	g_object_unref(src);
+
+	return 0;
+}
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
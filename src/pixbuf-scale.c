@@ -0,0 +1,331 @@
+/*
+ * Copyright (C) 2008 - 2016 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "main.h"
+#include "pixbuf-scale.h"
+
+#include <math.h>
+
+/*
+ * Separable resampling of a pixbuf region, with the same mapping as
+ * gdk_pixbuf_scale(): destination pixel x shows source pixel
+ * (x - offset_x) / scale_x, and likewise for y.
+ *
+ * The filter weights are computed once for each destination column and row.
+ * A destination row is made by summing the source rows under it into a float
+ * buffer, which is then filtered horizontally. The inner loops run over plain
+ * arrays so that the compiler can vectorize them.
+ *
+ * GDK_INTERP_NEAREST picks the nearest pixel, GDK_INTERP_TILES is a box filter,
+ * GDK_INTERP_BILINEAR a tent filter and GDK_INTERP_HYPER a three lobe Lanczos
+ * filter. When scaling down, the filters are widened to the source area of a
+ * destination pixel. Pixels with alpha are filtered premultiplied.
+ */
+
+typedef struct _ScaleFilter ScaleFilter;
+struct _ScaleFilter {
+	gint taps;		/* weights per destination pixel */
+	gint first;		/* lowest source pixel used */
+	gint last;		/* highest source pixel used */
+	gint *start;		/* first source pixel of each destination pixel */
+	gfloat *weights;	/* taps weights for each destination pixel */
+};
+
+static gdouble scale_kernel_support(GdkInterpType interp_type)
+{
+	switch (interp_type)
+		{
+		case GDK_INTERP_NEAREST:
+			return 0.0;
+		case GDK_INTERP_TILES:
+			return 0.5;
+		case GDK_INTERP_HYPER:
+			return 3.0;
+		case GDK_INTERP_BILINEAR:
+		default:
+			return 1.0;
+		}
+}
+
+static gdouble scale_kernel(GdkInterpType interp_type, gdouble x)
+{
+	x = fabs(x);
+
+	switch (interp_type)
+		{
+		case GDK_INTERP_NEAREST:
+		case GDK_INTERP_TILES:
+			return (x <= 0.5) ? 1.0 : 0.0;
+		case GDK_INTERP_HYPER:
+			if (x < 1e-6) return 1.0;
+			if (x >= 3.0) return 0.0;
+			return 3.0 * sin(G_PI * x) * sin(G_PI * x / 3.0) / (G_PI * G_PI * x * x);
+		case GDK_INTERP_BILINEAR:
+		default:
+			return (x < 1.0) ? 1.0 - x : 0.0;
+		}
+}
+
+static void scale_filter_init(ScaleFilter *sf, GdkInterpType interp_type,
+			      gint dest_pos, gint n, gdouble offset, gdouble scale, gint src_len)
+{
+	gdouble filter_scale;
+	gdouble support;
+	gint i;
+
+	filter_scale = (scale < 1.0) ? 1.0 / scale : 1.0;
+	support = scale_kernel_support(interp_type) * filter_scale;
+
+	if (interp_type == GDK_INTERP_NEAREST)
+		{
+		sf->taps = 1;
+		}
+	else
+		{
+		sf->taps = MIN((gint)ceil(support * 2.0) + 1, src_len);
+		}
+
+	sf->first = src_len - 1;
+	sf->last = 0;
+	sf->start = g_new(gint, n);
+	sf->weights = g_new0(gfloat, n * sf->taps);
+
+	for (i = 0; i < n; i++)
+		{
+		gfloat *w = sf->weights + i * sf->taps;
+		gdouble center;
+		gdouble sum = 0.0;
+		gint lo, hi;
+		gint start;
+		gint j;
+
+		/* source pixel j covers [j, j + 1) */
+		center = (dest_pos + i + 0.5 - offset) / scale;
+
+		if (interp_type == GDK_INTERP_NEAREST)
+			{
+			lo = hi = (gint)floor(center);
+			}
+		else
+			{
+			lo = (gint)ceil(center - support - 0.5);
+			hi = (gint)floor(center + support - 0.5);
+			if (hi < lo) lo = hi = (gint)floor(center);
+			if (hi - lo >= sf->taps) hi = lo + sf->taps - 1;
+			}
+
+		/* edge pixels are repeated, keep the taps inside the source */
+		start = CLAMP(lo, 0, src_len - 1);
+		start = MIN(start, src_len - sf->taps);
+
+		for (j = lo; j <= hi; j++)
+			{
+			gdouble k;
+
+			k = (interp_type == GDK_INTERP_NEAREST) ? 1.0 :
+			    scale_kernel(interp_type, (j + 0.5 - center) / filter_scale);
+			w[CLAMP(j, 0, src_len - 1) - start] += k;
+			sum += k;
+			}
+
+		if (sum != 0.0)
+			{
+			gint t;
+
+			for (t = 0; t < sf->taps; t++) w[t] /= sum;
+			}
+		else
+			{
+			w[CLAMP((gint)floor(center), start, start + sf->taps - 1) - start] = 1.0;
+			}
+
+		sf->start[i] = start;
+		sf->first = MIN(sf->first, start);
+		sf->last = MAX(sf->last, start + sf->taps - 1);
+		}
+}
+
+static void scale_filter_free(ScaleFilter *sf)
+{
+	g_free(sf->start);
+	g_free(sf->weights);
+}
+
+static void scale_row_add(gfloat *row, const guchar *s, gint n, gfloat w)
+{
+	gint i;
+
+	for (i = 0; i < n; i++)
+		{
+		row[i] += w * s[i];
+		}
+}
+
+static void scale_row_add_alpha(gfloat *row, const guchar *s, gint n, gfloat w)
+{
+	gint i;
+
+	for (i = 0; i < n; i++)
+		{
+		gfloat a = w * s[3];
+		gfloat p = a * (1.0f / 255.0f);
+
+		row[0] += p * s[0];
+		row[1] += p * s[1];
+		row[2] += p * s[2];
+		row[3] += a;
+
+		row += 4;
+		s += 4;
+		}
+}
+
+static inline guchar scale_clamp(gfloat v)
+{
+	if (v <= 0.0f) return 0;
+	if (v >= 255.0f) return 255;
+	return (guchar)(v + 0.5f);
+}
+
+void pixbuf_scale_region(const GdkPixbuf *src, GdkPixbuf *dest,
+			 gint dest_x, gint dest_y, gint dest_width, gint dest_height,
+			 gdouble offset_x, gdouble offset_y,
+			 gdouble scale_x, gdouble scale_y,
+			 GdkInterpType interp_type)
+{
+	ScaleFilter fx;
+	ScaleFilter fy;
+	const guchar *src_pixels;
+	guchar *dest_pixels;
+	gint src_rs;
+	gint dest_rs;
+	gint n_ch;
+	gboolean has_alpha;
+	gfloat *row;
+	gint span;
+	gint x, y;
+
+	if (dest_width <= 0 || dest_height <= 0) return;
+
+	n_ch = gdk_pixbuf_get_n_channels(src);
+	has_alpha = gdk_pixbuf_get_has_alpha(src);
+
+	if (gdk_pixbuf_get_bits_per_sample(src) != 8 ||
+	    gdk_pixbuf_get_n_channels(dest) != n_ch ||
+	    gdk_pixbuf_get_has_alpha(dest) != has_alpha ||
+	    n_ch != (has_alpha ? 4 : 3) ||
+	    scale_x <= 0.0 || scale_y <= 0.0)
+		{
+		gdk_pixbuf_scale(src, dest, dest_x, dest_y, dest_width, dest_height,
+				 offset_x, offset_y, scale_x, scale_y, interp_type);
+		return;
+		}
+
+	src_pixels = gdk_pixbuf_get_pixels(src);
+	src_rs = gdk_pixbuf_get_rowstride(src);
+	dest_pixels = gdk_pixbuf_get_pixels(dest);
+	dest_rs = gdk_pixbuf_get_rowstride(dest);
+
+	scale_filter_init(&fx, interp_type, dest_x, dest_width, offset_x, scale_x, gdk_pixbuf_get_width(src));
+	scale_filter_init(&fy, interp_type, dest_y, dest_height, offset_y, scale_y, gdk_pixbuf_get_height(src));
+
+	span = fx.last - fx.first + 1;
+	row = g_new(gfloat, span * n_ch);
+
+	for (y = 0; y < dest_height; y++)
+		{
+		const gfloat *wy = fy.weights + y * fy.taps;
+		guchar *d = dest_pixels + (dest_y + y) * dest_rs + dest_x * n_ch;
+		gint t;
+
+		memset(row, 0, sizeof(gfloat) * span * n_ch);
+		for (t = 0; t < fy.taps; t++)
+			{
+			const guchar *s;
+
+			if (wy[t] == 0.0f) continue;
+
+			s = src_pixels + (fy.start[y] + t) * src_rs + fx.first * n_ch;
+			if (has_alpha)
+				{
+				scale_row_add_alpha(row, s, span, wy[t]);
+				}
+			else
+				{
+				scale_row_add(row, s, span * n_ch, wy[t]);
+				}
+			}
+
+		for (x = 0; x < dest_width; x++)
+			{
+			const gfloat *wx = fx.weights + x * fx.taps;
+			const gfloat *r = row + (fx.start[x] - fx.first) * n_ch;
+			gfloat c0 = 0.0f;
+			gfloat c1 = 0.0f;
+			gfloat c2 = 0.0f;
+			gfloat c3 = 0.0f;
+
+			if (has_alpha)
+				{
+				for (t = 0; t < fx.taps; t++)
+					{
+					c0 += wx[t] * r[0];
+					c1 += wx[t] * r[1];
+					c2 += wx[t] * r[2];
+					c3 += wx[t] * r[3];
+					r += 4;
+					}
+
+				if (c3 > 0.5f)
+					{
+					gfloat m = 255.0f / c3;
+
+					d[0] = scale_clamp(c0 * m);
+					d[1] = scale_clamp(c1 * m);
+					d[2] = scale_clamp(c2 * m);
+					d[3] = scale_clamp(c3);
+					}
+				else
+					{
+					d[0] = d[1] = d[2] = d[3] = 0;
+					}
+				d += 4;
+				}
+			else
+				{
+				for (t = 0; t < fx.taps; t++)
+					{
+					c0 += wx[t] * r[0];
+					c1 += wx[t] * r[1];
+					c2 += wx[t] * r[2];
+					r += 3;
+					}
+
+				d[0] = scale_clamp(c0);
+				d[1] = scale_clamp(c1);
+				d[2] = scale_clamp(c2);
+				d += 3;
+				}
+			}
+		}
+
+	g_free(row);
+	scale_filter_free(&fx);
+	scale_filter_free(&fy);
+}
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
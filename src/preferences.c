@@ -306,6 +306,7 @@ static void config_window_apply(void)
 	DEBUG_1("TG: applied editor %s", c_options->image_l_click_video_editor);
 
 	options->file_ops.enable_in_place_rename = c_options->file_ops.enable_in_place_rename;
+	options->file_ops.transfer_jobs = c_options->file_ops.transfer_jobs;
 
 	options->image.tile_cache_max = c_options->image.tile_cache_max;
 	options->image.image_cache_max = c_options->image.image_cache_max;
@@ -2318,6 +2319,9 @@ static void config_tab_behavior(GtkWidget *notebook)
 	pref_checkbox_new_int(group, _("In place renaming"),
 			      options->file_ops.enable_in_place_rename, &c_options->file_ops.enable_in_place_rename);
 
+	pref_spin_new_int(group, _("Concurrent file transfers per device"), NULL,
+			  1, 16, 1, options->file_ops.transfer_jobs, &c_options->file_ops.transfer_jobs);
+
 	pref_checkbox_new_int(group, _("List directory view uses single click to enter"),
 			      options->view_dir_list_single_click_enter, &c_options->view_dir_list_single_click_enter);
 
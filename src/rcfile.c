@@ -347,6 +347,7 @@ static void write_global_attributes(GString *outstr, gint indent)
 	WRITE_NL(); WRITE_BOOL(*options, file_ops.safe_delete_enable);
 	WRITE_NL(); WRITE_CHAR(*options, file_ops.safe_delete_path);
 	WRITE_NL(); WRITE_INT(*options, file_ops.safe_delete_folder_maxsize);
+	WRITE_NL(); WRITE_INT(*options, file_ops.transfer_jobs);
 
 	/* Properties dialog Options */
 	WRITE_NL(); WRITE_CHAR(*options, properties.tabs_order);
@@ -690,6 +691,7 @@ static gboolean load_global_params(const gchar **attribute_names, const gchar **
 		if (READ_BOOL(*options, file_ops.safe_delete_enable)) continue;
 		if (READ_CHAR(*options, file_ops.safe_delete_path)) continue;
 		if (READ_INT(*options, file_ops.safe_delete_folder_maxsize)) continue;
+		if (READ_INT_CLAMP(*options, file_ops.transfer_jobs, 1, 16)) continue;
 
 		/* Fullscreen options */
 		if (READ_INT(*options, fullscreen.screen)) continue;
@@ -30,6 +30,7 @@
 #include "layout.h"
 #include "layout_image.h"
 #include "misc.h"
+#include "perf.h"
 #include "slideshow.h"
 #include "ui_fileops.h"
 #include "rcfile.h"
@@ -38,12 +39,23 @@
 #include <sys/un.h>
 #include <signal.h>
 #include <errno.h>
+#include <poll.h>
 
 
 #define SERVER_MAX_CLIENTS 8
 
 #define REMOTE_SERVER_BACKLOG 4
 
+/* commands run in one wake up, the answers are flushed once for all */
+#define REMOTE_SERVER_BATCH 1024
+
+/*
+ * bytes of commands sent before reading their answers, less than a socket
+ * buffer so that the client never waits to write while the server waits
+ * for its answers to be read
+ */
+#define REMOTE_CLIENT_WINDOW 4096
+
 
 #ifndef UNIX_PATH_MAX
 #define UNIX_PATH_MAX 108
@@ -52,6 +64,7 @@
 
 static RemoteConnection *remote_client_open(const gchar *path);
 static gint remote_client_send(RemoteConnection *rc, const gchar *text);
+static gboolean remote_client_send_list(RemoteConnection *rc, GList *list);
 static void gr_raise(const gchar *text, GIOChannel *channel, gpointer data);
 
 
@@ -65,9 +78,25 @@ struct _RemoteClient {
 typedef struct _RemoteData RemoteData;
 struct _RemoteData {
 	CollectionData *command_collection;
+	GList *list_add;	/* FileData of --list-add commands not added yet, reversed */
 };
 
 
+/* TRUE when a command is waiting, reading it does not block */
+static gboolean remote_server_client_pending(GIOChannel *channel, gint fd)
+{
+	struct pollfd pfd;
+
+	if (g_io_channel_get_buffer_condition(channel) & G_IO_IN) return TRUE;
+
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+
+	return (poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLIN));
+}
+
+
 static gboolean remote_server_client_cb(GIOChannel *source, GIOCondition condition, gpointer data)
 {
 	RemoteClient *client = data;
@@ -81,7 +110,11 @@ static gboolean remote_server_client_cb(GIOChannel *source, GIOCondition conditi
 		gchar *buffer = NULL;
 		GError *error = NULL;
 		gsize termpos;
+		gint count = 0;
 
+		/* a client may send many commands before reading the answers,
+		 * all those already received are run as one batch
+		 */
 		while ((status = g_io_channel_read_line(source, &buffer, NULL, &termpos, &error)) == G_IO_STATUS_NORMAL)
 			{
 			if (buffer)
@@ -92,14 +125,19 @@ static gboolean remote_server_client_cb(GIOChannel *source, GIOCondition conditi
 					{
 					if (rc->read_func) rc->read_func(rc, buffer, source, rc->read_data);
 					g_io_channel_write_chars(source, "\n", -1, NULL, NULL); /* empty line finishes the command */
-					g_io_channel_flush(source, NULL);
 					}
 				g_free(buffer);
 
 				buffer = NULL;
 				}
+
+			count++;
+			if (count >= REMOTE_SERVER_BATCH || !remote_server_client_pending(source, client->fd)) break;
 			}
 
+		if (rc->read_func) rc->read_func(rc, NULL, source, rc->read_data);
+		g_io_channel_flush(source, NULL);
+
 		if (error)
 			{
 			log_printf("error reading socket: %s\n", error->message);
@@ -285,15 +323,22 @@ static void sighandler_sigpipe(gint sig)
 	sigpipe_occured = TRUE;
 }
 
-static gboolean remote_client_send(RemoteConnection *rc, const gchar *text)
+/**
+ * @brief Sends the commands of list, gchar *text, and prints their answers.
+ *
+ * The commands are written in windows of REMOTE_CLIENT_WINDOW bytes before
+ * the answers are read, the server runs those it has received as one batch.
+ */
+static gboolean remote_client_send_list(RemoteConnection *rc, GList *list)
 {
 	struct sigaction new_action, old_action;
-	gboolean ret = FALSE;
+	gboolean ret = TRUE;
 	GError *error = NULL;
 	GIOChannel *channel;
+	GList *work;
 
 	if (!rc || rc->server) return FALSE;
-	if (!text) return TRUE;
+	if (!list) return TRUE;
 
 	sigpipe_occured = FALSE;
 
@@ -306,57 +351,98 @@ static gboolean remote_client_send(RemoteConnection *rc, const gchar *text)
 
 	channel = g_io_channel_unix_new(rc->fd);
 
-	g_io_channel_write_chars(channel, text, -1, NULL, &error);
-	g_io_channel_write_chars(channel, "\n", -1, NULL, &error);
-	g_io_channel_flush(channel, &error);
-
-	if (error)
+	work = list;
+	while (work && ret)
 		{
-		log_printf("error reading socket: %s\n", error->message);
-		g_error_free(error);
-		ret = FALSE;;
-		}
-	else
-		{
-		ret = TRUE;
-		}
+		gint sent = 0;
+		gsize size = 0;
 
-	if (ret)
-		{
-		gchar *buffer = NULL;
-		gsize termpos;
-		while (g_io_channel_read_line(channel, &buffer, NULL, &termpos, &error) == G_IO_STATUS_NORMAL)
+		while (work && !error)
 			{
+			const gchar *text = work->data;
+			gsize len = strlen(text) + 1;
+
+			/* a window has at least one command */
+			if (sent > 0 && size + len > REMOTE_CLIENT_WINDOW) break;
+
+			work = work->next;
+
+			/* the server answers each non empty line */
+			if (text[0] == '\0' || strchr(text, '\n'))
+				{
+				log_printf("remote command skipped, empty or with a new line: %s\n", text);
+				continue;
+				}
+
+			g_io_channel_write_chars(channel, text, -1, NULL, &error);
+			if (!error) g_io_channel_write_chars(channel, "\n", -1, NULL, &error);
+			sent++;
+			size += len;
+			}
+		if (!error) g_io_channel_flush(channel, &error);
+
+		if (error)
+			{
+			log_printf("error reading socket: %s\n", error->message);
+			g_error_free(error);
+			error = NULL;
+			ret = FALSE;
+			break;
+			}
+
+		/* each answer is finished by an empty line */
+		while (sent > 0)
+			{
+			gchar *buffer = NULL;
+			gsize termpos;
+
+			if (g_io_channel_read_line(channel, &buffer, NULL, &termpos, &error) != G_IO_STATUS_NORMAL) break;
+
 			if (buffer)
 				{
-				if (buffer[0] == '\n') /* empty line finishes the command */
+				if (buffer[0] == '\n')
 					{
-					g_free(buffer);
-					fflush(stdout);
-					break;
+					sent--;
+					}
+				else
+					{
+					buffer[termpos] = '\0';
+					printf("%s\n", buffer);
 					}
-				buffer[termpos] = '\0';
-				printf("%s\n", buffer);
 				g_free(buffer);
-				buffer = NULL;
 				}
 			}
+		fflush(stdout);
 
 		if (error)
 			{
 			log_printf("error reading socket: %s\n", error->message);
 			g_error_free(error);
-			ret = FALSE;
+			error = NULL;
 			}
+		if (sent > 0) ret = FALSE;
 		}
 
-
 	/* restore the original signal handler */
 	sigaction(SIGPIPE, &old_action, NULL);
 	g_io_channel_unref(channel);
 	return ret;
 }
 
+static gboolean remote_client_send(RemoteConnection *rc, const gchar *text)
+{
+	GList *list;
+	gboolean ret;
+
+	if (!text) return (rc && !rc->server);
+
+	list = g_list_append(NULL, (gpointer)text);
+	ret = remote_client_send_list(rc, list);
+	g_list_free(list);
+
+	return ret;
+}
+
 void remote_close(RemoteConnection *rc)
 {
 	if (!rc) return;
@@ -474,6 +560,11 @@ static void gr_cache_render_standard_recurse(const gchar *text, GIOChannel *chan
 		cache_manager_render_remote(text, TRUE, TRUE);
 }
 
+static void gr_cache_render_jobs(const gchar *text, GIOChannel *channel, gpointer data)
+{
+	cache_manager_render_set_jobs(atoi(text));
+}
+
 static void gr_slideshow_toggle(const gchar *text, GIOChannel *channel, gpointer data)
 {
 	layout_image_slideshow_toggle(NULL);
@@ -586,6 +677,27 @@ static void gr_file_tell(const gchar *text, GIOChannel *channel, gpointer data)
 		}
 }
 
+static void gr_memory_stats(const gchar *text, GIOChannel *channel, gpointer data)
+{
+	gchar *report = file_data_memory_report();
+
+	g_io_channel_write_chars(channel, report, -1, NULL, NULL);
+	g_free(report);
+}
+
+static void gr_perf_stats(const gchar *text, GIOChannel *channel, gpointer data)
+{
+	gchar *report = perf_report();
+
+	g_io_channel_write_chars(channel, report, -1, NULL, NULL);
+	g_free(report);
+}
+
+static void gr_perf_reset(const gchar *text, GIOChannel *channel, gpointer data)
+{
+	perf_reset();
+}
+
 static void gr_config_load(const gchar *text, GIOChannel *channel, gpointer data)
 {
 	gchar *filename = expand_tilde(text);
@@ -658,11 +770,17 @@ static void gr_list_clear(const gchar *text, GIOChannel *channel, gpointer data)
 		}
 }
 
-static void gr_list_add(const gchar *text, GIOChannel *channel, gpointer data)
+/* adds the files of the --list-add commands of a batch at once */
+static void remote_list_add_flush(RemoteData *remote_data)
 {
-	RemoteData *remote_data = data;
+	GList *list;
 	gboolean new = TRUE;
 
+	if (!remote_data->list_add) return;
+
+	list = g_list_reverse(remote_data->list_add);
+	remote_data->list_add = NULL;
+
 	if (!remote_data->command_collection)
 		{
 		CollectionData *cd;
@@ -681,11 +799,124 @@ static void gr_list_add(const gchar *text, GIOChannel *channel, gpointer data)
 		new = (!collection_get_first(remote_data->command_collection));
 		}
 
-	if (collection_add(remote_data->command_collection, file_data_new_group(text), FALSE) && new)
+	if (collection_add_filelist(remote_data->command_collection, list, FALSE, TRUE) > 0 && new)
 		{
 		layout_image_set_collection(NULL, remote_data->command_collection,
 					    collection_get_first(remote_data->command_collection));
 		}
+
+	filelist_free(list);
+}
+
+static void gr_list_add(const gchar *text, GIOChannel *channel, gpointer data)
+{
+	RemoteData *remote_data = data;
+
+	/* added with the rest of the batch by remote_list_add_flush() */
+	remote_data->list_add = g_list_prepend(remote_data->list_add, file_data_new_group(text));
+}
+
+/**
+ * @brief Reads a list of paths from file, "-" is stdin.
+ * @returns list of gchar *, utf8 and absolute
+ *
+ * The paths are separated by nul chars, or by new lines when there is
+ * no nul char. Relative paths are taken from the current folder.
+ */
+static GList *remote_path_list_read(const gchar *file)
+{
+	GList *list = NULL;
+	gchar *data = NULL;
+	gsize len = 0;
+	gchar *cwd;
+	gchar sep;
+	const gchar *p;
+	const gchar *end;
+
+	if (strcmp(file, "-") == 0)
+		{
+		GString *str = g_string_new(NULL);
+		gchar buf[8192];
+		gsize n;
+
+		while ((n = fread(buf, 1, sizeof(buf), stdin)) > 0) g_string_append_len(str, buf, n);
+
+		len = str->len;
+		data = g_string_free(str, FALSE);
+		}
+	else
+		{
+		gchar *filename = expand_tilde(file);
+		gchar *pathl = path_from_utf8(filename);
+
+		if (!g_file_get_contents(pathl, &data, &len, NULL))
+			{
+			log_printf("unable to read the list of files: %s\n", filename);
+			}
+		g_free(pathl);
+		g_free(filename);
+		}
+
+	if (!data) return NULL;
+
+	sep = memchr(data, '\0', len) ? '\0' : '\n';
+	cwd = g_get_current_dir();
+
+	p = data;
+	end = data + len;
+	while (p < end)
+		{
+		const gchar *q = memchr(p, sep, end - p);
+		gchar *pathl;
+
+		if (!q) q = end;
+
+		pathl = g_strndup(p, q - p);
+		if (sep == '\n') g_strchomp(pathl);
+
+		if (pathl[0] != '\0')
+			{
+			gchar *path = path_to_utf8(pathl);
+
+			if (!g_path_is_absolute(path))
+				{
+				gchar *abs_path = g_build_filename(cwd, path, NULL);
+
+				g_free(path);
+				path = abs_path;
+				}
+			list = g_list_prepend(list, path);
+			}
+		g_free(pathl);
+
+		p = q + 1;
+		}
+
+	g_free(cwd);
+	g_free(data);
+
+	return g_list_reverse(list);
+}
+
+/* the client sends the list as --list-add commands, this is for other senders */
+static void gr_list_add_from(const gchar *text, GIOChannel *channel, gpointer data)
+{
+	RemoteData *remote_data = data;
+	GList *list;
+	GList *work;
+
+	if (strcmp(text, "-") == 0)
+		{
+		log_printf("remote --list-add-from: can not read the stdin of the client\n");
+		return;
+		}
+
+	list = remote_path_list_read(text);
+	for (work = list; work; work = work->next)
+		{
+		remote_data->list_add = g_list_prepend(remote_data->list_add, file_data_new_group(work->data));
+		}
+	string_list_free(list);
 }
 
 static void gr_raise(const gchar *text, GIOChannel *channel, gpointer data)
@@ -732,9 +963,13 @@ static RemoteCommandEntry remote_commands[] = {
 	{ NULL, "file:",                gr_file_load,           TRUE,  FALSE, N_("<FILE>"), N_("open FILE, bring Geeqie window to the top") },
 	{ NULL, "File:",                gr_file_load_no_raise,  TRUE,  FALSE, N_("<FILE>"), N_("open FILE, do not bring Geeqie window to the top") },
 	{ NULL, "--tell",               gr_file_tell,           FALSE, FALSE, NULL, N_("print filename of current image") },
+	{ NULL, "--memory-stats",       gr_memory_stats,        FALSE, FALSE, NULL, N_("print memory used by file entries") },
+	{ NULL, "--perf-stats",         gr_perf_stats,          FALSE, FALSE, NULL, N_("print performance counters of the hot paths") },
+	{ NULL, "--perf-reset",         gr_perf_reset,          FALSE, FALSE, NULL, N_("reset performance counters") },
 	{ NULL, "view:",                gr_file_view,           TRUE,  FALSE, N_("<FILE>"), N_("open FILE in new window") },
 	{ NULL, "--list-clear",         gr_list_clear,          FALSE, FALSE, NULL, N_("clear command line collection list") },
 	{ NULL, "--list-add:",          gr_list_add,            TRUE,  FALSE, N_("<FILE>"), N_("add FILE to command line collection list") },
+	{ NULL, "--list-add-from:",     gr_list_add_from,       TRUE,  FALSE, N_("<LIST>"), N_("add the files in LIST, - for stdin, to command line collection list") },
 	{ NULL, "raise",                gr_raise,               FALSE, FALSE, NULL, N_("bring the Geeqie window to the top") },
 	{ "-ct:", "--cache-thumbs:",    gr_cache_thumb,         TRUE, FALSE, N_("clear|clean"), N_("clear or clean thumbnail cache") },
 	{ "-cs:", "--cache-shared:",    gr_cache_shared,        TRUE, FALSE, N_("clear|clean"), N_("clear or clean shared thumbnail cache") },
@@ -743,6 +978,7 @@ static RemoteCommandEntry remote_commands[] = {
 	{ "-crr:", "--cache-render-recurse:", gr_cache_render_recurse, TRUE, FALSE, N_("<folder> "), N_("render thumbnails recursively") },
 	{ "-crs:", "--cache-render-shared:", gr_cache_render_standard, TRUE, FALSE, N_("<folder> "), N_(" render thumbnails (see Help)") },
 	{ "-crsr:", "--cache-render-shared-recurse:", gr_cache_render_standard_recurse, TRUE, FALSE, N_("<folder>"), N_(" render thumbnails recursively (see Help)") },
+	{ "-j:", "--jobs:",             gr_cache_render_jobs,   TRUE, FALSE, N_("<N>"), N_("render N thumbnails at once, 0 for one per processor") },
 	{ NULL, NULL, NULL, FALSE, FALSE, NULL, NULL }
 };
 
@@ -790,9 +1026,19 @@ static void remote_cb(RemoteConnection *rc, const gchar *text, GIOChannel *chann
 	RemoteCommandEntry *entry;
 	const gchar *offset;
 
+	/* end of a batch */
+	if (!text)
+		{
+		remote_list_add_flush(data);
+		return;
+		}
+
 	entry = remote_command_find(text, &offset);
 	if (entry && entry->func)
 		{
+		/* the files of --list-add are added in one go, before any other command */
+		if (entry->func != gr_list_add && entry->func != gr_list_add_from) remote_list_add_flush(data);
+
 		entry->func(offset, channel, data);
 		}
 	else
@@ -929,10 +1175,11 @@ void remote_control(const gchar *arg_exec, GList *remote_list, const gchar *path
 	if (rc)
 		{
 		GList *work;
+		GList *send = NULL;
 		const gchar *prefix;
 		gboolean use_path = TRUE;
-		gboolean sent = FALSE;
 
+		/* all commands are sent in one batch */
 		work = remote_list;
 		while (work)
 			{
@@ -947,15 +1194,28 @@ void remote_control(const gchar *arg_exec, GList *remote_list, const gchar *path
 			    entry->opt_l &&
 			    strcmp(entry->opt_l, "file:") == 0) use_path = FALSE;
 
-			remote_client_send(rc, text);
+			if (entry && entry->func == gr_list_add_from)
+				{
+				GList *list;
+				GList *list_work;
+
+				/* read here, the list may be the stdin of this client */
+				list = remote_path_list_read(text + strlen(entry->opt_l));
+				for (list_work = list; list_work; list_work = list_work->next)
+					{
+					send = g_list_prepend(send, g_strconcat("--list-add:", list_work->data, NULL));
+					}
+				string_list_free(list);
+				continue;
+				}
 
-			sent = TRUE;
+			send = g_list_prepend(send, g_strdup(text));
 			}
 
 		if (cmd_list && cmd_list->next)
 			{
 			prefix = "--list-add:";
-			remote_client_send(rc, "--list-clear");
+			send = g_list_prepend(send, g_strdup("--list-clear"));
 			}
 		else
 			{
@@ -966,49 +1226,37 @@ void remote_control(const gchar *arg_exec, GList *remote_list, const gchar *path
 		while (work)
 			{
 			FileData *fd;
-			gchar *text;
 
 			fd = work->data;
 			work = work->next;
 
-			text = g_strconcat(prefix, fd->path, NULL);
-			remote_client_send(rc, text);
-			g_free(text);
-
-			sent = TRUE;
+			send = g_list_prepend(send, g_strconcat(prefix, fd->path, NULL));
 			}
 
 		if (path && !cmd_list && use_path)
 			{
-			gchar *text;
-
-			text = g_strdup_printf("file:%s", path);
-			remote_client_send(rc, text);
-			g_free(text);
-
-			sent = TRUE;
+			send = g_list_prepend(send, g_strdup_printf("file:%s", path));
 			}
 
 		work = collection_list;
 		while (work)
 			{
 			const gchar *name;
-			gchar *text;
 
 			name = work->data;
 			work = work->next;
 
-			text = g_strdup_printf("file:%s", name);
-			remote_client_send(rc, text);
-			g_free(text);
-
-			sent = TRUE;
+			send = g_list_prepend(send, g_strdup_printf("file:%s", name));
 			}
 
-		if (!started && !sent)
+		if (!started && !send && !remote_list)
 			{
 			remote_client_send(rc, "raise");
 			}
+
+		send = g_list_reverse(send);
+		remote_client_send_list(rc, send);
+		string_list_free(send);
 		}
 	else
 		{
@@ -1021,7 +1269,7 @@ void remote_control(const gchar *arg_exec, GList *remote_list, const gchar *path
 RemoteConnection *remote_server_init(gchar *path, CollectionData *command_collection)
 {
 	RemoteConnection *remote_connection = remote_server_open(path);
-	RemoteData *remote_data = g_new(RemoteData, 1);
+	RemoteData *remote_data = g_new0(RemoteData, 1);
 
 	remote_data->command_collection = command_collection;
 
@@ -25,6 +25,7 @@
 
 typedef struct _RemoteConnection RemoteConnection;
 
+/* called for each command, then with a NULL text at the end of a batch of commands */
 typedef void RemoteReadFunc(RemoteConnection *rc, const gchar *text, GIOChannel *channel, gpointer data);
 
 struct _RemoteConnection {
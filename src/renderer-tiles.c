@@ -43,7 +43,9 @@
 #ifdef GQ_BUILD
 #include "main.h"
 #include "pixbuf_util.h"
+#include "pixbuf-scale.h"
 #include "exif.h"
+#include "perf.h"
 #else
 typedef enum {
 	EXIF_ORIENTATION_UNKNOWN	= 0,
@@ -62,8 +64,14 @@ typedef enum {
 /* size to use when breaking up image pane for rendering */
 #define PR_TILE_SIZE 128
 
+/* threads that render the high quality pass of the tiles */
+#define PR_RENDER_THREADS 4
+#define PR_RENDER_POLL_INTERVAL 10	/* ms */
+
 typedef struct _ImageTile ImageTile;
 typedef struct _QueueData QueueData;
+typedef struct _TileRegion TileRegion;
+typedef struct _RenderJob RenderJob;
 
 struct _ImageTile
 {
@@ -88,6 +96,7 @@ struct _ImageTile
 
 	QueueData *qd;
 	QueueData *qd2;
+	RenderJob *job;		/* render in progress on a worker thread */
 
 	guint size;		/* est. memory used by pixmap and pixbuf */
 };
@@ -102,6 +111,47 @@ struct _QueueData
 	gboolean new_data;
 };
 
+/* the part of the image that goes into an area of a tile */
+struct _TileRegion
+{
+	gint pb_x;		/* area of the tile pixbuf, before orientation */
+	gint pb_y;
+	gint pb_w;
+	gint pb_h;
+	gdouble src_x;		/* tile position in the image */
+	gdouble src_y;
+	gdouble scale_x;
+	gdouble scale_y;
+	GdkInterpType interp_type;
+};
+
+struct _RenderJob
+{
+	ImageTile *it;		/* NULL once the tile is freed */
+	gint generation;
+	gint x;			/* area of the tile */
+	gint y;
+	gint w;
+	gint h;
+
+	/* read only for the worker */
+	GdkPixbuf *source;
+	TileRegion region;
+	gdouble offset_x;
+	gint orientation;
+	gboolean has_alpha;
+	gint check_x;		/* alpha checkerboard origin */
+	gint check_y;
+	gboolean post_process;	/* done on the main thread, the callback is not thread safe */
+	gboolean post_process_threaded;	/* done by the worker, with the post process lock */
+
+	/* results */
+	GdkPixbuf *pixbuf;
+	GdkPixbuf *spare;
+	cairo_surface_t *surface;
+	gboolean done;
+};
+
 typedef struct _OverlayData OverlayData;
 struct _OverlayData
 {
@@ -147,6 +197,11 @@ struct _RendererTiles
 	gint x_scroll;  /* allow local adjustment and mirroring */
 	gint y_scroll;
 
+	GThreadPool *render_pool;
+	GAsyncQueue *render_done;	/* jobs back from the workers */
+	GList *render_jobs;		/* jobs not yet collected */
+	gint render_generation;		/* bumped when queued renders become stale */
+	guint render_poll_id;
 };
 
 
@@ -314,6 +369,8 @@ static void rt_tile_free(ImageTile *it)
 {
 	if (!it) return;
 
+	if (it->job) it->job->it = NULL;
+
 	if (it->pixbuf) g_object_unref(it->pixbuf);
 	if (it->surface) cairo_surface_destroy(it->surface);
 
@@ -324,6 +381,8 @@ static void rt_tile_free_all(RendererTiles *rt)
 {
 	GList *work;
 
+	g_atomic_int_inc(&rt->render_generation);
+
 	work = rt->tiles;
 	while (work)
 		{
@@ -887,7 +946,15 @@ static GdkPixbuf *rt_get_spare_tile(RendererTiles *rt)
 
 #define COLOR_BYTES 3	/* rgb */
 
-static void rt_tile_rotate_90_clockwise(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
+/* spare is swapped with the tile by the transforms, so each thread needs its own */
+static GdkPixbuf *rt_tile_spare(GdkPixbuf **spare, GdkPixbuf *tile)
+{
+	if (!*spare) *spare = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8,
+					     gdk_pixbuf_get_width(tile), gdk_pixbuf_get_height(tile));
+	return *spare;
+}
+
+static void rt_tile_rotate_90_clockwise(GdkPixbuf **spare, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
 {
 	GdkPixbuf *src = *tile;
 	GdkPixbuf *dest;
@@ -896,13 +963,13 @@ static void rt_tile_rotate_90_clockwise(RendererTiles *rt, GdkPixbuf **tile, gin
 	guchar *sp, *dp;
 	guchar *ip, *spi, *dpi;
 	gint i, j;
-	gint tw = rt->tile_width;
+	gint tw = gdk_pixbuf_get_width(src);
 
 	srs = gdk_pixbuf_get_rowstride(src);
 	s_pix = gdk_pixbuf_get_pixels(src);
 	spi = s_pix + (x * COLOR_BYTES);
 
-	dest = rt_get_spare_tile(rt);
+	dest = rt_tile_spare(spare, src);
 	drs = gdk_pixbuf_get_rowstride(dest);
 	d_pix = gdk_pixbuf_get_pixels(dest);
 	dpi = d_pix + (tw - 1) * COLOR_BYTES;
@@ -919,11 +986,11 @@ static void rt_tile_rotate_90_clockwise(RendererTiles *rt, GdkPixbuf **tile, gin
 			}
 		}
 
-	rt->spare_tile = src;
+	*spare = src;
 	*tile = dest;
 }
 
-static void rt_tile_rotate_90_counter_clockwise(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
+static void rt_tile_rotate_90_counter_clockwise(GdkPixbuf **spare, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
 {
 	GdkPixbuf *src = *tile;
 	GdkPixbuf *dest;
@@ -932,13 +999,13 @@ static void rt_tile_rotate_90_counter_clockwise(RendererTiles *rt, GdkPixbuf **t
 	guchar *sp, *dp;
 	guchar *ip, *spi, *dpi;
 	gint i, j;
-	gint th = rt->tile_height;
+	gint th = gdk_pixbuf_get_height(src);
 
 	srs = gdk_pixbuf_get_rowstride(src);
 	s_pix = gdk_pixbuf_get_pixels(src);
 	spi = s_pix + (x * COLOR_BYTES);
 
-	dest = rt_get_spare_tile(rt);
+	dest = rt_tile_spare(spare, src);
 	drs = gdk_pixbuf_get_rowstride(dest);
 	d_pix = gdk_pixbuf_get_pixels(dest);
 	dpi = d_pix + (th - 1) * drs;
@@ -955,11 +1022,11 @@ static void rt_tile_rotate_90_counter_clockwise(RendererTiles *rt, GdkPixbuf **t
 			}
 		}
 
-	rt->spare_tile = src;
+	*spare = src;
 	*tile = dest;
 }
 
-static void rt_tile_mirror_only(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
+static void rt_tile_mirror_only(GdkPixbuf **spare, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
 {
 	GdkPixbuf *src = *tile;
 	GdkPixbuf *dest;
@@ -969,13 +1036,13 @@ static void rt_tile_mirror_only(RendererTiles *rt, GdkPixbuf **tile, gint x, gin
 	guchar *spi, *dpi;
 	gint i, j;
 
-	gint tw = rt->tile_width;
+	gint tw = gdk_pixbuf_get_width(src);
 
 	srs = gdk_pixbuf_get_rowstride(src);
 	s_pix = gdk_pixbuf_get_pixels(src);
 	spi = s_pix + (x * COLOR_BYTES);
 
-	dest = rt_get_spare_tile(rt);
+	dest = rt_tile_spare(spare, src);
 	drs = gdk_pixbuf_get_rowstride(dest);
 	d_pix = gdk_pixbuf_get_pixels(dest);
 	dpi =  d_pix + (tw - x - 1) * COLOR_BYTES;
@@ -992,11 +1059,11 @@ static void rt_tile_mirror_only(RendererTiles *rt, GdkPixbuf **tile, gint x, gin
 			}
 		}
 
-	rt->spare_tile = src;
+	*spare = src;
 	*tile = dest;
 }
 
-static void rt_tile_mirror_and_flip(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
+static void rt_tile_mirror_and_flip(GdkPixbuf **spare, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
 {
 	GdkPixbuf *src = *tile;
 	GdkPixbuf *dest;
@@ -1005,13 +1072,13 @@ static void rt_tile_mirror_and_flip(RendererTiles *rt, GdkPixbuf **tile, gint x,
 	guchar *sp, *dp;
 	guchar *dpi;
 	gint i, j;
-	gint tw = rt->tile_width;
-	gint th = rt->tile_height;
+	gint tw = gdk_pixbuf_get_width(src);
+	gint th = gdk_pixbuf_get_height(src);
 
 	srs = gdk_pixbuf_get_rowstride(src);
 	s_pix = gdk_pixbuf_get_pixels(src);
 
-	dest = rt_get_spare_tile(rt);
+	dest = rt_tile_spare(spare, src);
 	drs = gdk_pixbuf_get_rowstride(dest);
 	d_pix = gdk_pixbuf_get_pixels(dest);
 	dpi = d_pix + (th - 1) * drs + (tw - 1) * COLOR_BYTES;
@@ -1028,11 +1095,11 @@ static void rt_tile_mirror_and_flip(RendererTiles *rt, GdkPixbuf **tile, gint x,
 			}
 		}
 
-	rt->spare_tile = src;
+	*spare = src;
 	*tile = dest;
 }
 
-static void rt_tile_flip_only(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
+static void rt_tile_flip_only(GdkPixbuf **spare, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
 {
 	GdkPixbuf *src = *tile;
 	GdkPixbuf *dest;
@@ -1041,13 +1108,13 @@ static void rt_tile_flip_only(RendererTiles *rt, GdkPixbuf **tile, gint x, gint
 	guchar *sp, *dp;
 	guchar *spi, *dpi;
 	gint i;
-	gint th = rt->tile_height;
+	gint th = gdk_pixbuf_get_height(src);
 
 	srs = gdk_pixbuf_get_rowstride(src);
 	s_pix = gdk_pixbuf_get_pixels(src);
 	spi = s_pix + (x * COLOR_BYTES);
 
-	dest = rt_get_spare_tile(rt);
+	dest = rt_tile_spare(spare, src);
 	drs = gdk_pixbuf_get_rowstride(dest);
 	d_pix = gdk_pixbuf_get_pixels(dest);
 	dpi = d_pix + (th - 1) * drs + (x * COLOR_BYTES);
@@ -1059,11 +1126,11 @@ static void rt_tile_flip_only(RendererTiles *rt, GdkPixbuf **tile, gint x, gint
 		memcpy(dp, sp, w * COLOR_BYTES);
 		}
 
-	rt->spare_tile = src;
+	*spare = src;
 	*tile = dest;
 }
 
-static void rt_tile_apply_orientation(RendererTiles *rt, gint orientation, GdkPixbuf **pixbuf, gint x, gint y, gint w, gint h)
+static void rt_tile_apply_orientation(GdkPixbuf **spare, gint orientation, GdkPixbuf **pixbuf, gint x, gint y, gint w, gint h)
 {
 	switch (orientation)
 		{
@@ -1073,43 +1140,43 @@ static void rt_tile_apply_orientation(RendererTiles *rt, gint orientation, GdkPi
 		case EXIF_ORIENTATION_TOP_RIGHT:
 			/* mirrored */
 			{
-				rt_tile_mirror_only(rt, pixbuf, x, y, w, h);
+				rt_tile_mirror_only(spare, pixbuf, x, y, w, h);
 			}
 			break;
 		case EXIF_ORIENTATION_BOTTOM_RIGHT:
 			/* upside down */
 			{
-				rt_tile_mirror_and_flip(rt, pixbuf, x, y, w, h);
+				rt_tile_mirror_and_flip(spare, pixbuf, x, y, w, h);
 			}
 			break;
 		case EXIF_ORIENTATION_BOTTOM_LEFT:
 			/* flipped */
 			{
-				rt_tile_flip_only(rt, pixbuf, x, y, w, h);
+				rt_tile_flip_only(spare, pixbuf, x, y, w, h);
 			}
 			break;
 		case EXIF_ORIENTATION_LEFT_TOP:
 			{
-				rt_tile_flip_only(rt, pixbuf, x, y, w, h);
-				rt_tile_rotate_90_clockwise(rt, pixbuf, x, rt->tile_height - y - h, w, h);
+				rt_tile_flip_only(spare, pixbuf, x, y, w, h);
+				rt_tile_rotate_90_clockwise(spare, pixbuf, x, gdk_pixbuf_get_height(*pixbuf) - y - h, w, h);
 			}
 			break;
 		case EXIF_ORIENTATION_RIGHT_TOP:
 			/* rotated -90 (270) */
 			{
-				rt_tile_rotate_90_clockwise(rt, pixbuf, x, y, w, h);
+				rt_tile_rotate_90_clockwise(spare, pixbuf, x, y, w, h);
 			}
 			break;
 		case EXIF_ORIENTATION_RIGHT_BOTTOM:
 			{
-				rt_tile_flip_only(rt, pixbuf, x, y, w, h);
-				rt_tile_rotate_90_counter_clockwise(rt, pixbuf, x, rt->tile_height - y - h, w, h);
+				rt_tile_flip_only(spare, pixbuf, x, y, w, h);
+				rt_tile_rotate_90_counter_clockwise(spare, pixbuf, x, gdk_pixbuf_get_height(*pixbuf) - y - h, w, h);
 			}
 			break;
 		case EXIF_ORIENTATION_LEFT_BOTTOM:
 			/* rotated 90 */
 			{
-				rt_tile_rotate_90_counter_clockwise(rt, pixbuf, x, y, w, h);
+				rt_tile_rotate_90_counter_clockwise(spare, pixbuf, x, y, w, h);
 			}
 			break;
 		default:
@@ -1194,8 +1261,8 @@ static gboolean rt_source_tile_render(RendererTiles *rt, ImageTile *it,
 
 			stx = floor((gdouble)st->x * scale_x);
 			sty = floor((gdouble)st->y * scale_y);
-			stw = ceil((gdouble)(st->x + pr->source_tile_width) * scale_x) - stx;
-			sth = ceil((gdouble)(st->y + pr->source_tile_height) * scale_y) - sty;
+			stw = ceil((gdouble)(st->x + (pr->source_tile_width << st->level)) * scale_x) - stx;
+			sth = ceil((gdouble)(st->y + (pr->source_tile_height << st->level)) * scale_y) - sty;
 
 			if (pr_clip_region(stx, sty, stw, sth,
 					   it->x + x, it->y + y, w, h,
@@ -1204,12 +1271,10 @@ static gboolean rt_source_tile_render(RendererTiles *rt, ImageTile *it,
 
 				if (st->blank)
 					{
-					cairo_t *cr;
-					cr = cairo_create(it->surface);
-					cairo_rectangle (cr, rx - st->x, ry - st->y, rw, rh);
-					cairo_set_source_rgb(cr, 0, 0, 0);
-					cairo_fill (cr);
-					cairo_destroy (cr);
+					/* the tile pixbuf is copied to the surface when drawn */
+					pixbuf_set_rect_fill(it->pixbuf, rx - it->x, ry - it->y, rw, rh,
+							     0, 0, 0, 255);
+					draw = TRUE;
 					}
 				else
 					{
@@ -1220,11 +1285,11 @@ static gboolean rt_source_tile_render(RendererTiles *rt, ImageTile *it,
 					offset_x = (gdouble)(stx - it->x);
 					offset_y = (gdouble)(sty - it->y);
 
-					gdk_pixbuf_scale(st->pixbuf, it->pixbuf, rx - it->x, ry - it->y, rw, rh,
-						 (gdouble) 0.0 + offset_x,
-						 (gdouble) 0.0 + offset_y,
-						 scale_x, scale_y,
-						 (fast) ? GDK_INTERP_NEAREST : pr->zoom_quality);
+					pixbuf_scale_region(st->pixbuf, it->pixbuf, rx - it->x, ry - it->y, rw, rh,
+							    (gdouble) 0.0 + offset_x,
+							    (gdouble) 0.0 + offset_y,
+							    scale_x * (1 << st->level), scale_y * (1 << st->level),
+							    (fast) ? GDK_INTERP_NEAREST : pr->zoom_quality);
 					draw = TRUE;
 					}
 				}
@@ -1255,12 +1320,12 @@ static void rt_tile_get_region(gboolean has_alpha,
 			}
 		else
 			{
-			gdk_pixbuf_scale(src, dest,
-					 pb_x, pb_y, pb_w, pb_h,
-					 offset_x,
-					 offset_y,
-					 scale_x, scale_y,
-					 interp_type);
+			pixbuf_scale_region(src, dest,
+					    pb_x, pb_y, pb_w, pb_h,
+					    offset_x,
+					    offset_y,
+					    scale_x, scale_y,
+					    interp_type);
 			}
 		}
 	else
@@ -1297,9 +1362,50 @@ static gint rt_get_orientation(RendererTiles *rt)
 }
 
 
-static void rt_tile_render(RendererTiles *rt, ImageTile *it,
-			   gint x, gint y, gint w, gint h,
-			   gboolean new_data, gboolean fast)
+static gboolean rt_tile_region_get(RendererTiles *rt, ImageTile *it, gint orientation,
+				   gint x, gint y, gint w, gint h, gboolean fast, TileRegion *r)
+{
+	PixbufRenderer *pr = rt->pr;
+
+	if (pr->image_width == 0 || pr->image_height == 0) return FALSE;
+
+	r->scale_x = (gdouble)pr->width / pr->image_width;
+	r->scale_y = (gdouble)pr->height / pr->image_height;
+
+	pr_tile_coords_map_orientation(orientation, it->x, it->y,
+				    pr->width, pr->height,
+				    rt->tile_width, rt->tile_height,
+				    &r->src_x, &r->src_y);
+	pr_tile_region_map_orientation(orientation, x, y,
+				    rt->tile_width, rt->tile_height,
+				    w, h,
+				    &r->pb_x, &r->pb_y,
+				    &r->pb_w, &r->pb_h);
+
+	switch (orientation)
+		{
+		gdouble tmp;
+		case EXIF_ORIENTATION_LEFT_TOP:
+		case EXIF_ORIENTATION_RIGHT_TOP:
+		case EXIF_ORIENTATION_RIGHT_BOTTOM:
+		case EXIF_ORIENTATION_LEFT_BOTTOM:
+			tmp = r->scale_x;
+			r->scale_x = r->scale_y;
+			r->scale_y = tmp;
+			break;
+		default:
+			/* nothing to do */
+			break;
+		}
+
+	r->interp_type = (fast) ? GDK_INTERP_NEAREST : pr->zoom_quality;
+
+	return TRUE;
+}
+
+static void rt_tile_render_real(RendererTiles *rt, ImageTile *it,
+				gint x, gint y, gint w, gint h,
+				gboolean new_data, gboolean fast)
 {
 	PixbufRenderer *pr = rt->pr;
 	gboolean has_alpha;
@@ -1349,69 +1455,37 @@ static void rt_tile_render(RendererTiles *rt, ImageTile *it,
 		}
 	else
 		{
-		gdouble scale_x, scale_y;
-		gdouble src_x, src_y;
-		gint pb_x, pb_y;
-		gint pb_w, pb_h;
-
-		if (pr->image_width == 0 || pr->image_height == 0) return;
-
-		scale_x = (gdouble)pr->width / pr->image_width;
-		scale_y = (gdouble)pr->height / pr->image_height;
-
-		pr_tile_coords_map_orientation(orientation, it->x, it->y,
-					    pr->width, pr->height,
-					    rt->tile_width, rt->tile_height,
-					    &src_x, &src_y);
-		pr_tile_region_map_orientation(orientation, x, y,
-					    rt->tile_width, rt->tile_height,
-					    w, h,
-					    &pb_x, &pb_y,
-					    &pb_w, &pb_h);
-
-		switch (orientation)
-			{
-			gdouble tmp;
-			case EXIF_ORIENTATION_LEFT_TOP:
-			case EXIF_ORIENTATION_RIGHT_TOP:
-			case EXIF_ORIENTATION_RIGHT_BOTTOM:
-			case EXIF_ORIENTATION_LEFT_BOTTOM:
-				tmp = scale_x;
-				scale_x = scale_y;
-				scale_y = tmp;
-				break;
-			default:
-				/* nothing to do */
-				break;
-			}
+		TileRegion r;
 
 		/* HACK: The pixbuf scalers get kinda buggy(crash) with extremely
 		 * small sizes for anything but GDK_INTERP_NEAREST
 		 */
 		if (pr->width < PR_MIN_SCALE_SIZE || pr->height < PR_MIN_SCALE_SIZE) fast = TRUE;
 
+		if (!rt_tile_region_get(rt, it, orientation, x, y, w, h, fast, &r)) return;
+
 		rt_tile_get_region(has_alpha,
-				   pr->pixbuf, it->pixbuf, pb_x, pb_y, pb_w, pb_h,
-				   (gdouble) 0.0 - src_x - GET_RIGHT_PIXBUF_OFFSET(rt) * scale_x,
-				   (gdouble) 0.0 - src_y,
-				   scale_x, scale_y,
-				   (fast) ? GDK_INTERP_NEAREST : pr->zoom_quality,
-				   it->x + pb_x, it->y + pb_y);
+				   pr->pixbuf, it->pixbuf, r.pb_x, r.pb_y, r.pb_w, r.pb_h,
+				   (gdouble) 0.0 - r.src_x - GET_RIGHT_PIXBUF_OFFSET(rt) * r.scale_x,
+				   (gdouble) 0.0 - r.src_y,
+				   r.scale_x, r.scale_y,
+				   r.interp_type,
+				   it->x + r.pb_x, it->y + r.pb_y);
 		if (rt->stereo_mode & PR_STEREO_ANAGLYPH &&
 		    (pr->stereo_pixbuf_offset_right > 0 || pr->stereo_pixbuf_offset_left > 0))
 			{
 			GdkPixbuf *right_pb = rt_get_spare_tile(rt);
 			rt_tile_get_region(has_alpha,
-					   pr->pixbuf, right_pb, pb_x, pb_y, pb_w, pb_h,
-					   (gdouble) 0.0 - src_x - GET_LEFT_PIXBUF_OFFSET(rt) * scale_x,
-					   (gdouble) 0.0 - src_y,
-					   scale_x, scale_y,
-					   (fast) ? GDK_INTERP_NEAREST : pr->zoom_quality,
-					   it->x + pb_x, it->y + pb_y);
-			pr_create_anaglyph(rt->stereo_mode, it->pixbuf, right_pb, pb_x, pb_y, pb_w, pb_h);
+					   pr->pixbuf, right_pb, r.pb_x, r.pb_y, r.pb_w, r.pb_h,
+					   (gdouble) 0.0 - r.src_x - GET_LEFT_PIXBUF_OFFSET(rt) * r.scale_x,
+					   (gdouble) 0.0 - r.src_y,
+					   r.scale_x, r.scale_y,
+					   r.interp_type,
+					   it->x + r.pb_x, it->y + r.pb_y);
+			pr_create_anaglyph(rt->stereo_mode, it->pixbuf, right_pb, r.pb_x, r.pb_y, r.pb_w, r.pb_h);
 			/* do not care about freeing spare_tile, it will be reused */
 			}
-		rt_tile_apply_orientation(rt, orientation, &it->pixbuf, pb_x, pb_y, pb_w, pb_h);
+		rt_tile_apply_orientation(&rt->spare_tile, orientation, &it->pixbuf, r.pb_x, r.pb_y, r.pb_w, r.pb_h);
 		draw = TRUE;
 		}
 
@@ -1430,39 +1504,55 @@ static void rt_tile_render(RendererTiles *rt, ImageTile *it,
 		}
 }
 
-
-static void rt_tile_expose(RendererTiles *rt, ImageTile *it,
+static void rt_tile_render(RendererTiles *rt, ImageTile *it,
 			   gint x, gint y, gint w, gint h,
 			   gboolean new_data, gboolean fast)
+{
+	PERF_TIMER_DECLARE(timer);
+
+	PERF_TIMER_START(timer);
+	rt_tile_render_real(rt, it, x, y, w, h, new_data, fast);
+	PERF_TIMER_STOP(timer, PERF_TILE_RENDER);
+}
+
+
+static gboolean rt_tile_clamp_visible(RendererTiles *rt, ImageTile *it,
+				      gint *x, gint *y, gint *w, gint *h)
 {
 	PixbufRenderer *pr = rt->pr;
-	GtkWidget *box;
-	GdkWindow *window;
-	cairo_t *cr;
 
-	/* clamp to visible */
-	if (it->x + x < rt->x_scroll)
+	if (it->x + *x < rt->x_scroll)
 		{
-		w -= rt->x_scroll - it->x - x;
-		x = rt->x_scroll - it->x;
+		*w -= rt->x_scroll - it->x - *x;
+		*x = rt->x_scroll - it->x;
 		}
-	if (it->x + x + w > rt->x_scroll + pr->vis_width)
+	if (it->x + *x + *w > rt->x_scroll + pr->vis_width)
 		{
-		w = rt->x_scroll + pr->vis_width - it->x - x;
+		*w = rt->x_scroll + pr->vis_width - it->x - *x;
 		}
-	if (w < 1) return;
-	if (it->y + y < rt->y_scroll)
+	if (*w < 1) return FALSE;
+	if (it->y + *y < rt->y_scroll)
 		{
-		h -= rt->y_scroll - it->y - y;
-		y = rt->y_scroll - it->y;
+		*h -= rt->y_scroll - it->y - *y;
+		*y = rt->y_scroll - it->y;
 		}
-	if (it->y + y + h > rt->y_scroll + pr->vis_height)
+	if (it->y + *y + *h > rt->y_scroll + pr->vis_height)
 		{
-		h = rt->y_scroll + pr->vis_height - it->y - y;
+		*h = rt->y_scroll + pr->vis_height - it->y - *y;
 		}
-	if (h < 1) return;
+	if (*h < 1) return FALSE;
 
-	rt_tile_render(rt, it, x, y, w, h, new_data, fast);
+	return TRUE;
+}
+
+/* copies an area of the tile surface to the window */
+static void rt_tile_draw(RendererTiles *rt, ImageTile *it,
+			 gint x, gint y, gint w, gint h)
+{
+	PixbufRenderer *pr = rt->pr;
+	GtkWidget *box;
+	GdkWindow *window;
+	cairo_t *cr;
 
 	box = GTK_WIDGET(pr);
 	window = gtk_widget_get_window(box);
@@ -1482,6 +1572,16 @@ static void rt_tile_expose(RendererTiles *rt, ImageTile *it,
 		}
 }
 
+static void rt_tile_expose(RendererTiles *rt, ImageTile *it,
+			   gint x, gint y, gint w, gint h,
+			   gboolean new_data, gboolean fast)
+{
+	if (!rt_tile_clamp_visible(rt, it, &x, &y, &w, &h)) return;
+
+	rt_tile_render(rt, it, x, y, w, h, new_data, fast);
+	rt_tile_draw(rt, it, x, y, w, h);
+}
+
 
 static gboolean rt_tile_is_visible(RendererTiles *rt, ImageTile *it)
 {
@@ -1490,6 +1590,248 @@ static gboolean rt_tile_is_visible(RendererTiles *rt, ImageTile *it)
 		it->y + it->h >= rt->y_scroll && it->y < rt->y_scroll + pr->vis_height);
 }
 
+/*
+ *-------------------------------------------------------------------
+ * threaded rendering
+ *-------------------------------------------------------------------
+ */
+
+/* The high quality pass of a visible tile is rendered by a pool of worker
+ * threads. Meanwhile the tile shows its fast pass, the main thread only copies
+ * the finished result to the tile and the window. Jobs from before a zoom or
+ * image change are dropped by comparing generations.
+ */
+
+#ifdef HAVE_GTHREAD
+static void rt_render_job_free(RenderJob *job)
+{
+	if (job->source) g_object_unref(job->source);
+	if (job->pixbuf) g_object_unref(job->pixbuf);
+	if (job->spare) g_object_unref(job->spare);
+	if (job->surface) cairo_surface_destroy(job->surface);
+	g_free(job);
+}
+
+static void rt_render_job_run(gpointer data, gpointer user_data)
+{
+	RenderJob *job = data;
+	RendererTiles *rt = user_data;
+
+	if (job->generation == g_atomic_int_get(&rt->render_generation))
+		{
+		TileRegion *r = &job->region;
+
+		rt_tile_get_region(job->has_alpha,
+				   job->source, job->pixbuf, r->pb_x, r->pb_y, r->pb_w, r->pb_h,
+				   job->offset_x,
+				   (gdouble) 0.0 - r->src_y,
+				   r->scale_x, r->scale_y,
+				   r->interp_type,
+				   job->check_x, job->check_y);
+		rt_tile_apply_orientation(&job->spare, job->orientation, &job->pixbuf,
+					  r->pb_x, r->pb_y, r->pb_w, r->pb_h);
+
+		if (job->post_process_threaded)
+			{
+			PixbufRenderer *pr = rt->pr;
+
+			/* the tiles are corrected concurrently, only a change of the func waits */
+			pixbuf_renderer_post_process_read_lock(pr);
+			if (pr->func_post_process && job->generation == g_atomic_int_get(&rt->render_generation))
+				pr->func_post_process(pr, &job->pixbuf, job->x, job->y, job->w, job->h, pr->post_process_user_data);
+			pixbuf_renderer_post_process_read_unlock(pr);
+			}
+
+		if (!job->post_process)
+			{
+			cairo_t *cr;
+
+			job->surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24, job->w, job->h);
+			cr = cairo_create(job->surface);
+			gdk_cairo_set_source_pixbuf(cr, job->pixbuf, -job->x, -job->y);
+			cairo_paint(cr);
+			cairo_destroy(cr);
+			}
+
+		job->done = TRUE;
+		}
+
+	g_async_queue_push(rt->render_done, job);
+}
+
+static void rt_render_job_finish(RendererTiles *rt, RenderJob *job)
+{
+	PixbufRenderer *pr = rt->pr;
+	ImageTile *it = job->it;
+
+	rt->render_jobs = g_list_remove(rt->render_jobs, job);
+	if (it && it->job == job) it->job = NULL;
+
+	if (it && it->surface && job->done && job->generation == rt->render_generation)
+		{
+		cairo_t *cr;
+		gint x = job->x;
+		gint y = job->y;
+		gint w = job->w;
+		gint h = job->h;
+
+		cr = cairo_create(it->surface);
+		cairo_rectangle(cr, job->x, job->y, job->w, job->h);
+		if (job->post_process)
+			{
+			if (pr->func_post_process)
+				pr->func_post_process(pr, &job->pixbuf, job->x, job->y, job->w, job->h, pr->post_process_user_data);
+			gdk_cairo_set_source_pixbuf(cr, job->pixbuf, 0, 0);
+			}
+		else
+			{
+			cairo_set_source_surface(cr, job->surface, job->x, job->y);
+			}
+		cairo_fill(cr);
+		cairo_destroy(cr);
+
+		if (gtk_widget_get_realized(GTK_WIDGET(pr)) &&
+		    rt_tile_clamp_visible(rt, it, &x, &y, &w, &h))
+			{
+			rt_tile_draw(rt, it, x, y, w, h);
+			}
+		}
+
+	rt_render_job_free(job);
+}
+
+static gboolean rt_render_poll_cb(gpointer data)
+{
+	RendererTiles *rt = data;
+	RenderJob *job;
+
+	while ((job = g_async_queue_try_pop(rt->render_done)))
+		{
+		rt_render_job_finish(rt, job);
+		}
+
+	if (rt->render_jobs) return TRUE;
+
+	rt->render_poll_id = 0;
+	if (!rt->draw_idle_id) pr_render_complete_signal(rt->pr);
+
+	return FALSE;
+}
+
+/* returns FALSE when the tile is to be rendered right away instead */
+static gboolean rt_tile_render_async(RendererTiles *rt, ImageTile *it,
+				     gint x, gint y, gint w, gint h, gboolean new_data)
+{
+	PixbufRenderer *pr = rt->pr;
+	RenderJob *job;
+	TileRegion r;
+	gint orientation;
+
+	if (new_data) it->blank = FALSE;
+
+	/* only tiles that already show something, and only when scaling */
+	if (pr->loading || !pr->pixbuf || pr->source_tiles_enabled ||
+	    it->blank || !it->surface || pr->scale == 1.0 ||
+	    pr->width < PR_MIN_SCALE_SIZE || pr->height < PR_MIN_SCALE_SIZE ||
+	    (rt->stereo_mode & PR_STEREO_ANAGLYPH)) return FALSE;
+
+	/* nothing to render, the same checks as rt_tile_render() */
+	if (it->render_todo == TILE_RENDER_NONE && !new_data) return FALSE;
+	if (it->render_done == TILE_RENDER_ALL && it->render_todo != TILE_RENDER_AREA) return FALSE;
+
+	if (it->render_done != TILE_RENDER_ALL || it->job)
+		{
+		/* a pending job is replaced by one for the whole tile */
+		x = 0;
+		y = 0;
+		w = it->w;
+		h = it->h;
+		}
+
+	orientation = rt_get_orientation(rt);
+	if (!rt_tile_region_get(rt, it, orientation, x, y, w, h, FALSE, &r)) return FALSE;
+
+	it->render_done = TILE_RENDER_ALL;
+	it->render_todo = TILE_RENDER_NONE;
+
+	if (it->job) it->job->it = NULL;
+
+	job = g_new0(RenderJob, 1);
+	job->it = it;
+	job->generation = rt->render_generation;
+	job->x = x;
+	job->y = y;
+	job->w = w;
+	job->h = h;
+	job->source = g_object_ref(pr->pixbuf);
+	job->region = r;
+	job->offset_x = (gdouble) 0.0 - r.src_x - GET_RIGHT_PIXBUF_OFFSET(rt) * r.scale_x;
+	job->orientation = orientation;
+	job->has_alpha = gdk_pixbuf_get_has_alpha(pr->pixbuf);
+	job->check_x = it->x + r.pb_x;
+	job->check_y = it->y + r.pb_y;
+	job->post_process = (pr->func_post_process != NULL && !pr->post_process_threaded);
+	job->post_process_threaded = (pr->func_post_process != NULL && pr->post_process_threaded);
+	job->pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, rt->tile_width, rt->tile_height);
+
+	it->job = job;
+	rt->render_jobs = g_list_prepend(rt->render_jobs, job);
+
+	if (!rt->render_pool)
+		{
+		rt->render_done = g_async_queue_new();
+		rt->render_pool = g_thread_pool_new(rt_render_job_run, rt, PR_RENDER_THREADS, FALSE, NULL);
+		}
+	g_thread_pool_push(rt->render_pool, job, NULL);
+
+	if (!rt->render_poll_id)
+		{
+		rt->render_poll_id = g_timeout_add(PR_RENDER_POLL_INTERVAL, rt_render_poll_cb, rt);
+		}
+
+	/* show what the tile has until the job is done */
+	if (rt_tile_clamp_visible(rt, it, &x, &y, &w, &h)) rt_tile_draw(rt, it, x, y, w, h);
+
+	return TRUE;
+}
+#endif
+
+static void rt_render_free(RendererTiles *rt)
+{
+#ifdef HAVE_GTHREAD
+	GList *work;
+
+	if (rt->render_pool)
+		{
+		/* drop the jobs not yet started and wait for the others */
+		g_thread_pool_free(rt->render_pool, TRUE, TRUE);
+		rt->render_pool = NULL;
+		}
+	if (rt->render_done)
+		{
+		g_async_queue_unref(rt->render_done);
+		rt->render_done = NULL;
+		}
+	if (rt->render_poll_id)
+		{
+		g_source_remove(rt->render_poll_id);
+		rt->render_poll_id = 0;
+		}
+
+	work = rt->render_jobs;
+	while (work)
+		{
+		RenderJob *job = work->data;
+		work = work->next;
+
+		if (job->it) job->it->job = NULL;
+		rt_render_job_free(job);
+		}
+	g_list_free(rt->render_jobs);
+	rt->render_jobs = NULL;
+#endif
+}
+
 /*
  *-------------------------------------------------------------------
  * draw queue
@@ -1596,7 +1938,10 @@ static gboolean rt_queue_draw_idle_cb(gpointer data)
 		{
 		if (rt_tile_is_visible(rt, qd->it))
 			{
-			rt_tile_expose(rt, qd->it, qd->x, qd->y, qd->w, qd->h, qd->new_data, fast);
+#ifdef HAVE_GTHREAD
+			if (fast || !rt_tile_render_async(rt, qd->it, qd->x, qd->y, qd->w, qd->h, qd->new_data))
+#endif
+				rt_tile_expose(rt, qd->it, qd->x, qd->y, qd->w, qd->h, qd->new_data, fast);
 			}
 		else if (qd->new_data)
 			{
@@ -1640,7 +1985,8 @@ static gboolean rt_queue_draw_idle_cb(gpointer data)
 
 	if (!rt->draw_queue && !rt->draw_queue_2pass)
 		{
-		pr_render_complete_signal(pr);
+		/* otherwise signalled once the workers are done */
+		if (!rt->render_jobs) pr_render_complete_signal(pr);
 
 		rt->draw_idle_id = 0;
 		return FALSE;
@@ -1671,6 +2017,8 @@ static void rt_queue_list_free(GList *list)
 
 static void rt_queue_clear(RendererTiles *rt)
 {
+	g_atomic_int_inc(&rt->render_generation);
+
 	rt_queue_list_free(rt->draw_queue);
 	rt->draw_queue = NULL;
 
@@ -2064,6 +2412,7 @@ static void renderer_free(void *renderer)
 {
 	RendererTiles *rt = (RendererTiles *)renderer;
 	rt_queue_clear(rt);
+	rt_render_free(rt);
 	rt_tile_free_all(rt);
 	if (rt->spare_tile) g_object_unref(rt->spare_tile);
 	if (rt->overlay_buffer) g_object_unref(rt->overlay_buffer);
@@ -297,7 +297,7 @@ static gint search_result_count(SearchData *sd, gint64 *bytes);
 
 static void search_window_close(SearchData *sd);
 
-static void search_notify_cb(FileData *fd, NotifyType type, gpointer data);
+static void search_notify_batch_cb(const FileDataNotifyEvent *events, guint count, gpointer data);
 
 /*
  *-------------------------------------------------------------------
@@ -2485,10 +2485,8 @@ static gint search_result_sort_cb(GtkTreeModel *model, GtkTreeIter *a, GtkTreeIt
 			return 0;
 			break;
 		case SEARCH_COLUMN_NAME:
-			if (options->file_sort.case_sensitive)
-				return strcmp(fda->fd->collate_key_name, fdb->fd->collate_key_name);
-			else
-				return strcmp(fda->fd->collate_key_name_nocase, fdb->fd->collate_key_name_nocase);
+			return strcmp(file_data_get_collate_key(fda->fd, options->file_sort.case_sensitive),
+				      file_data_get_collate_key(fdb->fd, options->file_sort.case_sensitive));
 			break;
 		case SEARCH_COLUMN_SIZE:
 			if (fda->fd->size > fdb->fd->size) return 1;
@@ -2796,7 +2794,7 @@ static void search_window_destroy_cb(GtkWidget *widget, gpointer data)
 	g_free(sd->search_similarity_path);
 	string_list_free(sd->search_keyword_list);
 
-	file_data_unregister_notify_func(search_notify_cb, sd);
+	file_data_unregister_notify_batch_func(search_notify_batch_cb, sd);
 
 	g_free(sd);
 }
@@ -3154,7 +3152,7 @@ void search_new(FileData *dir_fd, FileData *example_file)
 
 	search_window_list = g_list_append(search_window_list, sd);
 
-	file_data_register_notify_func(search_notify_cb, sd, NOTIFY_PRIORITY_MEDIUM);
+	file_data_register_notify_batch_func(search_notify_batch_cb, sd, NOTIFY_PRIORITY_MEDIUM);
 
 	gtk_widget_show(sd->window);
 }
@@ -3165,7 +3163,8 @@ void search_new(FileData *dir_fd, FileData *example_file)
  *-------------------------------------------------------------------
  */
 
-static void search_result_change_path(SearchData *sd, FileData *fd)
+/* one pass over the results for all changed files of a batch */
+static void search_result_change_paths(SearchData *sd, GHashTable *changed)
 {
 	GtkTreeModel *store;
 	GtkTreeIter iter;
@@ -3177,46 +3176,59 @@ static void search_result_change_path(SearchData *sd, FileData *fd)
 		{
 		GtkTreeIter current;
 		MatchFileData *mfd;
+		const FileDataNotifyEvent *event;
 
 		current = iter;
 		valid = gtk_tree_model_iter_next(store, &iter);
 
 		gtk_tree_model_get(store, &current, SEARCH_COLUMN_POINTER, &mfd, -1);
-		if (mfd->fd == fd)
+		event = g_hash_table_lookup(changed, mfd->fd);
+		if (!event) continue;
+
+		if (event->change_type != FILEDATA_CHANGE_DELETE)
 			{
-			if (fd->change && fd->change->dest)
-				{
-				gtk_list_store_set(GTK_LIST_STORE(store), &current,
-						   SEARCH_COLUMN_NAME, mfd->fd->name,
-						   SEARCH_COLUMN_PATH, mfd->fd->path, -1);
-				}
-			else
-				{
-				search_result_remove_item(sd, mfd, &current);
-				}
+			gtk_list_store_set(GTK_LIST_STORE(store), &current,
+					   SEARCH_COLUMN_NAME, mfd->fd->name,
+					   SEARCH_COLUMN_PATH, mfd->fd->path, -1);
+			}
+		else
+			{
+			search_result_remove_item(sd, mfd, &current);
 			}
 		}
 }
 
-static void search_notify_cb(FileData *fd, NotifyType type, gpointer data)
+static void search_notify_batch_cb(const FileDataNotifyEvent *events, guint count, gpointer data)
 {
 	SearchData *sd = data;
+	GHashTable *changed;
+	guint i;
 
-	if (!(type & NOTIFY_CHANGE) || !fd->change) return;
+	changed = g_hash_table_new(g_direct_hash, g_direct_equal);
+	for (i = 0; i < count; i++)
+		{
+		if (!(events[i].type & NOTIFY_CHANGE) || !events[i].change) continue;
 
-	DEBUG_1("Notify search: %s %04x", fd->path, type);
+		switch (events[i].change_type)
+			{
+			case FILEDATA_CHANGE_MOVE:
+			case FILEDATA_CHANGE_RENAME:
+			case FILEDATA_CHANGE_DELETE:
+				g_hash_table_insert(changed, events[i].fd, (gpointer)&events[i]);
+				break;
+			case FILEDATA_CHANGE_COPY:
+			case FILEDATA_CHANGE_UNSPECIFIED:
+			case FILEDATA_CHANGE_WRITE_METADATA:
+				break;
+			}
+		}
 
-	switch (fd->change->type)
+	if (g_hash_table_size(changed) > 0)
 		{
-		case FILEDATA_CHANGE_MOVE:
-		case FILEDATA_CHANGE_RENAME:
-		case FILEDATA_CHANGE_DELETE:
-			search_result_change_path(sd, fd);
-			break;
-		case FILEDATA_CHANGE_COPY:
-		case FILEDATA_CHANGE_UNSPECIFIED:
-		case FILEDATA_CHANGE_WRITE_METADATA:
-			break;
+		DEBUG_1("Notify search: %u files", g_hash_table_size(changed));
+		search_result_change_paths(sd, changed);
 		}
+
+	g_hash_table_destroy(changed);
 }
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2008 - 2016 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "main.h"
+#include "startup_trace.h"
+
+#include "secure_save.h"
+#include "ui_fileops.h"
+
+/*
+ *-----------------------------------------------------------------------------
+ * startup trace
+ *-----------------------------------------------------------------------------
+ */
+
+/* The phases of the startup are recorded from the beginning of main() until
+ * the first image is decoded and the first thumbnail is done, or until
+ * STARTUP_TRACE_TIMEOUT after the main loop starts. Each phase name is
+ * recorded once, so a phase that repeats, like an image decode, gives the time
+ * to its first occurrence. The phases are printed at debug level 1 and, with
+ * --trace-startup:<file>, written in the Chrome trace event format, which
+ * chrome://tracing and Perfetto can open.
+ *
+ * Only to be used from the main thread.
+ */
+
+/* seconds after the start of the main loop when the trace ends anyway */
+#define STARTUP_TRACE_TIMEOUT 10
+
+/* the phases that end the trace when both are done */
+#define STARTUP_TRACE_LAST_IMAGE "image decode"
+#define STARTUP_TRACE_LAST_THUMB "thumbnail"
+
+typedef struct _StartupTraceEvent StartupTraceEvent;
+struct _StartupTraceEvent {
+	const gchar *name;	/* static string */
+	gint64 start;		/* microseconds from startup_trace_init() */
+	gint64 duration;	/* -1 while running, 0 for a mark */
+};
+
+static GTimer *startup_trace_timer = NULL;
+static GArray *startup_trace_events = NULL;
+static gchar *startup_trace_file = NULL;
+static guint startup_trace_timeout_id = 0; /* event source id */
+
+void startup_trace_init(void)
+{
+	if (startup_trace_timer) return;
+
+	startup_trace_timer = g_timer_new();
+	startup_trace_events = g_array_new(FALSE, FALSE, sizeof(StartupTraceEvent));
+}
+
+void startup_trace_set_file(const gchar *path)
+{
+	g_free(startup_trace_file);
+	startup_trace_file = g_strdup(path);
+}
+
+static gint64 startup_trace_now(void)
+{
+	return (gint64)(g_timer_elapsed(startup_trace_timer, NULL) * 1000000.0);
+}
+
+static StartupTraceEvent *startup_trace_find(const gchar *name)
+{
+	guint i;
+
+	for (i = 0; i < startup_trace_events->len; i++)
+		{
+		StartupTraceEvent *event = &g_array_index(startup_trace_events, StartupTraceEvent, i);
+
+		if (strcmp(event->name, name) == 0) return event;
+		}
+
+	return NULL;
+}
+
+static gboolean startup_trace_done(const gchar *name)
+{
+	StartupTraceEvent *event = startup_trace_find(name);
+
+	return (event && event->duration >= 0);
+}
+
+static void startup_trace_add(const gchar *name, gint64 duration)
+{
+	StartupTraceEvent event;
+
+	if (!startup_trace_events || startup_trace_find(name)) return;
+
+	event.name = name;
+	event.start = startup_trace_now();
+	event.duration = duration;
+	g_array_append_val(startup_trace_events, event);
+}
+
+/* name must be a static string */
+void startup_trace_begin(const gchar *name)
+{
+	startup_trace_add(name, -1);
+}
+
+void startup_trace_end(const gchar *name)
+{
+	StartupTraceEvent *event;
+
+	if (!startup_trace_events) return;
+
+	event = startup_trace_find(name);
+	if (!event || event->duration >= 0) return;
+
+	event->duration = startup_trace_now() - event->start;
+	DEBUG_1("startup: %s took %.3f ms, done at %.3f ms", name,
+		event->duration / 1000.0, (event->start + event->duration) / 1000.0);
+
+	if (startup_trace_done(STARTUP_TRACE_LAST_IMAGE) && startup_trace_done(STARTUP_TRACE_LAST_THUMB))
+		{
+		startup_trace_finish();
+		}
+}
+
+/* name must be a static string */
+void startup_trace_mark(const gchar *name)
+{
+	if (!startup_trace_events) return;
+
+	startup_trace_add(name, 0);
+	DEBUG_1("startup: %s at %.3f ms", name, startup_trace_now() / 1000.0);
+}
+
+static void startup_trace_write(const gchar *path)
+{
+	SecureSaveInfo *ssi;
+	gchar *pathl;
+	guint i;
+
+	pathl = path_from_utf8(path);
+	ssi = secure_open(pathl);
+	g_free(pathl);
+	if (!ssi)
+		{
+		log_printf(_("Unable to write startup trace: %s\n"), path);
+		return;
+		}
+
+	secure_fprintf(ssi, "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"version\":\"%s\"},\"traceEvents\":[\n", VERSION);
+
+	for (i = 0; i < startup_trace_events->len; i++)
+		{
+		StartupTraceEvent *event = &g_array_index(startup_trace_events, StartupTraceEvent, i);
+		const gchar *sep = (i + 1 < startup_trace_events->len) ? "," : "";
+
+		if (event->duration > 0)
+			{
+			secure_fprintf(ssi, "{\"name\":\"%s\",\"cat\":\"startup\",\"ph\":\"X\",\"pid\":1,\"tid\":1,"
+					    "\"ts\":%" G_GINT64_FORMAT ",\"dur\":%" G_GINT64_FORMAT "}%s\n",
+				       event->name, event->start, event->duration, sep);
+			}
+		else
+			{
+			/* marks, and phases that did not end before the trace */
+			secure_fprintf(ssi, "{\"name\":\"%s\",\"cat\":\"startup\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":1,"
+					    "\"ts\":%" G_GINT64_FORMAT "}%s\n",
+				       event->name, event->start, sep);
+			}
+		}
+
+	secure_fputs(ssi, "]}\n");
+
+	if (secure_close(ssi))
+		{
+		log_printf(_("Unable to write startup trace: %s\nerror: %s\n"), path,
+			   secsave_strerror(secsave_errno));
+		}
+}
+
+static gboolean startup_trace_timeout_cb(gpointer data)
+{
+	startup_trace_timeout_id = 0;
+	startup_trace_finish();
+	return FALSE;
+}
+
+/* called right before gtk_main() */
+void startup_trace_main_loop(void)
+{
+	startup_trace_mark("main loop");
+
+	if (!startup_trace_events) return;
+
+	startup_trace_timeout_id = g_timeout_add_seconds(STARTUP_TRACE_TIMEOUT, startup_trace_timeout_cb, NULL);
+}
+
+/* writes the trace file and stops recording, safe to call more than once */
+void startup_trace_finish(void)
+{
+	if (!startup_trace_events) return;
+
+	DEBUG_1("startup: trace finished at %.3f ms", startup_trace_now() / 1000.0);
+
+	if (startup_trace_file) startup_trace_write(startup_trace_file);
+
+	if (startup_trace_timeout_id) g_source_remove(startup_trace_timeout_id);
+	startup_trace_timeout_id = 0;
+
+	g_array_free(startup_trace_events, TRUE);
+	startup_trace_events = NULL;
+	g_timer_destroy(startup_trace_timer);
+	startup_trace_timer = NULL;
+	g_free(startup_trace_file);
+	startup_trace_file = NULL;
+}
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,32 @@
+/*
+ * Copyright (C) 2008 - 2016 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef STARTUP_TRACE_H
+#define STARTUP_TRACE_H
+
+void startup_trace_init(void);
+void startup_trace_set_file(const gchar *path);
+void startup_trace_main_loop(void);
+void startup_trace_finish(void);
+
+void startup_trace_begin(const gchar *name);
+void startup_trace_end(const gchar *name);
+void startup_trace_mark(const gchar *name);
+
+#endif /* STARTUP_TRACE_H */
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
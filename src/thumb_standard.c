@@ -30,6 +30,7 @@
 #include "filedata.h"
 #include "exif.h"
 #include "metadata.h"
+#include "perf.h"
 
 
 /*
@@ -578,6 +579,7 @@ static void thumb_loader_std_done_cb(ImageLoader *il, gpointer data)
 		tl->fd->thumb_pixbuf = thumb_loader_std_finish(tl, pixbuf, image_loader_get_shrunk(il));
 		}
 
+	PERF_TIMER_STOP(tl->perf_start, PERF_THUMBNAIL);
 	if (tl->func_done) tl->func_done(tl, tl->data);
 }
 
@@ -665,6 +667,7 @@ gboolean thumb_loader_std_start(ThumbLoaderStd *tl, FileData *fd)
 	if (!tl || !fd) return FALSE;
 
 	thumb_loader_std_reset(tl);
+	PERF_TIMER_START(tl->perf_start);
 
 
 	tl->fd = file_data_ref(fd);
@@ -800,6 +803,40 @@ static void thumb_loader_std_thumb_file_validate_finish(ThumbValidate *tv, gbool
 	thumb_loader_std_thumb_file_validate_free(tv);
 }
 
+/* checks the Thumb::URI and Thumb::MTime markers of the thumbnail at thumbl,
+ * thumbl is in the file system encoding. No debug output, it runs in worker threads.
+ */
+static gboolean thumb_std_cache_markers_valid(const gchar *thumbl, const gchar *uri, const gchar *mtime_str, gint days)
+{
+	struct stat st;
+	gboolean valid = FALSE;
+
+	if (strncmp(uri, "file:", strlen("file:")) == 0)
+		{
+		gchar *target;
+
+		target = g_filename_from_uri(uri, NULL, NULL);
+		if (target && stat(target, &st) == 0 &&
+		    st.st_mtime == strtol(mtime_str, NULL, 10))
+			{
+			valid = TRUE;
+			}
+		g_free(target);
+		}
+	else if (stat(thumbl, &st) == 0)
+		{
+		time_t now;
+
+		now = time(NULL);
+		if (st.st_atime >= now - (time_t)days * 24 * 60 * 60)
+			{
+			valid = TRUE;
+			}
+		}
+
+	return valid;
+}
+
 static void thumb_loader_std_thumb_file_validate_done_cb(ThumbLoaderStd *tl, gpointer data)
 {
 	ThumbValidate *tv = data;
@@ -818,36 +855,16 @@ static void thumb_loader_std_thumb_file_validate_done_cb(ThumbLoaderStd *tl, gpo
 		mtime_str = gdk_pixbuf_get_option(pixbuf, THUMB_MARKER_MTIME);
 		if (uri && mtime_str)
 			{
-			if (strncmp(uri, "file:", strlen("file:")) == 0)
-				{
-				struct stat st;
-				gchar *target;
+			gchar *thumbl;
 
-				target = g_filename_from_uri(uri, NULL, NULL);
-				if (stat(target, &st) == 0 &&
-				    st.st_mtime == strtol(mtime_str, NULL, 10))
-					{
-					valid = TRUE;
-					}
-				g_free(target);
-				}
-			else
+			if (strncmp(uri, "file:", strlen("file:")) != 0)
 				{
-				struct stat st;
-
 				DEBUG_1("thumb uri foreign, doing day check: %s", uri);
-
-				if (stat_utf8(tv->path, &st))
-					{
-					time_t now;
-
-					now = time(NULL);
-					if (st.st_atime >= now - (time_t)tv->days * 24 * 60 * 60)
-						{
-						valid = TRUE;
-						}
-					}
 				}
+
+			thumbl = path_from_utf8(tv->path);
+			valid = thumb_std_cache_markers_valid(thumbl, uri, mtime_str, tv->days);
+			g_free(thumbl);
 			}
 		else
 			{
@@ -910,6 +927,140 @@ ThumbLoaderStd *thumb_loader_std_thumb_file_validate(const gchar *thumb_path, gi
 	return tv->tl;
 }
 
+gboolean thumb_std_cache_recent(const gchar *source, gint width, gint height, gboolean local)
+{
+	const gchar *folders[2];
+	struct stat st;
+	gchar *sourcel;
+	gchar *uri;
+	gboolean recent = FALSE;
+	gint i;
+
+	sourcel = path_from_utf8(source);
+	if (stat(sourcel, &st) != 0)
+		{
+		g_free(sourcel);
+		return FALSE;
+		}
+	uri = g_filename_to_uri(sourcel, NULL, NULL);
+	g_free(sourcel);
+	if (!uri) return FALSE;
+
+	folders[0] = (width > THUMB_SIZE_NORMAL || height > THUMB_SIZE_NORMAL) ? THUMB_FOLDER_LARGE : THUMB_FOLDER_NORMAL;
+	folders[1] = THUMB_FOLDER_FAIL;
+
+	for (i = 0; i < 2 && !recent; i++)
+		{
+		gchar *thumb_path;
+		struct stat thumb_st;
+
+		thumb_path = thumb_std_cache_path(source,
+						  (local) ? filename_from_path(uri) : uri,
+						  local, folders[i]);
+		recent = (thumb_path && stat_utf8(thumb_path, &thumb_st) &&
+			  thumb_st.st_mtime >= st.st_mtime);
+		g_free(thumb_path);
+		}
+
+	g_free(uri);
+
+	return recent;
+}
+
+/* longest text chunk read from a thumbnail, the uri is the long one */
+#define THUMB_STD_TEXT_MAX 16384
+
+static guint32 thumb_std_png_uint32(const guchar *buf)
+{
+	return ((guint32)buf[0] << 24) | ((guint32)buf[1] << 16) | ((guint32)buf[2] << 8) | (guint32)buf[3];
+}
+
+/* Reads the text chunks in front of the image data of a png thumbnail,
+ * the pixels are never read or decoded. Returns FALSE for a file that is not a png.
+ */
+static gboolean thumb_std_png_markers(FILE *f, gchar **uri, gchar **mtime_str)
+{
+	static const guchar png_signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	guchar buf[8];
+
+	if (fread(buf, 1, 8, f) != 8 || memcmp(buf, png_signature, 8) != 0) return FALSE;
+
+	while (!(*uri && *mtime_str) && fread(buf, 1, 8, f) == 8)
+		{
+		guint32 length = thumb_std_png_uint32(buf);
+		const gchar *type = (const gchar *)buf + 4;
+
+		if (memcmp(type, "IDAT", 4) == 0 || memcmp(type, "IEND", 4) == 0) break;
+
+		if (memcmp(type, "tEXt", 4) == 0 && length < THUMB_STD_TEXT_MAX)
+			{
+			gchar *text = g_malloc(length + 1);
+			gsize keyword_len;
+
+			if (fread(text, 1, length, f) != length)
+				{
+				g_free(text);
+				break;
+				}
+			text[length] = '\0';
+
+			/* keyword, a nul, then the value */
+			keyword_len = strlen(text);
+			if (keyword_len < length)
+				{
+				if (!*uri && strcmp(text, "Thumb::URI") == 0)
+					{
+					*uri = g_strdup(text + keyword_len + 1);
+					}
+				else if (!*mtime_str && strcmp(text, "Thumb::MTime") == 0)
+					{
+					*mtime_str = g_strdup(text + keyword_len + 1);
+					}
+				}
+			g_free(text);
+
+			/* crc */
+			if (fseek(f, 4, SEEK_CUR) != 0) break;
+			}
+		else if (fseek(f, (glong)length + 4, SEEK_CUR) != 0)
+			{
+			break;
+			}
+		}
+
+	return TRUE;
+}
+
+/**
+ * @brief Validates a non local thumbnail file without loading its image.
+ * @param thumbl path of the thumbnail, in the file system encoding
+ * @param allowed_days age limit for thumbnails of a non file: uri
+ *
+ * Gives the same result as thumb_loader_std_thumb_file_validate(),
+ * but only the png header is read and it may be called from any thread.
+ */
+gboolean thumb_std_cache_file_valid(const gchar *thumbl, gint allowed_days)
+{
+	FILE *f;
+	gchar *uri = NULL;
+	gchar *mtime_str = NULL;
+	gboolean valid = FALSE;
+
+	f = fopen(thumbl, "rb");
+	if (!f) return FALSE;
+
+	if (thumb_std_png_markers(f, &uri, &mtime_str) && uri && mtime_str)
+		{
+		valid = thumb_std_cache_markers_valid(thumbl, uri, mtime_str, allowed_days);
+		}
+	fclose(f);
+
+	g_free(uri);
+	g_free(mtime_str);
+
+	return valid;
+}
+
 static void thumb_std_maint_remove_one(const gchar *source, const gchar *uri, gboolean local,
 				       const gchar *subfolder)
 {
@@ -64,6 +64,9 @@ struct _ThumbLoaderStd
 	gboolean cache_retry;
 
 	gdouble progress;
+#ifdef PERF_COUNTERS
+	gint64 perf_start; /* for the thumbnail latency counter */
+#endif
 
 	ThumbLoaderStdFunc func_done;
 	ThumbLoaderStdFunc func_error;
@@ -95,6 +98,12 @@ ThumbLoaderStd *thumb_loader_std_thumb_file_validate(const gchar *thumb_path, gi
 						     gpointer data);
 void thumb_loader_std_thumb_file_validate_cancel(ThumbLoaderStd *tl);
 
+/* same check reading only the png header, thread safe, thumbl is in the file system encoding */
+gboolean thumb_std_cache_file_valid(const gchar *thumbl, gint allowed_days);
+
+
+/* a thumbnail or failure mark newer than the source exists, nothing is decoded */
+gboolean thumb_std_cache_recent(const gchar *source, gint width, gint height, gboolean local);
 
 void thumb_std_maint_removed(const gchar *source);
 void thumb_std_maint_moved(const gchar *source, const gchar *dest);
@@ -265,6 +265,8 @@ typedef enum {
 typedef struct _ImageLoader ImageLoader;
 typedef struct _ThumbLoader ThumbLoader;
 
+typedef struct _CacheSimPack CacheSimPack;
+
 typedef struct _AnimationData AnimationData;
 
 typedef struct _CollectInfo CollectInfo;
@@ -275,6 +277,8 @@ typedef struct _CollectWindow CollectWindow;
 typedef struct _ImageWindow ImageWindow;
 
 typedef struct _FileData FileData;
+typedef struct _FileDataCold FileDataCold;
+typedef struct _FileDataArena FileDataArena;
 typedef struct _FileDataChangeInfo FileDataChangeInfo;
 
 typedef struct _LayoutWindow LayoutWindow;
@@ -392,6 +396,14 @@ struct _CollectionData
 	gboolean changed;
 
 	GHashTable *existence;
+
+	/* the collection file as last written or read from its index,
+	 * a save appends to it while the list still starts with these files */
+	gchar *saved_path;
+	GPtrArray *saved_files;		/* referenced FileData, in file order */
+	gchar *saved_geometry;		/* NULL when the file has none */
+	gint64 saved_size;
+	gint64 saved_mtime;
 };
 
 struct _CollectTable
@@ -541,26 +553,24 @@ struct _FileDataChangeInfo {
 	gboolean regroup_when_finished;
 };
 
+/* rarely used FileData members, allocated on first write by file_data_cold() */
+struct _FileDataCold {
+	gchar *extended_extension;
+	HistMap *histmap;
+	GHashTable *modified_xmp; // hash table which contains unwritten xmp metadata in format: key->list of string values
+	GList *cached_metadata;
+};
+
 struct _FileData {
-	guint magick;
-	gint type;
-	gchar *original_path; /* key to file_data_pool hash table */
+	gchar *original_path; /* key to file_data_pool hash table, shares the string with path when equal */
 	gchar *path;
 	const gchar *name;
 	const gchar *extension;
-	gchar *extended_extension;
-	FileFormatClass format_class;
-	gchar *collate_key_name;
-	gchar *collate_key_name_nocase;
-	gint64 size;
-	time_t date;
-	time_t cdate;
-	mode_t mode; /* this is needed at least for notification in view_dir because it is preserved after the file/directory is deleted */
-	gint sidecar_priority;
-
-	guint marks; /* each bit represents one mark */
-	guint valid_marks; /* zero bit means that the corresponding mark needs to be reread */
+	FileDataArena *arena; /* owns path and original_path, NULL after a rename */
+	FileDataCold *cold; /* NULL until one of the cold members is set */
 
+	gchar *collate_key_name; /* computed on demand, see file_data_get_collate_key() */
+	gchar *collate_key_name_nocase;
 
 	GList *sidecar_files;
 	FileData *parent; /* parent file if this is a sidecar file, NULL otherwise */
@@ -570,23 +580,34 @@ struct _FileData {
 	GdkPixbuf *pixbuf; /* full-size image, only complete images, NULL during loading
 			      all FileData with non-NULL pixbuf are referenced by image_cache */
 
-	HistMap *histmap;
+	ExifData *exif;
+
+	gint64 size;
+	time_t date;
+	time_t cdate;
+	time_t exifdate;
+
+	guint magick;
+	gint type;
+	FileFormatClass format_class;
+	mode_t mode; /* this is needed at least for notification in view_dir because it is preserved after the file/directory is deleted */
+	gint sidecar_priority;
+
+	guint marks; /* each bit represents one mark */
+	guint valid_marks; /* zero bit means that the corresponding mark needs to be reread */
 
-	gboolean locked;
 	gint ref;
 	gint version; /* increased when any field in this structure is changed */
-	gboolean disable_grouping;
 
 	gint user_orientation;
 	gint exif_orientation;
-
-	ExifData *exif;
-	time_t exifdate;
-	GHashTable *modified_xmp; // hash table which contains unwritten xmp metadata in format: key->list of string values
-	GList *cached_metadata;
 	gint rating;
 
 	SelectionType selected;  // Used by view_file_icon.
+
+	guint locked : 1;
+	guint disable_grouping : 1;
+	guint collate_natural : 1; /* collate keys were computed with options->file_sort.natural */
 };
 
 struct _LayoutOptions
@@ -799,6 +820,9 @@ struct _ViewDir
 	GtkWidget *view;
 
 	FileData *dir_fd;
+	FileData *notify_fd; /* folder the notifications are registered for */
+	gchar *notify_path;
+	gboolean notify_registered;
 
 	FileData *click_fd;
 
@@ -874,6 +898,8 @@ struct _ViewFile
 	/* refresh */
 	guint refresh_idle_id; /* event source id */
 	time_t time_refresh_set; /* time when refresh_idle_id was set */
+	FileData *notify_fd; /* folder the notifications are registered for */
+	gchar *notify_path;
 
 	/* file list for edit menu */
 	GList *editmenu_fd_list;
@@ -31,6 +31,15 @@
 #include <sys/param.h>
 #include <dirent.h>
 #include <utime.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#ifdef HAVE_LINUX_FS_H
+#  include <linux/fs.h>
+#endif
+#ifdef HAVE_SYS_SENDFILE_H
+#  include <sys/sendfile.h>
+#endif
 
 #include <glib.h>
 #include <gtk/gtk.h>	/* for locale warning dialog */
@@ -514,17 +523,146 @@ static gboolean hard_linked(const gchar *a, const gchar *b)
 		sta.st_ino == stb.st_ino);
 }
 
-gboolean copy_file(const gchar *s, const gchar *t)
+/* buffer of the read/write fallback, large enough to keep fast disks busy */
+#define COPY_FILE_BUFFER_SIZE (1024 * 1024)
+/* chunk of the in-kernel copies, limits the time spent in one call */
+#define COPY_FILE_CHUNK_SIZE (64 * 1024 * 1024)
+
+/* errors that mean the method is not available for these files, try the next one */
+static gboolean copy_file_try_next(gint err)
+{
+	return (err == ENOSYS || err == EXDEV || err == EINVAL || err == EBADF ||
+#ifdef EOPNOTSUPP
+		err == EOPNOTSUPP ||
+#endif
+		err == ENOTTY || err == EPERM);
+}
+
+/*
+ * copies the data from fi to fo, both at offset 0,
+ * tries a reflink, then in-kernel copies and finally read/write,
+ * size is only a hint, the data is copied up to the end of fi
+ */
+static gboolean copy_file_data(gint fi, gint fo, gint64 size, CopyFileStats *stats)
+{
+	gint64 done = 0;
+	gchar *buf;
+
+#if defined(HAVE_LINUX_FS_H) && defined(FICLONE)
+	/* btrfs, XFS and others share the extents, nothing is copied */
+	if (ioctl(fo, FICLONE, fi) == 0)
+		{
+		stats->method = "clone";
+		stats->bytes = size;
+		return TRUE;
+		}
+#endif
+
+#ifdef HAVE_COPY_FILE_RANGE
+	/* can be offloaded to the server on NFS 4.2 and SMB */
+	stats->method = "copy_file_range";
+	while (done < size)
+		{
+		ssize_t n = copy_file_range(fi, NULL, fo, NULL, MIN(size - done, COPY_FILE_CHUNK_SIZE), 0);
+
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0)
+			{
+			if (n == 0 || copy_file_try_next(errno)) break;
+			return FALSE;
+			}
+		done += n;
+		}
+#endif
+
+#if defined(HAVE_SENDFILE) && defined(HAVE_SYS_SENDFILE_H)
+	if (done < size) stats->method = "sendfile";
+	while (done < size)
+		{
+		ssize_t n = sendfile(fo, fi, NULL, MIN(size - done, COPY_FILE_CHUNK_SIZE));
+
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0)
+			{
+			if (n == 0 || copy_file_try_next(errno)) break;
+			return FALSE;
+			}
+		done += n;
+		}
+#endif
+
+	/*
+	 * continues where the methods above stopped, they moved both file offsets,
+	 * after them it only reads the end of file, unless fi has grown or has
+	 * no size like the files in /proc
+	 */
+	if (size == 0 || done < size)
+		{
+		stats->method = "read/write";
+#ifdef HAVE_POSIX_FADVISE
+		posix_fadvise(fi, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+		}
+
+	buf = g_malloc(COPY_FILE_BUFFER_SIZE);
+	while (TRUE)
+		{
+		ssize_t n = read(fi, buf, COPY_FILE_BUFFER_SIZE);
+		ssize_t w = 0;
+
+		if (n < 0 && errno == EINTR) continue;
+		if (n < 0)
+			{
+			g_free(buf);
+			return FALSE;
+			}
+		if (n == 0) break;
+
+		while (w < n)
+			{
+			ssize_t r = write(fo, buf + w, n - w);
+
+			if (r < 0 && errno == EINTR) continue;
+			if (r <= 0)
+				{
+				g_free(buf);
+				return FALSE;
+				}
+			w += r;
+			}
+		done += n;
+		}
+	g_free(buf);
+
+#ifdef HAVE_POSIX_FADVISE
+	/* the copied data is not going to be read again soon */
+	posix_fadvise(fi, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+
+	stats->bytes = done;
+	return TRUE;
+}
+
+/**
+ * \brief Copies file s to t, with the attributes of s
+ * \param stats if not NULL, receives the copy method, size and time, can be used from threads
+ *
+ * The data is written to a temporary file which is renamed to t on success.
+ */
+gboolean copy_file_full(const gchar *s, const gchar *t, CopyFileStats *stats)
 {
-	FILE *fi = NULL;
-	FILE *fo = NULL;
+	CopyFileStats local_stats;
+	struct stat st;
 	gchar *sl = NULL;
 	gchar *tl = NULL;
 	gchar *randname = NULL;
-	gchar buf[16384];
-	size_t b;
+	GTimer *timer;
 	gint ret = FALSE;
-	gint fd = -1;
+	gint fi = -1;
+	gint fo = -1;
+
+	if (!stats) stats = &local_stats;
+	memset(stats, 0, sizeof(CopyFileStats));
 
 	sl = path_from_utf8(s);
 	tl = path_from_utf8(t);
@@ -535,56 +673,79 @@ gboolean copy_file(const gchar *s, const gchar *t)
 		goto end;
 		}
 
-	fi = fopen(sl, "rb");
-	if (!fi) goto end;
+	fi = open(sl, O_RDONLY);
+	if (fi == -1 || fstat(fi, &st) != 0) goto end;
 
 	/* First we write to a temporary file, then we rename it on success,
 	   and attributes from original file are copied */
 	randname = g_strconcat(tl, ".tmp_XXXXXX", NULL);
 	if (!randname) goto end;
 
-	fd = g_mkstemp(randname);
-	if (fd == -1) goto end;
-
-	fo = fdopen(fd, "wb");
-	if (!fo) {
-		close(fd);
-		goto end;
-	}
+	fo = g_mkstemp(randname);
+	if (fo == -1) goto end;
 
-	while ((b = fread(buf, sizeof(gchar), sizeof(buf), fi)) && b != 0)
-		{
-		if (fwrite(buf, sizeof(gchar), b, fo) != b)
-			{
-			unlink(randname);
-			goto end;
-			}
-		}
+	timer = g_timer_new();
+	ret = copy_file_data(fi, fo, st.st_size, stats);
+	stats->seconds = g_timer_elapsed(timer, NULL);
+	g_timer_destroy(timer);
 
-	fclose(fi); fi = NULL;
-	fclose(fo); fo = NULL;
+	close(fi);
+	fi = -1;
+	if (close(fo) != 0) ret = FALSE;
+	fo = -1;
 
-	if (rename(randname, tl) < 0) {
+	if (!ret || rename(randname, tl) < 0)
+		{
 		unlink(randname);
+		ret = FALSE;
 		goto end;
-	}
+		}
 
 	ret = copy_file_attributes(s, t, TRUE, TRUE);
 
 end:
-	if (fi) fclose(fi);
-	if (fo) fclose(fo);
-	if (sl) g_free(sl);
-	if (tl) g_free(tl);
-	if (randname) g_free(randname);
+	if (fi != -1) close(fi);
+	if (fo != -1) close(fo);
+	g_free(sl);
+	g_free(tl);
+	g_free(randname);
 	return ret;
 }
 
-gboolean move_file(const gchar *s, const gchar *t)
+static void copy_file_report(const gchar *t, CopyFileStats *stats)
 {
+	if (!stats->method || !stats->bytes) return;
+
+	DEBUG_1("copy %s: %" G_GINT64_FORMAT " bytes in %.3fs, %.1f MB/s (%s)", t, stats->bytes, stats->seconds,
+		stats->seconds > 0.0 ? stats->bytes / stats->seconds / 1000000.0 : 0.0, stats->method);
+}
+
+gboolean copy_file(const gchar *s, const gchar *t)
+{
+	CopyFileStats stats;
+	gboolean ret;
+
+	ret = copy_file_full(s, t, &stats);
+	if (ret) copy_file_report(t, &stats);
+
+	return ret;
+}
+
+/**
+ * \brief Moves file s to t, copies and deletes s when a rename is not possible
+ * \param stats if not NULL, receives the copy statistics, the method is "rename" when no data was copied
+ *
+ * Does not log, can be used from threads.
+ */
+gboolean move_file_full(const gchar *s, const gchar *t, CopyFileStats *stats)
+{
+	CopyFileStats local_stats;
 	gchar *sl, *tl;
 	gboolean ret = TRUE;
 
+	if (!stats) stats = &local_stats;
+	memset(stats, 0, sizeof(CopyFileStats));
+
 	if (!s || !t) return FALSE;
 
 	sl = path_from_utf8(s);
@@ -593,7 +754,7 @@ gboolean move_file(const gchar *s, const gchar *t)
 		{
 		/* this may have failed because moving a file across filesystems
 		was attempted, so try copy and delete instead */
-		if (copy_file(s, t))
+		if (copy_file_full(s, t, stats))
 			{
 			if (unlink(sl) < 0)
 				{
@@ -606,12 +767,27 @@ gboolean move_file(const gchar *s, const gchar *t)
 			ret = FALSE;
 			}
 		}
+	else
+		{
+		stats->method = "rename";
+		}
 	g_free(sl);
 	g_free(tl);
 
 	return ret;
 }
 
+gboolean move_file(const gchar *s, const gchar *t)
+{
+	CopyFileStats stats;
+	gboolean ret;
+
+	ret = move_file_full(s, t, &stats);
+	if (ret) copy_file_report(t, &stats);
+
+	return ret;
+}
+
 gboolean rename_file(const gchar *s, const gchar *t)
 {
 	gchar *sl, *tl;
@@ -74,7 +74,16 @@ gboolean symlink_utf8(const gchar *source, const gchar *target);
 gboolean mkdir_utf8(const gchar *s, gint mode);
 gboolean rmdir_utf8(const gchar *s);
 gboolean copy_file_attributes(const gchar *s, const gchar *t, gint perms, gint mtime);
+typedef struct _CopyFileStats CopyFileStats;
+struct _CopyFileStats {
+	const gchar *method; /* "clone", "copy_file_range", "sendfile" or "read/write", NULL if nothing was copied */
+	gint64 bytes;
+	gdouble seconds; /* time spent copying the data */
+};
+
+gboolean copy_file_full(const gchar *s, const gchar *t, CopyFileStats *stats);
 gboolean copy_file(const gchar *s, const gchar *t);
+gboolean move_file_full(const gchar *s, const gchar *t, CopyFileStats *stats);
 gboolean move_file(const gchar *s, const gchar *t);
 gboolean rename_file(const gchar *s, const gchar *t);
 gchar *get_current_dir(void);
@@ -275,6 +275,7 @@ struct _UtilityDataMessages {
 };
 
 typedef struct _UtilityData UtilityData;
+typedef struct _UtilityTransfer UtilityTransfer;
 
 struct _UtilityData {
 	UtilityType type;
@@ -292,6 +293,7 @@ struct _UtilityData {
 
 	guint update_idle_id; /* event source id */
 	guint perform_idle_id; /* event source id */
+	UtilityTransfer *transfer; /* internal operation running in threads, NULL otherwise */
 
 	gboolean with_sidecars; /* operate on grouped or single files; TRUE = use file_data_sc_, FALSE = use file_data_ functions */
 
@@ -695,6 +697,505 @@ static gboolean file_util_perform_ci_internal(gpointer data)
 	return TRUE;
 }
 
+#ifdef HAVE_GTHREAD
+/*
+ *--------------------------------------------------------------------------
+ * Background transfers
+ *--------------------------------------------------------------------------
+ */
+
+/* Copies, moves and deletes of many files run on threads, with
+ * options->file_ops.transfer_jobs workers for each pair of source and
+ * destination devices. The workers only get path strings, the results are
+ * applied to the FileData by the main loop, through file_util_perform_ci_cb().
+ */
+
+/* ms between progress updates and result processing */
+#define UTILITY_TRANSFER_POLL_INTERVAL 100
+/* seconds before the progress dialog appears */
+#define UTILITY_TRANSFER_DIALOG_DELAY 0.5
+
+typedef struct _UtilityTransferDevice UtilityTransferDevice;
+typedef struct _UtilityTransferJob UtilityTransferJob;
+
+struct _UtilityTransferDevice {
+	UtilityTransfer *ut;
+	GThreadPool *pool;
+	GAsyncQueue *pending;	/* UtilityTransferJob waiting for a worker */
+	gint workers;		/* use g_atomic_int_* */
+};
+
+/* one FileData with its sidecars, done by a single worker */
+struct _UtilityTransferJob {
+	FileData *fd;		/* only used by the main thread */
+	FileDataChangeType type;
+	gchar **source;		/* UTF-8, sidecars first, like file_data_sc_perform_ci() */
+	gchar **dest;		/* NULL for delete */
+
+	/* set by the worker */
+	gboolean success;
+	gint64 bytes;
+};
+
+struct _UtilityTransfer {
+	UtilityData *ud;
+	GHashTable *devices;	/* "source device:destination device" -> UtilityTransferDevice */
+	GAsyncQueue *done;	/* finished UtilityTransferJob */
+	GList *failed;		/* FileData that could not be changed */
+	GTimer *timer;
+	guint idle_id; /* event source id */
+
+	gint jobs;
+	gint total;
+	gint count_done;
+	gint64 bytes;
+
+	/* read by the workers, use g_atomic_int_* */
+	gint paused;
+	gint cancel;
+
+	GenericDialog *gd;
+	GtkWidget *progress;
+	GtkWidget *button_pause;
+	GtkWidget *button_resume;
+};
+
+static void file_util_transfer_job_free(UtilityTransferJob *job)
+{
+	g_strfreev(job->source);
+	g_strfreev(job->dest);
+	g_free(job);
+}
+
+static gboolean file_util_transfer_job_perform(UtilityTransferJob *job)
+{
+	gboolean ret = TRUE;
+	gint i;
+
+	for (i = 0; job->source[i]; i++)
+		{
+		const gchar *source = job->source[i];
+		CopyFileStats stats;
+		gboolean success = FALSE;
+
+		memset(&stats, 0, sizeof(CopyFileStats));
+
+		switch (job->type)
+			{
+			case FILEDATA_CHANGE_COPY:
+				success = copy_file_full(source, job->dest[i], &stats);
+				break;
+			case FILEDATA_CHANGE_MOVE:
+			case FILEDATA_CHANGE_RENAME:
+				success = move_file_full(source, job->dest[i], &stats);
+				break;
+			case FILEDATA_CHANGE_DELETE:
+				if (isdir(source) && !islink(source))
+					success = rmdir_utf8(source);
+				else
+					success = unlink_file(source);
+				break;
+			default:
+				break;
+			}
+
+		if (!success) ret = FALSE;
+		job->bytes += stats.bytes;
+		}
+
+	return ret;
+}
+
+static void file_util_transfer_thread_run(gpointer data, gpointer user_data)
+{
+	UtilityTransferDevice *dev = data;
+	UtilityTransfer *ut = dev->ut;
+	UtilityTransferJob *job;
+
+	/* a worker takes jobs until the queue is empty, or the transfer is paused or cancelled */
+	while (!g_atomic_int_get(&ut->paused) && !g_atomic_int_get(&ut->cancel) &&
+	       (job = g_async_queue_try_pop(dev->pending)))
+		{
+		job->success = file_util_transfer_job_perform(job);
+		g_async_queue_push(ut->done, job);
+		}
+
+	g_atomic_int_add(&dev->workers, -1);
+}
+
+static void file_util_transfer_device_free(gpointer data)
+{
+	UtilityTransferDevice *dev = data;
+	UtilityTransferJob *job;
+
+	g_thread_pool_free(dev->pool, FALSE, TRUE);
+	while ((job = g_async_queue_try_pop(dev->pending))) file_util_transfer_job_free(job);
+	g_async_queue_unref(dev->pending);
+	g_free(dev);
+}
+
+/* starts workers for the queued jobs, up to ut->jobs per device */
+static void file_util_transfer_start_workers(UtilityTransfer *ut)
+{
+	GHashTableIter iter;
+	gpointer value;
+
+	if (g_atomic_int_get(&ut->paused) || g_atomic_int_get(&ut->cancel)) return;
+
+	g_hash_table_iter_init(&iter, ut->devices);
+	while (g_hash_table_iter_next(&iter, NULL, &value))
+		{
+		UtilityTransferDevice *dev = value;
+		gint queued = g_async_queue_length(dev->pending);
+
+		while (queued > 0 && g_atomic_int_get(&dev->workers) < ut->jobs)
+			{
+			g_atomic_int_inc(&dev->workers);
+			g_thread_pool_push(dev->pool, dev, NULL);
+			queued--;
+			}
+		}
+}
+
+static gboolean file_util_transfer_running(UtilityTransfer *ut)
+{
+	GHashTableIter iter;
+	gpointer value;
+
+	g_hash_table_iter_init(&iter, ut->devices);
+	while (g_hash_table_iter_next(&iter, NULL, &value))
+		{
+		UtilityTransferDevice *dev = value;
+
+		if (g_atomic_int_get(&dev->workers) > 0) return TRUE;
+		}
+
+	return FALSE;
+}
+
+static void file_util_transfer_progress_update(UtilityTransfer *ut)
+{
+	gchar *buf;
+	gdouble elapsed;
+
+	if (!ut->gd) return;
+
+	elapsed = g_timer_elapsed(ut->timer, NULL);
+	if (g_atomic_int_get(&ut->paused))
+		{
+		buf = g_strdup_printf(_("%d of %d files, paused"), ut->count_done, ut->total);
+		}
+	else
+		{
+		buf = g_strdup_printf(_("%d of %d files, %.1f MB/s"), ut->count_done, ut->total,
+				      (elapsed > 0.0) ? ut->bytes / elapsed / 1000000.0 : 0.0);
+		}
+
+	gtk_progress_bar_set_text(GTK_PROGRESS_BAR(ut->progress), buf);
+	gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(ut->progress),
+				      (ut->total > 0) ? (gdouble)ut->count_done / ut->total : 0.0);
+	g_free(buf);
+}
+
+static void file_util_transfer_pause_cb(GenericDialog *gd, gpointer data)
+{
+	UtilityTransfer *ut = data;
+
+	g_atomic_int_set(&ut->paused, TRUE);
+	gtk_widget_set_sensitive(ut->button_pause, FALSE);
+	gtk_widget_set_sensitive(ut->button_resume, TRUE);
+	file_util_transfer_progress_update(ut);
+}
+
+static void file_util_transfer_resume_cb(GenericDialog *gd, gpointer data)
+{
+	UtilityTransfer *ut = data;
+
+	g_atomic_int_set(&ut->paused, FALSE);
+	gtk_widget_set_sensitive(ut->button_pause, TRUE);
+	gtk_widget_set_sensitive(ut->button_resume, FALSE);
+	file_util_transfer_start_workers(ut);
+	file_util_transfer_progress_update(ut);
+}
+
+/* the jobs already started are finished, the others are skipped */
+static void file_util_transfer_stop_cb(GenericDialog *gd, gpointer data)
+{
+	UtilityTransfer *ut = data;
+
+	g_atomic_int_set(&ut->cancel, TRUE);
+	gtk_widget_set_sensitive(ut->button_pause, FALSE);
+	gtk_widget_set_sensitive(ut->button_resume, FALSE);
+	gtk_widget_set_sensitive(gd->cancel_button, FALSE);
+}
+
+static void file_util_transfer_dialog_new(UtilityTransfer *ut)
+{
+	ut->gd = file_util_gen_dlg(ut->ud->messages.title, "dlg_transfer",
+				   ut->ud->parent, FALSE,
+				   file_util_transfer_stop_cb, ut);
+	generic_dialog_add_message(ut->gd, NULL, ut->ud->messages.title, NULL, FALSE);
+
+	ut->button_resume = generic_dialog_add_button(ut->gd, GTK_STOCK_MEDIA_PLAY, _("_Resume"),
+						      file_util_transfer_resume_cb, FALSE);
+	gtk_widget_set_sensitive(ut->button_resume, FALSE);
+	ut->button_pause = generic_dialog_add_button(ut->gd, GTK_STOCK_MEDIA_PAUSE, _("_Pause"),
+						     file_util_transfer_pause_cb, FALSE);
+
+	ut->progress = gtk_progress_bar_new();
+#if GTK_CHECK_VERSION(3,0,0)
+	gtk_progress_bar_set_show_text(GTK_PROGRESS_BAR(ut->progress), TRUE);
+#endif
+	gtk_box_pack_start(GTK_BOX(ut->gd->vbox), ut->progress, FALSE, FALSE, 0);
+	gtk_widget_show(ut->progress);
+
+	file_util_transfer_progress_update(ut);
+	gtk_widget_show(ut->gd->dialog);
+}
+
+static void file_util_transfer_finish(UtilityTransfer *ut)
+{
+	UtilityData *ud = ut->ud;
+	GList *failed;
+	GList *skipped;
+	GList *work;
+
+	DEBUG_1("%s: %d files, %" G_GINT64_FORMAT " bytes in %.3fs, %d failed", ud->messages.title,
+		ut->count_done, ut->bytes, g_timer_elapsed(ut->timer, NULL), (gint)g_list_length(ut->failed));
+
+	failed = ut->failed;
+	ut->failed = NULL;
+
+	/* what is left in ud->flist and did not fail was skipped by a cancel */
+	skipped = g_list_copy(ud->flist);
+	for (work = failed; work; work = work->next) skipped = g_list_remove(skipped, work->data);
+
+	if (ut->gd) generic_dialog_close(ut->gd);
+	g_hash_table_destroy(ut->devices);
+	g_async_queue_unref(ut->done);
+	g_timer_destroy(ut->timer);
+	g_free(ut);
+	ud->transfer = NULL;
+
+	if (skipped) file_util_perform_ci_cb(GINT_TO_POINTER(TRUE), EDITOR_ERROR_SKIPPED, skipped, ud);
+	g_list_free(skipped);
+
+	/* ends the operation, errors are reported in one dialog */
+	file_util_perform_ci_cb(NULL, failed ? EDITOR_ERROR_STATUS : 0, failed, ud);
+	g_list_free(failed);
+}
+
+static gboolean file_util_transfer_idle_cb(gpointer data)
+{
+	UtilityTransfer *ut = data;
+	UtilityTransferJob *job;
+
+	while ((job = g_async_queue_try_pop(ut->done)))
+		{
+		ut->count_done++;
+		ut->bytes += job->bytes;
+
+		if (job->success)
+			{
+			GList *single_entry = g_list_append(NULL, job->fd);
+
+			file_util_perform_ci_cb(GINT_TO_POINTER(TRUE), 0, single_entry, ut->ud);
+			g_list_free(single_entry);
+			}
+		else
+			{
+			ut->failed = g_list_prepend(ut->failed, job->fd);
+			}
+		file_util_transfer_job_free(job);
+		}
+
+	if ((ut->count_done < ut->total && !g_atomic_int_get(&ut->cancel)) ||
+	    file_util_transfer_running(ut))
+		{
+		file_util_transfer_start_workers(ut);
+
+		if (!ut->gd && g_timer_elapsed(ut->timer, NULL) > UTILITY_TRANSFER_DIALOG_DELAY)
+			{
+			file_util_transfer_dialog_new(ut);
+			}
+		file_util_transfer_progress_update(ut);
+		return TRUE;
+		}
+
+	ut->idle_id = 0;
+	ut->failed = g_list_reverse(ut->failed);
+	file_util_transfer_finish(ut);
+	return FALSE;
+}
+
+/* the workers must not log, see path_from_utf8() */
+static gboolean file_util_transfer_path_valid(const gchar *path)
+{
+	gchar *sl;
+
+	if (!path) return FALSE;
+
+	sl = g_filename_from_utf8(path, -1, NULL, NULL, NULL);
+	g_free(sl);
+
+	return (sl != NULL);
+}
+
+static gboolean file_util_transfer_type_valid(FileDataChangeType type)
+{
+	switch (type)
+		{
+		case FILEDATA_CHANGE_COPY:
+		case FILEDATA_CHANGE_MOVE:
+		case FILEDATA_CHANGE_RENAME:
+			return TRUE;
+		case FILEDATA_CHANGE_DELETE:
+			/* safe delete can show dialogs */
+			return !options->file_ops.safe_delete_enable;
+		default:
+			return FALSE;
+		}
+}
+
+static guint64 file_util_transfer_device(const gchar *path)
+{
+	struct stat st;
+	gchar *dir;
+	guint64 dev = 0;
+
+	dir = remove_level_from_path(path);
+	if (stat_utf8(dir, &st)) dev = (guint64)st.st_dev;
+	g_free(dir);
+
+	return dev;
+}
+
+static UtilityTransferJob *file_util_transfer_job_new(UtilityData *ud, FileData *fd)
+{
+	UtilityTransferJob *job;
+	GList *work;
+	GList *list = NULL;
+	gint n;
+	gint i;
+
+	if (!fd->change || !file_util_transfer_type_valid(fd->change->type)) return NULL;
+
+	if (ud->with_sidecars) list = g_list_copy(fd->sidecar_files);
+	list = g_list_append(list, fd);
+
+	job = g_new0(UtilityTransferJob, 1);
+	job->fd = fd;
+	job->type = fd->change->type;
+
+	n = g_list_length(list);
+	job->source = g_new0(gchar *, n + 1);
+	if (job->type != FILEDATA_CHANGE_DELETE) job->dest = g_new0(gchar *, n + 1);
+
+	for (work = list, i = 0; work; work = work->next, i++)
+		{
+		FileData *sfd = work->data;
+
+		if (!sfd->change ||
+		    !file_util_transfer_path_valid(sfd->change->source) ||
+		    (job->dest && !file_util_transfer_path_valid(sfd->change->dest)))
+			{
+			g_list_free(list);
+			file_util_transfer_job_free(job);
+			return NULL;
+			}
+
+		job->source[i] = g_strdup(sfd->change->source);
+		if (job->dest) job->dest[i] = g_strdup(sfd->change->dest);
+		}
+	g_list_free(list);
+
+	return job;
+}
+
+/*
+ * Performs the operation of ud on threads, returns FALSE when the list
+ * contains a change that must run on the main thread
+ */
+static gboolean file_util_perform_ci_transfer(UtilityData *ud)
+{
+	UtilityTransfer *ut;
+	GList *jobs = NULL;
+	GList *work;
+
+	if (!ud->flist || !ud->flist->next) return FALSE;
+
+	for (work = ud->flist; work; work = work->next)
+		{
+		FileData *fd = work->data;
+		UtilityTransferJob *job;
+
+		if (ud->with_sidecars && !file_data_sc_check_ci(fd, fd->change->type))
+			{
+			/* fails the same way as file_data_sc_perform_ci() */
+			job = g_new0(UtilityTransferJob, 1);
+			job->fd = fd;
+			}
+		else if (!(job = file_util_transfer_job_new(ud, fd)))
+			{
+			g_list_foreach(jobs, (GFunc)file_util_transfer_job_free, NULL);
+			g_list_free(jobs);
+			return FALSE;
+			}
+
+		jobs = g_list_prepend(jobs, job);
+		}
+	jobs = g_list_reverse(jobs);
+
+	ut = g_new0(UtilityTransfer, 1);
+	ut->ud = ud;
+	ut->jobs = MAX(options->file_ops.transfer_jobs, 1);
+	ut->total = g_list_length(jobs);
+	ut->devices = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, file_util_transfer_device_free);
+	ut->done = g_async_queue_new();
+	ut->timer = g_timer_new();
+	ud->transfer = ut;
+
+	for (work = jobs; work; work = work->next)
+		{
+		UtilityTransferJob *job = work->data;
+		UtilityTransferDevice *dev;
+		gchar *key;
+
+		if (!job->source)
+			{
+			/* failed the check */
+			g_async_queue_push(ut->done, job);
+			continue;
+			}
+
+		key = g_strdup_printf("%" G_GUINT64_FORMAT ":%" G_GUINT64_FORMAT,
+				      file_util_transfer_device(job->source[0]),
+				      job->dest ? file_util_transfer_device(job->dest[0]) : 0);
+		dev = g_hash_table_lookup(ut->devices, key);
+		if (!dev)
+			{
+			dev = g_new0(UtilityTransferDevice, 1);
+			dev->ut = ut;
+			dev->pending = g_async_queue_new();
+			dev->pool = g_thread_pool_new(file_util_transfer_thread_run, NULL, ut->jobs, FALSE, NULL);
+			g_hash_table_insert(ut->devices, key, dev);
+			}
+		else
+			{
+			g_free(key);
+			}
+
+		g_async_queue_push(dev->pending, job);
+		}
+	g_list_free(jobs);
+
+	file_util_transfer_start_workers(ut);
+	ut->idle_id = g_timeout_add(UTILITY_TRANSFER_POLL_INTERVAL, file_util_transfer_idle_cb, ut);
+
+	return TRUE;
+}
+#endif
+
 static void file_util_perform_ci_dir(UtilityData *ud, gboolean internal, gboolean ext_result)
 {
 	switch (ud->type)
@@ -933,6 +1434,9 @@ void file_util_perform_ci(UtilityData *ud)
 			}
 		else
 			{
+#ifdef HAVE_GTHREAD
+			if (file_util_perform_ci_transfer(ud)) return;
+#endif
 			file_util_perform_ci_internal(ud);
 			}
 		}
@@ -2018,9 +2522,9 @@ static void file_util_write_metadata_details_dialog(UtilityData *ud, FileData *f
 	gint i;
 	const gchar *stock_id;
 
-	if (fd && fd->modified_xmp)
+	if (fd && fd->cold && fd->cold->modified_xmp)
 		{
-		keys = g_hash_table_get_keys(fd->modified_xmp);
+		keys = g_hash_table_get_keys(fd->cold->modified_xmp);
 		}
 
 	g_assert(keys);
@@ -2923,7 +3427,7 @@ static gboolean file_util_write_metadata_first(UtilityType type, UtilityPhase ph
 			return FALSE; /* another op. in progress, let the caller handle it */
 			}
 
-		if (fd->modified_xmp) /* has unsaved metadata */
+		if (fd->cold && fd->cold->modified_xmp) /* has unsaved metadata */
 			{
 			unsaved = g_list_prepend(unsaved, file_data_ref(fd));
 			}
@@ -75,11 +75,53 @@ static void folder_icons_free(PixmapFolders *pf)
 
 static void vd_notify_cb(FileData *fd, NotifyType type, gpointer data);
 
+/* the list listens to its folder only, the tree shows folders all over the file system */
+static void vd_notify_register(ViewDir *vd)
+{
+	if (vd->type == DIRVIEW_TREE)
+		{
+		file_data_register_notify_func(vd_notify_cb, vd, NOTIFY_PRIORITY_HIGH);
+		vd->notify_registered = TRUE;
+		return;
+		}
+
+	if (!vd->dir_fd) return;
+
+	/* the path is kept, dir_fd can be renamed meanwhile */
+	vd->notify_fd = file_data_ref(vd->dir_fd);
+	vd->notify_path = g_strdup(vd->dir_fd->path);
+
+	file_data_register_notify_fd_func(vd->notify_fd, vd_notify_cb, vd);
+	file_data_register_notify_dir_func(vd->notify_path, vd_notify_cb, vd);
+	vd->notify_registered = TRUE;
+}
+
+static void vd_notify_unregister(ViewDir *vd)
+{
+	if (!vd->notify_registered) return;
+
+	if (vd->type == DIRVIEW_TREE)
+		{
+		file_data_unregister_notify_func(vd_notify_cb, vd);
+		}
+	else
+		{
+		file_data_unregister_notify_fd_func(vd->notify_fd, vd_notify_cb, vd);
+		file_data_unregister_notify_dir_func(vd->notify_path, vd_notify_cb, vd);
+
+		file_data_unref(vd->notify_fd);
+		vd->notify_fd = NULL;
+		g_free(vd->notify_path);
+		vd->notify_path = NULL;
+		}
+	vd->notify_registered = FALSE;
+}
+
 static void vd_destroy_cb(GtkWidget *widget, gpointer data)
 {
 	ViewDir *vd = data;
 
-	file_data_unregister_notify_func(vd_notify_cb, vd);
+	vd_notify_unregister(vd);
 
 	if (vd->popup)
 		{
@@ -135,9 +177,8 @@ ViewDir *vd_new(DirViewType type, FileData *dir_fd)
 	g_signal_connect(G_OBJECT(vd->view), "button_release_event",
 			 G_CALLBACK(vd_release_cb), vd);
 
-	file_data_register_notify_func(vd_notify_cb, vd, NOTIFY_PRIORITY_HIGH);
+	vd_notify_register(vd);
 
-	/* vd_set_fd expects that vd_notify_cb is already registered */
 	if (dir_fd) vd_set_fd(vd, dir_fd);
 
 	gtk_widget_show(vd->view);
@@ -161,7 +202,7 @@ gboolean vd_set_fd(ViewDir *vd, FileData *dir_fd)
 {
 	gboolean ret = FALSE;
 
-	file_data_unregister_notify_func(vd_notify_cb, vd);
+	vd_notify_unregister(vd);
 
 	switch (vd->type)
 	{
@@ -169,7 +210,7 @@ gboolean vd_set_fd(ViewDir *vd, FileData *dir_fd)
 	case DIRVIEW_TREE: ret = vdtree_set_fd(vd, dir_fd); break;
 	}
 
-	file_data_register_notify_func(vd_notify_cb, vd, NOTIFY_PRIORITY_HIGH);
+	vd_notify_register(vd);
 
 	return ret;
 }
@@ -1090,7 +1131,6 @@ gboolean vd_press_cb(GtkWidget *widget, GdkEventButton *bevent, gpointer data)
 static void vd_notify_cb(FileData *fd, NotifyType type, gpointer data)
 {
 	ViewDir *vd = data;
-	gboolean refresh;
 	gchar *base;
 
 	if (!S_ISDIR(fd->mode)) return; /* this gives correct results even on recently deleted files/directories */
@@ -1099,33 +1139,10 @@ static void vd_notify_cb(FileData *fd, NotifyType type, gpointer data)
 
 	base = remove_level_from_path(fd->path);
 
+	/* the list is only notified about its folder and the files in it */
 	if (vd->type == DIRVIEW_LIST)
 		{
-		refresh = (fd == vd->dir_fd);
-
-		if (!refresh)
-			{
-			refresh = (strcmp(base, vd->dir_fd->path) == 0);
-			}
-
-		if ((type & NOTIFY_CHANGE) && fd->change)
-			{
-			if (!refresh && fd->change->dest)
-				{
-				gchar *dest_base = remove_level_from_path(fd->change->dest);
-				refresh = (strcmp(dest_base, vd->dir_fd->path) == 0);
-				g_free(dest_base);
-				}
-
-			if (!refresh && fd->change->source)
-				{
-				gchar *source_base = remove_level_from_path(fd->change->source);
-				refresh = (strcmp(source_base, vd->dir_fd->path) == 0);
-				g_free(source_base);
-				}
-			}
-
-		if (refresh) vd_refresh(vd);
+		vd_refresh(vd);
 		}
 
 	if (vd->type == DIRVIEW_TREE)
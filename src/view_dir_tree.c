@@ -896,10 +896,8 @@ static gint vdtree_sort_cb(GtkTreeModel *store, GtkTreeIter *a, GtkTreeIter *b,
 	if (!nda->fd) return 1;
 	if (!ndb->fd) return -1;
 
-	if (options->file_sort.case_sensitive)
-		return strcmp(nda->fd->collate_key_name, ndb->fd->collate_key_name);
-	else
-		return strcmp(nda->fd->collate_key_name_nocase, ndb->fd->collate_key_name_nocase);
+	return strcmp(file_data_get_collate_key(nda->fd, options->file_sort.case_sensitive),
+		      file_data_get_collate_key(ndb->fd, options->file_sort.case_sensitive));
 }
 
 /*
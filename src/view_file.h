@@ -67,7 +67,8 @@ void vf_mark_to_selection(ViewFile *vf, gint mark, MarkToSelectionMode mode);
 void vf_selection_to_mark(ViewFile *vf, gint mark, SelectionToMarkMode mode);
 
 void vf_refresh_idle_cancel(ViewFile *vf);
-void vf_notify_cb(FileData *fd, NotifyType type, gpointer data);
+void vf_notify_register(ViewFile *vf);
+void vf_notify_unregister(ViewFile *vf);
 
 void vf_thumb_update(ViewFile *vf);
 void vf_thumb_cleanup(ViewFile *vf);
@@ -27,6 +27,7 @@
 #include "editors.h"
 #include "layout.h"
 #include "menu.h"
+#include "startup_trace.h"
 #include "thumb.h"
 #include "ui_menu.h"
 #include "ui_fileops.h"
@@ -662,11 +663,18 @@ gboolean vf_refresh(ViewFile *vf)
 
 gboolean vf_set_fd(ViewFile *vf, FileData *dir_fd)
 {
+	gboolean ret = FALSE;
+
 	switch (vf->type)
 	{
-	case FILEVIEW_LIST: return vflist_set_fd(vf, dir_fd);
-	case FILEVIEW_ICON: return vficon_set_fd(vf, dir_fd);
+	case FILEVIEW_LIST: ret = vflist_set_fd(vf, dir_fd); break;
+	case FILEVIEW_ICON: ret = vficon_set_fd(vf, dir_fd); break;
 	}
+
+	/* the listener follows the folder */
+	vf_notify_register(vf);
+
+	return ret;
 }
 
 static void vf_destroy_cb(GtkWidget *widget, gpointer data)
@@ -875,6 +883,7 @@ static void vf_thumb_error_cb(ThumbLoader *tl, gpointer data)
 
 static void vf_thumb_done_cb(ThumbLoader *tl, gpointer data)
 {
+	startup_trace_end("thumbnail");
 	vf_thumb_common_cb(tl, data);
 }
 
@@ -912,6 +921,8 @@ static gboolean vf_thumb_next(ViewFile *vf)
 				   NULL,
 				   vf);
 
+	startup_trace_begin("thumbnail");
+
 	if (!thumb_loader_start(vf->thumbs_loader, fd))
 		{
 		/* set icon to unknown, continue */
@@ -1041,10 +1052,10 @@ void vf_refresh_idle(ViewFile *vf)
 		}
 }
 
-void vf_notify_cb(FileData *fd, NotifyType type, gpointer data)
+/* only called for the folder and the files in it, see vf_notify_register() */
+static void vf_notify_cb(FileData *fd, NotifyType type, gpointer data)
 {
 	ViewFile *vf = data;
-	gboolean refresh;
 
 	NotifyType interested = NOTIFY_CHANGE | NOTIFY_REREAD | NOTIFY_GROUPING;
 	if (vf->marks_enabled) interested |= NOTIFY_MARKS | NOTIFY_METADATA;
@@ -1052,37 +1063,40 @@ void vf_notify_cb(FileData *fd, NotifyType type, gpointer data)
 
 	if (!(type & interested) || vf->refresh_idle_id || !vf->dir_fd) return;
 
-	refresh = (fd == vf->dir_fd);
+	DEBUG_1("Notify vf: %s %04x", fd->path, type);
+	vf_refresh_idle(vf);
+}
 
-	if (!refresh)
-		{
-		gchar *base = remove_level_from_path(fd->path);
-		refresh = (g_strcmp0(base, vf->dir_fd->path) == 0);
-		g_free(base);
-		}
+/**
+ * \brief Listens to the notifications about vf->dir_fd and the files in it
+ *
+ * Replaces a previous registration, so it is called again when dir_fd changes.
+ */
+void vf_notify_register(ViewFile *vf)
+{
+	vf_notify_unregister(vf);
 
-	if ((type & NOTIFY_CHANGE) && fd->change)
-		{
-		if (!refresh && fd->change->dest)
-			{
-			gchar *dest_base = remove_level_from_path(fd->change->dest);
-			refresh = (g_strcmp0(dest_base, vf->dir_fd->path) == 0);
-			g_free(dest_base);
-			}
+	if (!vf->dir_fd) return;
 
-		if (!refresh && fd->change->source)
-			{
-			gchar *source_base = remove_level_from_path(fd->change->source);
-			refresh = (g_strcmp0(source_base, vf->dir_fd->path) == 0);
-			g_free(source_base);
-			}
-		}
+	/* the path is kept, dir_fd can be renamed meanwhile */
+	vf->notify_fd = file_data_ref(vf->dir_fd);
+	vf->notify_path = g_strdup(vf->dir_fd->path);
 
-	if (refresh)
-		{
-		DEBUG_1("Notify vf: %s %04x", fd->path, type);
-		vf_refresh_idle(vf);
-		}
+	file_data_register_notify_fd_func(vf->notify_fd, vf_notify_cb, vf);
+	file_data_register_notify_dir_func(vf->notify_path, vf_notify_cb, vf);
+}
+
+void vf_notify_unregister(ViewFile *vf)
+{
+	if (!vf->notify_fd) return;
+
+	file_data_unregister_notify_fd_func(vf->notify_fd, vf_notify_cb, vf);
+	file_data_unregister_notify_dir_func(vf->notify_path, vf_notify_cb, vf);
+
+	file_data_unref(vf->notify_fd);
+	vf->notify_fd = NULL;
+	g_free(vf->notify_path);
+	vf->notify_path = NULL;
 }
 
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -2069,7 +2069,7 @@ void vficon_destroy_cb(GtkWidget *widget, gpointer data)
 
 	vf_refresh_idle_cancel(vf);
 
-	file_data_unregister_notify_func(vf_notify_cb, vf);
+	vf_notify_unregister(vf);
 
 	tip_unschedule(vf);
 
@@ -2123,7 +2123,7 @@ ViewFile *vficon_new(ViewFile *vf, FileData *dir_fd)
 	/* force VFICON(vf)->columns to be at least 1 (sane) - this will be corrected in the size_cb */
 	vficon_populate_at_new_size(vf, 1, 1, FALSE);
 
-	file_data_register_notify_func(vf_notify_cb, vf, NOTIFY_PRIORITY_MEDIUM);
+	vf_notify_register(vf);
 
 	return vf;
 }
@@ -1532,7 +1532,7 @@ void vflist_selection_to_mark(ViewFile *vf, gint mark, SelectionToMarkMode mode)
 
 		/* the change has a very limited range and the standard notification would trigger
 		   complete re-read of the directory - try to do only minimal update instead */
-		file_data_unregister_notify_func(vf_notify_cb, vf); /* we don't need the notification */
+		vf_notify_unregister(vf); /* we don't need the notification */
 
 		switch (mode)
 			{
@@ -1557,7 +1557,7 @@ void vflist_selection_to_mark(ViewFile *vf, gint mark, SelectionToMarkMode mode)
 			}
 
 
-		file_data_register_notify_func(vf_notify_cb, vf, NOTIFY_PRIORITY_MEDIUM);
+		vf_notify_register(vf);
 
 		work = work->next;
 		}
@@ -1654,7 +1654,7 @@ gboolean vflist_refresh(ViewFile *vf)
 	DEBUG_1("%s vflist_refresh: read dir", get_exec_time());
 	if (vf->dir_fd)
 		{
-		file_data_unregister_notify_func(vf_notify_cb, vf); /* we don't need the notification of changes detected by filelist_read */
+		vf_notify_unregister(vf); /* we don't need the notification of changes detected by filelist_read */
 
 		ret = filelist_read(vf->dir_fd, &vf->list, NULL);
 
@@ -1672,7 +1672,7 @@ gboolean vflist_refresh(ViewFile *vf)
 			}
 
 		vf->list = file_data_filter_marks_list(vf->list, vf_marks_get_filter(vf));
-		file_data_register_notify_func(vf_notify_cb, vf, NOTIFY_PRIORITY_MEDIUM);
+		vf_notify_register(vf);
 
 		DEBUG_1("%s vflist_refresh: sort", get_exec_time());
 		vf->list = filelist_sort(vf->list, vf->sort_method, vf->sort_ascend);
@@ -1801,7 +1801,7 @@ static void vflist_listview_mark_toggled_cb(GtkCellRendererToggle *cell, gchar *
 
 	/* the change has a very limited range and the standard notification would trigger
 	   complete re-read of the directory - try to do only minimal update instead */
-	file_data_unregister_notify_func(vf_notify_cb, vf);
+	vf_notify_unregister(vf);
 	file_data_set_mark(fd, col_idx - FILE_COLUMN_MARKS, marked);
 	if (!file_data_filter_marks(fd, vf_marks_get_filter(vf))) /* file no longer matches the filter -> remove it */
 		{
@@ -1814,7 +1814,7 @@ static void vflist_listview_mark_toggled_cb(GtkCellRendererToggle *cell, gchar *
 		/* mark functions can change sidecars too */
 		vflist_setup_iter_recursive(vf, GTK_TREE_STORE(store), &iter, fd->sidecar_files, NULL, FALSE);
 		}
-	file_data_register_notify_func(vf_notify_cb, vf, NOTIFY_PRIORITY_MEDIUM);
+	vf_notify_register(vf);
 
 	gtk_tree_path_free(path);
 }
@@ -1869,7 +1869,7 @@ void vflist_destroy_cb(GtkWidget *widget, gpointer data)
 {
 	ViewFile *vf = data;
 
-	file_data_unregister_notify_func(vf_notify_cb, vf);
+	vf_notify_unregister(vf);
 
 	vflist_select_idle_cancel(vf);
 	vf_refresh_idle_cancel(vf);
@@ -1944,7 +1944,7 @@ ViewFile *vflist_new(ViewFile *vf, FileData *dir_fd)
 	g_assert(column == FILE_VIEW_COLUMN_DATE);
 	column++;
 
-	file_data_register_notify_func(vf_notify_cb, vf, NOTIFY_PRIORITY_MEDIUM);
+	vf_notify_register(vf);
 	return vf;
 }
 